@@ -0,0 +1,73 @@
+#include "BinaryDxf.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+const char BINARY_DXF_SENTINEL[] = "AutoCAD Binary DXF\r\n\x1a";
+
+const size_t BINARY_DXF_SENTINEL_SIZE = sizeof(BINARY_DXF_SENTINEL);  // Includes the terminating NUL
+
+
+
+
+
+BinaryValueType binaryValueType(int aGroupCode)
+{
+	if (
+		((aGroupCode >= 10) && (aGroupCode <= 59)) ||
+		((aGroupCode >= 110) && (aGroupCode <= 149)) ||
+		((aGroupCode >= 210) && (aGroupCode <= 239)) ||
+		((aGroupCode >= 460) && (aGroupCode <= 469)) ||
+		((aGroupCode >= 1010) && (aGroupCode <= 1059))
+	)
+	{
+		return bvtDouble;
+	}
+	if (
+		((aGroupCode >= 60) && (aGroupCode <= 79)) ||
+		((aGroupCode >= 170) && (aGroupCode <= 179)) ||
+		((aGroupCode >= 270) && (aGroupCode <= 289)) ||
+		((aGroupCode >= 370) && (aGroupCode <= 389)) ||
+		((aGroupCode >= 400) && (aGroupCode <= 409)) ||
+		((aGroupCode >= 1060) && (aGroupCode <= 1070))
+	)
+	{
+		return bvtInt16;
+	}
+	if (
+		((aGroupCode >= 90) && (aGroupCode <= 99)) ||
+		((aGroupCode >= 420) && (aGroupCode <= 429)) ||
+		((aGroupCode >= 440) && (aGroupCode <= 459)) ||
+		(aGroupCode == 1071)
+	)
+	{
+		return bvtInt32;
+	}
+	if ((aGroupCode >= 160) && (aGroupCode <= 169))
+	{
+		return bvtInt64;
+	}
+	if ((aGroupCode >= 290) && (aGroupCode <= 299))
+	{
+		return bvtBool;
+	}
+	if (((aGroupCode >= 310) && (aGroupCode <= 319)) || (aGroupCode == 1004))
+	{
+		return bvtBinaryChunk;
+	}
+	return bvtString;
+}
+
+
+
+
+
+}  // namespace Dxf
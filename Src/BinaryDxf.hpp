@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** The sentinel at the start of each binary DXF file, including the terminating NUL. */
+extern const char BINARY_DXF_SENTINEL[];
+
+/** The number of bytes in BINARY_DXF_SENTINEL, including the terminating NUL. */
+extern const size_t BINARY_DXF_SENTINEL_SIZE;
+
+
+
+
+
+/** The type of the value stored for a group code in binary DXF data. */
+enum BinaryValueType
+{
+	bvtString,       ///< NUL-terminated string
+	bvtDouble,       ///< 8-byte little-endian IEEE double
+	bvtInt16,        ///< 2-byte little-endian signed integer
+	bvtInt32,        ///< 4-byte little-endian signed integer
+	bvtInt64,        ///< 8-byte little-endian signed integer
+	bvtBool,         ///< Single byte, 0 or 1
+	bvtBinaryChunk,  ///< Single byte length, followed by that many bytes of data
+};
+
+
+
+
+
+/** Returns the type of the value that the specified group code has in binary DXF data. */
+BinaryValueType binaryValueType(int aGroupCode);
+
+
+
+
+
+}  // namespace Dxf
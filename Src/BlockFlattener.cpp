@@ -0,0 +1,451 @@
+// BlockFlattener.cpp
+
+// Implements the Dxf::BlockFlattener class that provides the cached flattened geometry for Block objects
+
+#include "BlockFlattener.hpp"
+#include <cmath>
+#include "Tessellation.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+namespace
+{
+
+/** The transformation applied to the objects of a block: first scale, then rotate around the origin, then move by the offset. */
+class Transform
+{
+	/** The scale applied to each axis. */
+	Coords mScale;
+
+	/** The rotation, in degrees. */
+	Coord mAngle;
+
+	/** Cached sine and cosine of mAngle. */
+	Coord mSin, mCos;
+
+	/** The offset added after scaling and rotating. */
+	Coords mOffset;
+
+
+public:
+
+	Transform(Coord aAngle, const Coords & aScale, const Coords & aOffset):
+		mScale(aScale),
+		mAngle(aAngle),
+		mOffset(aOffset)
+	{
+		// Use exact values for the right angles, so that the common orthogonal inserts don't accumulate rounding errors:
+		auto quadrant = std::fmod(aAngle, 360.0);
+		if (quadrant < 0)
+		{
+			quadrant += 360;
+		}
+		if (quadrant == 0)        { mSin =  0; mCos =  1; }
+		else if (quadrant == 90)  { mSin =  1; mCos =  0; }
+		else if (quadrant == 180) { mSin =  0; mCos = -1; }
+		else if (quadrant == 270) { mSin = -1; mCos =  0; }
+		else
+		{
+			auto rad = aAngle * PI / 180;
+			mSin = std::sin(rad);
+			mCos = std::cos(rad);
+		}
+	}
+
+
+	/** Returns a transform that only moves by the specified offset. */
+	static Transform offset(const Coords & aOffset)
+	{
+		return Transform(0, {1, 1, 1}, aOffset);
+	}
+
+
+	/** Returns the transformed point. */
+	Coords apply(const Coords & aPt) const
+	{
+		auto x = aPt.mX * mScale.mX;
+		auto y = aPt.mY * mScale.mY;
+		return {
+			x * mCos - y * mSin + mOffset.mX,
+			x * mSin + y * mCos + mOffset.mY,
+			aPt.mZ * mScale.mZ + mOffset.mZ
+		};
+	}
+
+
+	/** Returns true if the transformation mirrors the objects (changes the orientation from CCW to CW). */
+	bool isMirrored() const
+	{
+		return ((mScale.mX < 0) != (mScale.mY < 0));
+	}
+
+
+	/** Returns true if the specified object, transformed, can still be represented by an object of its own type.
+	Circles and arcs need the same scale on both axes, axis-aligned ellipses need a rotation by a multiple of 90 degrees. */
+	bool canTransformInPlace(const Primitive & aObject) const
+	{
+		switch (aObject.mObjectType)
+		{
+			case otCircle:
+			case otArc:
+			{
+				return (std::abs(mScale.mX) == std::abs(mScale.mY));
+			}
+			case otSimpleEllipse:
+			{
+				return ((mSin == 0) || (mCos == 0));
+			}
+			default:
+			{
+				return true;
+			}
+		}
+	}
+
+
+	/** Returns a transformed copy of the specified object.
+	The curves that cannot be transformed in-place (see canTransformInPlace()) are tessellated in the block's coords,
+	with the default TessellationOptions adjusted for the scale, and returned as a Polyline of the transformed points. */
+	PrimitivePtr transformed(const Primitive & aObject) const
+	{
+		if (canTransformInPlace(aObject))
+		{
+			auto res = clonePrimitive(aObject);
+			applyTo(*res);
+			return res;
+		}
+
+		// Tessellate, so that the chords stay within the tolerance after scaling:
+		TessellationOptions options;
+		auto maxScale = std::max(std::abs(mScale.mX), std::abs(mScale.mY));
+		if (maxScale > 0)
+		{
+			options.mChordTolerance /= maxScale;
+		}
+		std::vector<Coord> coords(3 * numTessellatedPoints(aObject, options));
+		tessellate(aObject, options, coords.data());
+
+		auto res = std::make_shared<Polyline>(aObject.mColor, aObject.mWidth);
+		res->mPos = apply(aObject.mPos);
+		res->mAttribs = aObject.mAttribs;
+		res->mHandle = aObject.mHandle;
+		res->mOwnerHandle = aObject.mOwnerHandle;
+		if (aObject.mExtendedData != nullptr)
+		{
+			res->mExtendedData = std::make_unique<RawGroups>(*aObject.mExtendedData);
+		}
+		auto numPoints = coords.size() / 3;
+		if (aObject.mObjectType != otArc)
+		{
+			// Closed curve, the closing point repeats the first one:
+			res->mFlags = plfClosedPolyline;
+			numPoints -= 1;
+		}
+		res->mVertices.reserve(numPoints);
+		for (size_t i = 0; i < numPoints; ++i)
+		{
+			res->addVertex(apply({coords[3 * i], coords[3 * i + 1], coords[3 * i + 2]}));
+		}
+		return res;
+	}
+
+
+	/** Transforms the specified object in-place.
+	The curves that cannot be transformed in-place are only approximated, see transformed(). */
+	void applyTo(Primitive & aObject) const
+	{
+		aObject.mPos = apply(aObject.mPos);
+		switch (aObject.mObjectType)
+		{
+			case otLine:
+			{
+				auto & line = static_cast<Line &>(aObject);
+				line.mPos2 = apply(line.mPos2);
+				break;
+			}
+			case otPolyline:
+			case otLWPolyline:
+			case otPolygon:
+			{
+				auto & multiVertex = static_cast<MultiVertex &>(aObject);
+				auto shouldNegateBulge = isMirrored();
+				for (auto & v: multiVertex.mVertices)
+				{
+					v.mPos = apply(v.mPos);
+					if (shouldNegateBulge)
+					{
+						v.mBulge = -v.mBulge;
+					}
+				}
+				break;
+			}
+			case otSolid:
+			{
+				auto & solid = static_cast<Solid &>(aObject);
+				solid.mPos2 = apply(solid.mPos2);
+				solid.mPos3 = apply(solid.mPos3);
+				solid.mPos4 = apply(solid.mPos4);
+				break;
+			}
+			case otCircle:
+			{
+				// Non-uniform scaling is handled by transformed()
+				static_cast<Circle &>(aObject).mRadius *= std::abs(mScale.mX);
+				break;
+			}
+			case otSimpleEllipse:
+			{
+				// Rotations other than multiples of 90 degrees are handled by transformed()
+				auto & ellipse = static_cast<AxisAligned2DEllipse &>(aObject);
+				ellipse.mDiameterX *= std::abs(mScale.mX);
+				ellipse.mDiameterY *= std::abs(mScale.mY);
+				if (mSin * mSin > mCos * mCos)
+				{
+					std::swap(ellipse.mDiameterX, ellipse.mDiameterY);
+				}
+				break;
+			}
+			case otArc:
+			{
+				// Non-uniform scaling is handled by transformed()
+				auto & arc = static_cast<Arc &>(aObject);
+				arc.mRadius *= std::abs(mScale.mX);
+				auto startAngle = arc.mStartAngle;
+				auto endAngle = arc.mEndAngle;
+				if ((mScale.mX < 0) && (mScale.mY < 0))
+				{
+					startAngle += 180;
+					endAngle += 180;
+				}
+				else if (mScale.mX < 0)
+				{
+					// Mirrored along the Y axis, the arc runs in the opposite direction:
+					startAngle = 180 - arc.mEndAngle;
+					endAngle = 180 - arc.mStartAngle;
+				}
+				else if (mScale.mY < 0)
+				{
+					// Mirrored along the X axis, the arc runs in the opposite direction:
+					startAngle = -arc.mEndAngle;
+					endAngle = -arc.mStartAngle;
+				}
+				arc.mStartAngle = startAngle + mAngle;
+				arc.mEndAngle = endAngle + mAngle;
+				break;
+			}
+			case otText:
+			{
+				auto & text = static_cast<Text &>(aObject);
+				text.mAngle += mAngle;
+				text.mSize *= std::abs(mScale.mY);
+				break;
+			}
+			case otBlock:
+			{
+				auto & block = static_cast<Block &>(aObject);
+				block.mAngle += mAngle;
+				block.mScale = {block.mScale.mX * mScale.mX, block.mScale.mY * mScale.mY, block.mScale.mZ * mScale.mZ};
+				break;
+			}
+			case otVertex:
+			{
+				if (isMirrored())
+				{
+					auto & vertex = static_cast<Vertex &>(aObject);
+					vertex.mBulge = -vertex.mBulge;
+				}
+				break;
+			}
+			case otError:
+			case otHatch:
+			case otPoint:
+			{
+				// Only the mPos is transformed, which has already been done
+				break;
+			}
+		}
+	}
+};
+
+}  // anonymous namespace
+
+
+
+
+
+FlattenedBlockPtr BlockFlattener::flatten(const Block & aBlock)
+{
+	if (aBlock.mDefinition == nullptr)
+	{
+		return std::make_shared<FlattenedBlock>();
+	}
+	return flatten(aBlock.mDefinition, aBlock.mAngle, aBlock.mScale);
+}
+
+
+
+
+
+FlattenedBlockPtr BlockFlattener::flatten(const std::shared_ptr<BlockDefinition> & aDefinition, Coord aAngle, const Coords & aScale)
+{
+	assert(aDefinition != nullptr);
+
+	std::vector<const BlockDefinition *> definitionStack;
+	return flattenInternal(aDefinition, aAngle, aScale, definitionStack);
+}
+
+
+
+
+
+PrimitivePtrs BlockFlattener::worldObjects(const Block & aBlock)
+{
+	auto flattened = flatten(aBlock);
+	auto transform = Transform::offset(aBlock.mPos);
+	PrimitivePtrs res;
+	res.reserve(flattened->mObjects.size());
+	for (const auto & obj: flattened->mObjects)
+	{
+		auto copy = clonePrimitive(*obj);
+		transform.applyTo(*copy);
+		if (copy->mColor == COLOR_BYBLOCK)
+		{
+			copy->mColor = aBlock.mColor;
+		}
+		res.push_back(std::move(copy));
+	}
+	return res;
+}
+
+
+
+
+
+void BlockFlattener::invalidate(const BlockDefinition & aDefinition)
+{
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	for (auto itr = mCache.begin(); itr != mCache.end();)
+	{
+		if (std::get<0>(itr->first) == &aDefinition)
+		{
+			itr = mCache.erase(itr);
+		}
+		else
+		{
+			++itr;
+		}
+	}
+}
+
+
+
+
+
+void BlockFlattener::clear()
+{
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	mCache.clear();
+}
+
+
+
+
+
+size_t BlockFlattener::cacheSize() const
+{
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	return mCache.size();
+}
+
+
+
+
+
+FlattenedBlockPtr BlockFlattener::flattenInternal(
+	const std::shared_ptr<BlockDefinition> & aDefinition,
+	Coord aAngle,
+	const Coords & aScale,
+	std::vector<const BlockDefinition *> & aDefinitionStack
+)
+{
+	// Try the cache first:
+	Key key(aDefinition.get(), aAngle, aScale.mX, aScale.mY, aScale.mZ);
+	{
+		std::lock_guard<std::mutex> lock(mMtxCache);
+		auto itr = mCache.find(key);
+		if (itr != mCache.end())
+		{
+			return itr->second.mFlattened;
+		}
+	}
+
+	// Check for recursion:
+	if (std::find(aDefinitionStack.begin(), aDefinitionStack.end(), aDefinition.get()) != aDefinitionStack.end())
+	{
+		throw RecursiveBlockDefinition(aDefinition->mName);
+	}
+	aDefinitionStack.push_back(aDefinition.get());
+
+	// Flatten, without holding the lock:
+	auto res = std::make_shared<FlattenedBlock>();
+	Transform transform(aAngle, aScale, {0, 0, 0});
+	for (const auto & obj: aDefinition->mObjects)
+	{
+		if (obj->mObjectType != otBlock)
+		{
+			auto copy = transform.transformed(*obj);
+			res->mExtent.expandTo(copy->extent());
+			res->mObjects.push_back(std::move(copy));
+			continue;
+		}
+
+		// Expand the nested block:
+		const auto & nested = static_cast<const Block &>(*obj);
+		if (nested.mDefinition == nullptr)
+		{
+			continue;
+		}
+		auto nestedFlattened = flattenInternal(nested.mDefinition, nested.mAngle, nested.mScale, aDefinitionStack);
+		auto nestedOffset = Transform::offset(nested.mPos);
+		for (const auto & nestedObj: nestedFlattened->mObjects)
+		{
+			auto copy = clonePrimitive(*nestedObj);
+			nestedOffset.applyTo(*copy);
+			if (transform.canTransformInPlace(*copy))
+			{
+				transform.applyTo(*copy);
+			}
+			else
+			{
+				copy = transform.transformed(*copy);
+			}
+			if (copy->mColor == COLOR_BYBLOCK)
+			{
+				copy->mColor = nested.mColor;
+			}
+			res->mExtent.expandTo(copy->extent());
+			res->mObjects.push_back(std::move(copy));
+		}
+	}
+	aDefinitionStack.pop_back();
+
+	// Store in the cache; if another thread has stored the same geometry meanwhile, use that one instead:
+	std::lock_guard<std::mutex> lock(mMtxCache);
+	auto itr = mCache.emplace(key, CacheEntry{aDefinition, std::move(res)}).first;
+	return itr->second.mFlattened;
+}
+
+
+
+
+
+}  // namespace Dxf
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include "DxfDrawing.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** The geometry of a single BlockDefinition, transformed by an insert's angle and scale, with all nested blocks expanded.
+The coords are relative to the insertion point; add the Block's mPos to get the world coords.
+Instances are shared between all the Block objects using the same definition, angle and scale, so they must not be modified. */
+class FlattenedBlock
+{
+public:
+
+	/** The transformed objects.
+	Contains no Block objects, all nested blocks are expanded into their transformed objects.
+	The curves whose transformed shape has no object type of its own are replaced by a tessellated Polyline
+	(closed for Circles and AxisAligned2DEllipses), with the default TessellationOptions' chord tolerance:
+	Circles and Arcs scaled differently along X and Y, and AxisAligned2DEllipses rotated by other than a multiple of 90 degrees.
+	Texts are scaled by the Y scale only. */
+	PrimitivePtrs mObjects;
+
+	/** The extent of all the objects in mObjects (relative to the insertion point). */
+	Extent mExtent;
+};
+
+using FlattenedBlockPtr = std::shared_ptr<const FlattenedBlock>;
+
+
+
+
+
+/** Provides the flattened geometry for Block objects.
+The flattening is done lazily, upon the first request for each combination of BlockDefinition, angle and scale,
+and the result is cached, so that all the inserts of the same symbol at the same angle and scale share the same FlattenedBlock.
+All public functions are thread-safe. */
+class BlockFlattener
+{
+public:
+
+	/** Exception thrown when a BlockDefinition (indirectly) contains a Block of itself. */
+	using RecursiveBlockDefinition = std::runtime_error;
+
+
+	/** Creates a new instance with an empty cache. */
+	BlockFlattener() = default;
+
+	// Disable copy- and move-constructors, the mutex is not copyable:
+	BlockFlattener(const BlockFlattener & aOther) = delete;
+	BlockFlattener(BlockFlattener && aOther) = delete;
+
+	/** Returns the flattened geometry of the specified block instance, relative to its insertion point.
+	If the block has no definition, returns an empty FlattenedBlock.
+	Throws a RecursiveBlockDefinition exception if the definition (indirectly) contains itself. */
+	FlattenedBlockPtr flatten(const Block & aBlock);
+
+	/** Returns the flattened geometry of the specified definition, scaled and then rotated by the specified angle (in degrees).
+	Throws a RecursiveBlockDefinition exception if the definition (indirectly) contains itself. */
+	FlattenedBlockPtr flatten(const std::shared_ptr<BlockDefinition> & aDefinition, Coord aAngle, const Coords & aScale);
+
+	/** Returns new copies of the flattened objects of the specified block instance, moved to the world coords.
+	Useful for exporters that need standalone objects; renderers should prefer flatten() and offset by the Block's mPos. */
+	PrimitivePtrs worldObjects(const Block & aBlock);
+
+	/** Removes all the cached geometry of the specified definition.
+	Call this after modifying a BlockDefinition's objects.
+	Note that the definitions containing aDefinition as a nested block are not removed, use clear() for those. */
+	void invalidate(const BlockDefinition & aDefinition);
+
+	/** Removes all the cached geometry. */
+	void clear();
+
+	/** Returns the number of the currently cached FlattenedBlock instances. */
+	size_t cacheSize() const;
+
+
+protected:
+
+	/** The cache key: the definition, angle and the three scale coords. */
+	using Key = std::tuple<const BlockDefinition *, Coord, Coord, Coord, Coord>;
+
+	/** A single cached flattened geometry. */
+	struct CacheEntry
+	{
+		/** The definition from which mFlattened was created.
+		Keeps the definition alive so that its address, used in the Key, cannot be reused while cached. */
+		std::shared_ptr<BlockDefinition> mDefinition;
+
+		/** The flattened geometry. */
+		FlattenedBlockPtr mFlattened;
+	};
+
+
+	/** Protects mCache against multithreaded access. */
+	mutable std::mutex mMtxCache;
+
+	/** The cached flattened geometry. */
+	std::map<Key, CacheEntry> mCache;
+
+
+	/** Returns the (cached) flattened geometry of the specified definition.
+	aDefinitionStack contains the definitions currently being flattened, used to detect recursive definitions.
+	The flattening itself is done without holding the cache lock, so that nested blocks may use the cache, too;
+	if two threads flatten the same geometry concurrently, the first one stored wins and is returned to both. */
+	FlattenedBlockPtr flattenInternal(
+		const std::shared_ptr<BlockDefinition> & aDefinition,
+		Coord aAngle,
+		const Coords & aScale,
+		std::vector<const BlockDefinition *> & aDefinitionStack
+	);
+};
+
+
+
+
+
+}  // namespace Dxf
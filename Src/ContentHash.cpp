@@ -0,0 +1,158 @@
+// ContentHash.cpp
+
+// Implements the ContentHasher class for hashing the input data
+
+#include "ContentHash.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+
+
+
+namespace
+{
+
+/** Multipliers used for mixing the words, taken from the xxHash64 algorithm. */
+const uint64_t PRIME1 = 0x9e3779b185ebca87ULL;
+const uint64_t PRIME2 = 0xc2b2ae3d27d4eb4fULL;
+const uint64_t PRIME3 = 0x165667b19e3779f9ULL;
+
+
+
+
+
+inline uint64_t rotateLeft(uint64_t aValue, int aNumBits)
+{
+	return (aValue << aNumBits) | (aValue >> (64 - aNumBits));
+}
+
+}  // anonymous namespace
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// ContentHasher:
+
+ContentHasher::ContentHasher():
+	mState(PRIME3),
+	mTotalSize(0),
+	mTailSize(0)
+{
+}
+
+
+
+
+
+void ContentHasher::update(const char * aData, size_t aSize)
+{
+	mTotalSize += aSize;
+
+	// Complete the word started in the previous call:
+	if (mTailSize > 0)
+	{
+		auto numToCopy = std::min(aSize, sizeof(mTail) - mTailSize);
+		std::memcpy(mTail + mTailSize, aData, numToCopy);
+		mTailSize += numToCopy;
+		aData += numToCopy;
+		aSize -= numToCopy;
+		if (mTailSize < sizeof(mTail))
+		{
+			return;
+		}
+		uint64_t word;
+		std::memcpy(&word, mTail, sizeof(word));
+		processWord(word);
+		mTailSize = 0;
+	}
+
+	// Process all complete words:
+	while (aSize >= sizeof(uint64_t))
+	{
+		uint64_t word;
+		std::memcpy(&word, aData, sizeof(word));
+		processWord(word);
+		aData += sizeof(word);
+		aSize -= sizeof(word);
+	}
+
+	// Store the rest for later:
+	std::memcpy(mTail, aData, aSize);
+	mTailSize = aSize;
+}
+
+
+
+
+
+uint64_t ContentHasher::digest() const
+{
+	// Mix in the incomplete tail word and the total size, so that trailing zero bytes change the hash:
+	auto state = mState;
+	uint64_t tail = 0;
+	std::memcpy(&tail, mTail, mTailSize);
+	state = rotateLeft(state ^ (tail * PRIME2), 27) * PRIME1;
+	state ^= mTotalSize;
+
+	// Final avalanche (from MurmurHash3's fmix64):
+	state ^= state >> 33;
+	state *= 0xff51afd7ed558ccdULL;
+	state ^= state >> 33;
+	state *= 0xc4ceb9fe1a85ec53ULL;
+	state ^= state >> 33;
+	return state;
+}
+
+
+
+
+
+void ContentHasher::processWord(uint64_t aWord)
+{
+	aWord = rotateLeft(aWord * PRIME2, 31) * PRIME1;
+	mState = rotateLeft(mState ^ aWord, 27) * PRIME1 + PRIME3;
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Globals:
+
+uint64_t contentHash(const char * aData, size_t aSize)
+{
+	ContentHasher hasher;
+	hasher.update(aData, aSize);
+	return hasher.digest();
+}
+
+
+
+
+
+Parser::DataSource Parser::hashingDataSource(DataSource && aDataSource, ContentHasher & aHasher)
+{
+	return [dataSource = std::move(aDataSource), &aHasher](char * aDestBuffer, size_t aSize)
+	{
+		auto numRead = dataSource(aDestBuffer, aSize);
+		aHasher.update(aDestBuffer, numRead);
+		return numRead;
+	};
+}
+
+
+
+
+
+}  // namespace Dxf
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include "DataSource.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** Incrementally computes a fast non-cryptographic 64-bit hash of a stream of bytes.
+The result doesn't depend on how the data is split into the individual update() calls.
+Meant for detecting changed input files, not for protection against deliberate collisions.
+The data is processed as native-endian 8-byte words, so the hash values are only comparable between machines of the same byte order. */
+class ContentHasher
+{
+public:
+
+	/** Creates a new instance, representing the hash of empty data. */
+	ContentHasher();
+
+	/** Adds the specified data to the hashed stream. */
+	void update(const char * aData, size_t aSize);
+
+	/** Returns the hash of all the data added so far.
+	Doesn't modify the state, more data can be added afterwards. */
+	uint64_t digest() const;
+
+	/** Returns the total number of bytes added so far. */
+	uint64_t totalSize() const { return mTotalSize; }
+
+
+protected:
+
+	/** The hash state of all the complete words processed so far. */
+	uint64_t mState;
+
+	/** The total number of bytes added so far. */
+	uint64_t mTotalSize;
+
+	/** The bytes of the last incomplete word, waiting for more data. */
+	char mTail[8];
+
+	/** The number of valid bytes in mTail. */
+	size_t mTailSize;
+
+
+	/** Mixes the specified complete word into mState. */
+	void processWord(uint64_t aWord);
+};
+
+
+
+
+
+/** Returns the ContentHasher hash of the specified data. */
+uint64_t contentHash(const char * aData, size_t aSize);
+
+
+
+
+
+namespace Parser
+{
+
+/** Returns a DataSource that reads from aDataSource and adds all the data read to aHasher.
+Once the parser has consumed the entire input, aHasher contains the hash of the entire input,
+without reading the data twice.
+The hasher must stay alive as long as the returned DataSource is used. */
+DataSource hashingDataSource(DataSource && aDataSource, ContentHasher & aHasher);
+
+}  // namespace Parser
+
+
+
+
+
+}  // namespace Dxf
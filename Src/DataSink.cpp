@@ -0,0 +1,41 @@
+#include "DataSink.hpp"
+
+#include <ostream>
+
+
+
+
+
+namespace Dxf::Writer
+{
+
+
+
+
+
+DataSink dataSinkFromStdStream(std::ostream & aStream)
+{
+	aStream.exceptions(std::ostream::failbit | std::ostream::badbit);
+	return [&aStream](const char * aData, size_t aSize)
+	{
+		aStream.write(aData, static_cast<std::streamsize>(aSize));
+	};
+}
+
+
+
+
+
+DataSink dataSinkToString(std::string & aOutput)
+{
+	return [&aOutput](const char * aData, size_t aSize)
+	{
+		aOutput.append(aData, aSize);
+	};
+}
+
+
+
+
+
+}  // namespace Dxf::Writer
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <string>
+
+
+
+
+
+namespace Dxf::Writer
+{
+
+
+
+
+
+/** The data sink, the output counterpart of Dxf::Parser::DataSource.
+This is a function that consumes the aSize bytes of data pointed to by aData.
+The writing functions call this repeatedly, with large blocks of data, to sequentially output the entire data.
+The function should report hard errors by throwing exceptions. */
+using DataSink = std::function<void (const char * /* aData */, size_t /* aSize */)>;
+
+
+
+
+
+/** Convenience helper that adapts std::ostream into DataSink. */
+DataSink dataSinkFromStdStream(std::ostream & aStream);
+
+/** Convenience helper that makes a DataSink that appends all the data to the specified string. */
+DataSink dataSinkToString(std::string & aOutput);
+
+
+
+
+
+}  // namespace Dxf::Writer
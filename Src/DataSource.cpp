@@ -1,7 +1,10 @@
 #include "DataSource.hpp"
 
-#include <istream>
+#include <cstdio>
 #include <cstring>
+#include <istream>
+#include <memory>
+#include <stdexcept>
 
 
 
@@ -54,6 +57,35 @@ DataSource dataSourceFromString(std::string && aInput)
 
 
 
+DataSource dataSourceFromFile(const std::string & aFileName)
+{
+	std::shared_ptr<FILE> f(std::fopen(aFileName.c_str(), "rb"), [](FILE * aFile)
+		{
+			if (aFile != nullptr)
+			{
+				std::fclose(aFile);
+			}
+		}
+	);
+	if (f == nullptr)
+	{
+		throw std::runtime_error("Cannot open file " + aFileName);
+	}
+	return [f, aFileName](char * aDestBuffer, size_t aSize)
+	{
+		auto numRead = std::fread(aDestBuffer, 1, aSize, f.get());
+		if ((numRead == 0) && std::ferror(f.get()))
+		{
+			throw std::runtime_error("Cannot read file " + aFileName);
+		}
+		return numRead;
+	};
+}
+
+
+
+
+
 DataSource dataSourceFromStdStream(std::istream & aStream)
 {
 	aStream.exceptions(std::istream::failbit | std::istream::badbit);
@@ -29,6 +29,10 @@ using DataSource = std::function<size_t (char * /* aDestBuffer */, size_t /* aSi
 /** Convenience helper that adapts std::istream into DataSource. */
 DataSource dataSourceFromStdStream(std::istream & aStream);
 
+/** Convenience helper that makes a DataSource reading the specified file.
+Throws a std::runtime_error if the file cannot be opened; the DataSource throws a std::runtime_error on read errors. */
+DataSource dataSourceFromFile(const std::string & aFileName);
+
 /** Convenience helper that makes a DataSource that feed in the specified input string. */
 DataSource dataSourceFromString(std::string && aInput);
 
@@ -1,6 +1,8 @@
 #include "DxfDrawing.hpp"
 
+#include <charconv>
 #include <cmath>
+#include <limits>
 
 
 /*
@@ -749,9 +751,11 @@ extern void DXF_DrawColorComboItem(HWND iCombo, LPDRAWITEMSTRUCT dis)
 
 Primitive::Primitive(ObjectType aObjectType):
 	mObjectType(aObjectType),
-	mPos({0, 0}),
 	mColor(COLOR_BYLAYER),
-	mWidth(0)
+	mPos({0, 0}),
+	mWidth(0),
+	mHandle(0),
+	mOwnerHandle(0)
 {
 }
 
@@ -761,9 +765,27 @@ Primitive::Primitive(ObjectType aObjectType):
 
 Primitive::Primitive(ObjectType aObjectType, Coords && aPos, Color aColor, Coord aWidth):
 	mObjectType(aObjectType),
-	mPos(std::move(aPos)),
 	mColor(aColor),
-	mWidth(aWidth)
+	mPos(std::move(aPos)),
+	mWidth(aWidth),
+	mHandle(0),
+	mOwnerHandle(0)
+{
+}
+
+
+
+
+
+Primitive::Primitive(const Primitive & aOther):
+	mObjectType(aOther.mObjectType),
+	mColor(aOther.mColor),
+	mPos(aOther.mPos),
+	mWidth(aOther.mWidth),
+	mAttribs(aOther.mAttribs),
+	mHandle(aOther.mHandle),
+	mOwnerHandle(aOther.mOwnerHandle),
+	mExtendedData((aOther.mExtendedData == nullptr) ? nullptr : std::make_unique<RawGroups>(*aOther.mExtendedData))
 {
 }
 
@@ -771,6 +793,27 @@ Primitive::Primitive(ObjectType aObjectType, Coords && aPos, Color aColor, Coord
 
 
 
+Primitive & Primitive::operator = (const Primitive & aOther)
+{
+	if (this == &aOther)
+	{
+		return *this;
+	}
+	mObjectType = aOther.mObjectType;
+	mColor = aOther.mColor;
+	mPos = aOther.mPos;
+	mWidth = aOther.mWidth;
+	mAttribs = aOther.mAttribs;
+	mHandle = aOther.mHandle;
+	mOwnerHandle = aOther.mOwnerHandle;
+	mExtendedData = (aOther.mExtendedData == nullptr) ? nullptr : std::make_unique<RawGroups>(*aOther.mExtendedData);
+	return *this;
+}
+
+
+
+
+
 Extent Primitive::extent() const
 {
 	return {mPos, mPos};
@@ -780,6 +823,157 @@ Extent Primitive::extent() const
 
 
 
+namespace
+{
+	/** Parses the specified XDATA value as a number of type T into aDst.
+	Leaves aDst unchanged if the value is not a valid number. */
+	template <typename T>
+	void parseExtendedNumber(std::string_view aValue, T & aDst)
+	{
+		while (!aValue.empty() && (aValue.front() == ' '))
+		{
+			aValue.remove_prefix(1);
+		}
+		while (!aValue.empty() && (aValue.back() == ' '))
+		{
+			aValue.remove_suffix(1);
+		}
+		T value;
+		auto res = std::from_chars(aValue.data(), aValue.data() + aValue.size(), value);
+		if ((res.ec == std::errc()) && (res.ptr == aValue.data() + aValue.size()))
+		{
+			aDst = value;
+		}
+	}
+
+
+
+
+
+	/** Decodes the hex representation of binary data used by DXF.
+	Returns an empty string if the value is not valid hex data. */
+	std::string decodeHex(std::string_view aValue)
+	{
+		auto digitValue = [](char aDigit)
+		{
+			if ((aDigit >= '0') && (aDigit <= '9')) return aDigit - '0';
+			if ((aDigit >= 'a') && (aDigit <= 'f')) return aDigit - 'a' + 10;
+			if ((aDigit >= 'A') && (aDigit <= 'F')) return aDigit - 'A' + 10;
+			return -1;
+		};
+		if (aValue.size() % 2 != 0)
+		{
+			return {};
+		}
+		std::string res(aValue.size() / 2, '\0');
+		for (size_t i = 0; i < res.size(); ++i)
+		{
+			auto hi = digitValue(aValue[2 * i]);
+			auto lo = digitValue(aValue[2 * i + 1]);
+			if ((hi < 0) || (lo < 0))
+			{
+				return {};
+			}
+			res[i] = static_cast<char>((hi << 4) | lo);
+		}
+		return res;
+	}
+}  // anonymous namespace
+
+
+
+
+
+std::vector<ExtendedData> Primitive::extendedData() const
+{
+	std::vector<ExtendedData> res;
+	if (mExtendedData == nullptr)
+	{
+		return res;
+	}
+	for (size_t i = 0, count = mExtendedData->size(); i < count; ++i)
+	{
+		auto groupCode = mExtendedData->groupCode(i);
+		auto value = mExtendedData->value(i);
+		if ((groupCode == 1001) || res.empty())
+		{
+			res.emplace_back();
+		}
+		auto & dst = res.back();
+		switch (groupCode)
+		{
+			case 1000: dst.mString.assign(value); break;
+			case 1001: dst.mApplicationName.assign(value); break;
+			case 1002: dst.mControlString = true; break;
+			case 1003: dst.mLayerName.assign(value); break;
+			case 1004: dst.mBinaryData = decodeHex(value); break;
+			case 1005:
+			{
+				uint64_t handle;
+				auto parsed = std::from_chars(value.data(), value.data() + value.size(), handle, 16);
+				if ((parsed.ec == std::errc()) && (parsed.ptr == value.data() + value.size()))
+				{
+					dst.mDatabaseHandle = handle;
+				}
+				break;
+			}
+			case 1010: parseExtendedNumber(value, dst.mPos.mX); break;
+			case 1020: parseExtendedNumber(value, dst.mPos.mY); break;
+			case 1030: parseExtendedNumber(value, dst.mPos.mZ); break;
+			case 1011: parseExtendedNumber(value, dst.mWorldSpacePosition.mX); break;
+			case 1021: parseExtendedNumber(value, dst.mWorldSpacePosition.mY); break;
+			case 1031: parseExtendedNumber(value, dst.mWorldSpacePosition.mZ); break;
+			case 1012: parseExtendedNumber(value, dst.mWorldSpaceDisplacement.mX); break;
+			case 1022: parseExtendedNumber(value, dst.mWorldSpaceDisplacement.mY); break;
+			case 1032: parseExtendedNumber(value, dst.mWorldSpaceDisplacement.mZ); break;
+			case 1013: parseExtendedNumber(value, dst.mWorldDirection.mX); break;
+			case 1023: parseExtendedNumber(value, dst.mWorldDirection.mY); break;
+			case 1033: parseExtendedNumber(value, dst.mWorldDirection.mZ); break;
+			case 1040: parseExtendedNumber(value, dst.mReal); break;
+			case 1041: parseExtendedNumber(value, dst.mDistance); break;
+			case 1042: parseExtendedNumber(value, dst.mScaleFactor); break;
+			case 1070: parseExtendedNumber(value, dst.mInteger); break;
+			case 1071: parseExtendedNumber(value, dst.mLong); break;
+			default: break;
+		}
+	}
+	return res;
+}
+
+
+
+
+
+PrimitivePtr clonePrimitive(const Primitive & aPrimitive)
+{
+	switch (aPrimitive.mObjectType)
+	{
+		case otLine:          return std::make_shared<Line>(static_cast<const Line &>(aPrimitive));
+		case otPolyline:      return std::make_shared<Polyline>(static_cast<const Polyline &>(aPrimitive));
+		case otLWPolyline:    return std::make_shared<LWPolyline>(static_cast<const LWPolyline &>(aPrimitive));
+		case otPolygon:       return std::make_shared<Polygon>(static_cast<const Polygon &>(aPrimitive));
+		case otSolid:         return std::make_shared<Solid>(static_cast<const Solid &>(aPrimitive));
+		case otCircle:        return std::make_shared<Circle>(static_cast<const Circle &>(aPrimitive));
+		case otSimpleEllipse: return std::make_shared<AxisAligned2DEllipse>(static_cast<const AxisAligned2DEllipse &>(aPrimitive));
+		case otArc:           return std::make_shared<Arc>(static_cast<const Arc &>(aPrimitive));
+		case otText:          return std::make_shared<Text>(static_cast<const Text &>(aPrimitive));
+		case otBlock:         return std::make_shared<Block>(static_cast<const Block &>(aPrimitive));
+		case otVertex:        return std::make_shared<Vertex>(static_cast<const Vertex &>(aPrimitive));
+		case otPoint:         return std::make_shared<Point>(static_cast<const Point &>(aPrimitive));
+		case otError:
+		case otHatch:
+		{
+			// No specific class for these, copy just the base
+			break;
+		}
+	}
+	return std::make_shared<Primitive>(aPrimitive);
+}
+
+
+
+
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Attrib:
 
@@ -804,7 +998,7 @@ ExtendedData::ExtendedData():
 	mLayerName(),
 	mBinaryData(),
 	mDatabaseHandle(0),
-	mPos(0, 0),
+	mPos(0, 0, 0),
 	mWorldSpacePosition(0, 0, 0),
 	mWorldSpaceDisplacement(0, 0, 0),
 	mWorldDirection(0, 0, 0),
@@ -989,14 +1183,50 @@ void MultiVertex::removeDuplicateVertices()
 	{
 		return;
 	}
-	std::vector<Vertex> newVertices;
-	for (size_t idx = mVertices.size() - 1; idx > 0; --idx)
+	// Single pass, moving the kept vertices to the front:
+	size_t numKept = 1;
+	for (size_t idx = 1, count = mVertices.size(); idx < count; ++idx)
 	{
-		if (mVertices[idx - 1].mPos == mVertices[idx].mPos)
+		if (mVertices[numKept - 1].mPos == mVertices[idx].mPos)
+		{
+			continue;
+		}
+		if (numKept != idx)
 		{
-			mVertices.erase(mVertices.begin() + idx);
+			mVertices[numKept] = std::move(mVertices[idx]);
 		}
+		numKept += 1;
+	}
+	mVertices.erase(mVertices.begin() + static_cast<std::ptrdiff_t>(numKept), mVertices.end());
+}
+
+
+
+
+
+bool MultiVertex::isClosed() const
+{
+	switch (mObjectType)
+	{
+		case otPolygon:    return true;
+		case otPolyline:   return ((static_cast<const Polyline *>(this)->mFlags & plfClosedPolyline) != 0);
+		case otLWPolyline: return ((static_cast<const LWPolyline *>(this)->mFlags & plfClosedPolyline) != 0);
+		default:           return false;
+	}
+}
+
+
+
+
+
+bool MultiVertex::isSimplePath() const
+{
+	if (mObjectType != otPolyline)
+	{
+		return true;
 	}
+	static const int SPECIAL_FLAGS = plfCurveFitVertices | plfSplineFitVertices | plf3DPolygonMesh | plfPolyfaceMesh;
+	return ((static_cast<const Polyline *>(this)->mFlags & SPECIAL_FLAGS) == 0);
 }
 
 
@@ -1005,7 +1235,7 @@ void MultiVertex::removeDuplicateVertices()
 
 Extent MultiVertex::extent() const
 {
-	Extent res(mVertices[0].mPos);
+	Extent res;
 	for (const auto & v: mVertices)
 	{
 		res.expandTo(v.mPos);
@@ -1131,10 +1361,264 @@ Extent Arc::extent() const
 
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// RawGroups:
+
+void RawGroups::add(int aGroupCode, std::string_view aValue)
+{
+	if (mValues.size() + aValue.size() > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::length_error("RawGroups: Too much data");
+	}
+	mValues.append(aValue.data(), aValue.size());
+	mValueEnds.push_back(static_cast<uint32_t>(mValues.size()));
+	mGroupCodes.push_back(static_cast<int16_t>(aGroupCode));
+}
+
+
+
+
+
+void RawGroups::clear()
+{
+	mValues.clear();
+	mValueEnds.clear();
+	mGroupCodes.clear();
+}
+
+
+
+
+
+size_t RawGroups::memoryUsage() const
+{
+	return mValues.capacity() + mValueEnds.capacity() * sizeof(uint32_t) + mGroupCodes.capacity() * sizeof(int16_t);
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// StringPool:
+
+SharedString StringPool::intern(std::string_view aStr)
+{
+	auto itr = mStrings.find(aStr);
+	if (itr != mStrings.end())
+	{
+		return itr->second;
+	}
+	return intern(std::string(aStr));
+}
+
+
+
+
+
+SharedString StringPool::intern(std::string && aStr)
+{
+	auto itr = mStrings.find(aStr);
+	if (itr != mStrings.end())
+	{
+		return itr->second;
+	}
+
+	// The key is a view of the shared storage, which doesn't move even when the map rehashes:
+	SharedString res(std::move(aStr));
+	mStrings.emplace(std::string_view(res.str()), res);
+	return res;
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// MemoryUsage:
+
+namespace
+{
+	/** The estimated size of a shared_ptr control block, when created by std::make_shared (vtable + two counters). */
+	static const size_t CONTROL_BLOCK_SIZE = sizeof(void *) + 2 * sizeof(int);
+
+	/** The estimated bookkeeping size of a single std::map node (three pointers and the color). */
+	static const size_t MAP_NODE_OVERHEAD = 4 * sizeof(void *);
+
+	/** Returns the heap storage used by the specified string. */
+	size_t stringHeapSize(const std::string & aString)
+	{
+		// The capacity of an empty string is the size of the inline (short string optimization) buffer:
+		static const size_t inlineCapacity = std::string().capacity();
+		return (aString.capacity() > inlineCapacity) ? aString.capacity() + 1 : 0;
+	}
+
+	/** Returns the share of the memory used by the specified SharedString's storage attributable to a single holder,
+	so that summing over all the holders gives the total. */
+	size_t sharedStringSize(const SharedString & aString)
+	{
+		auto useCount = aString.useCount();
+		if (useCount <= 0)
+		{
+			return 0;
+		}
+		return (CONTROL_BLOCK_SIZE + sizeof(std::string) + stringHeapSize(aString.str())) / static_cast<size_t>(useCount);
+	}
+
+	/** Returns the size of the class of the objects of the specified type. */
+	size_t primitiveSize(ObjectType aObjectType)
+	{
+		switch (aObjectType)
+		{
+			case otLine:          return sizeof(Line);
+			case otPolyline:      return sizeof(Polyline);
+			case otLWPolyline:    return sizeof(LWPolyline);
+			case otPolygon:       return sizeof(Polygon);
+			case otSolid:         return sizeof(Solid);
+			case otCircle:        return sizeof(Circle);
+			case otSimpleEllipse: return sizeof(AxisAligned2DEllipse);
+			case otArc:           return sizeof(Arc);
+			case otText:          return sizeof(Text);
+			case otBlock:         return sizeof(Block);
+			case otVertex:        return sizeof(Vertex);
+			case otPoint:         return sizeof(Point);
+			case otError:
+			case otHatch:
+			{
+				break;
+			}
+		}
+		return sizeof(Primitive);
+	}
+}
+
+
+
+
+
+size_t MemoryUsage::total() const
+{
+	return mObjects + mVertices + mStrings + mAttribs + mExtendedData + mSmartPointers + mOther;
+}
+
+
+
+
+
+MemoryUsage & MemoryUsage::operator += (const MemoryUsage & aOther)
+{
+	for (const auto & ot: aOther.mObjectTypes)
+	{
+		auto & dst = mObjectTypes[ot.first];
+		dst.mCount += ot.second.mCount;
+		dst.mBytes += ot.second.mBytes;
+	}
+	mObjects += aOther.mObjects;
+	mVertices += aOther.mVertices;
+	mStrings += aOther.mStrings;
+	mAttribs += aOther.mAttribs;
+	mExtendedData += aOther.mExtendedData;
+	mSmartPointers += aOther.mSmartPointers;
+	mOther += aOther.mOther;
+	return *this;
+}
+
+
+
+
+
+void MemoryUsage::addPrimitive(const Primitive & aPrimitive)
+{
+	auto size = primitiveSize(aPrimitive.mObjectType);
+	auto & typeUsage = mObjectTypes[aPrimitive.mObjectType];
+	typeUsage.mCount += 1;
+	typeUsage.mBytes += size;
+	mObjects += size;
+	mSmartPointers += CONTROL_BLOCK_SIZE;
+
+	auto addAttribs = [this](const std::vector<Attrib> & aAttribs)
+	{
+		mAttribs += aAttribs.capacity() * sizeof(Attrib);
+		for (const auto & attr: aAttribs)
+		{
+			mStrings += stringHeapSize(attr.mName) + stringHeapSize(attr.mValue);
+		}
+	};
+	addAttribs(aPrimitive.mAttribs);
+	if (aPrimitive.mExtendedData != nullptr)
+	{
+		mExtendedData += sizeof(RawGroups) + aPrimitive.mExtendedData->memoryUsage();
+	}
+
+	switch (aPrimitive.mObjectType)
+	{
+		case otPolyline:
+		case otLWPolyline:
+		case otPolygon:
+		{
+			const auto & vertices = static_cast<const MultiVertex &>(aPrimitive).mVertices;
+			mVertices += vertices.capacity() * sizeof(Vertex);
+			for (const auto & v: vertices)
+			{
+				addAttribs(v.mAttribs);
+				if (v.mExtendedData != nullptr)
+				{
+					mExtendedData += sizeof(RawGroups) + v.mExtendedData->memoryUsage();
+				}
+			}
+			break;
+		}
+		case otText:
+		{
+			mStrings += sharedStringSize(static_cast<const Text &>(aPrimitive).mRawText);
+			break;
+		}
+		default:
+		{
+			// No additional dynamic data
+			break;
+		}
+	}
+}
+
+
+
+
+
+void MemoryUsage::addObjects(ObjectType aObjectType, size_t aCount)
+{
+	auto size = aCount * primitiveSize(aObjectType);
+	auto & typeUsage = mObjectTypes[aObjectType];
+	typeUsage.mCount += aCount;
+	typeUsage.mBytes += size;
+	mObjects += size;
+	mSmartPointers += aCount * CONTROL_BLOCK_SIZE;
+}
+
+
+
+
+
+size_t StringPool::memoryUsage() const
+{
+	// Each node holds the key, the value, the next pointer and the cached hash; plus the bucket array:
+	size_t res = mStrings.bucket_count() * sizeof(void *);
+	for (const auto & str: mStrings)
+	{
+		res += sizeof(str) + 2 * sizeof(void *) + sharedStringSize(str.second);
+	}
+	return res;
+}
+
+
+
+
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Layer:
 
 Layer::Layer(Drawing & aParentDrawing, const std::string & aName):
+	mNumRemoved(0),
 	mParentDrawing(aParentDrawing),
 	mDefaultColor(COLOR_BYLAYER),  // dummy, forces black color
 	mName(aName)
@@ -1147,7 +1631,17 @@ Layer::Layer(Drawing & aParentDrawing, const std::string & aName):
 
 void Layer::clear()
 {
+	for (size_t i = 0, count = mObjects.size(); i < count; ++i)
+	{
+		if (mObjects[i] != nullptr)
+		{
+			unindexHandle(*mObjects[i]);
+			freeSlot(mObjectSlots[i]);
+		}
+	}
 	mObjects.clear();
+	mObjectSlots.clear();
+	mNumRemoved = 0;
 	mExtent = Extent();
 }
 
@@ -1160,7 +1654,10 @@ void Layer::updateExtent()
 	Extent extent;
 	for (const auto & obj: mObjects)
 	{
-		extent.expandTo(obj->extent());
+		if (obj != nullptr)
+		{
+			extent.expandTo(obj->extent());
+		}
 	}
 	mExtent = extent;
 }
@@ -1171,8 +1668,20 @@ void Layer::updateExtent()
 
 PrimitivePtr Layer::removeObjByIndex(size_t aIndex)
 {
-	auto res = mObjects[aIndex];
-	mObjects.erase(mObjects.begin() + aIndex);
+	compact();
+	if (aIndex >= mObjects.size())
+	{
+		return nullptr;
+	}
+	auto res = std::move(mObjects[aIndex]);
+	unindexHandle(*res);
+	freeSlot(mObjectSlots[aIndex]);
+	mObjects.erase(mObjects.begin() + static_cast<ptrdiff_t>(aIndex));
+	mObjectSlots.erase(mObjectSlots.begin() + static_cast<ptrdiff_t>(aIndex));
+	for (size_t i = aIndex, count = mObjectSlots.size(); i < count; ++i)
+	{
+		mSlots[mObjectSlots[i]].mObjectIndex = static_cast<uint32_t>(i);
+	}
 	return res;
 }
 
@@ -1182,26 +1691,225 @@ PrimitivePtr Layer::removeObjByIndex(size_t aIndex)
 
 void Layer::removeObj(Primitive * aObject)
 {
-	auto cmp = [aObject](const PrimitivePtr aStoredObj){ return (aStoredObj.get() == aObject); };
-	mObjects.erase(std::remove_if(mObjects.begin(), mObjects.end(), cmp), mObjects.end());
+	if (aObject == nullptr)
+	{
+		return;  // Would match the tombstones
+	}
+	for (size_t i = 0, count = mObjects.size(); i < count; ++i)
+	{
+		if (mObjects[i].get() == aObject)
+		{
+			removeObjById({mObjectSlots[i], mSlots[mObjectSlots[i]].mGeneration});
+		}
+	}
+}
+
+
+
+
+
+PrimitivePtr Layer::removeObjById(EntityId aId)
+{
+	auto res = objectById(aId);
+	if (res == nullptr)
+	{
+		return nullptr;
+	}
+	unindexHandle(*res);
+	mObjects[mSlots[aId.mSlot].mObjectIndex] = nullptr;
+	mNumRemoved += 1;
+	freeSlot(aId.mSlot);
+	return res;
 }
 
 
 
 
 
-void Layer::addObject(PrimitivePtr && aObject)
+PrimitivePtr Layer::removeObjByStableIndex(size_t aIndex)
 {
+	return removeObjById(objectId(aIndex));
+}
+
+
+
+
+
+EntityId Layer::addObject(PrimitivePtr && aObject)
+{
+	if (mObjects.size() >= NO_OBJECT)
+	{
+		throw std::length_error("Layer: Too many objects");
+	}
+	uint32_t slot;
+	if (mFreeSlots.empty())
+	{
+		slot = static_cast<uint32_t>(mSlots.size());
+		mSlots.push_back({NO_OBJECT, 1});
+	}
+	else
+	{
+		slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+	}
+	mSlots[slot].mObjectIndex = static_cast<uint32_t>(mObjects.size());
+	EntityId id(slot, mSlots[slot].mGeneration);
+	indexHandle(aObject, id);
 	mObjects.push_back(std::move(aObject));
+	mObjectSlots.push_back(slot);
+	return id;
+}
+
+
+
+
+
+EntityId Layer::addObject(const PrimitivePtr & aObject)
+{
+	return addObject(PrimitivePtr(aObject));
+}
+
+
+
+
+
+PrimitivePtr Layer::objectById(EntityId aId) const
+{
+	if (
+		(aId.mSlot >= mSlots.size()) ||
+		(mSlots[aId.mSlot].mGeneration != aId.mGeneration) ||
+		(mSlots[aId.mSlot].mObjectIndex == NO_OBJECT)
+	)
+	{
+		return nullptr;
+	}
+	return mObjects[mSlots[aId.mSlot].mObjectIndex];
+}
+
+
+
+
+
+EntityId Layer::objectId(size_t aIndex) const
+{
+	if ((aIndex >= mObjects.size()) || (mObjects[aIndex] == nullptr))
+	{
+		return EntityId();
+	}
+	auto slot = mObjectSlots[aIndex];
+	return {slot, mSlots[slot].mGeneration};
+}
+
+
+
+
+
+void Layer::forEachObject(const std::function<void (const PrimitivePtr &)> & aCallback) const
+{
+	for (const auto & obj: mObjects)
+	{
+		if (obj != nullptr)
+		{
+			aCallback(obj);
+		}
+	}
 }
 
 
 
 
 
-void Layer::addObject(const PrimitivePtr & aObject)
+void Layer::compact()
 {
-	mObjects.push_back(aObject);
+	if (mNumRemoved == 0)
+	{
+		return;
+	}
+	size_t dst = 0;
+	for (size_t src = 0, count = mObjects.size(); src < count; ++src)
+	{
+		if (mObjects[src] == nullptr)
+		{
+			continue;
+		}
+		if (dst != src)
+		{
+			mObjects[dst] = std::move(mObjects[src]);
+			mObjectSlots[dst] = mObjectSlots[src];
+			mSlots[mObjectSlots[dst]].mObjectIndex = static_cast<uint32_t>(dst);
+		}
+		dst += 1;
+	}
+	mObjects.resize(dst);
+	mObjectSlots.resize(dst);
+	mNumRemoved = 0;
+}
+
+
+
+
+
+void Layer::freeSlot(uint32_t aSlot)
+{
+	auto & slot = mSlots[aSlot];
+	slot.mObjectIndex = NO_OBJECT;
+	slot.mGeneration += 1;
+	if (slot.mGeneration == 0)
+	{
+		// Skip the generation reserved for invalid identifiers:
+		slot.mGeneration = 1;
+	}
+	mFreeSlots.push_back(aSlot);
+}
+
+
+
+
+
+void Layer::indexHandle(const PrimitivePtr & aObject, EntityId aId)
+{
+	if (aObject->mHandle != 0)
+	{
+		mParentDrawing.mHandleIndex[aObject->mHandle] = {aObject, this, aId};
+	}
+}
+
+
+
+
+
+void Layer::unindexHandle(const Primitive & aObject)
+{
+	if (aObject.mHandle == 0)
+	{
+		return;
+	}
+	auto itr = mParentDrawing.mHandleIndex.find(aObject.mHandle);
+	if ((itr != mParentDrawing.mHandleIndex.end()) && (itr->second.mObject.get() == &aObject))
+	{
+		mParentDrawing.mHandleIndex.erase(itr);
+	}
+}
+
+
+
+
+
+MemoryUsage Layer::memoryUsage() const
+{
+	MemoryUsage res;
+	res.mOther += sizeof(Layer);
+	res.mStrings += stringHeapSize(mName);
+	res.mSmartPointers += mObjects.capacity() * sizeof(PrimitivePtr);
+	res.mOther += mObjectSlots.capacity() * sizeof(uint32_t) + mSlots.capacity() * sizeof(Slot) + mFreeSlots.capacity() * sizeof(uint32_t);
+	for (const auto & obj: mObjects)
+	{
+		if (obj != nullptr)
+		{
+			res.addPrimitive(*obj);
+		}
+	}
+	return res;
 }
 
 
@@ -1215,6 +1923,11 @@ void Drawing::clear()
 {
 	mLayers.clear();
 	mBlockDefinitions.clear();
+	mStringPool.clear();
+	mRawEntities.clear();
+	mRawEntityPositions.clear();
+	mRawSections.clear();
+	mHandleIndex.clear();
 }
 
 
@@ -1241,7 +1954,7 @@ std::shared_ptr<Layer> Drawing::addLayer(const std::string & aName)
 
 
 
-std::shared_ptr<Layer> Drawing::layerByName(const std::string & aName) const
+std::shared_ptr<Layer> Drawing::layerByName(std::string_view aName) const
 {
 	for (const auto & lay: mLayers)
 	{
@@ -1275,4 +1988,106 @@ void Drawing::addBlockDefinition(std::string && aName, std::shared_ptr<BlockDefi
 
 
 
+const Drawing::HandleEntry * Drawing::findByHandle(uint64_t aHandle) const
+{
+	auto itr = mHandleIndex.find(aHandle);
+	if (itr == mHandleIndex.end())
+	{
+		return nullptr;
+	}
+	return &itr->second;
+}
+
+
+
+
+
+PrimitivePtr Drawing::removeByHandle(uint64_t aHandle)
+{
+	auto itr = mHandleIndex.find(aHandle);
+	if (itr == mHandleIndex.end())
+	{
+		return nullptr;
+	}
+	return itr->second.mLayer->removeObjById(itr->second.mId);
+}
+
+
+
+
+
+void Drawing::compact()
+{
+	for (const auto & lay: mLayers)
+	{
+		lay->compact();
+	}
+}
+
+
+
+
+
+void Drawing::rebuildHandleIndex()
+{
+	mHandleIndex.clear();
+	for (const auto & lay: mLayers)
+	{
+		lay->compact();
+		const auto & objects = lay->objects();
+		for (size_t i = 0, count = objects.size(); i < count; ++i)
+		{
+			if (objects[i]->mHandle != 0)
+			{
+				mHandleIndex[objects[i]->mHandle] = {objects[i], lay.get(), lay->objectId(i)};
+			}
+		}
+	}
+}
+
+
+
+
+
+MemoryUsage Drawing::memoryUsage() const
+{
+	MemoryUsage res;
+	res.mOther += sizeof(Drawing);
+
+	// Layers:
+	res.mSmartPointers += mLayers.capacity() * sizeof(std::shared_ptr<Layer>) + mLayers.size() * CONTROL_BLOCK_SIZE;
+	for (const auto & layer: mLayers)
+	{
+		res += layer->memoryUsage();
+	}
+
+	res.mStrings += mStringPool.memoryUsage();
+	res.mOther += mRawEntities.memoryUsage();
+	res.mOther += mRawEntityPositions.capacity() * sizeof(RawEntityPosition);
+	for (const auto & rs: mRawSections)
+	{
+		res.mOther += MAP_NODE_OVERHEAD + sizeof(rs) + stringHeapSize(rs.first) + rs.second.memoryUsage();
+	}
+
+	// The handle index, each node holds the key, the value and the next pointer; plus the bucket array:
+	res.mOther += mHandleIndex.bucket_count() * sizeof(void *) + mHandleIndex.size() * (sizeof(std::pair<const uint64_t, HandleEntry>) + sizeof(void *));
+
+	// Block definitions:
+	for (const auto & bd: mBlockDefinitions)
+	{
+		res.mOther += MAP_NODE_OVERHEAD + sizeof(bd) + sizeof(BlockDefinition);
+		res.mSmartPointers += CONTROL_BLOCK_SIZE + bd.second->mObjects.capacity() * sizeof(PrimitivePtr);
+		res.mStrings += stringHeapSize(bd.first) + stringHeapSize(bd.second->mName);
+		for (const auto & obj: bd.second->mObjects)
+		{
+			res.addPrimitive(*obj);
+		}
+	}
+	return res;
+}
+
+
+
+
+
 }  // namespace Dxf
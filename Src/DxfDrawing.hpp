@@ -1,13 +1,16 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <memory>
 #include <cstdint>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <algorithm>
 #include <stdexcept>
 #include <cassert>
+#include <functional>
 
 
 
@@ -44,6 +47,9 @@ static const Coord WIDTH_DEFAULT = 1;
 /** The default Z coord, if not given to a constructor. */
 static const Coord Z_DEFAULT = 0;
 
+/** The value of pi, for the angle conversions (M_PI is not standard C++). */
+static constexpr Coord PI = 3.14159265358979323846;
+
 
 
 
@@ -300,6 +306,146 @@ public:
 
 
 
+/** An immutable string that shares its storage with all its copies.
+Used for the strings that repeat a lot within a drawing, such as texts; see StringPool. */
+class SharedString
+{
+	/** The shared storage, nullptr for an empty string. */
+	std::shared_ptr<const std::string> mStr;
+
+
+public:
+
+	/** Creates an empty string. */
+	SharedString() = default;
+
+	/** Creates a new string with its own storage, holding a copy of aStr. */
+	SharedString(const std::string & aStr):
+		mStr(std::make_shared<const std::string>(aStr))
+	{
+	}
+
+	/** Creates a new string with its own storage, holding aStr. */
+	SharedString(std::string && aStr):
+		mStr(std::make_shared<const std::string>(std::move(aStr)))
+	{
+	}
+
+	/** Creates a new string with its own storage, holding a copy of aStr. */
+	SharedString(const char * aStr):
+		mStr(std::make_shared<const std::string>(aStr))
+	{
+	}
+
+	/** Returns the string value. */
+	const std::string & str() const
+	{
+		static const std::string empty;
+		return (mStr == nullptr) ? empty : *mStr;
+	}
+
+	operator const std::string & () const { return str(); }
+
+	size_t length() const { return str().length(); }
+	bool empty() const { return str().empty(); }
+	const char * c_str() const { return str().c_str(); }
+
+	/** Returns the number of SharedString instances sharing this string's storage (zero for an unset empty string). */
+	long useCount() const { return mStr.use_count(); }
+
+	/** Returns true if the two strings share the same storage. */
+	bool sharesStorageWith(const SharedString & aOther) const { return (mStr == aOther.mStr); }
+
+	bool operator == (const SharedString & aOther) const { return (mStr == aOther.mStr) || (str() == aOther.str()); }
+	bool operator == (const std::string & aOther) const { return (str() == aOther); }
+	bool operator == (const char * aOther) const { return (str() == aOther); }
+	bool operator != (const SharedString & aOther) const { return !(*this == aOther); }
+};
+
+
+
+
+
+/** Stores a single shared copy of each distinct string, so that equal strings share one immutable storage.
+Each Drawing has its own pool, used by the parser for the texts. */
+class StringPool
+{
+	/** The interned strings, keyed by the view of their own (stable) storage. */
+	std::unordered_map<std::string_view, SharedString> mStrings;
+
+
+public:
+
+	/** Returns the shared string equal to aStr, adding it to the pool if not present yet.
+	Doesn't allocate anything if the string is already in the pool. */
+	SharedString intern(std::string_view aStr);
+
+	/** Returns the shared string equal to aStr, adding it to the pool (by moving aStr) if not present yet. */
+	SharedString intern(std::string && aStr);
+
+	/** Returns the shared string equal to aStr, adding it to the pool if not present yet. */
+	SharedString intern(const char * aStr) { return intern(std::string_view(aStr)); }
+
+	/** Returns the number of distinct strings in the pool. */
+	size_t size() const { return mStrings.size(); }
+
+	/** Removes all the strings from the pool. The strings already given out stay valid. */
+	void clear() { mStrings.clear(); }
+
+	/** Returns the estimate of the memory used by the pool itself, including its share of the strings' storage. */
+	size_t memoryUsage() const;
+};
+
+
+
+
+
+/** A compact sequence of raw DXF groups (group code and value), preserved without interpreting them,
+such as the entities and sections not supported by the parser.
+All the values are stored in a single contiguous buffer with an array of their end offsets, instead of a string per group. */
+class RawGroups
+{
+	/** All the values, concatenated. */
+	std::string mValues;
+
+	/** The end offset of each value within mValues (the start is the previous value's end). */
+	std::vector<uint32_t> mValueEnds;
+
+	/** The group code of each value. */
+	std::vector<int16_t> mGroupCodes;
+
+
+public:
+
+	/** Appends a single group.
+	Throws a std::length_error if the total size of the values would exceed 4 GiB. */
+	void add(int aGroupCode, std::string_view aValue);
+
+	/** Returns the number of groups stored. */
+	size_t size() const { return mGroupCodes.size(); }
+
+	bool empty() const { return mGroupCodes.empty(); }
+
+	int groupCode(size_t aIndex) const { return mGroupCodes[aIndex]; }
+
+	/** Returns the value of the specified group. The view is valid until the next modification. */
+	std::string_view value(size_t aIndex) const
+	{
+		auto start = (aIndex == 0) ? 0 : mValueEnds[aIndex - 1];
+		return std::string_view(mValues.data() + start, mValueEnds[aIndex] - start);
+	}
+
+	/** Removes all the groups. */
+	void clear();
+
+	/** Returns the memory used by the stored groups, in bytes. */
+	size_t memoryUsage() const;
+};
+
+
+
+
+
 class Attrib
 {
 public:
@@ -314,24 +460,27 @@ public:
 
 
 
+/** The extended entity data (XDATA) of a single application, decoded from the raw groups, see Primitive::extendedData().
+Each field holds the value of the corresponding XDATA group; if a group repeats, the last value is kept
+(iterate over Primitive::mExtendedData for all the values). Values that fail to parse are left at their defaults. */
 class ExtendedData
 {
 public:
-	std::string mString;
-	std::string mApplicationName;
-	bool mControlString;
-	std::string mLayerName;
-	std::string mBinaryData;
-	int mDatabaseHandle;
-	Coords mPos;
-	Coords mWorldSpacePosition;
-	Coords mWorldSpaceDisplacement;
-	Coords mWorldDirection;
-	Coord mReal;
-	Coord mDistance;
-	Coord mScaleFactor;
-	unsigned short int mInteger;
-	int mLong;
+	std::string mString;              ///< 1000
+	std::string mApplicationName;     ///< 1001
+	bool mControlString;              ///< 1002, set if the data contains any control string ("{" or "}")
+	std::string mLayerName;           ///< 1003
+	std::string mBinaryData;          ///< 1004, decoded from the hex representation
+	uint64_t mDatabaseHandle;         ///< 1005
+	Coords mPos;                      ///< 1010, 1020, 1030
+	Coords mWorldSpacePosition;       ///< 1011, 1021, 1031
+	Coords mWorldSpaceDisplacement;   ///< 1012, 1022, 1032
+	Coords mWorldDirection;           ///< 1013, 1023, 1033
+	Coord mReal;                      ///< 1040
+	Coord mDistance;                  ///< 1041
+	Coord mScaleFactor;               ///< 1042
+	int16_t mInteger;                 ///< 1070
+	int32_t mLong;                    ///< 1071
 
 	ExtendedData();
 };
@@ -345,11 +494,22 @@ class Primitive
 {
 public:
 	ObjectType mObjectType;
-	Coords mPos;
 	Color mColor;
+	Coords mPos;
 	Coord mWidth;
 	std::vector<Attrib> mAttribs;
-	// std::unique_ptr<ExtendedData> mExtended;
+
+	/** The entity handle (DXF group 5), 0 if the entity has no handle.
+	Entities in layers are indexed by their handles in the parent Drawing, see Drawing::findByHandle().
+	If the handle is changed after adding the entity to a layer, Drawing::rebuildHandleIndex() needs to be called. */
+	uint64_t mHandle;
+
+	/** The handle of the owner object (DXF group 330), 0 if not known. */
+	uint64_t mOwnerHandle;
+
+	/** The raw extended entity data (XDATA, group codes 1000 - 1071), as read from the DXF data, in the text representation.
+	Allocated only for the entities that have XDATA, nullptr otherwise. Decoded on demand by extendedData(). */
+	std::unique_ptr<RawGroups> mExtendedData;
 
 	/** Creates a new empty instance of the specified type.
 	Used mainly by the parser. */
@@ -358,12 +518,27 @@ public:
 	/** Creates a new instance of the specified type and the specified coords and color. */
 	Primitive(ObjectType aObjectType, Coords && aPos, Color aColor = COLOR_BYLAYER, Coord aWidth = WIDTH_DEFAULT);
 
+	/** Creates a copy of the specified instance, including a copy of its extended data.
+	Note that the copy has the same handle as the original. */
+	Primitive(const Primitive & aOther);
+
+	Primitive(Primitive && aOther) = default;
+
 	/** Deletes the instance. */
 	virtual ~Primitive() {}
 
+	Primitive & operator = (const Primitive & aOther);
+
+	Primitive & operator = (Primitive && aOther) = default;
+
 	/** Returns the axis-aligned bounding box of this primitive.
 	Descendants are expected to provide real implementations returning the true extent of the object. */
 	virtual Extent extent() const;
+
+	/** Decodes the raw extended entity data, one ExtendedData per application (each starting with its group 1001).
+	Groups before the first application name are decoded into an ExtendedData with an empty mApplicationName.
+	Returns an empty vector if the primitive has no extended data. */
+	std::vector<ExtendedData> extendedData() const;
 };
 
 using PrimitivePtr = std::shared_ptr<Primitive>;
@@ -388,13 +563,15 @@ public:
 	/** Creates a new empty instance.
 	Used mainly by the parser. */
 	Vertex():
-		Super(otVertex)
+		Super(otVertex),
+		mBulge(0)
 	{
 	}
 
 	/** Creates a new instance at the specified coords. */
 	explicit Vertex(Coords && aPos):
-		Super(otVertex, std::move(aPos))
+		Super(otVertex, std::move(aPos)),
+		mBulge(0)
 	{
 	}
 };
@@ -545,8 +722,9 @@ class Text:
 public:
 
 	/** The raw text stored in the DXF.
-	May contain formatting instructions. */
-	std::string mRawText;
+	May contain formatting instructions.
+	Shared with the other texts of the same value, when interned through the Drawing's StringPool. */
+	SharedString mRawText;
 
 	/** The angle of the text, in degrees. */
 	Coord mAngle;
@@ -658,6 +836,13 @@ public:
 	/** Removes any vertices that have the same coords as their direct predecessor. */
 	void removeDuplicateVertices();
 
+	/** Returns true if the last vertex connects back to the first one (closed Polyline / LWPolyline, or a Polygon). */
+	bool isClosed() const;
+
+	/** Returns true if the vertices form a simple path that can be processed as a sequence of segments.
+	Mesh and curve- / spline-fit Polylines have vertices with special meaning, those are not simple paths. */
+	bool isSimplePath() const;
+
 	// Primitive overrides:
 	virtual Extent extent() const override;
 };
@@ -823,14 +1008,145 @@ public:
 
 
 
+/** An estimate of the memory used by a Layer or a Drawing, broken down by category.
+All values are in bytes. They are estimates, the exact numbers depend on the standard library and the heap allocator. */
+class MemoryUsage
+{
+public:
+
+	/** The memory used by the objects of a single ObjectType. */
+	class ObjectTypeUsage
+	{
+	public:
+		/** The number of the objects. */
+		size_t mCount = 0;
+
+		/** The size of the objects themselves (the class sizes). */
+		size_t mBytes = 0;
+	};
+
+
+	/** The objects, per their type. */
+	std::map<ObjectType, ObjectTypeUsage> mObjectTypes;
+
+	/** The size of all the objects themselves (the sum of mObjectTypes' mBytes). */
+	size_t mObjects = 0;
+
+	/** The heap storage of the vertices within the MultiVertex objects. */
+	size_t mVertices = 0;
+
+	/** The heap storage of the strings (texts, layer and block names, attribs).
+	Short strings stored inline within the string object don't use any heap storage. */
+	size_t mStrings = 0;
+
+	/** The heap storage of the Attrib vectors (the strings within are counted in mStrings). */
+	size_t mAttribs = 0;
+
+	/** The extended entity data (XDATA) of the objects. */
+	size_t mExtendedData = 0;
+
+	/** The shared_ptr overhead: the control blocks and the pointer storage in the object containers. */
+	size_t mSmartPointers = 0;
+
+	/** Everything else: the Layer, BlockDefinition and Drawing objects and the containers' bookkeeping. */
+	size_t mOther = 0;
+
+
+	/** Returns the total of all the categories. */
+	size_t total() const;
+
+	/** Adds the usage from the other instance into this one. */
+	MemoryUsage & operator += (const MemoryUsage & aOther);
+
+	/** Adds the memory used by the specified primitive (and its vertices, strings and attribs). */
+	void addPrimitive(const Primitive & aPrimitive);
+
+	/** Adds the memory used by aCount objects of the specified type, without any vertices, strings or attribs.
+	Used for estimating the memory usage before the objects are created. */
+	void addObjects(ObjectType aObjectType, size_t aCount);
+};
+
+
+
+
+
+/** A stable identifier of an object within a Layer, returned by Layer::addObject().
+Stays valid until the object is removed from the layer, regardless of the other objects being added or removed.
+The identifiers of removed objects are never reused (the slot's generation changes). */
+class EntityId
+{
+public:
+	/** The index of the slot in the layer's slot map. */
+	uint32_t mSlot;
+
+	/** The generation of the slot, 0 for an invalid identifier. */
+	uint32_t mGeneration;
+
+
+	/** Creates an invalid identifier. */
+	EntityId():
+		mSlot(0),
+		mGeneration(0)
+	{
+	}
+
+	EntityId(uint32_t aSlot, uint32_t aGeneration):
+		mSlot(aSlot),
+		mGeneration(aGeneration)
+	{
+	}
+
+	/** Returns true if the identifier was assigned by a layer (it may still refer to an already removed object). */
+	bool isValid() const { return (mGeneration != 0); }
+
+	bool operator == (const EntityId & aOther) const { return (mSlot == aOther.mSlot) && (mGeneration == aOther.mGeneration); }
+	bool operator != (const EntityId & aOther) const { return !(*this == aOther); }
+};
+
+
+
+
+
 /** Represents an entire layer of a drawing.
-Contains (and owns) the objects that belong to this layer. */
+The objects are stored in the order of adding, with a slot map assigning each a stable EntityId.
+Removing an object by its EntityId is O(1): it leaves a nullptr tombstone in the storage, so the indices of the other
+objects don't change until the tombstones are removed by an explicit compact(), which keeps the order of the remaining
+objects. The readers use forEachObject(), which skips the tombstones, so the layer stays readable at all times. */
 class Layer
 {
 protected:
-	/** The objects contained within the layer. */
+
+	/** A single slot of the slot map, mapping an EntityId to the object's index in mObjects. */
+	class Slot
+	{
+	public:
+		/** The index of the object in mObjects, NO_OBJECT for a free slot. */
+		uint32_t mObjectIndex;
+
+		/** The current generation of the slot, incremented whenever the slot is freed. */
+		uint32_t mGeneration;
+	};
+
+	/** The mObjectIndex value of a free slot. */
+	static const uint32_t NO_OBJECT = 0xffffffff;
+
+
+	/** The objects contained within the layer, in the order of adding.
+	Removed objects are replaced with nullptr tombstones, until the next compaction. */
 	PrimitivePtrs mObjects;
 
+	/** The slot of each object in mObjects. */
+	std::vector<uint32_t> mObjectSlots;
+
+	/** The slot map, indexed by EntityId::mSlot. */
+	std::vector<Slot> mSlots;
+
+	/** The indices of the free slots in mSlots, reused by addObject(). */
+	std::vector<uint32_t> mFreeSlots;
+
+	/** The number of tombstones in mObjects. */
+	size_t mNumRemoved;
+
 	/** The parent drawing.
 	Used mainly for block definitions. */
 	Drawing & mParentDrawing;
@@ -845,13 +1161,23 @@ protected:
 	The extent is updated upon adding an object and explicitly via updateExtent(). */
 	Extent mExtent;
 
+	/** Adds the specified object to the parent drawing's handle index, if it has a handle. */
+	void indexHandle(const PrimitivePtr & aObject, EntityId aId);
+
+	/** Removes the specified object from the parent drawing's handle index, if it is indexed. */
+	void unindexHandle(const Primitive & aObject);
+
+	/** Marks the specified slot as free, invalidating its EntityId, and makes it available for reuse. */
+	void freeSlot(uint32_t aSlot);
+
 
 public:
 
 	/** Creates a new empty layer of the specified name. */
 	Layer(Drawing & aParentDrawing, const std::string & aName);
 
-	/** Removes all objects from this layer. */
+	/** Removes all objects from this layer.
+	The identifiers of the removed objects become invalid. */
 	void clear();
 
 
@@ -860,22 +1186,65 @@ public:
 	void updateExtent();
 
 	/** Removes the object at the specified index and returns the pointer to it.
-	Ignored if the index is invalid. */
+	The index refers to the objects without the removed ones; the indices of all the later objects shift down by one.
+	Returns nullptr if the index is invalid. O(n), prefer removeObjById() when removing many objects.
+	The object is removed from the drawing's handle index as well. */
 	PrimitivePtr removeObjByIndex(size_t aIndex);
 
 	/** Removes the specified object.
-	Ignored if the object is not present in the layer. */
+	Ignored if the object is not present in the layer.
+	This needs to search for the object, prefer removeObjById() when removing many objects.
+	The object is removed from the drawing's handle index as well. */
 	void removeObj(Primitive * aObject);
 
-	/** Adds the specified object to the layer.
-	If the object is modified after this call, you should call updateExtent(). */
-	void addObject(PrimitivePtr && aObject);
+	/** Removes the object with the specified identifier in O(1) and returns the pointer to it.
+	Returns nullptr if there's no such object (already removed, or the identifier is invalid).
+	The object is removed from the drawing's handle index as well. */
+	PrimitivePtr removeObjById(EntityId aId);
+
+	/** Removes the object at the specified index in the storage and returns the pointer to it, in O(1).
+	The index refers to the storage as of the last compaction (same as objectId()), so removing doesn't shift the indices
+	of the other objects until compact() is called. Returns nullptr if the index is invalid or the object is already
+	removed. The object is removed from the drawing's handle index as well. */
+	PrimitivePtr removeObjByStableIndex(size_t aIndex);
+
+	/** Adds the specified object to the layer and returns its identifier.
+	If the object is modified after this call, you should call updateExtent().
+	If the object has a handle, it is added to the drawing's handle index. */
+	EntityId addObject(PrimitivePtr && aObject);
+
+	/** Adds the specified object to the layer and returns its identifier.
+	If the object is modified after this call, you should call updateExtent().
+	If the object has a handle, it is added to the drawing's handle index. */
+	EntityId addObject(const PrimitivePtr & aObject);
+
+	/** Returns the object with the specified identifier, or nullptr if there's no such object. O(1). */
+	PrimitivePtr objectById(EntityId aId) const;
+
+	/** Returns the identifier of the object at the specified index, in the storage as of the last compaction.
+	Returns an invalid identifier if the index is invalid or the object is removed. */
+	EntityId objectId(size_t aIndex) const;
+
+	/** Removes the tombstones left by the removed objects from the storage, keeping the order of the remaining objects.
+	This renumbers the indices used by removeObjByStableIndex() and objectId(); the EntityIds stay valid.
+	O(n), does nothing if there were no removals since the last compaction. */
+	void compact();
+
+	/** Returns true if there are tombstones in the storage, left by the removals since the last compaction. */
+	bool needsCompaction() const { return (mNumRemoved > 0); }
+
+	/** Returns the storage of the objects in the layer, in the order of adding.
+	Contains a nullptr tombstone in place of each object removed since the last compaction (see needsCompaction()),
+	prefer forEachObject() unless the layer is known to be compacted. */
+	const PrimitivePtrs & objects() const { return mObjects; }
 
-	/** Adds the specified object to the layer.
-	If the object is modified after this call, you should call updateExtent(). */
-	void addObject(const PrimitivePtr & aObject);
+	/** Calls the callback for each object in the layer, in the order of adding, skipping the removed objects.
+	Doesn't modify the layer, so it is safe to call from multiple threads at once. */
+	void forEachObject(const std::function<void (const PrimitivePtr & /* aObject */)> & aCallback) const;
+
+	/** Returns the number of objects in the layer, not counting the removed ones. */
+	size_t numObjects() const { return mObjects.size() - mNumRemoved; }
 
-	const PrimitivePtrs & objects() const { return mObjects; }
 	const Drawing & parentDrawing() const { return mParentDrawing; }
 	Color defaultColor() const { return mDefaultColor; }
 	const std::string & name() const { return mName; }
@@ -883,6 +1252,10 @@ public:
 	/** Returns the currently cached extent of the layer. */
 	const Extent & extent() const { return mExtent; }
 
+	/** Returns the estimate of the memory used by this layer and its objects.
+	The block definitions used by the Block objects are not included, they belong to the Drawing. */
+	MemoryUsage memoryUsage() const;
+
 	void setDefaultColor(Color aColor) { mDefaultColor = aColor; }
 	void setName(const std::string & aName) { mName = aName; }
 } ;
@@ -901,6 +1274,33 @@ public:
 	using NoSuchLayer = std::runtime_error;
 	using BlockDefinitionAlreadyExists = std::runtime_error;
 
+
+	/** An entry in the index of the entities by their handles. */
+	class HandleEntry
+	{
+	public:
+		/** The entity with the handle. */
+		PrimitivePtr mObject;
+
+		/** The layer containing the entity. */
+		Layer * mLayer;
+
+		/** The identifier of the entity within mLayer. */
+		EntityId mId;
+	};
+
+
+	/** The position of a single raw entity within the ENTITIES section, relative to the parsed entities. */
+	class RawEntityPosition
+	{
+	public:
+		/** The index of the raw entity's first group (its group 0) in mRawEntities. */
+		size_t mFirstGroup;
+
+		/** The parsed entity that preceded the raw entity in the section, nullptr if it preceded all of them. */
+		PrimitivePtr mPrecedingEntity;
+	};
+
 	/** All layers within the drawing.
 	The order of the layers is important. */
 	std::vector<std::shared_ptr<Layer>> mLayers;
@@ -908,22 +1308,62 @@ public:
 	/** All the BlockDefinitions within the drawing. */
 	std::map<std::string, std::shared_ptr<BlockDefinition>> mBlockDefinitions;
 
+	/** The pool of strings shared by the objects in the drawing (texts). */
+	StringPool mStringPool;
+
+	/** The entities of the ENTITIES section not supported by the parser, preserved as raw groups, so that they can be
+	written back unchanged. Each entity starts with its group 0. */
+	RawGroups mRawEntities;
+
+	/** The positions of the raw entities among the parsed ones, in the order of mRawEntities, so that the writer can put
+	them back in place. Each position covers the raw groups up to the next position's mFirstGroup.
+	The raw groups not covered by any position, or whose preceding entity is no longer in any layer,
+	are written after all the parsed entities. */
+	std::vector<RawEntityPosition> mRawEntityPositions;
+
+	/** The sections, or their parts, not supported by the parser, preserved as raw groups, keyed by the section name:
+	HEADER, CLASSES, TABLES (all the tables except for LAYER), BLOCKS and OBJECTS.
+	The groups are the section contents, without the {0, SECTION}, {2, name} and {0, ENDSEC} groups. */
+	std::map<std::string, RawGroups> mRawSections;
+
+	/** The index of the entities in the layers by their handles (Primitive::mHandle), for O(1) lookup.
+	Maintained by the Layer's functions that add and remove objects; entities without a handle are not indexed.
+	If there are multiple entities with the same handle, the one added last is indexed.
+	Entities in block definitions are not indexed. */
+	std::unordered_map<uint64_t, HandleEntry> mHandleIndex;
+
 
 	/** Creates a new empty instance. */
 	Drawing()
 	{
 	}
 
-	/** Removes all layers and block definitions. */
+	/** Removes all layers, block definitions and the raw data. */
 	void clear();
 
+	/** Returns the index entry of the entity with the specified handle, or nullptr if there's no such entity.
+	The returned pointer is valid until the next modification of the drawing's layers. */
+	const HandleEntry * findByHandle(uint64_t aHandle) const;
+
+	/** Removes the entity with the specified handle from its layer, in O(1).
+	Returns the removed entity, or nullptr if there's no such entity.
+	The layer keeps a tombstone in place of the removed object until it is compacted, see Layer::compact(). */
+	PrimitivePtr removeByHandle(uint64_t aHandle);
+
+	/** Compacts all the layers that have pending removals, see Layer::compact(). */
+	void compact();
+
+	/** Rebuilds mHandleIndex from scratch from all the layers' objects.
+	Needed only after changing the handles of objects already in layers, or after modifying mLayers directly. */
+	void rebuildHandleIndex();
+
 	/** Adds a new empty layer of the specified name.
 	If there already is a layer of the name, throws a LayerAlreadyExists exception. */
 	std::shared_ptr<Layer> addLayer(const std::string & aName);
 
 	/** Returns the specified layer.
 	If there's no such layer, returns nullptr. */
-	std::shared_ptr<Layer> layerByName(const std::string & aName) const;
+	std::shared_ptr<Layer> layerByName(std::string_view aName) const;
 
 	/** Adds a new BlockDefinition.
 	If there already is a BlockDefinition of the specified name, throws a BlockDefinitionAlreadyExists exception. */
@@ -934,12 +1374,26 @@ public:
 	std::shared_ptr<BlockDefinition> blockDefinitionByName(const std::string & aName) const;
 
 	const std::vector<std::shared_ptr<Layer>> & layers() const { return mLayers; }
+
+	/** Returns the pool of strings shared by the objects in the drawing. */
+	StringPool & stringPool() { return mStringPool; }
+
+	/** Returns the estimate of the memory used by the entire drawing: all its layers and block definitions. */
+	MemoryUsage memoryUsage() const;
 } ;
 
 
 
 
 
+/** Returns a new deep copy of the specified primitive, of the same type.
+Uses mObjectType to determine the actual type to copy. */
+PrimitivePtr clonePrimitive(const Primitive & aPrimitive);
+
+
+
+
+
 /** The DXF color values, as 0x00BBGGRR constants, indexed by the color index from the file format. */
 extern const uint32_t gColors[];
 
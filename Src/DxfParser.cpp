@@ -3,8 +3,14 @@
 // Implements the Dxf::Parser class representing the DXF file format parser
 
 #include "DxfParser.hpp"
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <limits>
 #include "fmt/format.h"
+#include "BinaryDxf.hpp"
 
 
 
@@ -48,6 +54,58 @@ class Parser
 	/** The drawing into which the parsed data is applied. */
 	std::shared_ptr<Drawing> mDrawing;
 
+	/** True if the data is binary DXF, false for the regular text DXF. */
+	bool mIsBinary;
+
+	/** True if the binary DXF data uses 2-byte group codes (R13+), false for 1-byte group codes (R12 and older). */
+	bool mHasTwoByteGroupCodes;
+
+	/** The type of the value of the last group read from binary DXF data.
+	Always bvtString for text DXF data. */
+	BinaryValueType mCurrentBinaryType;
+
+	/** The value of the last group read from binary DXF data, if it is an integral type. */
+	int64_t mCurrentBinaryInt;
+
+	/** The value of the last group read from binary DXF data, if it is a floating-point type. */
+	double mCurrentBinaryDouble;
+
+	/** The value of the last group read by readNext(), in its text representation.
+	Reused for all the groups, so that reading a value doesn't allocate once the capacity is large enough. */
+	std::string mCurrentValue;
+
+	/** The group code line last read from text DXF data, reused the same way as mCurrentValue. */
+	std::string mCurrentGroupCodeLine;
+
+	/** The instrumentation data to fill in while parsing, nullptr if not requested. */
+	ParseStats * mStats;
+
+	/** The callback for reporting progress, empty if not requested. */
+	ProgressCallback mProgressCallback;
+
+	/** The number of bytes between the progress callback calls. */
+	uint64_t mProgressInterval;
+
+	/** The total size of the input data, as given in the options, passed to the progress callback. */
+	uint64_t mTotalSize;
+
+	/** The number of consumed bytes at which the progress callback is to be called next.
+	Set to the maximum value if there's no progress callback, so that the check in readNext() never fires. */
+	uint64_t mNextProgressReport;
+
+	/** The callback for emitting the completed entities, empty if not requested. */
+	EntityCallback mEntityCallback;
+
+	/** If false, the entities of the ENTITIES section are not added to their layers. */
+	bool mShouldStoreEntities;
+
+	/** The layer last returned by layerByName(), checked first on the next lookup. */
+	std::shared_ptr<Layer> mLastLayer;
+
+	/** The state of the ENTITIES section being read by readNextEntity(), nullptr when not inside the section. */
+	class EntitiesState;
+	std::unique_ptr<EntitiesState> mReaderState;
+
 
 
 
@@ -183,6 +241,15 @@ class Parser
 			throwError("invalid number: <empty string>");
 		}
 
+		// Fast path: std::from_chars is exact and much faster than std::stod, but doesn't accept the whitespace or
+		// a leading plus sign that DXF files sometimes contain, so anything it doesn't consume fully goes to std::stod:
+		double res;
+		auto end = aStr.data() + aStr.size();
+		auto conv = std::from_chars(aStr.data(), end, res);
+		if ((conv.ec == std::errc()) && (conv.ptr == end))
+		{
+			return res;
+		}
 		try
 		{
 			auto res = std::stod(aStr);
@@ -198,28 +265,299 @@ class Parser
 
 
 
+	/** Returns the value of the last read group as an integer.
+	For binary DXF data, uses the already decoded number, for text DXF data parses aValue.
+	Throws an Error upon invalid input. */
+	template <class T>
+	T valueToInt(const std::string & aValue)
+	{
+		switch (mCurrentBinaryType)
+		{
+			case bvtInt16:
+			case bvtInt32:
+			case bvtInt64:
+			case bvtBool:
+			{
+				if (
+					(mCurrentBinaryInt < static_cast<int64_t>(std::numeric_limits<T>::min())) ||
+					(mCurrentBinaryInt > static_cast<int64_t>(std::numeric_limits<T>::max()))
+				)
+				{
+					throwError("Number is too large.");
+				}
+				return static_cast<T>(mCurrentBinaryInt);
+			}
+			case bvtDouble:
+			{
+				throwError("Unexpected floating-point value, integer expected.");
+			}
+			case bvtString:
+			case bvtBinaryChunk:
+			{
+				break;
+			}
+		}
+		return stringToInt<T>(trimWhitespace(aValue));
+	}
+
+
+
+
+
+	/** Parses the specified value as a handle (a hex number), such as in groups 5 and 330.
+	Throws an Error upon invalid input. */
+	uint64_t valueToHandle(const std::string & aValue)
+	{
+		auto trimmed = trimWhitespace(aValue);
+		uint64_t res;
+		auto end = trimmed.data() + trimmed.size();
+		auto parsed = std::from_chars(trimmed.data(), end, res, 16);
+		if (trimmed.empty() || (parsed.ec != std::errc()) || (parsed.ptr != end))
+		{
+			throwError(fmt::format("Invalid handle: \"{}\"", aValue));
+		}
+		return res;
+	}
+
+
+
+
+
+	/** Returns the value of the last read group as a double.
+	For binary DXF data, uses the already decoded number, for text DXF data parses aValue.
+	Throws an Error upon invalid input. */
+	double valueToDouble(const std::string & aValue)
+	{
+		switch (mCurrentBinaryType)
+		{
+			case bvtDouble:
+			{
+				return mCurrentBinaryDouble;
+			}
+			case bvtInt16:
+			case bvtInt32:
+			case bvtInt64:
+			case bvtBool:
+			{
+				return static_cast<double>(mCurrentBinaryInt);
+			}
+			case bvtString:
+			case bvtBinaryChunk:
+			{
+				break;
+			}
+		}
+		return stringToDouble(aValue);
+	}
+
+
+
+
+
+	/** Reads a little-endian unsigned integer of the specified byte size from the binary data. */
+	uint64_t readBinaryUInt(size_t aNumBytes)
+	{
+		unsigned char bytes[8];
+		mLineExtractor.readBytes(reinterpret_cast<char *>(bytes), aNumBytes);
+		uint64_t res = 0;
+		for (size_t i = aNumBytes; i > 0; --i)
+		{
+			res = (res << 8) | bytes[i - 1];
+		}
+		return res;
+	}
+
+
+
+
+
+	/** Reads the next group code from the binary DXF data and returns it, together with its value.
+	String values are stored in mCurrentValue, numeric values are stored in mCurrentBinaryInt / mCurrentBinaryDouble
+	(and mCurrentValue is emptied). */
+	int readNextBinary()
+	{
+		int groupCode;
+		if (mHasTwoByteGroupCodes)
+		{
+			groupCode = static_cast<int>(readBinaryUInt(2));
+		}
+		else
+		{
+			groupCode = static_cast<int>(readBinaryUInt(1));
+			if (groupCode == 255)
+			{
+				// Extended group code:
+				groupCode = static_cast<int>(readBinaryUInt(2));
+			}
+		}
+
+		mCurrentBinaryType = binaryValueType(groupCode);
+		switch (mCurrentBinaryType)
+		{
+			case bvtString:
+			{
+				mLineExtractor.getNextNullTerminatedString(mCurrentValue);
+				return groupCode;
+			}
+			case bvtDouble:
+			{
+				auto bits = readBinaryUInt(8);
+				static_assert(sizeof(bits) == sizeof(mCurrentBinaryDouble));
+				std::memcpy(&mCurrentBinaryDouble, &bits, sizeof(bits));
+				break;
+			}
+			case bvtInt16:
+			{
+				mCurrentBinaryInt = static_cast<int16_t>(readBinaryUInt(2));
+				break;
+			}
+			case bvtInt32:
+			{
+				mCurrentBinaryInt = static_cast<int32_t>(readBinaryUInt(4));
+				break;
+			}
+			case bvtInt64:
+			{
+				mCurrentBinaryInt = static_cast<int64_t>(readBinaryUInt(8));
+				break;
+			}
+			case bvtBool:
+			{
+				mCurrentBinaryInt = static_cast<int64_t>(readBinaryUInt(1));
+				break;
+			}
+			case bvtBinaryChunk:
+			{
+				// Convert to the hex representation used by the text DXF:
+				auto len = static_cast<size_t>(readBinaryUInt(1));
+				char data[256];
+				mLineExtractor.readBytes(data, len);
+				static const char hexDigits[] = "0123456789ABCDEF";
+				mCurrentValue.clear();
+				for (size_t i = 0; i < len; ++i)
+				{
+					auto b = static_cast<unsigned char>(data[i]);
+					mCurrentValue.push_back(hexDigits[b >> 4]);
+					mCurrentValue.push_back(hexDigits[b & 0x0f]);
+				}
+				return groupCode;
+			}
+		}
+		mCurrentValue.clear();
+		return groupCode;
+	}
+
+
+
+
+
 	/** Reads the next group code and value from the stream.
+	The value is a reference to mCurrentValue, valid only until the next readNext() call.
 	Assumes that mStream converts CRLF to LF upon reading. */
-	std::pair<int, std::string> readNext()
+	std::pair<int, const std::string &> readNext()
 	{
-		auto groupCodeStr = mLineExtractor.getNextLine();
+		if (mLineExtractor.numBytesConsumed() >= mNextProgressReport)
+		{
+			reportProgress();
+		}
+		if (mIsBinary)
+		{
+			auto groupCode = readNextBinary();
+			return {groupCode, mCurrentValue};
+		}
+		auto & groupCodeStr = mCurrentGroupCodeLine;
+		mLineExtractor.getNextLine(groupCodeStr);
 		auto isWhiteSpace = [](const char aChar)
 		{
 			return ((aChar == ' ') || (aChar == '\t'));
 		};
 		groupCodeStr.erase(std::remove_if(groupCodeStr.begin(), groupCodeStr.end(), isWhiteSpace), groupCodeStr.end());  // Remove any whitespace from the line
 		auto groupCode = stringToInt<int>(groupCodeStr);
-		auto value = mLineExtractor.getNextLine();
-		return {groupCode, value};
+		mLineExtractor.getNextLine(mCurrentValue);
+		return {groupCode, mCurrentValue};
+	}
+
+
+
+
+
+	/** Calls the progress callback with the current progress and schedules its next call.
+	Throws a Cancelled exception if the callback requests cancellation. */
+	void reportProgress()
+	{
+		auto numBytesConsumed = mLineExtractor.numBytesConsumed();
+		if (!mProgressCallback(numBytesConsumed, mTotalSize))
+		{
+			throw Cancelled(numBytesConsumed);
+		}
+		mNextProgressReport = numBytesConsumed + std::max<uint64_t>(mProgressInterval, 1);
 	}
 
 
 
 
 
+	/** Stores the HEADER section's variables as raw groups, the writer merges them with the variables it generates. */
 	void parseHeaderSection()
 	{
-		return skipUntilSectionEnd();
+		return parseRawSection("HEADER");
+	}
+
+
+
+
+
+	/** Adds the specified group, just read from the input, into aDst.
+	For binary DXF data, the numeric values are converted to their text representation. */
+	void addRawGroup(RawGroups & aDst, int aGroupCode, const std::string & aValue)
+	{
+		switch (mCurrentBinaryType)
+		{
+			case bvtDouble:
+			{
+				aDst.add(aGroupCode, fmt::format("{}", mCurrentBinaryDouble));
+				return;
+			}
+			case bvtInt16:
+			case bvtInt32:
+			case bvtInt64:
+			case bvtBool:
+			{
+				aDst.add(aGroupCode, fmt::format("{}", mCurrentBinaryInt));
+				return;
+			}
+			case bvtString:
+			case bvtBinaryChunk:
+			{
+				break;
+			}
+		}
+		aDst.add(aGroupCode, aValue);
+	}
+
+
+
+
+
+	/** Stores the contents of the current section, up to the section end {0, ENDSEC}, into mDrawing's raw sections.
+	Used for the sections that the parser doesn't interpret, so that they can be written back unchanged.
+	When the entities are not being stored (streaming), the section is only skipped. */
+	void parseRawSection(const std::string & aSectionName)
+	{
+		if (!mShouldStoreEntities)
+		{
+			return skipUntilSectionEnd();
+		}
+		auto & raw = mDrawing->mRawSections[aSectionName];
+		for (;;)
+		{
+			auto [groupCode, value] = readNext();
+			if ((groupCode == 0) && isSameStringIgnoreCase(value, "endsec"))
+			{
+				return;
+			}
+			addRawGroup(raw, groupCode, value);
+		}
 	}
 
 
@@ -228,7 +566,7 @@ class Parser
 
 	void parseClassesSection()
 	{
-		return skipUntilSectionEnd();
+		return parseRawSection("CLASSES");
 	}
 
 
@@ -292,29 +630,48 @@ class Parser
 
 
 	/** Parses a single table out of the TABLES section of the DXF data.
+	The LAYER table is interpreted, the other tables (line types, styles, block records etc.) are stored in mDrawing's
+	raw TABLES section, including their {0, TABLE} and {0, ENDTAB} groups, so that they can be written back.
+	When the entities are not being stored (streaming), the other tables are only skipped.
 	Finishes after encountering the {0, ENDTAB} pair*/
 	void parseSingleTable()
 	{
+		RawGroups table;
+		table.add(0, "TABLE");
+		bool hasName = false;
 		for (;;)
 		{
 			auto [groupCode, value] = readNext();
+			if (mShouldStoreEntities)
+			{
+				addRawGroup(table, groupCode, value);
+			}
 			switch (groupCode)
 			{
 				case 0:
 				{
 					if (isSameStringIgnoreCase(value, "endtab"))
 					{
+						if (mShouldStoreEntities)
+						{
+							auto & raw = mDrawing->mRawSections["TABLES"];
+							for (size_t i = 0, count = table.size(); i < count; ++i)
+							{
+								raw.add(table.groupCode(i), table.value(i));
+							}
+						}
 						return;
 					}
 					break;
 				}
 				case 2:
 				{
-					if (isSameStringIgnoreCase(value, "layer"))
+					// The first group 2 is the table name, the later ones are the entries' names:
+					if (!hasName && isSameStringIgnoreCase(value, "layer"))
 					{
 						return parseLayerTable();
 					}
-					// No error on unknown values, we skip tables other than layer
+					hasName = true;
 					break;
 				}
 			}
@@ -356,6 +713,10 @@ class Parser
 					try
 					{
 						currentLayer = mDrawing->addLayer(value);
+						if (mStats != nullptr)
+						{
+							mStats->mNumObjectAllocations += 1;
+						}
 					}
 					catch (Dxf::Drawing::LayerAlreadyExists & exc)
 					{
@@ -367,7 +728,7 @@ class Parser
 				{
 					if (currentLayer != nullptr)
 					{
-						currentLayer->setDefaultColor(stringToInt<Color>(trimWhitespace(value)));
+						currentLayer->setDefaultColor(valueToInt<Color>(value));
 					}
 					break;
 				}
@@ -379,31 +740,170 @@ class Parser
 
 
 
+	/** Stores the BLOCKS section as raw groups, so that the block definitions referenced by the raw INSERT entities
+	are written back together with them. */
 	void parseBlocksSection()
 	{
-		// TODO: Parse the block definitions
-		return skipUntilSectionEnd();
+		return parseRawSection("BLOCKS");
+	}
+
+
+
+
+
+	/** Returns the drawing's layer of the specified name, nullptr if there's no such layer.
+	Entities usually come in long runs on the same layer, so the last found layer is checked first,
+	which makes the lookup for each entity's group 8 a single string comparison, without any allocation. */
+	const std::shared_ptr<Layer> & layerByName(std::string_view aName)
+	{
+		if ((mLastLayer == nullptr) || (mLastLayer->name() != aName))
+		{
+			mLastLayer = mDrawing->layerByName(aName);
+		}
+		return mLastLayer;
 	}
 
 
 
 
 
-	/** Parses the entities from mStream.
-	If aParentBlockDef is valid, the entities are stored within that BlockDefinition. */
+	/** The state of parsing a single entities section, kept between the parseNextEntity() calls. */
+	class EntitiesState
+	{
+	public:
+		/** If valid, the entities are stored within this BlockDefinition instead of the layers. */
+		BlockDefinition * mParentBlockDef;
+
+		/** The last entity added (polyline vertices are added to it). */
+		PrimitivePtr mLast;
+
+		/** The entity currently being parsed. */
+		PrimitivePtr mCur;
+
+		/** The layer to which mCur is added once it is complete. */
+		std::shared_ptr<Layer> mCurLayer;
+
+		/** The last entity stored in a layer, the position of the next raw entity is recorded relative to it. */
+		PrimitivePtr mLastStored;
+
+		/** Accumulator for text / mtext. */
+		std::string mCurrentCaption;
+
+		/** Set while reading the vertices of a POLYLINE. */
+		bool mIsPolylineSequence;
+
+		/** The polyline added to a layer that is waiting for its vertices, to be reported once complete. */
+		PrimitivePtr mPendingPolyline;
+		std::shared_ptr<Layer> mPendingPolylineLayer;
+
+		/** The entities that are complete and not yet returned by parseNextEntity(), with their layers. */
+		std::deque<std::pair<std::shared_ptr<Layer>, PrimitivePtr>> mCompleted;
+
+		/** Set once the end of the section has been reached. */
+		bool mIsSectionEnd;
+
+		/** Set while reading an unsupported entity, whose groups are being stored in the drawing's mRawEntities. */
+		bool mIsRawEntity;
+
+
+		explicit EntitiesState(BlockDefinition * aParentBlockDef):
+			mParentBlockDef(aParentBlockDef),
+			mIsPolylineSequence(false),
+			mIsSectionEnd(false),
+			mIsRawEntity(false)
+		{
+		}
+
+		/** Moves the pending polyline, if any, into mCompleted. */
+		void completePendingPolyline()
+		{
+			if (mPendingPolyline != nullptr)
+			{
+				mCompleted.emplace_back(std::move(mPendingPolylineLayer), std::move(mPendingPolyline));
+				mPendingPolyline.reset();
+				mPendingPolylineLayer.reset();
+			}
+		}
+	};
+
+
+
+
+
+	/** Parses the entities from mLineExtractor until the end of the section.
+	If aParentBlockDef is valid, the entities are stored within that BlockDefinition.
+	Reports the entities added to the layers through mEntityCallback, if requested. */
 	void parseEntitiesSection(BlockDefinition * aParentBlockDef)
 	{
-		PrimitivePtr last;
-		PrimitivePtr cur;
-		std::string currentCaption;  // Accumulator for text / mtext
-		bool isPolylineSequence = false;
+		EntitiesState state(aParentBlockDef);
+		std::shared_ptr<Layer> layer;
+		while (auto entity = parseNextEntity(state, layer))
+		{
+			if (mEntityCallback)
+			{
+				mEntityCallback(layer, entity);
+			}
+		}
+	}
+
+
+
+
+
+	/** Returns the oldest completed entity from aState (and its layer in aLayer), nullptr if there is none. */
+	PrimitivePtr takeCompletedEntity(EntitiesState & aState, std::shared_ptr<Layer> & aLayer)
+	{
+		if (aState.mCompleted.empty())
+		{
+			return nullptr;
+		}
+		aLayer = std::move(aState.mCompleted.front().first);
+		auto res = std::move(aState.mCompleted.front().second);
+		aState.mCompleted.pop_front();
+		return res;
+	}
+
+
+
+
+
+	/** Parses the entities from mLineExtractor until the next entity added to a layer is complete
+	(for polylines, once all their vertices have been read), then returns it, with its layer in aLayer.
+	Entities within block definitions are stored in aState.mParentBlockDef and not returned.
+	Returns nullptr once the end of the section is reached. */
+	PrimitivePtr parseNextEntity(EntitiesState & aState, std::shared_ptr<Layer> & aLayer)
+	{
+		if (auto res = takeCompletedEntity(aState, aLayer))
+		{
+			return res;
+		}
+		if (aState.mIsSectionEnd)
+		{
+			return nullptr;
+		}
+
+		auto & last = aState.mLast;
+		auto & cur = aState.mCur;
+		auto & curLayer = aState.mCurLayer;
+		auto & currentCaption = aState.mCurrentCaption;
+		auto & isPolylineSequence = aState.mIsPolylineSequence;
 		for (;;)
 		{
 			auto [groupCode, value] = readNext();
+			if (aState.mIsRawEntity && (groupCode != 0))
+			{
+				addRawGroup(mDrawing->mRawEntities, groupCode, value);
+				continue;
+			}
 			switch (groupCode)
 			{
 				case 0:
 				{
+					// Unsupported entities are stored raw (not in block definitions, and not when streaming):
+					auto wasRawEntity = aState.mIsRawEntity;
+					aState.mIsRawEntity = false;
+					auto shouldStoreRaw = (mShouldStoreEntities && (aState.mParentBlockDef == nullptr));
+
 					if (cur != nullptr)
 					{
 						if (
@@ -419,24 +919,54 @@ class Parser
 						else
 						{
 							last = cur;
-							if (aParentBlockDef != nullptr)
+							if (aState.mParentBlockDef != nullptr)
+							{
+								aState.mParentBlockDef->mObjects.push_back(cur);
+							}
+							else if (curLayer != nullptr)
 							{
-								aParentBlockDef->mObjects.push_back(cur);
+								if (mShouldStoreEntities)
+								{
+									curLayer->addObject(cur);
+									aState.mLastStored = cur;
+								}
+
+								// A pending polyline cannot receive any more vertices, it is complete:
+								aState.completePendingPolyline();
+								if (cur->mObjectType == otPolyline)
+								{
+									aState.mPendingPolyline = cur;
+									aState.mPendingPolylineLayer = curLayer;
+								}
+								else
+								{
+									aState.mCompleted.emplace_back(curLayer, cur);
+								}
 							}
 						}  // not poly vertex
 						cur = nullptr;
 					}
-					if (isSameStringIgnoreCase(value, "endsec"))
+					curLayer = nullptr;
+					if (isSameStringIgnoreCase(value, "endsec") || isSameStringIgnoreCase(value, "endblk"))
 					{
-						return;
+						aState.completePendingPolyline();
+						aState.mIsSectionEnd = true;
+						return takeCompletedEntity(aState, aLayer);
 					}
-					if (isSameStringIgnoreCase(value, "endblk"))
+					if (mStats != nullptr)
 					{
-						return;
+						mStats->mEntityCounts[value] += 1;
 					}
 					if (isSameStringIgnoreCase(value, "seqend"))
 					{
 						isPolylineSequence = false;
+						aState.completePendingPolyline();
+						if (wasRawEntity)
+						{
+							// The end of an unsupported sequence, such as INSERT with ATTRIBs:
+							addRawGroup(mDrawing->mRawEntities, 0, value);
+							aState.mIsRawEntity = true;
+						}
 					}
 					else if (isSameStringIgnoreCase(value, "line"))
 					{
@@ -477,7 +1007,20 @@ class Parser
 					}
 					else
 					{
-						// DEBUG: std::cout << "Unhandled entity: " << value << "\n";
+						if (mStats != nullptr)
+						{
+							mStats->mNumUnknownEntities += 1;
+						}
+						if (shouldStoreRaw)
+						{
+							mDrawing->mRawEntityPositions.push_back({mDrawing->mRawEntities.size(), aState.mLastStored});
+							addRawGroup(mDrawing->mRawEntities, 0, value);
+							aState.mIsRawEntity = true;
+						}
+					}
+					if ((cur != nullptr) && (mStats != nullptr))
+					{
+						mStats->mNumObjectAllocations += 1;
 					}
 					break;
 				}  // case 0
@@ -493,10 +1036,18 @@ class Parser
 							{
 								currentCaption.append(value);
 								const auto text = std::static_pointer_cast<Text>(cur);
-								text->mRawText.assign(convertDxfText(currentCaption));
-								currentCaption.clear();
-								break;
-							}
+								// Interning only pays off when the texts are kept; when streaming, the pool would only grow:
+								if (mShouldStoreEntities)
+								{
+									text->mRawText = mDrawing->stringPool().intern(convertDxfText(currentCaption));
+								}
+								else
+								{
+									text->mRawText = SharedString(convertDxfText(currentCaption));
+								}
+								currentCaption.clear();
+								break;
+							}
 							case otError:
 							case otLine:
 							case otPolyline:
@@ -538,15 +1089,30 @@ class Parser
 					break;
 				}  // case 3
 
+				case 5:  // handle
+				{
+					if (cur != nullptr)
+					{
+						cur->mHandle = valueToHandle(value);
+					}
+					break;
+				}
+
+				case 330:  // owner handle
+				{
+					if (cur != nullptr)
+					{
+						cur->mOwnerHandle = valueToHandle(value);
+					}
+					break;
+				}
+
 				case 8:  // layer
 				{
 					if (cur != nullptr)
 					{
-						auto lay = mDrawing->layerByName(value);
-						if (lay != nullptr)
-						{
-							lay->addObject(cur);
-						}
+						// The object is added to the layer only once it is complete, polyline vertices are not added at all
+						curLayer = layerByName(value);
 					}
 					break;
 				}
@@ -561,7 +1127,7 @@ class Parser
 					{
 						case otLWPolyline:
 						{
-							std::static_pointer_cast<LWPolyline>(cur)->addVertex({stringToDouble(value), 0});
+							std::static_pointer_cast<LWPolyline>(cur)->addVertex({valueToDouble(value), 0});
 							break;
 						}
 						case otLine:
@@ -571,7 +1137,7 @@ class Parser
 						case otCircle:
 						case otArc:
 						{
-							cur->mPos.mX = stringToDouble(value);
+							cur->mPos.mX = valueToDouble(value);
 							break;
 						}
 						case otPolyline: break;  // Ignore
@@ -593,7 +1159,7 @@ class Parser
 					}
 					switch (cur->mObjectType)
 					{
-						case otLine: std::static_pointer_cast<Line>(cur)->mPos2.mX = stringToDouble(value); break;
+						case otLine: std::static_pointer_cast<Line>(cur)->mPos2.mX = valueToDouble(value); break;
 						default:
 						{
 							break;
@@ -614,7 +1180,7 @@ class Parser
 						{
 							if (!std::static_pointer_cast<LWPolyline>(cur)->mVertices.empty())
 							{
-								std::static_pointer_cast<LWPolyline>(cur)->mVertices.back().mPos.mY = stringToDouble(value);
+								std::static_pointer_cast<LWPolyline>(cur)->mVertices.back().mPos.mY = valueToDouble(value);
 							}
 							break;
 						}
@@ -625,7 +1191,7 @@ class Parser
 						case otCircle:
 						case otArc:
 						{
-							cur->mPos.mY = stringToDouble(value);
+							cur->mPos.mY = valueToDouble(value);
 							break;
 						}
 						case otPolyline: break;  // Ignore
@@ -650,7 +1216,7 @@ class Parser
 						{
 							break;  // Ignore
 						}
-						case otLine: std::static_pointer_cast<Line>(cur)->mPos2.mY = stringToDouble(value); break;
+						case otLine: std::static_pointer_cast<Line>(cur)->mPos2.mY = valueToDouble(value); break;
 
 						default:
 						{
@@ -676,7 +1242,7 @@ class Parser
 						case otCircle:
 						case otArc:
 						{
-							cur->mPos.mZ = stringToDouble(value);
+							cur->mPos.mZ = valueToDouble(value);
 							break;
 						}
 						case otPolyline: break;  // Ignore
@@ -702,7 +1268,7 @@ class Parser
 						{
 							break;  // Ignore
 						}
-						case otLine: std::static_pointer_cast<Line>(cur)->mPos2.mZ = stringToDouble(value); break;
+						case otLine: std::static_pointer_cast<Line>(cur)->mPos2.mZ = valueToDouble(value); break;
 
 						default:
 						{
@@ -721,7 +1287,7 @@ class Parser
 					}
 					switch (cur->mObjectType)
 					{
-						case otLWPolyline: std::static_pointer_cast<LWPolyline>(cur)->mPos.mZ = stringToDouble(value); break;
+						case otLWPolyline: std::static_pointer_cast<LWPolyline>(cur)->mPos.mZ = valueToDouble(value); break;
 						case otPolyline:
 						{
 							// Silently ignore this "error"
@@ -758,12 +1324,28 @@ class Parser
 					{
 						case otCircle:
 						{
-							std::static_pointer_cast<Circle>(cur)->mRadius = stringToDouble(value);
+							std::static_pointer_cast<Circle>(cur)->mRadius = valueToDouble(value);
 							break;
 						}
 						case otArc:
 						{
-							std::static_pointer_cast<Arc>(cur)->mRadius = stringToDouble(value);
+							std::static_pointer_cast<Arc>(cur)->mRadius = valueToDouble(value);
+							break;
+						}
+						case otText:
+						{
+							std::static_pointer_cast<Text>(cur)->mSize = valueToDouble(value);
+							break;
+						}
+						case otPolyline:
+						{
+							cur->mWidth = valueToDouble(value);
+							break;
+						}
+						case otVertex:
+						case otLWPolyline:
+						{
+							// Ignore per-vertex widths
 							break;
 						}
 						default:
@@ -774,6 +1356,15 @@ class Parser
 					break;
 				}  // case 40
 
+				case 43:
+				{
+					if ((cur != nullptr) && (cur->mObjectType == otLWPolyline))
+					{
+						cur->mWidth = valueToDouble(value);
+					}
+					break;
+				}  // case 43
+
 				case 42:
 				{
 					if (cur == nullptr)
@@ -784,7 +1375,7 @@ class Parser
 					{
 						case otVertex:
 						{
-							std::static_pointer_cast<Vertex>(cur)->mBulge = stringToDouble(value);
+							std::static_pointer_cast<Vertex>(cur)->mBulge = valueToDouble(value);
 							break;
 						}
 						case otLWPolyline:
@@ -792,7 +1383,7 @@ class Parser
 							auto polyline = std::static_pointer_cast<LWPolyline>(cur);
 							if (!polyline->mVertices.empty())
 							{
-								polyline->mVertices.back().mBulge = stringToDouble(value);
+								polyline->mVertices.back().mBulge = valueToDouble(value);
 							}
 							break;
 						}
@@ -814,9 +1405,15 @@ class Parser
 					{
 						case otArc:
 						{
-							std::static_pointer_cast<Arc>(cur)->mStartAngle = stringToDouble(value);
+							std::static_pointer_cast<Arc>(cur)->mStartAngle = valueToDouble(value);
 							break;
 						}
+						case otText:
+						{
+							std::static_pointer_cast<Text>(cur)->mAngle = valueToDouble(value);
+							break;
+						}
+						case otVertex: break;  // Ignore the curve-fit tangent direction
 						default:
 						{
 							throwError(fmt::format("Unhandled object type with groupcode 50: {}", cur->mObjectType));
@@ -835,7 +1432,7 @@ class Parser
 					{
 						case otArc:
 						{
-							std::static_pointer_cast<Arc>(cur)->mEndAngle = stringToDouble(value);
+							std::static_pointer_cast<Arc>(cur)->mEndAngle = valueToDouble(value);
 							break;
 						}
 						default:
@@ -846,6 +1443,15 @@ class Parser
 					break;
 				}  // case 51
 
+				case 62:
+				{
+					if (cur != nullptr)
+					{
+						cur->mColor = valueToInt<Color>(value);
+					}
+					break;
+				}  // case 62
+
 				case 70:
 				{
 					if (cur == nullptr)
@@ -856,12 +1462,12 @@ class Parser
 					{
 						case otPolyline:
 						{
-							std::static_pointer_cast<Polyline>(cur)->mFlags = static_cast<PolylineFlags>(stringToInt<int>(trimWhitespace(value)));
+							std::static_pointer_cast<Polyline>(cur)->mFlags = static_cast<PolylineFlags>(valueToInt<int>(value));
 							break;
 						}
 						case otLWPolyline:
 						{
-							std::static_pointer_cast<LWPolyline>(cur)->mFlags = static_cast<PolylineFlags>(stringToInt<int>(trimWhitespace(value)));
+							std::static_pointer_cast<LWPolyline>(cur)->mFlags = static_cast<PolylineFlags>(valueToInt<int>(value));
 							break;
 						}
 						case otVertex: break;  // Ignore
@@ -887,161 +1493,25 @@ class Parser
 
 				default:
 				{
-					/*
-					// TODO: We don't store the extended data yet
-					if (cur == nullptr) break;
-					if (cur->Extended == nullptr)
+					if ((groupCode >= 1000) && (groupCode <= 1071) && (cur != nullptr))
 					{
-						cur->Extended = new ExtendedData();
+						// Extended entity data, stored raw and decoded only on demand:
+						if (cur->mExtendedData == nullptr)
+						{
+							cur->mExtendedData = std::make_unique<RawGroups>();
+						}
+						addRawGroup(*cur->mExtendedData, groupCode, value);
 					}
-
-					setExtendedEntityData(*cur->Extended, groupCode, std::move(value));
-					*/
 					break;
 				}
 			}  // switch (mCurrentGroup)
-		}  // for (;;)
-	}
-
-
-
-
 
-	/*
-	// TODO: Process the extended entity data
-	void setExtendedEntityData(ExtendedData & extended, int aGroupCode, std::string && aValue)
-	{
-		switch (aGroupCode)
-		{
-			case 1000:
-			{
-				extended.mString = std::move(aValue);
-				break;
-			}
-			case 1001:
-			{
-				// TODO: Add check that the group is the first one within the extended data and the name is in a reference table
-				extended.mApplicationName.assign(mCurrentValue);
-				break;
-			}
-			case 1002:
-			{
-				// TODO: Add support for blocks
-				break;
-			}
-			case 1003:
-			{
-				extended.LayerName.assign(mCurrentValue);
-				break;
-			}
-			case 1004:
+			if (auto res = takeCompletedEntity(aState, aLayer))
 			{
-				// TODO: Add parser of binary data
-				break;
+				return res;
 			}
-			case 1005:
-			{
-				long value;
-				if (StringToInt(mCurrentValue, &value) == FALSE || value < INT_MIN || value > INT_MAX) value = 0u;
-				extended.DatabaseHandle = static_cast<int>(value);
-				break;
-			}
-			case 1010:
-			{
-				extended.X = _tstof(mCurrentValue);
-				break;
-			}
-			case 1020:
-			{
-				extended.Y = _tstof(mCurrentValue);
-				break;
-			}
-			case 1030:
-			{
-				extended.Z = _tstof(mCurrentValue);
-				break;
-			}
-			case 1011:
-			{
-				extended.WorldSpacePositionX = _tstof(mCurrentValue);
-				break;
-			}
-			case 1021:
-			{
-				extended.WorldSpacePositionY = _tstof(mCurrentValue);
-				break;
-			}
-			case 1031:
-			{
-				extended.WorldSpacePositionZ = _tstof(mCurrentValue);
-				break;
-			}
-			case 1012:
-			{
-				extended.WorldSpaceDisplacementX = _tstof(mCurrentValue);
-				break;
-			}
-			case 1022:
-			{
-				extended.WorldSpaceDisplacementY = _tstof(mCurrentValue);
-				break;
-			}
-			case 1032:
-			{
-				extended.WorldSpaceDisplacementZ = _tstof(mCurrentValue);
-				break;
-			}
-			case 1013:
-			{
-				extended.WorldDirectionX = _tstof(mCurrentValue);
-				break;
-			}
-			case 1023:
-			{
-				extended.WorldDirectionY = _tstof(mCurrentValue);
-				break;
-			}
-			case 1033:
-			{
-				extended.WorldDirectionZ = _tstof(mCurrentValue);
-				break;
-			}
-			case 1040:
-			{
-				extended.Real = _tstof(mCurrentValue);
-				break;
-			}
-			case 1041:
-			{
-				extended.Distance = _tstof(mCurrentValue);
-				break;
-			}
-			case 1042:
-			{
-				extended.ScaleFactor = _tstof(mCurrentValue);
-				break;
-			}
-			case 1070:
-			{
-				long value;
-				if (StringToInt(mCurrentValue, &value) == FALSE || value < 0 || value > USHRT_MAX) value = 0;
-				extended.Integer = static_cast<unsigned short int>(value);
-				break;
-			}
-			case 1071:
-			{
-				long value;
-				if (StringToInt(mCurrentValue, &value) == FALSE || value < INT_MIN || value > INT_MAX) value = 0;
-				extended.Long = static_cast<int>(value);
-				break;
-			}
-			default:
-			{
-				break;
-			}
-		}
+		}  // for (;;)
 	}
-	*/
 
 
 
@@ -1049,7 +1519,7 @@ class Parser
 
 	void parseObjectsSection()
 	{
-		return skipUntilSectionEnd();
+		return parseRawSection("OBJECTS");
 	}
 
 
@@ -1245,18 +1715,105 @@ class Parser
 
 public:
 
-	Parser(DataSource && aDataSource):
+	Parser(DataSource && aDataSource, const Options & aOptions):
 		mLineExtractor(std::move(aDataSource)),
-		mDrawing(new Drawing)
+		mDrawing(new Drawing),
+		mIsBinary(false),
+		mHasTwoByteGroupCodes(false),
+		mCurrentBinaryType(bvtString),
+		mCurrentBinaryInt(0),
+		mCurrentBinaryDouble(0),
+		mStats(aOptions.mStats),
+		mProgressCallback(aOptions.mProgressCallback),
+		mProgressInterval(aOptions.mProgressInterval),
+		mTotalSize(aOptions.mTotalSize),
+		mNextProgressReport(mProgressCallback ? mProgressInterval : std::numeric_limits<uint64_t>::max()),
+		mEntityCallback(aOptions.mEntityCallback),
+		mShouldStoreEntities(aOptions.mShouldStoreEntities)
 	{
+		// Detect binary DXF:
+		if (mLineExtractor.startsWith(BINARY_DXF_SENTINEL, BINARY_DXF_SENTINEL_SIZE))
+		{
+			mLineExtractor.skipBytes(BINARY_DXF_SENTINEL_SIZE);
+			mIsBinary = true;
+
+			// The first group is always {0, SECTION}; R13+ files store the group code in 2 bytes, older in 1 byte:
+			static const char twoByteZero[2] = {0, 0};
+			mHasTwoByteGroupCodes = mLineExtractor.startsWith(twoByteZero, sizeof(twoByteZero));
+		}
 	}
 
 
 
 
 
-	/** Parses the data from mLineExtractor into mDrawing. */
+	/** Parses the data from mLineExtractor into mDrawing.
+	Fills in the instrumentation data, if requested. */
 	void parse(bool aShouldContinueAfterLayerList)
+	{
+		if (mStats == nullptr)
+		{
+			parseSections(aShouldContinueAfterLayerList);
+			reportFinalProgress();
+			return;
+		}
+		auto startTime = std::chrono::steady_clock::now();
+		parseSections(aShouldContinueAfterLayerList);
+		reportFinalProgress();
+		mStats->mTotalSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		mStats->mTotalBytes += mLineExtractor.numBytesConsumed();
+		mStats->mTotalLines += mLineExtractor.currentLineNum() - 1;
+		mStats->mNumBufferGrowths += mLineExtractor.numBufferGrowths();
+		mStats->mBufferSize = mLineExtractor.bufferSize();
+		mStats->mNumDataSourceReads += mLineExtractor.numDataSourceReads();
+	}
+
+
+
+
+
+	/** Reports the final progress, once the parsing has finished, if requested.
+	Cancelling at this point still throws a Cancelled exception, so that the caller doesn't need to handle a late result. */
+	void reportFinalProgress()
+	{
+		if (mProgressCallback)
+		{
+			reportProgress();
+		}
+	}
+
+
+
+
+
+	/** Calls the specified function to parse a single section.
+	If instrumentation is requested, measures the section's time and amount of data and adds them to the section's stats. */
+	template <typename Fn>
+	void parseSection(const char * aSectionName, Fn && aParseFn)
+	{
+		if (mStats == nullptr)
+		{
+			aParseFn();
+			return;
+		}
+		auto startTime = std::chrono::steady_clock::now();
+		auto startBytes = mLineExtractor.numBytesConsumed();
+		auto startLine = mLineExtractor.currentLineNum();
+		aParseFn();
+		auto & section = mStats->mSections[aSectionName];
+		section.mSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		section.mNumBytes += mLineExtractor.numBytesConsumed() - startBytes;
+		section.mNumLines += mLineExtractor.currentLineNum() - startLine;
+	}
+
+
+
+
+
+	/** Parses the individual sections from mLineExtractor into mDrawing.
+	If aShouldStopAtEntities is true, stops at the start of the ENTITIES section and returns true, leaving the section
+	for readNextEntity(); returns false when the end of the data is reached (or the layer list, if not continuing). */
+	bool parseSections(bool aShouldContinueAfterLayerList, bool aShouldStopAtEntities = false)
 	{
 		for (;;)
 		{
@@ -1268,7 +1825,7 @@ public:
 					if (isSameStringIgnoreCase(value, "eof"))
 					{
 						// All done.
-						return;
+						return false;
 					}
 					break;
 				}  // case 0
@@ -1277,31 +1834,35 @@ public:
 				{
 					if (isSameStringIgnoreCase(value, "header"))
 					{
-						parseHeaderSection();
+						parseSection("HEADER", [this]() { parseHeaderSection(); });
 					}
 					else if (isSameStringIgnoreCase(value, "classes"))
 					{
-						parseClassesSection();
+						parseSection("CLASSES", [this]() { parseClassesSection(); });
 					}
 					else if (isSameStringIgnoreCase(value, "tables"))
 					{
-						parseTablesSection();
+						parseSection("TABLES", [this]() { parseTablesSection(); });
 						if (!aShouldContinueAfterLayerList)
 						{
-							return;
+							return false;
 						}
 					}
 					else if (isSameStringIgnoreCase(value, "blocks"))
 					{
-						parseBlocksSection();
+						parseSection("BLOCKS", [this]() { parseBlocksSection(); });
 					}
 					else if (isSameStringIgnoreCase(value, "entities"))
 					{
-						parseEntitiesSection(nullptr);
+						if (aShouldStopAtEntities)
+						{
+							return true;
+						}
+						parseSection("ENTITIES", [this]() { parseEntitiesSection(nullptr); });
 					}
 					else if (isSameStringIgnoreCase(value, "objects"))
 					{
-						parseObjectsSection();
+						parseSection("OBJECTS", [this]() { parseObjectsSection(); });
 					}
 					break;
 				}  // case 2
@@ -1317,6 +1878,158 @@ public:
 
 
 
+	/** Scans the entire data from mLineExtractor into aStats, without creating any objects. */
+	void scan(ScanStatistics & aStats)
+	{
+		bool isInSectionHeader = false;  // Set after {0, SECTION}, until the section name
+		bool isInEntities = false;
+		std::string entityType;  // The type of the current entity, upper-case
+		double lastX[9] = {0};  // The last X coord read for groups 10 .. 18, waiting for its Y coord
+		for (;;)
+		{
+			auto [groupCode, value] = readNext();
+			if (groupCode == 0)
+			{
+				if (isSameStringIgnoreCase(value, "section"))
+				{
+					isInSectionHeader = true;
+					continue;
+				}
+				if (isSameStringIgnoreCase(value, "endsec"))
+				{
+					isInEntities = false;
+					continue;
+				}
+				if (isSameStringIgnoreCase(value, "eof"))
+				{
+					break;
+				}
+				if (!isInEntities)
+				{
+					continue;
+				}
+				entityType = value;
+				std::transform(entityType.begin(), entityType.end(), entityType.begin(), ::toupper);
+				if (entityType == "VERTEX")
+				{
+					aStats.mNumVertices += 1;
+				}
+				else if (entityType != "SEQEND")
+				{
+					aStats.mEntityCounts[entityType] += 1;
+					aStats.mNumEntities += 1;
+				}
+				continue;
+			}
+			if (isInSectionHeader)
+			{
+				if (groupCode == 2)
+				{
+					isInEntities = isSameStringIgnoreCase(value, "entities");
+					isInSectionHeader = false;
+				}
+				continue;
+			}
+			if (!isInEntities)
+			{
+				continue;
+			}
+			switch (groupCode)
+			{
+				case 1:
+				case 3:
+				{
+					if ((entityType == "TEXT") || (entityType == "MTEXT"))
+					{
+						aStats.mTextBytes += value.size();
+					}
+					break;
+				}
+				case 8:
+				{
+					if ((entityType != "VERTEX") && (entityType != "SEQEND"))
+					{
+						aStats.mLayerEntityCounts[value] += 1;
+					}
+					break;
+				}
+				case 10:
+				case 11:
+				case 12:
+				case 13:
+				case 14:
+				case 15:
+				case 16:
+				case 17:
+				case 18:
+				{
+					lastX[groupCode - 10] = valueToDouble(value);
+					if ((groupCode == 10) && (entityType == "LWPOLYLINE"))
+					{
+						aStats.mNumVertices += 1;
+					}
+					break;
+				}
+				case 20:
+				case 21:
+				case 22:
+				case 23:
+				case 24:
+				case 25:
+				case 26:
+				case 27:
+				case 28:
+				{
+					aStats.mExtent.expandTo({lastX[groupCode - 20], valueToDouble(value)});
+					break;
+				}
+				default:
+				{
+					// Other groups are not needed for the statistics
+					break;
+				}
+			}
+		}
+		aStats.mTotalBytes = mLineExtractor.numBytesConsumed();
+		reportFinalProgress();
+	}
+
+
+
+
+
+	/** Returns the next entity from the ENTITIES section, with its layer in aLayer, parsing the other sections as needed.
+	Returns nullptr once the end of the data is reached; must not be called again afterwards.
+	Used by EntityReader. */
+	PrimitivePtr readNextEntity(std::shared_ptr<Layer> & aLayer)
+	{
+		for (;;)
+		{
+			if (mReaderState == nullptr)
+			{
+				if (!parseSections(true, true))
+				{
+					reportFinalProgress();
+					return nullptr;
+				}
+				mReaderState = std::make_unique<EntitiesState>(nullptr);
+			}
+			if (auto res = parseNextEntity(*mReaderState, aLayer))
+			{
+				if (mEntityCallback)
+				{
+					mEntityCallback(aLayer, res);
+				}
+				return res;
+			}
+			mReaderState.reset();
+		}
+	}
+
+
+
+
+
 	/** Returns the contained drawing. */
 	const std::shared_ptr<Drawing> & drawing() const
 	{
@@ -1328,9 +2041,9 @@ public:
 
 
 
-std::shared_ptr<Drawing> parse(DataSource && aDataSource)
+std::shared_ptr<Drawing> parse(DataSource && aDataSource, const Options & aOptions)
 {
-	Parser parser(std::move(aDataSource));
+	Parser parser(std::move(aDataSource), aOptions);
 	parser.parse(true);
 	return parser.drawing();
 }
@@ -1339,9 +2052,59 @@ std::shared_ptr<Drawing> parse(DataSource && aDataSource)
 
 
 
-std::vector<std::string> parseLayerList(DataSource && aDataSource)
+ScanStatistics scanStatistics(DataSource && aDataSource, const Options & aOptions)
+{
+	Parser parser(std::move(aDataSource), aOptions);
+	ScanStatistics res;
+	parser.scan(res);
+	return res;
+}
+
+
+
+
+
+MemoryUsage ScanStatistics::estimateMemoryUsage() const
+{
+	// The entity types created by the parser (see Parser::parseNextEntity()):
+	static const std::map<std::string, ObjectType> objectTypes =
+	{
+		{"LINE",       otLine},
+		{"POLYLINE",   otPolyline},
+		{"LWPOLYLINE", otLWPolyline},
+		{"TEXT",       otText},
+		{"MTEXT",      otText},
+		{"POINT",      otPoint},
+		{"ARC",        otArc},
+		{"CIRCLE",     otCircle},
+	};
+
+	MemoryUsage res;
+	size_t numObjects = 0;
+	for (const auto & ec: mEntityCounts)
+	{
+		auto itr = objectTypes.find(ec.first);
+		if (itr != objectTypes.end())
+		{
+			res.addObjects(itr->second, ec.second);
+			numObjects += ec.second;
+		}
+	}
+	res.mVertices = mNumVertices * sizeof(Vertex);
+	res.mStrings = mTextBytes;
+	res.mSmartPointers += numObjects * sizeof(PrimitivePtr);
+	res.mOther = sizeof(Drawing) + mLayerEntityCounts.size() * sizeof(Layer);
+	res.mOther += numObjects * (sizeof(uint32_t) + 2 * sizeof(uint32_t));  // The layers' slot maps
+	return res;
+}
+
+
+
+
+
+std::vector<std::string> parseLayerList(DataSource && aDataSource, const Options & aOptions)
 {
-	Parser parser(std::move(aDataSource));
+	Parser parser(std::move(aDataSource), aOptions);
 	parser.parse(false);
 	std::vector<std::string> res;
 	for (const auto & lay: parser.drawing()->layers())
@@ -1355,4 +2118,71 @@ std::vector<std::string> parseLayerList(DataSource && aDataSource)
 
 
 
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// EntityReader:
+
+/** Wraps the Parser class, so that it isn't exposed in the header. */
+class EntityReader::Impl:
+	public Parser
+{
+	using Super = Parser;
+
+public:
+	using Super::Super;
+};
+
+
+
+
+
+EntityReader::EntityReader(DataSource && aDataSource, const Options & aOptions):
+	mIsAtEnd(false)
+{
+	auto options = aOptions;
+	options.mShouldStoreEntities = false;
+	mImpl = std::make_unique<Impl>(std::move(aDataSource), options);
+}
+
+
+
+
+
+EntityReader::~EntityReader()
+{
+	// Nothing explicit needed, but needs to be defined where the Impl class is complete
+}
+
+
+
+
+
+EntityReader::Entity EntityReader::next()
+{
+	Entity res;
+	if (mIsAtEnd)
+	{
+		return res;
+	}
+	res.mPrimitive = mImpl->readNextEntity(res.mLayer);
+	if (res.mPrimitive == nullptr)
+	{
+		mIsAtEnd = true;
+		res.mLayer.reset();
+	}
+	return res;
+}
+
+
+
+
+
+const std::shared_ptr<Drawing> & EntityReader::drawing() const
+{
+	return mImpl->drawing();
+}
+
+
+
+
+
 }  // namespace Dxf::Parser
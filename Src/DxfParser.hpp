@@ -1,5 +1,10 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
 #include <string>
 #include "DxfDrawing.hpp"
 #include "DataSource.hpp"
@@ -17,17 +22,261 @@ namespace Parser
 
 
 
+/** The instrumentation data collected while parsing, see Options::mStats. */
+class ParseStats
+{
+public:
+
+	/** The statistics of a single section type. */
+	class Section
+	{
+	public:
+		/** The wall-clock time spent parsing the section, in seconds. */
+		double mSeconds = 0;
+
+		/** The number of bytes of input data in the section. */
+		uint64_t mNumBytes = 0;
+
+		/** The number of lines of input data in the section (zero for binary DXF). */
+		unsigned mNumLines = 0;
+	};
+
+
+	/** The statistics of the individual sections, keyed by the upper-case section name ("HEADER", "ENTITIES", ...).
+	Sections that the parser doesn't recognize are not included. */
+	std::map<std::string, Section> mSections;
+
+	/** The total wall-clock time of the parsing, in seconds. */
+	double mTotalSeconds = 0;
+
+	/** The total number of bytes consumed from the data source. */
+	uint64_t mTotalBytes = 0;
+
+	/** The total number of lines of the input data (zero for binary DXF). */
+	unsigned mTotalLines = 0;
+
+	/** The number of the entities in the ENTITIES section, keyed by the entity type name, as found in the data.
+	Includes the entities not supported by the parser, as well as the VERTEX and SEQEND parts of polylines. */
+	std::map<std::string, size_t> mEntityCounts;
+
+	/** The number of entities in the ENTITIES section that the parser doesn't support (and skips). */
+	size_t mNumUnknownEntities = 0;
+
+	/** The number of objects (entities, vertices and layers) that the parser allocated. */
+	size_t mNumObjectAllocations = 0;
+
+	/** The number of times the LineExtractor's buffer had to be enlarged to fit a long line. */
+	unsigned mNumBufferGrowths = 0;
+
+	/** The final size of the LineExtractor's buffer. */
+	size_t mBufferSize = 0;
+
+	/** The number of times the data source has been called. */
+	size_t mNumDataSourceReads = 0;
+};
+
+
+
+
+
+/** The statistics of the DXF data gathered by scanStatistics(), without parsing the data into a Drawing. */
+class ScanStatistics
+{
+public:
+
+	/** The number of the entities in the ENTITIES section, keyed by the entity type name, as found in the data.
+	Includes the entities not supported by the parser, but not the VERTEX and SEQEND parts of polylines. */
+	std::map<std::string, size_t> mEntityCounts;
+
+	/** The number of the entities in the ENTITIES section, keyed by the layer name, as found in the data. */
+	std::map<std::string, size_t> mLayerEntityCounts;
+
+	/** The total number of the entities in the ENTITIES section (not including VERTEX and SEQEND). */
+	size_t mNumEntities = 0;
+
+	/** The total number of the polyline vertices (VERTEX entities and LWPOLYLINE vertices) in the ENTITIES section. */
+	size_t mNumVertices = 0;
+
+	/** The total size of the texts (TEXT and MTEXT) in the ENTITIES section, in bytes. */
+	uint64_t mTextBytes = 0;
+
+	/** The approximate extent of the entities in the ENTITIES section.
+	Includes all the points stored in the data, but not the extent of the arcs, circles and texts around their points. */
+	Extent mExtent;
+
+	/** The total number of bytes consumed from the data source. */
+	uint64_t mTotalBytes = 0;
+
+
+	/** Returns the estimate of the memory that the drawing would use once fully parsed, see Drawing::memoryUsage(). */
+	MemoryUsage estimateMemoryUsage() const;
+};
+
+
+
+
+
+/** Exception thrown by the parsing functions when the parsing is cancelled by the progress callback. */
+class Cancelled:
+	public std::runtime_error
+{
+	using Super = std::runtime_error;
+
+
+public:
+
+	/** The number of bytes consumed from the data source before the parsing was cancelled. */
+	uint64_t mNumBytesConsumed;
+
+
+	Cancelled(uint64_t aNumBytesConsumed):
+		Super("Dxf::Parser::Cancelled"),
+		mNumBytesConsumed(aNumBytesConsumed)
+	{
+	}
+};
+
+
+
+
+
+/** The callback used to report the parsing progress and to cancel the parsing.
+aNumBytesConsumed is the number of bytes of the input data processed so far.
+aTotalSize is the total size of the input data as given in Options::mTotalSize, zero if not known.
+Return true to continue parsing, false to cancel it; the parser then throws a Cancelled exception. */
+using ProgressCallback = std::function<bool (uint64_t /* aNumBytesConsumed */, uint64_t /* aTotalSize */)>;
+
+
+
+
+
+/** The callback used to emit the entities as soon as they are parsed completely, see Options::mEntityCallback.
+aLayer is the layer into which the entity has been added. */
+using EntityCallback = std::function<void (const std::shared_ptr<Layer> & /* aLayer */, const PrimitivePtr & /* aEntity */)>;
+
+
+
+
+
+/** Options that modify the parsing. */
+class Options
+{
+public:
+
+	/** If not nullptr, the parser fills in the instrumentation data while parsing.
+	When nullptr (the default), no instrumentation data is collected and there's no measurable overhead. */
+	ParseStats * mStats;
+
+	/** If set, the parser calls this each time it consumes another mProgressInterval bytes of the input data,
+	and once more when the parsing finishes successfully. Returning false from the callback cancels the parsing. */
+	ProgressCallback mProgressCallback;
+
+	/** The number of bytes of input data to consume between the calls to mProgressCallback. */
+	uint64_t mProgressInterval;
+
+	/** The total size of the input data, if known (such as the file size), passed to mProgressCallback.
+	Zero if not known (default). */
+	uint64_t mTotalSize;
+
+	/** If set, the parser calls this for each entity of the ENTITIES section, as soon as the entity is complete
+	(for polylines, once all their vertices have been read). The entity is already added to its layer.
+	Entities within block definitions, and entities on layers not present in the drawing, are not reported. */
+	EntityCallback mEntityCallback;
+
+	/** If false, the entities of the ENTITIES section are not added to their layers, they are only reported
+	through mEntityCallback; the memory use of the parsing then doesn't grow with the number of entities.
+	True by default. */
+	bool mShouldStoreEntities;
+
+
+	/** Creates the default options: no instrumentation, no progress reporting. */
+	Options():
+		mStats(nullptr),
+		mProgressInterval(1024 * 1024),
+		mTotalSize(0),
+		mShouldStoreEntities(true)
+	{
+	}
+};
+
+
+
+
+
+/** Reads the entities of the ENTITIES section one by one, as they are parsed, without storing them in a Drawing.
+Meant for streaming processing of huge files: the memory use doesn't depend on the number of entities,
+only the layers and the entity currently being parsed are kept in the memory.
+Entities within block definitions, and entities on layers not present in the drawing, are not returned.
+Throws the same exceptions as parse(); after an exception, the reader must not be used anymore. */
+class EntityReader
+{
+public:
+
+	/** A single entity returned by next(). */
+	class Entity
+	{
+	public:
+		/** The entity, nullptr if there are no more entities. */
+		PrimitivePtr mPrimitive;
+
+		/** The layer on which the entity is. */
+		std::shared_ptr<Layer> mLayer;
+
+		/** Returns true if the entity is valid (there was another entity to return). */
+		explicit operator bool() const { return (mPrimitive != nullptr); }
+	};
+
+
+	/** Creates a new reader that reads the data from the specified data source.
+	Options::mShouldStoreEntities is ignored, the entities are never stored. */
+	EntityReader(DataSource && aDataSource, const Options & aOptions = Options());
+
+	// Disable copy- and move-constructors:
+	EntityReader(const EntityReader & aOther) = delete;
+	EntityReader(EntityReader && aOther) = delete;
+
+	~EntityReader();
+
+	/** Parses the data up to the end of the next entity and returns it (for polylines, including all their vertices).
+	Returns an invalid Entity once there are no more entities. */
+	Entity next();
+
+	/** Returns the drawing with the data parsed so far: the layers, but none of the entities. */
+	const std::shared_ptr<Drawing> & drawing() const;
+
+
+protected:
+
+	/** The internal parser doing the actual work. */
+	class Impl;
+	std::unique_ptr<Impl> mImpl;
+
+	/** Set once next() has reached the end of the data. */
+	bool mIsAtEnd;
+};
+
+
+
+
+
 /** Parses the DXF data from the specified data source.
 Returns the DXF drawing contained within.
-Throws a Dxf::Parser::Error exception upon an error.
+Throws a Dxf::Parser::Error exception upon an error, or a Dxf::Parser::Cancelled exception if cancelled by the progress callback.
+May throw other exceptions coming from the underlying systems, such as when reading the data source. */
+std::shared_ptr<Drawing> parse(DataSource && aDataSource, const Options & aOptions = Options());
+
+/** Scans the DXF data from the specified data source and returns its statistics.
+Only tokenizes the data, doesn't construct any objects, so it is much faster than the full parse and uses
+a constant amount of memory (apart from the per-type and per-layer counts).
+Throws a Dxf::Parser::Error exception upon an error, or a Dxf::Parser::Cancelled exception if cancelled by the progress callback.
 May throw other exceptions coming from the underlying systems, such as when reading the data source. */
-std::shared_ptr<Drawing> parse(DataSource && aDataSource);
+ScanStatistics scanStatistics(DataSource && aDataSource, const Options & aOptions = Options());
 
 /** Parses the DXF data from the specified data source, until it reads the complete layer list, then returns the names of the layers.
 Is faster than the full parse, because the layer list is at the top of the file.
-Throws a Dxf::Parser::Error exception upon an error.
+Throws a Dxf::Parser::Error exception upon an error, or a Dxf::Parser::Cancelled exception if cancelled by the progress callback.
 May throw other exceptions coming from the underlying systems, such as when reading the data source. */
-std::vector<std::string> parseLayerList(DataSource && aDataSource);
+std::vector<std::string> parseLayerList(DataSource && aDataSource, const Options & aOptions = Options());
 
 
 
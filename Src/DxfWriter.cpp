@@ -1,285 +1,1513 @@
-// TODO
+// DxfWriter.cpp
 
+// Implements the Dxf::Writer class that serializes a Drawing into DXF data
 
+#include "DxfWriter.hpp"
+#include "BinaryDxf.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <condition_variable>
+#include <cstring>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 
-#if 0
-void Layer::SaveToStream(TMStream * iStream, bool BlocksSection) const
+
+
+
+namespace Dxf::Writer
+{
+
+
+
+
+
+namespace
+{
+	/** The size of the output buffer.
+	The data sink is called with blocks of (up to) this size. */
+	static const size_t BUFFER_SIZE = 1024 * 1024;
+
+	/** The line separator written after each group code and value. */
+	static const char LINE_END[] = "\r\n";
+
+	/** The maximum number of bytes that a single formatted number may take.
+	Fixed-precision output of huge values may need more, those fall back to the shortest representation. */
+	static const size_t MAX_NUMBER_LENGTH = 64;
+
+	/** The number of entities formatted as a single chunk, when formatting the ENTITIES section in parallel. */
+	static const size_t ENTITIES_PER_CHUNK = 4096;
+
+	/** The max number of formatted chunks waiting to be written, per thread, when formatting in parallel.
+	Limits the memory used for the formatted data. */
+	static const size_t MAX_CHUNKS_IN_FLIGHT_PER_THREAD = 4;
+
+	/** The name of the layer to which the objects in block definitions belong. */
+	static const std::string BLOCK_LAYER_NAME = "0";
+
+	/** The header variables that the writer generates itself, their raw values are not written. */
+	static const char * const GENERATED_HEADER_VARIABLES[] = {"$EXTMIN", "$EXTMAX", "$HANDSEED"};
+
+
+
+
+
+	/** A range of consecutive raw groups forming a single item, such as a table, a block or a header variable. */
+	class RawItem
+	{
+	public:
+
+		/** The name of the item: the table or block name, or the header variable name. */
+		std::string_view mName;
+
+		/** The index of the item's first group. */
+		size_t mBegin;
+
+		/** The index after the item's last group. */
+		size_t mEnd;
+	};
+
+
+
+
+
+	/** Returns true if the two strings are the same, ignoring the case of ASCII letters. */
+	static bool isSameNameIgnoreCase(std::string_view aName1, std::string_view aName2)
+	{
+		if (aName1.size() != aName2.size())
+		{
+			return false;
+		}
+		for (size_t i = 0; i < aName1.size(); ++i)
+		{
+			if (std::tolower(static_cast<unsigned char>(aName1[i])) != std::tolower(static_cast<unsigned char>(aName2[i])))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+
+
+
+	/** Splits the raw groups into items, each one starting with a group with aStartGroupCode.
+	If aStartValue is nullptr, the start group's value is the item's name (header variables);
+	otherwise only the groups with the aStartValue value start an item and the item's name is the value of its first
+	group 2 (tables, blocks). The groups before the first item are ignored. */
+	static std::vector<RawItem> splitRawGroups(const RawGroups & aGroups, int aStartGroupCode, const char * aStartValue)
+	{
+		std::vector<RawItem> res;
+		bool hasName = false;
+		for (size_t i = 0, count = aGroups.size(); i < count; ++i)
+		{
+			auto groupCode = aGroups.groupCode(i);
+			auto value = aGroups.value(i);
+			if (
+				(groupCode == aStartGroupCode) &&
+				((aStartValue == nullptr) || isSameNameIgnoreCase(value, aStartValue))
+			)
+			{
+				if (!res.empty())
+				{
+					res.back().mEnd = i;
+				}
+				res.push_back({(aStartValue == nullptr) ? value : std::string_view(), i, count});
+				hasName = (aStartValue == nullptr);
+			}
+			else if ((groupCode == 2) && !hasName && !res.empty())
+			{
+				res.back().mName = value;
+				hasName = true;
+			}
+		}
+		return res;
+	}
+
+
+
+
+
+	/** The raw entities of a drawing, arranged by their positions among the parsed entities. */
+	class RawEntityPlacement
+	{
+	public:
+
+		/** The raw groups of the entities written right after each parsed entity. */
+		std::unordered_map<const Primitive *, RawItem> mAfterEntity;
+
+		/** The raw groups of the entities written before all the parsed entities. */
+		std::vector<RawItem> mAtStart;
+
+		/** The raw groups of the entities written after all the parsed entities, because their position is unknown. */
+		std::vector<RawItem> mAtEnd;
+	};
+
+
+
+
+
+	/** Arranges the raw entities of the drawing by their recorded positions (Drawing::mRawEntityPositions).
+	The consecutive raw entities following the same parsed entity form a single range. */
+	static RawEntityPlacement placeRawEntities(const Drawing & aDrawing)
+	{
+		RawEntityPlacement res;
+		const auto & positions = aDrawing.mRawEntityPositions;
+		auto numGroups = aDrawing.mRawEntities.size();
+		size_t placedBegin = std::min(positions.empty() ? numGroups : positions[0].mFirstGroup, numGroups);
+		if (placedBegin > 0)
+		{
+			res.mAtEnd.push_back({{}, 0, placedBegin});
+		}
+
+		// Split the groups into the ranges following the same entity, in their order:
+		std::vector<std::pair<const Primitive *, RawItem>> ranges;
+		for (size_t i = 0, count = positions.size(); i < count; ++i)
+		{
+			auto begin = std::max(std::min(positions[i].mFirstGroup, numGroups), placedBegin);
+			auto end = (i + 1 < count) ? std::max(std::min(positions[i + 1].mFirstGroup, numGroups), begin) : numGroups;
+			auto preceding = positions[i].mPrecedingEntity.get();
+			placedBegin = end;
+			if (!ranges.empty() && (ranges.back().first == preceding))
+			{
+				ranges.back().second.mEnd = end;
+			}
+			else if (begin < end)
+			{
+				ranges.push_back({preceding, {{}, begin, end}});
+			}
+		}
+
+		// Place the ranges after their entities, those whose entity is no longer in the layers go to the end:
+		for (const auto & range: ranges)
+		{
+			if (range.first == nullptr)
+			{
+				res.mAtStart.push_back(range.second);
+			}
+			else
+			{
+				res.mAfterEntity[range.first] = range.second;
+			}
+		}
+		if (res.mAfterEntity.empty())
+		{
+			return res;
+		}
+		std::unordered_set<const Primitive *> present;
+		for (const auto & lay: aDrawing.layers())
+		{
+			lay->forEachObject([&res, &present](const PrimitivePtr & aObject)
+			{
+				if (res.mAfterEntity.find(aObject.get()) != res.mAfterEntity.end())
+				{
+					present.insert(aObject.get());
+				}
+			});
+		}
+		for (const auto & range: ranges)
+		{
+			if ((range.first != nullptr) && (present.find(range.first) == present.end()))
+			{
+				res.mAfterEntity.erase(range.first);
+				res.mAtEnd.push_back(range.second);
+			}
+		}
+		return res;
+	}
+}
+
+
+
+
+
+class Writer
 {
-	SF_THISFN_STACK(Name.c_str());
+	/** The data sink into which the output is written, whenever mBuffer fills up. */
+	DataSink mDataSink;
+
+	/** The output buffer. */
+	std::vector<char> mBuffer;
+
+	/** The number of bytes in mBuffer that contain valid data. */
+	size_t mBufferUsed;
+
+	/** The options modifying the output. */
+	Options mOptions;
+
+
+
+
+
+	/** Sends the data in mBuffer into the data sink and empties the buffer. */
+	void flush()
+	{
+		if (mBufferUsed > 0)
+		{
+			mDataSink(mBuffer.data(), mBufferUsed);
+			mBufferUsed = 0;
+		}
+	}
+
+
+
+
+
+	/** Appends the specified raw data into the output.
+	Data larger than the buffer is sent directly to the data sink. */
+	void append(const char * aData, size_t aSize)
+	{
+		if (mBufferUsed + aSize > mBuffer.size())
+		{
+			flush();
+			if (aSize > mBuffer.size())
+			{
+				mDataSink(aData, aSize);
+				return;
+			}
+		}
+		std::memcpy(mBuffer.data() + mBufferUsed, aData, aSize);
+		mBufferUsed += aSize;
+	}
+
+
+
+
+
+	/** Makes sure there is at least aSize bytes of free space in mBuffer, flushing it if needed.
+	Returns the pointer to the free space. */
+	char * reserve(size_t aSize)
+	{
+		assert(aSize <= mBuffer.size());
+		if (mBufferUsed + aSize > mBuffer.size())
+		{
+			flush();
+		}
+		return mBuffer.data() + mBufferUsed;
+	}
+
+
+
+
+
+	/** Appends the line end into the output. */
+	void appendLineEnd()
+	{
+		append(LINE_END, sizeof(LINE_END) - 1);
+	}
+
+
+
+
+
+	/** Formats the specified integral value directly into the output. */
+	void appendInt(int aValue)
+	{
+		auto dst = reserve(MAX_NUMBER_LENGTH);
+		auto res = std::to_chars(dst, dst + MAX_NUMBER_LENGTH, aValue);
+		assert(res.ec == std::errc());
+		mBufferUsed += static_cast<size_t>(res.ptr - dst);
+	}
+
+
+
+
+
+	/** Formats the specified floating-point value directly into the output.
+	Uses either the shortest round-trip representation, or the fixed number of decimal places, based on mOptions. */
+	void appendDouble(double aValue)
+	{
+		auto dst = reserve(MAX_NUMBER_LENGTH);
+		auto end = dst + MAX_NUMBER_LENGTH;
+		if (mOptions.mDecimalPlaces >= 0)
+		{
+			auto res = std::to_chars(dst, end, aValue, std::chars_format::fixed, mOptions.mDecimalPlaces);
+			if (res.ec == std::errc())
+			{
+				mBufferUsed += static_cast<size_t>(trimFixedNumber(dst, res.ptr) - dst);
+				return;
+			}
+			// The value doesn't fit (huge number), fall back to the shortest representation
+		}
+		auto res = std::to_chars(dst, end, aValue);
+		assert(res.ec == std::errc());
+		mBufferUsed += static_cast<size_t>(res.ptr - dst);
+	}
+
+
+
+
+
+	/** Removes the trailing zeroes (and the decimal point, if all decimals are removed) from the fixed-format number.
+	Also changes a "negative zero" result into a plain zero.
+	Returns the new end of the number. */
+	static char * trimFixedNumber(char * aStart, char * aEnd)
+	{
+		if (std::find(aStart, aEnd, '.') != aEnd)
+		{
+			while (aEnd[-1] == '0')
+			{
+				--aEnd;
+			}
+			if (aEnd[-1] == '.')
+			{
+				--aEnd;
+			}
+		}
+		if ((aEnd - aStart == 2) && (aStart[0] == '-') && (aStart[1] == '0'))
+		{
+			aStart[0] = '0';
+			--aEnd;
+		}
+		return aEnd;
+	}
+
+
+
+
+
+	/** Appends the specified integer as a little-endian binary number of the specified byte size. */
+	void appendBinaryUInt(uint64_t aValue, size_t aNumBytes)
+	{
+		auto dst = reserve(aNumBytes);
+		for (size_t i = 0; i < aNumBytes; ++i)
+		{
+			dst[i] = static_cast<char>(aValue & 0xff);
+			aValue >>= 8;
+		}
+		mBufferUsed += aNumBytes;
+	}
+
+
+
+
+
+	/** Appends the specified integral value in the binary representation used for the specified group code. */
+	void appendBinaryInt(int aGroupCode, int64_t aValue)
+	{
+		switch (binaryValueType(aGroupCode))
+		{
+			case bvtInt16:  appendBinaryUInt(static_cast<uint64_t>(aValue), 2); return;
+			case bvtInt32:  appendBinaryUInt(static_cast<uint64_t>(aValue), 4); return;
+			case bvtInt64:  appendBinaryUInt(static_cast<uint64_t>(aValue), 8); return;
+			case bvtBool:   appendBinaryUInt((aValue != 0) ? 1 : 0, 1); return;
+			case bvtDouble: appendBinaryDouble(aGroupCode, static_cast<double>(aValue)); return;
+			case bvtString:
+			case bvtBinaryChunk:
+			{
+				// Not expected, but keep the output consistent: store as a string
+				appendInt(static_cast<int>(aValue));
+				append("", 1);
+				return;
+			}
+		}
+	}
+
+
+
+
+
+	/** Appends the specified floating-point value in the binary representation used for the specified group code. */
+	void appendBinaryDouble(int aGroupCode, double aValue)
+	{
+		switch (binaryValueType(aGroupCode))
+		{
+			case bvtDouble:
+			{
+				uint64_t bits;
+				static_assert(sizeof(bits) == sizeof(aValue));
+				std::memcpy(&bits, &aValue, sizeof(bits));
+				appendBinaryUInt(bits, 8);
+				return;
+			}
+			case bvtInt16:
+			case bvtInt32:
+			case bvtInt64:
+			case bvtBool:
+			{
+				appendBinaryInt(aGroupCode, static_cast<int64_t>(aValue));
+				return;
+			}
+			case bvtString:
+			case bvtBinaryChunk:
+			{
+				// Not expected, but keep the output consistent: store as a string
+				appendDouble(aValue);
+				append("", 1);
+				return;
+			}
+		}
+	}
+
+
+
+
+
+	/** Appends the specified group code into the output.
+	Text output has the group code followed by a line end, binary output uses 2 bytes. */
+	void writeGroupCode(int aGroupCode)
+	{
+		if (mOptions.mFormat == ofBinary)
+		{
+			appendBinaryUInt(static_cast<uint64_t>(aGroupCode), 2);
+			return;
+		}
+		appendInt(aGroupCode);
+		appendLineEnd();
+	}
+
+
+
+
+
+	/** Appends the terminator after a string value: a line end for text output, a NUL for binary output. */
+	void appendStringEnd()
+	{
+		if (mOptions.mFormat == ofBinary)
+		{
+			append("", 1);
+		}
+		else
+		{
+			appendLineEnd();
+		}
+	}
+
+
+
+
+
+	/** Writes the specified group code and string value. */
+	void writeGroup(int aGroupCode, const std::string & aValue)
+	{
+		writeGroupCode(aGroupCode);
+		append(aValue.data(), aValue.size());
+		appendStringEnd();
+	}
+
+
+
+
+
+	/** Writes the specified group code and string value. */
+	void writeGroup(int aGroupCode, const char * aValue)
+	{
+		writeGroupCode(aGroupCode);
+		append(aValue, std::strlen(aValue));
+		appendStringEnd();
+	}
+
+
+
+
+
+	/** Writes the specified group code and integral value. */
+	void writeGroup(int aGroupCode, int aValue)
+	{
+		writeGroupCode(aGroupCode);
+		if (mOptions.mFormat == ofBinary)
+		{
+			appendBinaryInt(aGroupCode, aValue);
+			return;
+		}
+		appendInt(aValue);
+		appendLineEnd();
+	}
+
+
+
+
+
+	/** Writes the specified group code and floating-point value. */
+	void writeGroup(int aGroupCode, double aValue)
+	{
+		writeGroupCode(aGroupCode);
+		if (mOptions.mFormat == ofBinary)
+		{
+			appendBinaryDouble(aGroupCode, aValue);
+			return;
+		}
+		appendDouble(aValue);
+		appendLineEnd();
+	}
+
+
+
+
+
+	/** Writes the specified raw groups, preserved by the parser, unchanged.
+	For binary output, the values are converted into the binary representation used for their group codes. */
+	void writeRawGroups(const RawGroups & aGroups)
+	{
+		writeRawGroups(aGroups, 0, aGroups.size());
+	}
+
+
+
+
+
+	/** Writes the raw groups in the [aBegin, aEnd) range, the same way as writeRawGroups(aGroups). */
+	void writeRawGroups(const RawGroups & aGroups, size_t aBegin, size_t aEnd)
+	{
+		for (size_t i = aBegin; i < aEnd; ++i)
+		{
+			auto groupCode = aGroups.groupCode(i);
+			auto value = aGroups.value(i);
+			writeGroupCode(groupCode);
+			if (mOptions.mFormat == ofBinary)
+			{
+				appendBinaryRawValue(groupCode, value);
+				continue;
+			}
+			append(value.data(), value.size());
+			appendLineEnd();
+		}
+	}
+
+
+
+
+
+	/** Appends the specified raw value (in its text DXF representation) in the binary representation used for the specified group code.
+	Values that cannot be converted are stored as strings. */
+	void appendBinaryRawValue(int aGroupCode, std::string_view aValue)
+	{
+		auto begin = aValue.data();
+		auto end = begin + aValue.size();
+		while ((begin < end) && (*begin == ' '))
+		{
+			++begin;
+		}
+		while ((end > begin) && (end[-1] == ' '))
+		{
+			--end;
+		}
+		switch (binaryValueType(aGroupCode))
+		{
+			case bvtDouble:
+			{
+				double v;
+				auto res = std::from_chars(begin, end, v);
+				if ((res.ec == std::errc()) && (res.ptr == end))
+				{
+					appendBinaryDouble(aGroupCode, v);
+					return;
+				}
+				break;
+			}
+			case bvtInt16:
+			case bvtInt32:
+			case bvtInt64:
+			case bvtBool:
+			{
+				int64_t v;
+				auto res = std::from_chars(begin, end, v);
+				if ((res.ec == std::errc()) && (res.ptr == end))
+				{
+					appendBinaryInt(aGroupCode, v);
+					return;
+				}
+				break;
+			}
+			case bvtBinaryChunk:
+			{
+				// Decode the hex representation used by the text DXF:
+				auto len = static_cast<size_t>(end - begin) / 2;
+				if (len > 255)
+				{
+					break;
+				}
+				char data[255];
+				bool isValid = true;
+				for (size_t i = 0; i < len; ++i)
+				{
+					auto hi = hexDigitValue(begin[2 * i]);
+					auto lo = hexDigitValue(begin[2 * i + 1]);
+					isValid = isValid && (hi >= 0) && (lo >= 0);
+					data[i] = static_cast<char>((hi << 4) | lo);
+				}
+				if (!isValid)
+				{
+					break;
+				}
+				appendBinaryUInt(len, 1);
+				append(data, len);
+				return;
+			}
+			case bvtString:
+			{
+				break;
+			}
+		}
+		append(aValue.data(), aValue.size());
+		append("", 1);
+	}
+
+
+
+
+
+	/** Returns the value of the specified hex digit, or -1 if it is not a hex digit. */
+	static int hexDigitValue(char aDigit)
+	{
+		if ((aDigit >= '0') && (aDigit <= '9'))
+		{
+			return aDigit - '0';
+		}
+		if ((aDigit >= 'a') && (aDigit <= 'f'))
+		{
+			return aDigit - 'a' + 10;
+		}
+		if ((aDigit >= 'A') && (aDigit <= 'F'))
+		{
+			return aDigit - 'A' + 10;
+		}
+		return -1;
+	}
+
+
+
+
+
+	/** Writes the specified raw section of the drawing, if it is present. */
+	void writeRawSection(const Drawing & aDrawing, const std::string & aSectionName)
+	{
+		auto itr = aDrawing.mRawSections.find(aSectionName);
+		if (itr == aDrawing.mRawSections.end())
+		{
+			return;
+		}
+		writeGroup(0, "SECTION");
+		writeGroup(2, aSectionName);
+		writeRawGroups(itr->second);
+		writeGroup(0, "ENDSEC");
+	}
+
+
+
+
+
+	/** Writes the three groups for the specified coords.
+	aBaseGroupCode is the group code of the X coord, Y and Z use the group codes +10 and +20. */
+	void writeCoords(int aBaseGroupCode, const Coords & aCoords)
+	{
+		writeGroup(aBaseGroupCode,      aCoords.mX);
+		writeGroup(aBaseGroupCode + 10, aCoords.mY);
+		writeGroup(aBaseGroupCode + 20, aCoords.mZ);
+	}
+
+
+
+
+
+	/** Writes the color group for the specified color.
+	Nothing is written for COLOR_BYLAYER, since that is the default. */
+	void writeColor(Color aColor)
+	{
+		if (aColor == COLOR_BYLAYER)
+		{
+			return;  // No value must be written in DXF
+		}
+		if ((aColor < 0) || (aColor > 256))
+		{
+			// Invalid color number, use ByBlock as a dummy
+			aColor = COLOR_BYBLOCK;
+		}
+		writeGroup(62, aColor);
+	}
+
+
+
+
+
+	/** Writes the entity type, handles, layer and color groups that start each entity. */
+	void writeEntityStart(const char * aEntityType, const Primitive & aObject, const std::string & aLayerName)
+	{
+		writeGroup(0, aEntityType);
+		writeHandles(aObject);
+		writeGroup(8, aLayerName);
+		writeColor(aObject.mColor);
+	}
+
+
+
+
+
+	/** Writes the handle and owner handle groups of the specified object, for the handles that are set. */
+	void writeHandles(const Primitive & aObject)
+	{
+		if (aObject.mHandle != 0)
+		{
+			writeHandle(5, aObject.mHandle);
+		}
+		if (aObject.mOwnerHandle != 0)
+		{
+			writeHandle(330, aObject.mOwnerHandle);
+		}
+	}
+
+
+
+
+
+	/** Writes the specified group code and handle value (as a hex number). */
+	void writeHandle(int aGroupCode, uint64_t aHandle)
+	{
+		writeGroupCode(aGroupCode);
+		char buf[MAX_NUMBER_LENGTH];
+		auto res = std::to_chars(buf, buf + sizeof(buf), aHandle, 16);
+		for (auto p = buf; p < res.ptr; ++p)
+		{
+			if ((*p >= 'a') && (*p <= 'f'))
+			{
+				*p = static_cast<char>(*p - 'a' + 'A');
+			}
+		}
+		append(buf, static_cast<size_t>(res.ptr - buf));
+		appendStringEnd();
+	}
+
+
+
+
+
+	/** Returns the largest handle used by the objects and the raw data in the drawing, 0 if there are no handles.
+	The raw HEADER section is not included, its only handle is the original $HANDSEED. */
+	static uint64_t maxUsedHandle(const Drawing & aDrawing)
+	{
+		uint64_t res = 0;
+		auto addObject = [&res](const Primitive & aObject)
+		{
+			res = std::max({res, aObject.mHandle, aObject.mOwnerHandle});
+			switch (aObject.mObjectType)
+			{
+				case otPolyline:
+				case otPolygon:
+				{
+					for (const auto & v: static_cast<const MultiVertex &>(aObject).mVertices)
+					{
+						res = std::max({res, v.mHandle, v.mOwnerHandle});
+					}
+					break;
+				}
+				default:
+				{
+					break;
+				}
+			}
+		};
+		auto addRawGroups = [&res](const RawGroups & aGroups)
+		{
+			for (size_t i = 0, count = aGroups.size(); i < count; ++i)
+			{
+				if (aGroups.groupCode(i) != 5)
+				{
+					continue;
+				}
+				auto value = aGroups.value(i);
+				uint64_t handle;
+				auto parsed = std::from_chars(value.data(), value.data() + value.size(), handle, 16);
+				if (parsed.ec == std::errc())
+				{
+					res = std::max(res, handle);
+				}
+			}
+		};
+
+		for (const auto & lay: aDrawing.layers())
+		{
+			lay->forEachObject([&addObject](const PrimitivePtr & aObject)
+			{
+				addObject(*aObject);
+			});
+		}
+		for (const auto & bd: aDrawing.mBlockDefinitions)
+		{
+			for (const auto & obj: bd.second->mObjects)
+			{
+				addObject(*obj);
+			}
+		}
+		addRawGroups(aDrawing.mRawEntities);
+		for (const auto & rs: aDrawing.mRawSections)
+		{
+			if (rs.first == "HEADER")
+			{
+				continue;
+			}
+			addRawGroups(rs.second);
+		}
+		return res;
+	}
+
+
+
+
+
+	/** Writes the HEADER section, containing the extents of the entire drawing and the handle seed, if handles are used,
+	followed by the other variables of the raw HEADER section, if present. */
+	void writeHeaderSection(const Drawing & aDrawing)
+	{
+		Extent extent;
+		for (const auto & lay: aDrawing.layers())
+		{
+			lay->forEachObject([&extent](const PrimitivePtr & aObject)
+			{
+				extent.expandTo(aObject->extent());
+			});
+		}
+
+		writeGroup(0, "SECTION");
+		writeGroup(2, "HEADER");
+		writeGroup(9, "$EXTMIN");
+		writeCoords(10, extent.minCoord());
+		writeGroup(9, "$EXTMAX");
+		writeCoords(10, extent.maxCoord());
+		auto maxHandle = maxUsedHandle(aDrawing);
+		if (maxHandle != 0)
+		{
+			// The next handle to be assigned by the applications editing the file:
+			writeGroup(9, "$HANDSEED");
+			writeHandle(5, maxHandle + 1);
+		}
+		auto itr = aDrawing.mRawSections.find("HEADER");
+		if (itr != aDrawing.mRawSections.end())
+		{
+			for (const auto & var: splitRawGroups(itr->second, 9, nullptr))
+			{
+				auto isGenerated = std::any_of(std::begin(GENERATED_HEADER_VARIABLES), std::end(GENERATED_HEADER_VARIABLES),
+					[&var](const char * aName) { return isSameNameIgnoreCase(var.mName, aName); }
+				);
+				if (!isGenerated)
+				{
+					writeRawGroups(itr->second, var.mBegin, var.mEnd);
+				}
+			}
+		}
+		writeGroup(0, "ENDSEC");
+	}
+
 
-	for (Primitives::const_iterator itr = Objects.begin(); itr != Objects.end(); ++itr)
+
+
+
+	/** Writes the TABLES section, containing the line types, text styles and layers,
+	followed by the other tables of the raw TABLES section, if present (block records, dimension styles etc.).
+	The raw VPORT, LTYPE and STYLE tables replace the generated ones, the LAYER table is always generated. */
+	void writeTablesSection(const Drawing & aDrawing)
 	{
-		if ((*itr)->ParentBlockDef == NULL)
+		static const RawGroups noRawTables;
+		auto itr = aDrawing.mRawSections.find("TABLES");
+		const auto & rawTables = (itr == aDrawing.mRawSections.end()) ? noRawTables : itr->second;
+		auto tables = splitRawGroups(rawTables, 0, "TABLE");
+		auto writeRawTable = [this, &rawTables, &tables](const char * aTableName)
+		{
+			for (const auto & table: tables)
+			{
+				if (isSameNameIgnoreCase(table.mName, aTableName))
+				{
+					writeRawGroups(rawTables, table.mBegin, table.mEnd);
+					return true;
+				}
+			}
+			return false;
+		};
+
+		writeGroup(0, "SECTION");
+		writeGroup(2, "TABLES");
+		writeRawTable("VPORT");
+		if (!writeRawTable("LTYPE"))
+		{
+			writeDefaultLineTypeTable();
+		}
+		writeLayerTable(aDrawing);
+		if (!writeRawTable("STYLE"))
+		{
+			writeDefaultStyleTable();
+		}
+
+		// The rest of the raw tables, in their original order:
+		for (const auto & table: tables)
 		{
-			(*itr)->SaveToStream(iStream, BlocksSection);
-			if ((*itr)->Extended != NULL)
+			if (
+				!isSameNameIgnoreCase(table.mName, "VPORT") &&
+				!isSameNameIgnoreCase(table.mName, "LTYPE") &&
+				!isSameNameIgnoreCase(table.mName, "STYLE")
+			)
 			{
-				(*itr)->Extended->SaveToStream(iStream);
+				writeRawGroups(rawTables, table.mBegin, table.mEnd);
 			}
 		}
-	}  // for i - Object[]
-}
+		writeGroup(0, "ENDSEC");
+	}
 
 
 
 
 
-void Drawing::SaveToStream(TMStream * iStream)
-{
-	SF_THISFN_STACK("");
+	/** Writes the LTYPE table, with the single CONTINUOUS line type used by all the layers. */
+	void writeDefaultLineTypeTable()
+	{
+		writeGroup(0, "TABLE");
+		writeGroup(2, "LTYPE");
+		writeGroup(70, 1);  // Max number of entries in the table
+		writeGroup(0, "LTYPE");
+		writeGroup(2, "CONTINUOUS");
+		writeGroup(70, 0);
+		writeGroup(3, "Solid line");
+		writeGroup(72, 65);
+		writeGroup(73, 0);
+		writeGroup(40, 0.0);
+		writeGroup(0, "ENDTAB");
+	}
+
+
+
+
+
+	/** Writes the STYLE table, with the single default text style. */
+	void writeDefaultStyleTable()
+	{
+		writeGroup(0, "TABLE");
+		writeGroup(2, "STYLE");
+		writeGroup(70, 1);
+		writeGroup(0, "STYLE");
+		writeGroup(2, "STANDARD");
+		writeGroup(70, 0);
+		writeGroup(40, 0.0);
+		writeGroup(41, 1.0);
+		writeGroup(50, 0.0);
+		writeGroup(71, 0);
+		writeGroup(42, 0.2);
+		writeGroup(3, "txt");
+		writeGroup(0, "ENDTAB");
+	}
+
+
+
+
+
+	/** Writes the LAYER table, containing all the layers of the drawing. */
+	void writeLayerTable(const Drawing & aDrawing)
+	{
+		const auto & layers = aDrawing.layers();
+		writeGroup(0, "TABLE");
+		writeGroup(2, "LAYER");
+		writeGroup(70, static_cast<int>(layers.size()));
+		for (const auto & lay: layers)
+		{
+			assert(!lay->name().empty());
+			writeGroup(0, "LAYER");
+			writeGroup(2, lay->name());
+			writeGroup(70, 0);
+			writeGroup(62, (lay->defaultColor() > 0) ? lay->defaultColor() : 7);
+			writeGroup(6, "CONTINUOUS");
+		}
+		writeGroup(0, "ENDTAB");
+	}
+
+
+
+
+
+	/** Writes the BLOCKS section, containing all the block definitions, followed by the blocks of the raw BLOCKS section,
+	if present, that have no block definition of the same name (such as the blocks referenced by the raw INSERTs). */
+	void writeBlocksSection(const Drawing & aDrawing)
+	{
+		writeGroup(0, "SECTION");
+		writeGroup(2, "BLOCKS");
+		for (const auto & blockDef: aDrawing.mBlockDefinitions)
+		{
+			const auto & name = blockDef.second->mName;
+			writeGroup(0, "BLOCK");
+			writeGroup(8, BLOCK_LAYER_NAME);
+			writeGroup(2, name);
+			writeGroup(70, 0);
+			writeCoords(10, {0, 0, 0});
+			writeGroup(3, name);
+			for (const auto & obj: blockDef.second->mObjects)
+			{
+				writeEntity(*obj, BLOCK_LAYER_NAME);
+			}
+			writeGroup(0, "ENDBLK");
+			writeGroup(8, BLOCK_LAYER_NAME);
+		}
+		auto itr = aDrawing.mRawSections.find("BLOCKS");
+		if (itr != aDrawing.mRawSections.end())
+		{
+			for (const auto & block: splitRawGroups(itr->second, 0, "BLOCK"))
+			{
+				auto isGenerated = std::any_of(aDrawing.mBlockDefinitions.begin(), aDrawing.mBlockDefinitions.end(),
+					[&block](const auto & aBlockDef) { return isSameNameIgnoreCase(block.mName, aBlockDef.first); }
+				);
+				if (!isGenerated)
+				{
+					writeRawGroups(itr->second, block.mBegin, block.mEnd);
+				}
+			}
+		}
+		writeGroup(0, "ENDSEC");
+	}
+
+
+
+
+
+	/** Writes the ENTITIES section, containing the objects of all the layers and the raw (unsupported) entities,
+	each raw entity placed after the parsed entity that preceded it in the original data. */
+	void writeEntitiesSection(const Drawing & aDrawing)
+	{
+		writeGroup(0, "SECTION");
+		writeGroup(2, "ENTITIES");
+		auto rawPlacement = placeRawEntities(aDrawing);
+		for (const auto & item: rawPlacement.mAtStart)
+		{
+			writeRawGroups(aDrawing.mRawEntities, item.mBegin, item.mEnd);
+		}
+		auto numThreads = mOptions.mNumThreads;
+		if (numThreads == 0)
+		{
+			numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		if (numThreads > 1)
+		{
+			writeEntitiesParallel(aDrawing, rawPlacement, numThreads);
+		}
+		else
+		{
+			for (const auto & lay: aDrawing.layers())
+			{
+				lay->forEachObject([this, &lay, &aDrawing, &rawPlacement](const PrimitivePtr & aObject)
+				{
+					writeEntityAndRawFollowers(*aObject, lay->name(), aDrawing, rawPlacement);
+				});
+			}
+		}
+		for (const auto & item: rawPlacement.mAtEnd)
+		{
+			writeRawGroups(aDrawing.mRawEntities, item.mBegin, item.mEnd);
+		}
+		writeGroup(0, "ENDSEC");
+	}
+
+
+
+
+
+	/** Writes a single object as a DXF entity, followed by the raw entities that followed it in the original data. */
+	void writeEntityAndRawFollowers(
+		const Primitive & aObject,
+		const std::string & aLayerName,
+		const Drawing & aDrawing,
+		const RawEntityPlacement & aRawPlacement
+	)
+	{
+		writeEntity(aObject, aLayerName);
+		if (aRawPlacement.mAfterEntity.empty())
+		{
+			return;
+		}
+		auto itr = aRawPlacement.mAfterEntity.find(&aObject);
+		if (itr != aRawPlacement.mAfterEntity.end())
+		{
+			writeRawGroups(aDrawing.mRawEntities, itr->second.mBegin, itr->second.mEnd);
+		}
+	}
+
 
-	double MinX = 1e16;
-	double MinY = MinX;
-	double MinZ = MinX;
-	double MaxX = -1e16;
-	double MaxY = MaxX;
-	double MaxZ = MaxX;
 
-	// fix names of layers/blocks, only upper letters, numbers and underscope are allowed up to 31 characters under DXF version 2000
-	DXFFixLayerNames(Layers);
-	DXFFixBlockNames(BlockDefinitions);
 
+
+	/** Formats the objects of all the layers on aNumThreads worker threads and writes them in the original order.
+	The objects are split into chunks of consecutive objects within a single layer, each worker formats whole chunks
+	into the chunk's own buffer, skipping the tombstones of the removed objects and adding the raw entities that follow
+	the chunk's objects (see writeEntityAndRawFollowers()). The calling thread writes the chunks in order as they become ready.
+	The workers never get more than MAX_CHUNKS_IN_FLIGHT_PER_THREAD chunks per thread ahead of the writing. */
+	void writeEntitiesParallel(const Drawing & aDrawing, const RawEntityPlacement & aRawPlacement, unsigned aNumThreads)
 	{
-		SF_THISFN_STACK("Find all used block definitions");
-		// find all used block definitions:
-		for (BlockDefinitions::const_iterator itr = BlockDefinitions.begin(); itr != BlockDefinitions.end(); ++itr)
+		/** A range of consecutive objects within a single layer, and their formatted output. */
+		struct Chunk
+		{
+			const Layer * mLayer;
+			size_t mBegin;
+			size_t mEnd;
+			std::string mOutput;
+			bool mIsReady;
+			std::exception_ptr mError;
+		};
+
+		// Split the objects into chunks:
+		std::vector<Chunk> chunks;
+		for (const auto & lay: aDrawing.layers())
+		{
+			auto numObjects = lay->objects().size();
+			for (size_t begin = 0; begin < numObjects; begin += ENTITIES_PER_CHUNK)
+			{
+				chunks.push_back({lay.get(), begin, std::min(begin + ENTITIES_PER_CHUNK, numObjects), {}, false, nullptr});
+			}
+		}
+		if (chunks.empty())
 		{
-			(*itr)->IsUsed = false;
+			return;
 		}
-		for (Layers::const_iterator itr = Layers.begin(); itr != Layers.end(); ++itr)
+
+		// The state shared between the workers and this thread, protected by mtx:
+		std::mutex mtx;
+		std::condition_variable cv;
+		size_t nextChunk = 0;  // Index of the next chunk to be picked up by a worker
+		size_t numWritten = 0;  // Number of chunks already written by this thread
+		bool shouldAbort = false;
+		auto maxInFlight = static_cast<size_t>(aNumThreads) * MAX_CHUNKS_IN_FLIGHT_PER_THREAD;
+
+		auto worker = [&]()
+		{
+			std::string * output = nullptr;
+			Writer formatter([&output](const char * aData, size_t aSize)
+			{
+				output->append(aData, aSize);
+			}, mOptions);
+			for (;;)
+			{
+				size_t idx;
+				{
+					std::unique_lock<std::mutex> lock(mtx);
+					cv.wait(lock, [&]()
+					{
+						return (shouldAbort || (nextChunk >= chunks.size()) || (nextChunk < numWritten + maxInFlight));
+					});
+					if (shouldAbort || (nextChunk >= chunks.size()))
+					{
+						return;
+					}
+					idx = nextChunk++;
+				}
+				auto & chunk = chunks[idx];
+				output = &chunk.mOutput;
+				try
+				{
+					const auto & objects = chunk.mLayer->objects();
+					for (size_t i = chunk.mBegin; i < chunk.mEnd; ++i)
+					{
+						if (objects[i] != nullptr)
+						{
+							formatter.writeEntityAndRawFollowers(*objects[i], chunk.mLayer->name(), aDrawing, aRawPlacement);
+						}
+					}
+					formatter.flush();
+				}
+				catch (...)
+				{
+					chunk.mError = std::current_exception();
+				}
+				{
+					std::lock_guard<std::mutex> lock(mtx);
+					chunk.mIsReady = true;
+				}
+				cv.notify_all();
+			}
+		};
+
+		// Makes sure the workers are stopped and joined, even when writing throws an exception:
+		class Workers
 		{
-			Primitives & Objects = (*itr)->Objects;
-			for (Primitives::const_iterator itrO = Objects.begin(); itrO != Objects.end(); ++itrO)
+		public:
+			std::vector<std::thread> mThreads;
+			std::mutex & mMtx;
+			std::condition_variable & mCV;
+			bool & mShouldAbort;
+
+			~Workers()
 			{
-				Primitive * const primitive = *itrO;
-				if (primitive->ObjType == otBlock)
 				{
-					static_cast<Block *>(primitive)->Definition->IsUsed = true;
+					std::lock_guard<std::mutex> lock(mMtx);
+					mShouldAbort = true;
+				}
+				mCV.notify_all();
+				for (auto & th: mThreads)
+				{
+					th.join();
 				}
-			}  // for itrO - Objects[]
-		}  // for itr - Layers[]
+			}
+		} workers{{}, mtx, cv, shouldAbort};
+		for (unsigned i = 0; i < aNumThreads; ++i)
+		{
+			workers.mThreads.emplace_back(worker);
+		}
+
+		// Write the chunks in order, as they become ready:
+		for (size_t idx = 0; idx < chunks.size(); ++idx)
+		{
+			auto & chunk = chunks[idx];
+			{
+				std::unique_lock<std::mutex> lock(mtx);
+				cv.wait(lock, [&chunk]() { return chunk.mIsReady; });
+			}
+			if (chunk.mError != nullptr)
+			{
+				std::rethrow_exception(chunk.mError);
+			}
+			append(chunk.mOutput.data(), chunk.mOutput.size());
+			std::string().swap(chunk.mOutput);  // Free the memory
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				numWritten = idx + 1;
+			}
+			cv.notify_all();
+		}
 	}
 
+
+
+
+
+	/** Writes a single object as a DXF entity.
+	Objects that have no DXF representation are silently skipped. */
+	void writeEntity(const Primitive & aObject, const std::string & aLayerName)
 	{
-		SF_THISFN_STACK("Get drawing extents");
-		// find one object and set extents to it:
-		for (Layers::const_iterator itr = Layers.begin(); itr != Layers.end(); ++itr)
+		switch (aObject.mObjectType)
 		{
-			const Primitives & Objects = (*itr)->Objects;
-			if (!Objects.empty())
+			case otLine:
 			{
-				MinX = Objects[0u]->x;
-				MaxX = MinX;
-				MinY = Objects[0u]->y;
-				MaxY = MinY;
-				MinZ = Objects[0u]->z;
-				MaxZ = MinZ;
+				const auto & line = static_cast<const Line &>(aObject);
+				writeEntityStart("LINE", line, aLayerName);
+				writeCoords(10, line.mPos);
+				writeCoords(11, line.mPos2);
 				break;
 			}
-		}  // for i
-
-		// Get extents:
-		for (Layers::const_iterator itr = Layers.begin(); itr != Layers.end(); ++itr)
-		{
-			(*itr)->GetExtent(&MinX, &MaxX, &MinY, &MaxY, &MinZ, &MaxZ);
-		}
-	}
-
-	int ID = 1;
-	const double wid = (MaxX - MinX) * 1.05;
-	const double hei = (MaxY - MinY) * 1.05;
-
-	DXFWriteStreamStr(iStream, 0, "SECTION");
-	DXFWriteStreamStr(iStream, 2, "HEADER");
-
-	/*
-	// make it an acad-2000 file:
-	// _X 2012_02_15: Doesn't work because acad2k requires lots of object handles etc.
-	DXFWriteStreamStr(iStream, 9, "$ACADVER");
-	DXFWriteStreamStr(iStream, 1, "AC1015");
-	*/
-
-	SaveCodepageToStream(iStream);
-
-	DXFWriteStreamStr(iStream, 9, "$EXTMIN");
-	DXFWriteStreamDbl(iStream, 10, MinX);
-	DXFWriteStreamDbl(iStream, 20, MinY);
-	DXFWriteStreamDbl(iStream, 30, MinZ);
-	DXFWriteStreamStr(iStream, 9, "$EXTMAX");
-	DXFWriteStreamDbl(iStream, 10, MaxX);
-	DXFWriteStreamDbl(iStream, 20, MaxY);
-	DXFWriteStreamDbl(iStream, 30, MaxZ);
-
-	DXFWriteStreamStr(iStream, 0, "ENDSEC");
-	DXFWriteStreamStr(iStream, 0, "SECTION");
-	DXFWriteStreamStr(iStream, 2, "TABLES");
-
-	// VPORT table
-	DXFWriteStreamStr(iStream, 0, "TABLE");
-	DXFWriteStreamStr(iStream, 2, "VPORT");
-	DXFWriteStreamInt(iStream, 70, 3);  // max number of entries in the table (DXF doc)
-	DXFWriteStream(iStream, 5, ID++);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTable");
-	DXFWriteStreamStr(iStream, 0, "VPORT");
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTableRecord");
-	DXFWriteStreamStr(iStream, 100, "AcDbViewportTableRecord");  // R13 stuff
-	DXFWriteStreamStr(iStream, 2, "*ACTIVE");
-	DXFWriteStreamInt(iStream, 70, 0);  // flags (read from DXF)
-	DXFWriteStreamDbl(iStream, 10, 0.0);  // vport bottleft (2D), ignored, ACAD 2k crashes if negative!
-	DXFWriteStreamDbl(iStream, 20, 0.0);
-	DXFWriteStreamDbl(iStream, 11, 1.0);  // vport topright (2D), ignored
-	DXFWriteStreamDbl(iStream, 21, 1.0);
-	DXFWriteStreamDbl(iStream, 12, (MinX + MaxX) / 2);  // vport center (2D), DCS(???)
-	DXFWriteStreamDbl(iStream, 22, (MinY + MaxY) / 2);
-	DXFWriteStreamDbl(iStream, 13, 0.0);  // snap base (2D)
-	DXFWriteStreamDbl(iStream, 23, 0.0);
-	DXFWriteStreamDbl(iStream, 14, 1.0);  // snap spacing (2D)
-	DXFWriteStreamDbl(iStream, 24, 1.0);
-	DXFWriteStreamDbl(iStream, 15, 0.0);  // grid spacing (2D)
-	DXFWriteStreamDbl(iStream, 25, 0.0);
-	DXFWriteStreamDbl(iStream, 16, 0.0);  // view direction (3D)
-	DXFWriteStreamDbl(iStream, 26, 0.0);
-	DXFWriteStreamDbl(iStream, 36, 1.0);
-	DXFWriteStreamDbl(iStream, 17, 0.0);  // view target (3D)
-	DXFWriteStreamDbl(iStream, 27, 0.0);
-	DXFWriteStreamDbl(iStream, 37, 0.0);
-	DXFWriteStreamDbl(iStream, 40, hei);  // height
-	DXFWriteStreamDbl(iStream, 41, (hei > 1e-10) ? (wid / hei) : 1.0);  // aspect ratio
-	DXFWriteStreamDbl(iStream, 42, 50.0);  // lens length (?)
-	DXFWriteStreamDbl(iStream, 43, 0.0);  // front clipping plane (?)
-	DXFWriteStreamDbl(iStream, 44, 0.0);  // back clipping plane (?)
-	DXFWriteStream(iStream, 50, 0);  // snap rotation angle
-	DXFWriteStream(iStream, 51, 0);  // view twist angle
-	DXFWriteStreamInt(iStream, 71, 0);  // viewmode variable
-	DXFWriteStreamInt(iStream, 72, 100);  // circle zoom percent
-	DXFWriteStreamInt(iStream, 73, 1);  // fast zoom setting
-	DXFWriteStreamInt(iStream, 74, 1);  // UCSICON setting
-	DXFWriteStreamInt(iStream, 75, 0);  // snap
-	DXFWriteStreamInt(iStream, 76, 0);  // grid
-	DXFWriteStreamInt(iStream, 77, 0);  // snap style
-	DXFWriteStreamInt(iStream, 78, 0);  // snap isopair
-	DXFWriteStreamStr(iStream, 0, "ENDTAB");
-
-	// LTYPE table:
-	DXFWriteStreamStr(iStream, 0, "TABLE");
-	DXFWriteStreamStr(iStream, 2, "LTYPE");
-	DXFWriteStream(iStream, 5, ID++);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTable");
-	DXFWriteStreamInt(iStream, 70, 1);
-	DXFWriteStreamStr(iStream, 0, "LTYPE");
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTableRecord");
-	DXFWriteStreamStr(iStream, 100, "AcDbLinetypeTableRecord");  // R13 stuff
-	DXFWriteStreamStr(iStream, 2, "CONTINUOUS");
-	DXFWriteStreamInt(iStream, 70, 0);
-	DXFWriteStreamStr(iStream, 3, "Solid line");
-	DXFWriteStreamInt(iStream, 72, 65);
-	DXFWriteStreamInt(iStream, 73, 0);
-	DXFWriteStreamStr(iStream, 40, "0.0");
-	DXFWriteStreamStr(iStream, 0, "ENDTAB");
-
-	// STYLE table:
-	DXFWriteStreamStr(iStream, 0, "TABLE");
-	DXFWriteStreamStr(iStream, 2, "STYLE");
-	DXFWriteStream(iStream, 5, ID++);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTable");
-	DXFWriteStreamInt(iStream, 70, 1);
-	DXFWriteStreamStr(iStream, 0, "STYLE");
-	DXFWriteStream(iStream, 5, 11);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTableRecord");
-	DXFWriteStreamStr(iStream, 100, "AcDbTextStyleTableRecord");
-	DXFWriteStreamStr(iStream, 2, "Standard");
-	DXFWriteStreamInt(iStream, 70, 0);
-	DXFWriteStreamDbl(iStream, 40, 0.0);
-	DXFWriteStreamDbl(iStream, 41, 1.0);
-	DXFWriteStream(iStream, 50, 0);
-	DXFWriteStreamInt(iStream, 71, 0);
-	DXFWriteStreamStr(iStream, 42, "0.2");
-	DXFWriteStreamStr(iStream, 3, "ARIAL.TTF");
-	DXFWriteStreamStr(iStream, 0, "ENDTAB");
-
-	DXFWriteStreamStr(iStream, 0, "TABLE");
-	DXFWriteStreamStr(iStream, 2, "LAYER");
-	DXFWriteStream(iStream, 5, ID++);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTable");
-	DXFWriteStreamInt(iStream, 70, static_cast<int>(Layers.size()));
-	for (Layers::const_iterator itr = Layers.begin(); itr != Layers.end(); ++itr)
-	{
-		SF_ASSERT(!(*itr)->Name.empty());
-		DXFWriteStreamStr(iStream, 100, "AcDbSymbolTableRecord");
-		DXFWriteStreamStr(iStream, 100, "AcDbLayerTableRecord");  // R13 stuff
-		DXFWriteStreamStr(iStream, 0, "LAYER");
-		DXFWriteStreamStr(iStream, 2, (*itr)->Name);
-		DXFWriteStreamInt(iStream, 70, 0);
-		DXFWriteStream(iStream, 62, 7);
-		DXFWriteStreamStr(iStream, 6, "CONTINUOUS");
-	}
-	DXFWriteStreamStr(iStream, 0, "ENDTAB");
-
-	DXFWriteStreamStr(iStream, 0, "TABLE");
-	DXFWriteStreamStr(iStream, 2, "APPID");
-	DXFWriteStream(iStream, 5, ID++);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTable");
-	DXFWriteStreamInt(iStream, 70, 1);
-	DXFWriteStreamStr(iStream, 0, "APPID");
-	DXFWriteStream(iStream, 5, 12);
-	DXFWriteStreamStr(iStream, 100, "AcDbSymbolTableRecord");
-	DXFWriteStreamStr(iStream, 100, "AcDbRegAppTableRecord");
-	DXFWriteStreamStr(iStream, 2, "ACAD");
-	DXFWriteStreamInt(iStream, 70, 0);
-	DXFWriteStreamStr(iStream, 0, "APPID");
-	DXFWriteStream(iStream, 5, 13);
-	DXFWriteStreamStr(iStream, 100, "AcDbRegAppTableRecord");
-	DXFWriteStreamStr(iStream, 2, "SITEFLOW"); // TODO: Replace hard-coded name with ability to add user App ID
-	DXFWriteStreamInt(iStream, 70, 0);
-	DXFWriteStreamStr(iStream, 0, "ENDTAB");
-	DXFWriteStreamStr(iStream, 0, "ENDSEC");
-
-	// save block definitions:
-	DXFWriteStreamStr(iStream, 0, "SECTION");
-	DXFWriteStreamStr(iStream, 2, "BLOCKS");
-	for (BlockDefinitions::const_iterator itr = BlockDefinitions.begin(); itr != BlockDefinitions.end(); ++itr)
-	{
-		if ((*itr)->IsUsed)
-		{
-			(*itr)->SaveHeaderToStream(iStream);
-		}
-	}  // for i
-	DXFWriteStreamStr(iStream, 0, "ENDSEC");
-
-	DXFWriteStreamStr(iStream, 0, "SECTION");
-	DXFWriteStreamStr(iStream, 2, "ENTITIES");
-
-	for (Layers::const_iterator itr = Layers.begin(); itr != Layers.end(); ++itr)
-	{
-		(*itr)->SaveToStream(iStream, false);
-	}
-
-	DXFWriteStreamStr(iStream, 0, "ENDSEC");
-	DXFWriteStreamStr(iStream, 0, "EOF");
-}
+			case otPolyline:
+			{
+				const auto & polyline = static_cast<const Polyline &>(aObject);
+				writePolyline(polyline, polyline.mFlags, aLayerName);
+				break;
+			}
+			case otPolygon:
+			{
+				writePolyline(static_cast<const MultiVertex &>(aObject), plfClosedPolyline, aLayerName);
+				break;
+			}
+			case otLWPolyline:
+			{
+				const auto & polyline = static_cast<const LWPolyline &>(aObject);
+				writeEntityStart("LWPOLYLINE", polyline, aLayerName);
+				writeGroup(90, static_cast<int>(polyline.mVertices.size()));
+				writeGroup(70, polyline.mFlags);
+				if (polyline.mWidth != 0)
+				{
+					writeGroup(43, polyline.mWidth);
+				}
+				if (polyline.mPos.mZ != 0)
+				{
+					writeGroup(38, polyline.mPos.mZ);
+				}
+				for (const auto & v: polyline.mVertices)
+				{
+					writeGroup(10, v.mPos.mX);
+					writeGroup(20, v.mPos.mY);
+					if (v.mBulge != 0)
+					{
+						writeGroup(42, v.mBulge);
+					}
+				}
+				break;
+			}
+			case otSolid:
+			{
+				const auto & solid = static_cast<const Solid &>(aObject);
+				writeEntityStart("SOLID", solid, aLayerName);
+				writeCoords(10, solid.mPos);
+				writeCoords(11, solid.mPos2);
+				writeCoords(12, solid.mPos3);
+				writeCoords(13, solid.isTetra() ? solid.mPos4 : solid.mPos3);
+				break;
+			}
+			case otCircle:
+			{
+				const auto & circle = static_cast<const Circle &>(aObject);
+				writeEntityStart("CIRCLE", circle, aLayerName);
+				writeCoords(10, circle.mPos);
+				writeGroup(40, circle.mRadius);
+				break;
+			}
+			case otSimpleEllipse:
+			{
+				const auto & ellipse = static_cast<const AxisAligned2DEllipse &>(aObject);
+				if ((ellipse.mDiameterX <= 0) || (ellipse.mDiameterY <= 0))
+				{
+					break;
+				}
+				writeEntityStart("ELLIPSE", ellipse, aLayerName);
+				writeCoords(10, ellipse.mPos);
+				if (ellipse.mDiameterX >= ellipse.mDiameterY)
+				{
+					writeCoords(11, {ellipse.mDiameterX, 0, 0});
+					writeGroup(40, ellipse.mDiameterY / ellipse.mDiameterX);
+				}
+				else
+				{
+					writeCoords(11, {0, ellipse.mDiameterY, 0});
+					writeGroup(40, ellipse.mDiameterX / ellipse.mDiameterY);
+				}
+				writeGroup(41, 0.0);
+				writeGroup(42, 2 * PI);
+				break;
+			}
+			case otArc:
+			{
+				const auto & arc = static_cast<const Arc &>(aObject);
+				writeEntityStart("ARC", arc, aLayerName);
+				writeCoords(10, arc.mPos);
+				writeGroup(40, arc.mRadius);
+				writeGroup(50, arc.mStartAngle);
+				writeGroup(51, arc.mEndAngle);
+				break;
+			}
+			case otText:
+			{
+				const auto & text = static_cast<const Text &>(aObject);
+				writeEntityStart("TEXT", text, aLayerName);
+				writeCoords(10, text.mPos);
+				writeGroup(40, text.mSize);
+				writeGroup(1, text.mRawText.str());
+				if (text.mAngle != 0)
+				{
+					writeGroup(50, text.mAngle);
+				}
+				auto hAlign = text.mAlignment & 0xff;
+				auto vAlign = (text.mAlignment >> 8) & 0xff;
+				if ((hAlign != 0) || (vAlign != 0))
+				{
+					// The alignment point is required whenever the alignment is not the default:
+					writeGroup(72, hAlign);
+					writeCoords(11, text.mPos);
+					writeGroup(73, vAlign);
+				}
+				break;
+			}
+			case otBlock:
+			{
+				const auto & block = static_cast<const Block &>(aObject);
+				if (block.mDefinition == nullptr)
+				{
+					break;
+				}
+				writeEntityStart("INSERT", block, aLayerName);
+				writeGroup(2, block.mDefinition->mName);
+				writeCoords(10, block.mPos);
+				if ((block.mScale.mX != 1) || (block.mScale.mY != 1) || (block.mScale.mZ != 1))
+				{
+					writeGroup(41, block.mScale.mX);
+					writeGroup(42, block.mScale.mY);
+					writeGroup(43, block.mScale.mZ);
+				}
+				if (block.mAngle != 0)
+				{
+					writeGroup(50, block.mAngle);
+				}
+				break;
+			}
+			case otVertex:
+			case otPoint:
+			{
+				// A standalone vertex has no DXF representation outside a polyline, write it as a point:
+				writeEntityStart("POINT", aObject, aLayerName);
+				writeCoords(10, aObject.mPos);
+				break;
+			}
+			case otError:
+			case otHatch:
+			{
+				// No DXF representation
+				break;
+			}
+		}
+	}
+
+
+
+
+
+	/** Writes the specified polyline as a POLYLINE entity, followed by its VERTEX entities and a SEQEND. */
+	void writePolyline(const MultiVertex & aPolyline, int aFlags, const std::string & aLayerName)
+	{
+		writeEntityStart("POLYLINE", aPolyline, aLayerName);
+		writeGroup(66, 1);  // Vertices follow
+		writeCoords(10, {0, 0, aPolyline.mPos.mZ});
+		writeGroup(70, aFlags);
+		if (aPolyline.mWidth != 0)
+		{
+			writeGroup(40, aPolyline.mWidth);
+			writeGroup(41, aPolyline.mWidth);
+		}
+		int vertexFlags = ((aFlags & plf3DPolyline) != 0) ? 32 : 0;
+		for (const auto & v: aPolyline.mVertices)
+		{
+			writeGroup(0, "VERTEX");
+			writeHandles(v);
+			writeGroup(8, aLayerName);
+			writeCoords(10, v.mPos);
+			if (v.mBulge != 0)
+			{
+				writeGroup(42, v.mBulge);
+			}
+			writeGroup(70, vertexFlags);
+		}
+		writeGroup(0, "SEQEND");
+		writeGroup(8, aLayerName);
+	}
+
+
+
+
+public:
+
+	Writer(DataSink && aDataSink, const Options & aOptions):
+		mDataSink(std::move(aDataSink)),
+		mBufferUsed(0),
+		mOptions(aOptions)
+	{
+		mBuffer.resize(BUFFER_SIZE);
+	}
+
+
+
+
+
+	/** Writes the entire drawing into the data sink. */
+	void write(const Drawing & aDrawing)
+	{
+		if (mOptions.mFormat == ofBinary)
+		{
+			append(BINARY_DXF_SENTINEL, BINARY_DXF_SENTINEL_SIZE);
+		}
+		writeHeaderSection(aDrawing);
+		writeRawSection(aDrawing, "CLASSES");
+		writeTablesSection(aDrawing);
+		writeBlocksSection(aDrawing);
+		writeEntitiesSection(aDrawing);
+		writeRawSection(aDrawing, "OBJECTS");
+		writeGroup(0, "EOF");
+		flush();
+	}
+};
 
 
 
 
 
-void Arc::SaveToStream(TMStream * iStream, bool BlocksSection) const
+void write(const Drawing & aDrawing, DataSink && aDataSink, const Options & aOptions)
 {
-	UNREFERENCED_PARAMETER(BlocksSection);
-
-	DXFWriteStreamStr(iStream, 0, "ARC");
-	DXFWriteStreamStr(iStream, 8, ParentLayer->Name);
-	DXFWriteStreamColor(iStream, Color);
-	DXFWriteStreamDbl(iStream, 10, x);
-	DXFWriteStreamDbl(iStream, 20, y);
-	DXFWriteStreamDbl(iStream, 30, z);
-	DXFWriteStreamDbl(iStream, 40, Diameter);
-	DXFWriteStream(iStream, 50, StartAngle);
-	DXFWriteStream(iStream, 51, EndAngle);
+	Writer writer(std::move(aDataSink), aOptions);
+	writer.write(aDrawing);
 }
 
 
 
 
 
-#endif  // 0
+}  // namespace Dxf::Writer
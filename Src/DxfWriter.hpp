@@ -1 +1,77 @@
-// TODO
+#pragma once
+
+#include <string>
+#include "DxfDrawing.hpp"
+#include "DataSink.hpp"
+
+
+
+
+
+namespace Dxf
+{
+namespace Writer
+{
+
+
+
+
+
+/** The format of the output data. */
+enum OutputFormat
+{
+	ofText,    ///< The regular text DXF
+	ofBinary,  ///< Binary DXF (R13+ variant, 2-byte group codes)
+};
+
+
+
+
+
+/** Options that modify the output of the writer. */
+class Options
+{
+public:
+
+	/** The format of the output data. */
+	OutputFormat mFormat;
+
+	/** The number of decimal places written for floating-point values.
+	Only used for the text output, binary output always stores the exact values.
+	Trailing zeroes are removed, so 1.5 is written as "1.5" even with 3 decimal places.
+	Negative value means writing the shortest representation that parses back to the exact same value (the default). */
+	int mDecimalPlaces;
+
+	/** The number of threads used for formatting the ENTITIES section.
+	1 formats everything on the calling thread, 0 uses as many threads as there are hardware threads.
+	The output is byte-for-byte identical regardless of the number of threads. */
+	unsigned mNumThreads;
+
+
+	/** Creates the default options: text output with the shortest round-trip representation of floating-point values, single-threaded. */
+	Options():
+		mFormat(ofText),
+		mDecimalPlaces(-1),
+		mNumThreads(1)
+	{
+	}
+};
+
+
+
+
+
+/** Writes the specified drawing as DXF data into the specified data sink.
+Writes the HEADER (extents), TABLES (layers), BLOCKS and ENTITIES sections.
+The raw data preserved by the parser (unsupported entities, CLASSES and OBJECTS sections) is written back unchanged.
+The data is serialized into an internal fixed-size buffer that is passed to the sink each time it fills up,
+so the memory used doesn't depend on the size of the drawing.
+May throw exceptions coming from the underlying systems, such as when writing into the data sink. */
+void write(const Drawing & aDrawing, DataSink && aDataSink, const Options & aOptions = Options());
+
+
+
+
+
+}  // namespace Writer
+}  // namespace Dxf
@@ -0,0 +1,320 @@
+// GeometryCleanup.cpp
+
+// Implements the cleanupGeometry() function and its helpers that remove degenerate geometry from a drawing
+
+#include "GeometryCleanup.hpp"
+#include <algorithm>
+#include <cmath>
+#include "ParallelFor.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+namespace
+{
+	/** Returns the dot product of the two vectors. */
+	Coord dot(const Coords & aV1, const Coords & aV2)
+	{
+		return aV1.mX * aV2.mX + aV1.mY * aV2.mY + aV1.mZ * aV2.mZ;
+	}
+
+
+
+
+
+	/** Returns the squared distance between the two points. */
+	Coord distanceSquared(const Coords & aPos1, const Coords & aPos2)
+	{
+		auto diff = aPos2 - aPos1;
+		return dot(diff, diff);
+	}
+
+
+
+
+
+	/** Returns the length of the specified arc. */
+	Coord arcLength(const Arc & aArc)
+	{
+		auto sweep = std::fmod(aArc.mEndAngle - aArc.mStartAngle, 360.0);
+		if (sweep < 0)
+		{
+			sweep += 360;
+		}
+		if ((sweep == 0) && (aArc.mEndAngle != aArc.mStartAngle))
+		{
+			sweep = 360;  // An explicit full turn
+		}
+		return std::abs(aArc.mRadius) * sweep * PI / 180;
+	}
+
+
+
+
+
+	/** Returns true if the specified object is degenerate and should be removed, as specified by the options.
+	Counts the object in aStats if so. */
+	bool isDegenerate(const Primitive & aObject, const CleanupOptions & aOptions, CleanupStats & aStats)
+	{
+		switch (aObject.mObjectType)
+		{
+			case otLine:
+			{
+				const auto & line = static_cast<const Line &>(aObject);
+				if (
+					aOptions.mShouldRemoveZeroLengthLines &&
+					(distanceSquared(line.mPos, line.mPos2) <= aOptions.mTolerance * aOptions.mTolerance)
+				)
+				{
+					aStats.mNumZeroLengthLines += 1;
+					return true;
+				}
+				return false;
+			}
+			case otPolyline:
+			case otLWPolyline:
+			case otPolygon:
+			{
+				if (aOptions.mShouldRemoveZeroLengthLines && (static_cast<const MultiVertex &>(aObject).mVertices.size() < 2))
+				{
+					aStats.mNumDegeneratePolylines += 1;
+					return true;
+				}
+				return false;
+			}
+			case otArc:
+			{
+				const auto & arc = static_cast<const Arc &>(aObject);
+				if (
+					aOptions.mShouldRemoveDegenerateArcs &&
+					((std::abs(arc.mRadius) <= aOptions.mTolerance) || (arcLength(arc) <= aOptions.mTolerance))
+				)
+				{
+					aStats.mNumDegenerateArcs += 1;
+					return true;
+				}
+				return false;
+			}
+			case otCircle:
+			{
+				if (aOptions.mShouldRemoveDegenerateArcs && (std::abs(static_cast<const Circle &>(aObject).mRadius) <= aOptions.mTolerance))
+				{
+					aStats.mNumDegenerateArcs += 1;
+					return true;
+				}
+				return false;
+			}
+			default:
+			{
+				return false;
+			}
+		}
+	}
+}  // anonymous namespace
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// CleanupStats:
+
+CleanupStats & CleanupStats::operator += (const CleanupStats & aOther)
+{
+	mNumDuplicateVertices += aOther.mNumDuplicateVertices;
+	mNumCollinearVertices += aOther.mNumCollinearVertices;
+	mNumZeroLengthLines += aOther.mNumZeroLengthLines;
+	mNumDegeneratePolylines += aOther.mNumDegeneratePolylines;
+	mNumDegenerateArcs += aOther.mNumDegenerateArcs;
+	return *this;
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Global functions:
+
+CleanupStats cleanupVertices(MultiVertex & aPolyline, const CleanupOptions & aOptions)
+{
+	CleanupStats res;
+	auto & vertices = aPolyline.mVertices;
+	if ((vertices.size() < 2) || !aPolyline.isSimplePath())
+	{
+		return res;
+	}
+
+	// Collinear vertices are checked against the line through the first two vertices of the current straight run,
+	// with half the tolerance, so that the removed vertices are within the tolerance of the resulting segment:
+	auto toleranceSquared = aOptions.mTolerance * aOptions.mTolerance;
+	auto halfToleranceSquared = toleranceSquared / 4;
+	Coords runDirection(0, 0, 0);  // Unit vector of the current run's line, zero if there's no run
+	size_t numKept = 0;
+	for (size_t idx = 0, count = vertices.size(); idx < count; ++idx)
+	{
+		auto & v = vertices[idx];
+		if (numKept > 0)
+		{
+			auto & last = vertices[numKept - 1];
+			if (aOptions.mShouldRemoveDuplicateVertices && (distanceSquared(last.mPos, v.mPos) <= toleranceSquared))
+			{
+				// The remaining vertex starts the next segment, so it takes over the bulge:
+				last.mBulge = v.mBulge;
+				res.mNumDuplicateVertices += 1;
+				continue;
+			}
+			if (
+				aOptions.mShouldRemoveCollinearVertices &&
+				(numKept >= 2) &&
+				(vertices[numKept - 2].mBulge == 0) &&
+				(last.mBulge == 0) &&
+				(dot(runDirection, runDirection) > 0)
+			)
+			{
+				const auto & runStart = vertices[numKept - 2].mPos;
+				auto rel = v.mPos - runStart;
+				auto along = dot(rel, runDirection);
+				auto distSquared = dot(rel, rel) - along * along;
+				if ((distSquared <= halfToleranceSquared) && (along > dot(last.mPos - runStart, runDirection)))
+				{
+					// v continues the straight run, it replaces the run's current end:
+					last = std::move(v);
+					res.mNumCollinearVertices += 1;
+					continue;
+				}
+			}
+		}
+
+		// Keep the vertex:
+		if (numKept != idx)
+		{
+			vertices[numKept] = std::move(v);
+		}
+		numKept += 1;
+		runDirection = Coords(0, 0, 0);
+		if (numKept >= 2)
+		{
+			auto diff = vertices[numKept - 1].mPos - vertices[numKept - 2].mPos;
+			auto len = std::sqrt(dot(diff, diff));
+			if (len > 0)
+			{
+				runDirection = Coords(diff.mX / len, diff.mY / len, diff.mZ / len);
+			}
+		}
+	}
+	vertices.erase(vertices.begin() + static_cast<std::ptrdiff_t>(numKept), vertices.end());
+
+	// The closing vertex of a closed polyline duplicating the first one:
+	if (
+		aOptions.mShouldRemoveDuplicateVertices &&
+		(vertices.size() > 2) &&
+		aPolyline.isClosed() &&
+		(distanceSquared(vertices.front().mPos, vertices.back().mPos) <= toleranceSquared)
+	)
+	{
+		vertices.pop_back();
+		res.mNumDuplicateVertices += 1;
+	}
+	return res;
+}
+
+
+
+
+
+CleanupStats cleanupGeometry(Drawing & aDrawing, const CleanupOptions & aOptions)
+{
+	// Collect all the polylines:
+	std::vector<MultiVertex *> polylines;
+	auto addPolylines = [&polylines](const PrimitivePtrs & aObjects)
+	{
+		for (const auto & obj: aObjects)
+		{
+			switch (obj->mObjectType)
+			{
+				case otPolyline:
+				case otLWPolyline:
+				case otPolygon:
+				{
+					polylines.push_back(static_cast<MultiVertex *>(obj.get()));
+					break;
+				}
+				default:
+				{
+					break;
+				}
+			}
+		}
+	};
+	aDrawing.compact();
+	for (const auto & lay: aDrawing.layers())
+	{
+		addPolylines(lay->objects());
+	}
+	for (const auto & bd: aDrawing.mBlockDefinitions)
+	{
+		addPolylines(bd.second->mObjects);
+	}
+
+	// Clean up the vertices, in parallel:
+	std::vector<CleanupStats> polylineStats(polylines.size());
+	parallelFor(polylines.size(), aOptions.mNumThreads, [&](size_t aIndex)
+		{
+			polylineStats[aIndex] = cleanupVertices(*polylines[aIndex], aOptions);
+		}
+	);
+	CleanupStats res;
+	for (const auto & stats: polylineStats)
+	{
+		res += stats;
+	}
+
+	// Remove the degenerate objects:
+	for (const auto & lay: aDrawing.layers())
+	{
+		std::vector<EntityId> toRemove;
+		const auto & objects = lay->objects();
+		for (size_t i = 0, count = objects.size(); i < count; ++i)
+		{
+			if (isDegenerate(*objects[i], aOptions, res))
+			{
+				toRemove.push_back(lay->objectId(i));
+			}
+		}
+		for (const auto & id: toRemove)
+		{
+			lay->removeObjById(id);
+		}
+		lay->compact();
+		lay->updateExtent();
+	}
+	for (const auto & bd: aDrawing.mBlockDefinitions)
+	{
+		auto & objects = bd.second->mObjects;
+		objects.erase(
+			std::remove_if(objects.begin(), objects.end(),
+				[&aOptions, &res](const PrimitivePtr & aObject)
+				{
+					return isDegenerate(*aObject, aOptions, res);
+				}
+			),
+			objects.end()
+		);
+	}
+	return res;
+}
+
+
+
+
+
+}  // namespace Dxf
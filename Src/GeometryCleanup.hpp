@@ -0,0 +1,95 @@
+#pragma once
+
+#include "DxfDrawing.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** Options for cleanupGeometry() and cleanupVertices(). */
+class CleanupOptions
+{
+public:
+
+	/** The distance within which the geometry is considered degenerate:
+	vertices closer than this to their predecessor are duplicates, collinear vertices removed are at most this far
+	from the resulting segment, lines shorter than this are zero-length and arcs shorter than this are degenerate. */
+	Coord mTolerance;
+
+	/** If true, vertices closer than mTolerance to their predecessor are removed. */
+	bool mShouldRemoveDuplicateVertices;
+
+	/** If true, vertices that lie (within mTolerance) on the straight segment between their neighbors are removed. */
+	bool mShouldRemoveCollinearVertices;
+
+	/** If true, Line objects shorter than mTolerance are removed, and so are the polylines that have less than two
+	vertices left after the vertex cleanup. */
+	bool mShouldRemoveZeroLengthLines;
+
+	/** If true, Arc and Circle objects with the radius or the arc length below mTolerance are removed. */
+	bool mShouldRemoveDegenerateArcs;
+
+	/** The number of threads used for cleaning up the polylines' vertices.
+	1 processes everything on the calling thread, 0 uses as many threads as there are hardware threads. */
+	unsigned mNumThreads;
+
+
+	/** Creates the default options: all the cleanups enabled, with a tolerance of 1e-9, single-threaded. */
+	CleanupOptions():
+		mTolerance(1e-9),
+		mShouldRemoveDuplicateVertices(true),
+		mShouldRemoveCollinearVertices(true),
+		mShouldRemoveZeroLengthLines(true),
+		mShouldRemoveDegenerateArcs(true),
+		mNumThreads(1)
+	{
+	}
+};
+
+
+
+
+
+/** The counts of the geometry removed by cleanupGeometry() and cleanupVertices(). */
+class CleanupStats
+{
+public:
+	size_t mNumDuplicateVertices = 0;
+	size_t mNumCollinearVertices = 0;
+	size_t mNumZeroLengthLines = 0;
+	size_t mNumDegeneratePolylines = 0;
+	size_t mNumDegenerateArcs = 0;
+
+	CleanupStats & operator += (const CleanupStats & aOther);
+};
+
+
+
+
+
+/** Removes the duplicate and collinear vertices of the specified polyline, as specified by the options, in a single pass.
+When a duplicate vertex is removed, its bulge is kept on the remaining vertex, so that the next segment keeps its shape.
+Collinear vertices are removed only between straight (zero-bulge) segments.
+For closed polylines, the last vertex is removed if it duplicates the first one.
+Mesh and curve- / spline-fit Polylines are not modified, their vertices are not a simple path. */
+CleanupStats cleanupVertices(MultiVertex & aPolyline, const CleanupOptions & aOptions = CleanupOptions());
+
+/** Cleans up the entire drawing, the layers and the block definitions, as specified by the options:
+removes the duplicate and collinear vertices of all the polylines (in parallel, if so specified),
+and the zero-length lines, degenerate polylines and degenerate arcs.
+The layers are compacted, and the extents of the modified layers are updated.
+Any BlockFlattener caches of the drawing's block definitions need to be cleared afterwards. */
+CleanupStats cleanupGeometry(Drawing & aDrawing, const CleanupOptions & aOptions = CleanupOptions());
+
+
+
+
+
+}  // namespace Dxf
@@ -0,0 +1,490 @@
+// LevelOfDetail.cpp
+
+// Implements the LodPyramid class providing the multi-resolution view of a drawing
+
+#include "LevelOfDetail.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include "ParallelFor.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+namespace
+{
+	/** The maximum number of the grid cells in each direction; the cells are enlarged for the layers that would need more. */
+	static const size_t MAX_CELLS_PER_AXIS = 1024;
+
+	/** The objects spanning more cells than this are not stored in the cells, but tested on each query instead. */
+	static const size_t MAX_CELLS_PER_OBJECT = 64;
+
+	/** The maximum number of the grid cells per object in the layer; the cells are enlarged for the sparse layers,
+	so that the memory used by the empty cells stays proportional to the number of objects. */
+	static const size_t MAX_CELLS_PER_LAYER_OBJECT = 4;
+
+
+
+
+
+	/** Returns true if the two (non-empty) extents intersect, including touching. */
+	bool intersects(const Extent & aExtent1, const Extent & aExtent2)
+	{
+		const auto & min1 = aExtent1.minCoord();
+		const auto & max1 = aExtent1.maxCoord();
+		const auto & min2 = aExtent2.minCoord();
+		const auto & max2 = aExtent2.maxCoord();
+		return (
+			(min1.mX <= max2.mX) && (min2.mX <= max1.mX) &&
+			(min1.mY <= max2.mY) && (min2.mY <= max1.mY)
+		);
+	}
+
+
+
+
+
+	/** Returns a closed Polygon outlining the extent, used in place of the tiny texts. */
+	PrimitivePtr textBox(const Text & aText, const Extent & aExtent)
+	{
+		auto res = std::make_shared<Polygon>(aText.mColor);
+		const auto & min = aExtent.minCoord();
+		const auto & max = aExtent.maxCoord();
+		res->addVertex({min.mX, min.mY});
+		res->addVertex({max.mX, min.mY});
+		res->addVertex({max.mX, max.mY});
+		res->addVertex({min.mX, max.mY});
+		return res;
+	}
+}  // anonymous namespace
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// LodPyramid::LayerLevel:
+
+void LodPyramid::LayerLevel::buildIndex(Coord aCellSize)
+{
+	mExtent = Extent();
+	for (const auto & ext: mExtents)
+	{
+		mExtent.expandTo(ext);
+	}
+	mCellStarts.clear();
+	mCellItems.clear();
+	mLargeObjects.clear();
+	if (mExtent.isEmpty())
+	{
+		mCellSize = aCellSize;
+		mNumCellsX = mNumCellsY = 0;
+		mCellStarts.push_back(0);
+		return;
+	}
+
+	// Size the grid so that it doesn't exceed MAX_CELLS_PER_AXIS, nor MAX_CELLS_PER_LAYER_OBJECT cells per object:
+	auto sizeX = mExtent.maxCoord().mX - mExtent.minCoord().mX;
+	auto sizeY = mExtent.maxCoord().mY - mExtent.minCoord().mY;
+	auto maxSize = std::max(sizeX, sizeY);
+	auto maxNumCells = std::max<size_t>(mObjects.size() * MAX_CELLS_PER_LAYER_OBJECT, 1);
+	mCellSize = std::max({aCellSize, maxSize / MAX_CELLS_PER_AXIS, std::sqrt(sizeX * sizeY / static_cast<Coord>(maxNumCells))});
+	if (mCellSize <= 0)
+	{
+		mCellSize = 1;
+	}
+	for (;;)
+	{
+		mNumCellsX = std::min(static_cast<size_t>(sizeX / mCellSize) + 1, MAX_CELLS_PER_AXIS);
+		mNumCellsY = std::min(static_cast<size_t>(sizeY / mCellSize) + 1, MAX_CELLS_PER_AXIS);
+		if (mNumCellsX * mNumCellsY <= maxNumCells)
+		{
+			break;
+		}
+		// The rounding up of the cell counts can still overshoot, most of all for thin extents:
+		mCellSize *= 1.25;
+	}
+
+	// Count the items per cell, then fill them in (CSR layout):
+	mCellStarts.assign(mNumCellsX * mNumCellsY + 1, 0);
+	auto forEachCell = [this](const Extent & aExtent, auto && aFunction)
+	{
+		auto x1 = cellIndex(aExtent.minCoord().mX, false);
+		auto x2 = cellIndex(aExtent.maxCoord().mX, false);
+		auto y1 = cellIndex(aExtent.minCoord().mY, true);
+		auto y2 = cellIndex(aExtent.maxCoord().mY, true);
+		for (auto y = y1; y <= y2; ++y)
+		{
+			for (auto x = x1; x <= x2; ++x)
+			{
+				aFunction(y * mNumCellsX + x);
+			}
+		}
+	};
+	auto numCellsSpanned = [this](const Extent & aExtent)
+	{
+		auto numX = cellIndex(aExtent.maxCoord().mX, false) - cellIndex(aExtent.minCoord().mX, false) + 1;
+		auto numY = cellIndex(aExtent.maxCoord().mY, true) - cellIndex(aExtent.minCoord().mY, true) + 1;
+		return numX * numY;
+	};
+	for (size_t i = 0, count = mObjects.size(); i < count; ++i)
+	{
+		if (numCellsSpanned(mExtents[i]) > MAX_CELLS_PER_OBJECT)
+		{
+			mLargeObjects.push_back(static_cast<uint32_t>(i));
+			continue;
+		}
+		forEachCell(mExtents[i], [this](size_t aCell) { mCellStarts[aCell + 1] += 1; });
+	}
+	for (size_t i = 1, count = mCellStarts.size(); i < count; ++i)
+	{
+		mCellStarts[i] += mCellStarts[i - 1];
+	}
+	mCellItems.resize(mCellStarts.back());
+	std::vector<uint32_t> fill(mCellStarts.begin(), mCellStarts.end() - 1);
+	size_t nextLarge = 0;
+	for (size_t i = 0, count = mObjects.size(); i < count; ++i)
+	{
+		if ((nextLarge < mLargeObjects.size()) && (mLargeObjects[nextLarge] == i))
+		{
+			nextLarge += 1;
+			continue;
+		}
+		forEachCell(mExtents[i], [this, &fill, i](size_t aCell)
+			{
+				mCellItems[fill[aCell]] = static_cast<uint32_t>(i);
+				fill[aCell] += 1;
+			}
+		);
+	}
+}
+
+
+
+
+
+size_t LodPyramid::LayerLevel::cellIndex(Coord aCoord, bool aIsY) const
+{
+	auto rel = aIsY ? (aCoord - mExtent.minCoord().mY) : (aCoord - mExtent.minCoord().mX);
+	auto numCells = aIsY ? mNumCellsY : mNumCellsX;
+	if (rel <= 0)
+	{
+		return 0;
+	}
+	return std::min(static_cast<size_t>(rel / mCellSize), numCells - 1);
+}
+
+
+
+
+
+void LodPyramid::LayerLevel::query(const Extent & aWindow, PrimitivePtrs & aDest) const
+{
+	if (mExtent.isEmpty() || aWindow.isEmpty() || !intersects(mExtent, aWindow))
+	{
+		return;
+	}
+	auto winX1 = cellIndex(aWindow.minCoord().mX, false);
+	auto winX2 = cellIndex(aWindow.maxCoord().mX, false);
+	auto winY1 = cellIndex(aWindow.minCoord().mY, true);
+	auto winY2 = cellIndex(aWindow.maxCoord().mY, true);
+	for (auto y = winY1; y <= winY2; ++y)
+	{
+		for (auto x = winX1; x <= winX2; ++x)
+		{
+			auto cell = y * mNumCellsX + x;
+			for (auto i = mCellStarts[cell], end = mCellStarts[cell + 1]; i < end; ++i)
+			{
+				auto idx = mCellItems[i];
+				const auto & ext = mExtents[idx];
+
+				// An object in multiple cells is reported only from the first cell where it overlaps the window:
+				auto firstX = std::max(cellIndex(ext.minCoord().mX, false), winX1);
+				auto firstY = std::max(cellIndex(ext.minCoord().mY, true), winY1);
+				if ((x == firstX) && (y == firstY) && intersects(ext, aWindow))
+				{
+					aDest.push_back(mObjects[idx]);
+				}
+			}
+		}
+	}
+	for (auto idx: mLargeObjects)
+	{
+		if (intersects(mExtents[idx], aWindow))
+		{
+			aDest.push_back(mObjects[idx]);
+		}
+	}
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// LodPyramid:
+
+LodPyramid::LodPyramid(std::shared_ptr<const Drawing> aDrawing, const LodOptions & aOptions):
+	mDrawing(std::move(aDrawing)),
+	mOptions(aOptions),
+	mPixelSizes(aOptions.mPixelSizes),
+	mIsFinished(false),
+	mShouldStop(false)
+{
+	std::sort(mPixelSizes.begin(), mPixelSizes.end());
+	const auto & layers = mDrawing->layers();
+	mLayerLevels.resize(mPixelSizes.size() * layers.size());
+	mBuilderThread = std::thread([this]() { build(); });
+}
+
+
+
+
+
+LodPyramid::~LodPyramid()
+{
+	mShouldStop = true;
+	mBuilderThread.join();
+}
+
+
+
+
+
+size_t LodPyramid::levelForPixelSize(Coord aPixelSize) const
+{
+	auto itr = std::upper_bound(mPixelSizes.begin(), mPixelSizes.end(), aPixelSize);
+	if (itr == mPixelSizes.begin())
+	{
+		return 0;
+	}
+	return static_cast<size_t>(itr - mPixelSizes.begin()) - 1;
+}
+
+
+
+
+
+bool LodPyramid::isReady() const
+{
+	std::lock_guard<std::mutex> lock(mMtx);
+	return mIsFinished;
+}
+
+
+
+
+
+bool LodPyramid::isLevelReady(size_t aLevel) const
+{
+	auto numLayers = mDrawing->layers().size();
+	std::lock_guard<std::mutex> lock(mMtx);
+	for (size_t i = 0; i < numLayers; ++i)
+	{
+		if (mLayerLevels.at(aLevel * numLayers + i) == nullptr)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+void LodPyramid::wait()
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+	mCVFinished.wait(lock, [this]() { return mIsFinished; });
+	if (mError != nullptr)
+	{
+		std::rethrow_exception(mError);
+	}
+}
+
+
+
+
+
+std::vector<LodLayerObjects> LodPyramid::query(size_t aLevel, const Extent & aWindow) const
+{
+	if (aLevel >= mPixelSizes.size())
+	{
+		throw std::out_of_range("LodPyramid::query(): level out of range");
+	}
+
+	// Pick the built levels to use for each layer: the requested one, or the nearest one, preferring the finer ones:
+	const auto & layers = mDrawing->layers();
+	auto numLayers = layers.size();
+	auto numLevels = mPixelSizes.size();
+	std::vector<LayerLevelPtr> layerLevels(numLayers);
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		for (size_t lay = 0; lay < numLayers; ++lay)
+		{
+			for (size_t dist = 0; (dist < numLevels) && (layerLevels[lay] == nullptr); ++dist)
+			{
+				if (aLevel >= dist)
+				{
+					layerLevels[lay] = mLayerLevels[(aLevel - dist) * numLayers + lay];
+				}
+				if ((layerLevels[lay] == nullptr) && (aLevel + dist < numLevels))
+				{
+					layerLevels[lay] = mLayerLevels[(aLevel + dist) * numLayers + lay];
+				}
+			}
+		}
+	}
+
+	std::vector<LodLayerObjects> res;
+	for (size_t lay = 0; lay < numLayers; ++lay)
+	{
+		LodLayerObjects layerObjects{layers[lay].get(), {}};
+		if (layerLevels[lay] != nullptr)
+		{
+			layerLevels[lay]->query(aWindow, layerObjects.mObjects);
+		}
+		else if (!aWindow.isEmpty())
+		{
+			// Nothing built for this layer yet, use the original objects:
+			layers[lay]->forEachObject([this, &layerObjects, &aWindow](const PrimitivePtr & aObject)
+			{
+				auto ext = objectExtent(*aObject);
+				if (!ext.isEmpty() && intersects(ext, aWindow))
+				{
+					layerObjects.mObjects.push_back(aObject);
+				}
+			});
+		}
+		if (!layerObjects.mObjects.empty())
+		{
+			res.push_back(std::move(layerObjects));
+		}
+	}
+	return res;
+}
+
+
+
+
+
+void LodPyramid::build()
+{
+	// The coarsest levels first, they are the quickest to build and the first needed by a zoomed-out view:
+	const auto & layers = mDrawing->layers();
+	auto numLayers = layers.size();
+	auto numLevels = mPixelSizes.size();
+	std::exception_ptr error;
+	try
+	{
+		parallelFor(numLevels * numLayers, mOptions.mNumThreads, [&](size_t aTask)
+			{
+				if (mShouldStop)
+				{
+					return;
+				}
+				auto level = numLevels - 1 - aTask / numLayers;
+				auto lay = aTask % numLayers;
+				auto layerLevel = buildLayerLevel(level, *layers[lay]);
+				std::lock_guard<std::mutex> lock(mMtx);
+				mLayerLevels[level * numLayers + lay] = std::move(layerLevel);
+			}
+		);
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	std::lock_guard<std::mutex> lock(mMtx);
+	mError = error;
+	mIsFinished = true;
+	mCVFinished.notify_all();
+}
+
+
+
+
+
+LodPyramid::LayerLevelPtr LodPyramid::buildLayerLevel(size_t aLevel, const Layer & aLayer) const
+{
+	auto pixelSize = mPixelSizes[aLevel];
+	auto minObjectSize = mOptions.mMinObjectSize * pixelSize;
+	auto minTextHeight = mOptions.mMinTextHeight * pixelSize;
+
+	// Drop the sub-pixel objects:
+	PrimitivePtrs kept;
+	aLayer.forEachObject([this, &kept, minObjectSize](const PrimitivePtr & aObject)
+	{
+		if (aObject->mObjectType == otPoint)
+		{
+			kept.push_back(aObject);
+			return;
+		}
+		auto ext = objectExtent(*aObject);
+		if (ext.isEmpty())
+		{
+			return;
+		}
+		auto sizeX = ext.maxCoord().mX - ext.minCoord().mX;
+		auto sizeY = ext.maxCoord().mY - ext.minCoord().mY;
+		if ((sizeX < minObjectSize) && (sizeY < minObjectSize))
+		{
+			return;
+		}
+		kept.push_back(aObject);
+	});
+
+	// Simplify the polylines, box the tiny texts:
+	auto res = std::make_shared<LayerLevel>();
+	res->mObjects = simplifiedObjects(kept, SimplifyOptions(mOptions.mSimplifyTolerance * pixelSize, mOptions.mAlgorithm));
+	res->mExtents.reserve(res->mObjects.size());
+	for (auto & obj: res->mObjects)
+	{
+		auto ext = objectExtent(*obj);
+		if (obj->mObjectType == otText)
+		{
+			const auto & text = static_cast<const Text &>(*obj);
+			if (text.mSize < minTextHeight)
+			{
+				obj = textBox(text, ext);
+			}
+		}
+		res->mExtents.push_back(std::move(ext));
+	}
+	res->buildIndex(mOptions.mCellSize * pixelSize);
+	return res;
+}
+
+
+
+
+
+Extent LodPyramid::objectExtent(const Primitive & aObject) const
+{
+	if (aObject.mObjectType != otBlock)
+	{
+		return aObject.extent();
+	}
+	const auto & block = static_cast<const Block &>(aObject);
+	auto flattened = mBlockFlattener.flatten(block);
+	if (flattened->mExtent.isEmpty())
+	{
+		return Extent(block.mPos);
+	}
+	return Extent(flattened->mExtent.minCoord() + block.mPos, flattened->mExtent.maxCoord() + block.mPos);
+}
+
+
+
+
+
+}  // namespace Dxf
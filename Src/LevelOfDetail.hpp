@@ -0,0 +1,233 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include "BlockFlattener.hpp"
+#include "Simplification.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** Options for building a LodPyramid.
+All the sizes except mPixelSizes are in pixels, they are converted to the drawing units for each level separately. */
+class LodOptions
+{
+public:
+
+	/** The sizes of a single pixel, in the drawing units, for which the levels are built; one level per value.
+	A viewer displaying the drawing at a scale of N drawing units per pixel uses the level with the largest
+	pixel size not exceeding N. */
+	std::vector<Coord> mPixelSizes;
+
+	/** The objects whose extent is smaller than this in both directions are dropped.
+	Points are never dropped, they are displayed with a fixed screen size. */
+	Coord mMinObjectSize;
+
+	/** The texts whose height is below this are replaced by a box outlining their extent. */
+	Coord mMinTextHeight;
+
+	/** The polyline simplification tolerance. */
+	Coord mSimplifyTolerance;
+
+	/** The polyline simplification algorithm. */
+	SimplificationAlgorithm mAlgorithm;
+
+	/** The size of the spatial index cells.
+	The cells are enlarged for the large and the sparse layers, so that the grid size stays bounded. */
+	Coord mCellSize;
+
+	/** The number of the background threads building the pyramid; 0 uses as many threads as there are hardware threads. */
+	unsigned mNumThreads;
+
+
+	/** Creates the default options: no levels, objects under 1 px dropped, texts under 3 px boxed,
+	simplification to half a pixel using Douglas-Peucker, 256 px index cells, all the hardware threads. */
+	LodOptions():
+		mMinObjectSize(1),
+		mMinTextHeight(3),
+		mSimplifyTolerance(0.5),
+		mAlgorithm(saDouglasPeucker),
+		mCellSize(256),
+		mNumThreads(0)
+	{
+	}
+};
+
+
+
+
+
+/** The objects of a single layer, returned from a LodPyramid query. */
+class LodLayerObjects
+{
+public:
+
+	/** The layer from which the objects come, used mainly for resolving the COLOR_BYLAYER colors. */
+	const Layer * mLayer;
+
+	/** The objects within the queried window. */
+	PrimitivePtrs mObjects;
+};
+
+
+
+
+
+/** A multi-resolution level-of-detail structure over a Drawing, for displaying it at various zoom levels.
+Each level contains, for each layer, the layer's objects as seen at the level's pixel size: the objects smaller than
+a pixel are dropped, the polylines are simplified, and the tiny texts are collapsed into boxes. The objects that don't
+change are shared with the drawing. Each level of each layer has its own uniform grid index for the window queries.
+The pyramid is built in background threads, starting with the coarsest level, and the levels become queryable
+one by one as they are finished; until then, the queries fall back to the nearest finished level or the original objects.
+The drawing must not be modified while the pyramid exists.
+All public functions are thread-safe. */
+class LodPyramid
+{
+public:
+
+	/** Starts building the pyramid for the specified drawing in the background. */
+	LodPyramid(std::shared_ptr<const Drawing> aDrawing, const LodOptions & aOptions);
+
+	/** Stops the building, if still in progress, and waits for the background threads to finish. */
+	~LodPyramid();
+
+	// Disable copy- and move-constructors, the background threads reference the instance:
+	LodPyramid(const LodPyramid & aOther) = delete;
+	LodPyramid(LodPyramid && aOther) = delete;
+
+	/** Returns the number of the levels. */
+	size_t numLevels() const { return mPixelSizes.size(); }
+
+	/** Returns the pixel size of the specified level. The levels are sorted from the finest (smallest pixel size). */
+	Coord levelPixelSize(size_t aLevel) const { return mPixelSizes.at(aLevel); }
+
+	/** Returns the level to use for displaying the drawing at the specified pixel size: the coarsest level whose
+	pixel size doesn't exceed aPixelSize, or the finest level if aPixelSize is smaller than all of them. */
+	size_t levelForPixelSize(Coord aPixelSize) const;
+
+	/** Returns true if the entire pyramid has been built (or the building failed). */
+	bool isReady() const;
+
+	/** Returns true if the specified level has been built for all the layers. */
+	bool isLevelReady(size_t aLevel) const;
+
+	/** Waits until the entire pyramid is built.
+	If the building failed, rethrows the exception (such as BlockFlattener::RecursiveBlockDefinition). */
+	void wait();
+
+	/** Returns the objects of the specified level whose extent intersects the window, per layer, in the layer order.
+	Layers with no objects within the window are omitted. */
+	std::vector<LodLayerObjects> query(size_t aLevel, const Extent & aWindow) const;
+
+	/** Returns the objects for displaying the window at the specified pixel size; see levelForPixelSize(). */
+	std::vector<LodLayerObjects> queryForPixelSize(Coord aPixelSize, const Extent & aWindow) const
+	{
+		return query(levelForPixelSize(aPixelSize), aWindow);
+	}
+
+
+protected:
+
+	/** A single level of a single layer, with its grid index.
+	Immutable once built, so that it can be queried without locking. */
+	class LayerLevel
+	{
+	public:
+		/** The objects of the level. */
+		PrimitivePtrs mObjects;
+
+		/** The extent of each object in mObjects. */
+		std::vector<Extent> mExtents;
+
+		/** The extent of all the objects. */
+		Extent mExtent;
+
+		/** The size of a single grid cell, in the drawing units. */
+		Coord mCellSize;
+
+		/** The number of the grid cells in each direction. */
+		size_t mNumCellsX, mNumCellsY;
+
+		/** The start of each cell's items in mCellItems, one more than the number of cells (row-major). */
+		std::vector<uint32_t> mCellStarts;
+
+		/** The indices into mObjects of the objects intersecting each cell. */
+		std::vector<uint32_t> mCellItems;
+
+		/** The indices into mObjects of the objects spanning too many cells, tested on every query instead. */
+		std::vector<uint32_t> mLargeObjects;
+
+
+		/** Builds the grid index over mObjects and mExtents. */
+		void buildIndex(Coord aCellSize);
+
+		/** Appends the objects intersecting the window to aDest. */
+		void query(const Extent & aWindow, PrimitivePtrs & aDest) const;
+
+		/** Returns the cell column (aIsY == false) or row containing the coord, clamped to the grid. */
+		size_t cellIndex(Coord aCoord, bool aIsY) const;
+	};
+
+	using LayerLevelPtr = std::shared_ptr<const LayerLevel>;
+
+
+	/** The drawing over which the pyramid is built. */
+	std::shared_ptr<const Drawing> mDrawing;
+
+	/** The options given at construction. */
+	LodOptions mOptions;
+
+	/** The pixel sizes of the levels, sorted ascending. */
+	std::vector<Coord> mPixelSizes;
+
+	/** Provides the extents of the Block objects. */
+	mutable BlockFlattener mBlockFlattener;
+
+	/** Protects mLayerLevels, mIsFinished and mError. */
+	mutable std::mutex mMtx;
+
+	/** Notified when the building finishes. */
+	std::condition_variable mCVFinished;
+
+	/** The built levels, indexed by (level * numLayers + layer); nullptr for the ones not yet built. */
+	std::vector<LayerLevelPtr> mLayerLevels;
+
+	/** Set when the building has finished, either successfully or with an error. */
+	bool mIsFinished;
+
+	/** The error that stopped the building, if any. */
+	std::exception_ptr mError;
+
+	/** Set by the destructor to stop the building early. */
+	std::atomic<bool> mShouldStop;
+
+	/** The background thread that distributes the building over the worker threads. */
+	std::thread mBuilderThread;
+
+
+	/** The background building, runs in mBuilderThread. */
+	void build();
+
+	/** Builds the specified level of the specified layer. */
+	LayerLevelPtr buildLayerLevel(size_t aLevel, const Layer & aLayer) const;
+
+	/** Returns the extent of the object; for Blocks, the extent of their flattened geometry. */
+	Extent objectExtent(const Primitive & aObject) const;
+};
+
+
+
+
+
+}  // namespace Dxf
@@ -29,6 +29,9 @@ LineExtractor::LineExtractor(DataSource && aDataSource):
 	mCurPos(0),
 	mDataEnd(0),
 	mCurrentLineNum(1),
+	mNumBytesDiscarded(0),
+	mNumBufferGrowths(0),
+	mNumDataSourceReads(0),
 	mIsEof(false)
 {
 	mBuffer.resize(1000);
@@ -40,6 +43,17 @@ LineExtractor::LineExtractor(DataSource && aDataSource):
 
 
 std::string LineExtractor::getNextLine()
+{
+	std::string res;
+	getNextLine(res);
+	return res;
+}
+
+
+
+
+
+void LineExtractor::getNextLine(std::string & aDest)
 {
 	// Search for the newline in the buffered data:
 	for (size_t i = mCurPos; i < mDataEnd; ++i)
@@ -57,12 +71,106 @@ std::string LineExtractor::getNextLine()
 		{
 			skipCr = 1;
 		}
-		return std::string(&mBuffer.front() + oldPos, i - oldPos - skipCr);
+		aDest.assign(&mBuffer.front() + oldPos, i - oldPos - skipCr);
+		return;
 	}
 
 	// There is no newline in the buffer, read more data and re-try:
 	readMoreData();
-	return getNextLine();
+	return getNextLine(aDest);
+}
+
+
+
+
+
+std::string LineExtractor::getNextNullTerminatedString()
+{
+	std::string res;
+	getNextNullTerminatedString(res);
+	return res;
+}
+
+
+
+
+
+void LineExtractor::getNextNullTerminatedString(std::string & aDest)
+{
+	// Search for the NUL in the buffered data:
+	for (size_t i = mCurPos; i < mDataEnd; ++i)
+	{
+		if (mBuffer[i] != 0)
+		{
+			continue;
+		}
+		// Found the NUL, return the string:
+		auto oldPos = mCurPos;
+		mCurPos = i + 1;
+		aDest.assign(&mBuffer.front() + oldPos, i - oldPos);
+		return;
+	}
+
+	// There is no NUL in the buffer, read more data and re-try:
+	readMoreData();
+	return getNextNullTerminatedString(aDest);
+}
+
+
+
+
+
+void LineExtractor::readBytes(char * aDest, size_t aSize)
+{
+	if (!ensureBufferedData(aSize))
+	{
+		throw Dxf::Parser::Error(mCurrentLineNum, "End of file reached.");
+	}
+	std::memcpy(aDest, &mBuffer.front() + mCurPos, aSize);
+	mCurPos += aSize;
+}
+
+
+
+
+
+bool LineExtractor::startsWith(const char * aData, size_t aSize)
+{
+	if (!ensureBufferedData(aSize))
+	{
+		return false;
+	}
+	return (std::memcmp(&mBuffer.front() + mCurPos, aData, aSize) == 0);
+}
+
+
+
+
+
+void LineExtractor::skipBytes(size_t aSize)
+{
+	if (!ensureBufferedData(aSize))
+	{
+		throw Dxf::Parser::Error(mCurrentLineNum, "End of file reached.");
+	}
+	mCurPos += aSize;
+}
+
+
+
+
+
+bool LineExtractor::ensureBufferedData(size_t aSize)
+{
+	while (mDataEnd - mCurPos < aSize)
+	{
+		if (mIsEof)
+		{
+			return false;
+		}
+		readMoreData();
+	}
+	return true;
 }
 
 
@@ -82,6 +190,7 @@ void LineExtractor::readMoreData()
 	{
 		std::memmove(&mBuffer.front(), &mBuffer.front() + mCurPos, mDataEnd - mCurPos);
 		mDataEnd -= mCurPos;
+		mNumBytesDiscarded += mCurPos;
 		mCurPos = 0;
 	}
 
@@ -93,10 +202,12 @@ void LineExtractor::readMoreData()
 			throw Dxf::Parser::Error(mCurrentLineNum, "Line too long, doesn't fit the buffer");
 		}
 		mBuffer.resize(mBuffer.size() * 2);
+		mNumBufferGrowths += 1;
 	}
 
 	// Read the bytes from the datasource:
 	auto numBytesRead = mDataSource(&mBuffer.front() + mDataEnd, mBuffer.size() - mDataEnd);
+	mNumDataSourceReads += 1;
 	if (numBytesRead == 0)
 	{
 		mIsEof = true;
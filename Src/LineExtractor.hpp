@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <stdexcept>
+#include <vector>
 
 #include "DataSource.hpp"
 
@@ -52,6 +54,7 @@ public:
 /** Extracts individual lines from input data source.
 The input is expected to be either LF- or CRLF-separated; CR-only is NOT supported.
 Switching from CRLF to LF and back in the middle IS supported and auto-detected.
+Also provides raw reads of bytes and NUL-terminated strings, used for the binary DXF data.
 Buffers some of the data so that the data source isn't called too often. */
 class LineExtractor
 {
@@ -68,10 +71,47 @@ public:
 	Throws an exception on error, either from the DataSource itself or a Dxf::Util::LineError. */
 	std::string getNextLine();
 
+	/** Reads the next line of input data into aDest, reusing its capacity, so that no allocation is needed
+	once aDest is large enough. Throws the same exceptions as getNextLine(). */
+	void getNextLine(std::string & aDest);
+
+	/** Returns the next NUL-terminated string from the data source, without the terminating NUL.
+	Throws an exception on error, either from the DataSource itself or a Dxf::Util::LineError. */
+	std::string getNextNullTerminatedString();
+
+	/** Reads the next NUL-terminated string into aDest, reusing its capacity.
+	Throws the same exceptions as getNextNullTerminatedString(). */
+	void getNextNullTerminatedString(std::string & aDest);
+
+	/** Reads exactly aSize bytes from the data source into aDest.
+	Throws an exception on error, either from the DataSource itself or a Dxf::Util::LineError. */
+	void readBytes(char * aDest, size_t aSize);
+
+	/** Returns true if the upcoming data starts with the specified bytes.
+	Doesn't consume any data. Returns false if there's not enough data left. */
+	bool startsWith(const char * aData, size_t aSize);
+
+	/** Skips the specified number of bytes of the upcoming data.
+	Throws a Dxf::Util::LineError if there's not enough data left. */
+	void skipBytes(size_t aSize);
+
 	/** Returns the current line number.
-	Useful when reporting errors. */
+	Useful when reporting errors.
+	Note that the raw reads don't update the line number. */
 	unsigned currentLineNum() const { return mCurrentLineNum; }
 
+	/** Returns the total number of bytes consumed from the data source so far (by both the line and raw reads). */
+	uint64_t numBytesConsumed() const { return mNumBytesDiscarded + mCurPos; }
+
+	/** Returns the number of times the internal buffer had to be enlarged to fit a long line. */
+	unsigned numBufferGrowths() const { return mNumBufferGrowths; }
+
+	/** Returns the current size of the internal buffer. */
+	size_t bufferSize() const { return mBuffer.size(); }
+
+	/** Returns the number of times the data source has been called. */
+	size_t numDataSourceReads() const { return mNumDataSourceReads; }
+
 
 protected:
 
@@ -90,11 +130,24 @@ protected:
 	/** The line-counter of the input data. Used mainly for error reporting. */
 	unsigned mCurrentLineNum;
 
+	/** The number of bytes that have been consumed and removed from the front of mBuffer. */
+	uint64_t mNumBytesDiscarded;
+
+	/** The number of times mBuffer has been enlarged. */
+	unsigned mNumBufferGrowths;
+
+	/** The number of times mDataSource has been called. */
+	size_t mNumDataSourceReads;
+
 	/** Set to true if the last data read operation signalled an EOF
 	Further attempts at reads throw an exception. */
 	bool mIsEof;
 
 
+	/** Makes sure that there are at least aSize bytes of data in the buffer, reading more data as needed.
+	Returns false if the data source reaches EOF before that. */
+	bool ensureBufferedData(size_t aSize);
+
 	/** Attempts to read in more data from the data source.
 	Updates mIsEof and throws appropriate exceptions on read-errors.
 	If the buffer has way too much unprocessed data in it, throws an error (invalid data format). */
@@ -0,0 +1,87 @@
+// ParallelFor.cpp
+
+// Implements the parallelFor() function for processing independent work items on multiple threads
+
+#include "ParallelFor.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+void parallelFor(size_t aCount, unsigned aNumThreads, const std::function<void(size_t)> & aFunction)
+{
+	if (aNumThreads == 0)
+	{
+		aNumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	if ((aNumThreads <= 1) || (aCount <= 1))
+	{
+		for (size_t i = 0; i < aCount; ++i)
+		{
+			aFunction(i);
+		}
+		return;
+	}
+
+	// Each worker picks the next index until there are none left:
+	std::atomic<size_t> nextIndex(0);
+	std::mutex mtx;  // Protects error
+	std::exception_ptr error;
+	auto worker = [&]()
+	{
+		try
+		{
+			for (;;)
+			{
+				auto idx = nextIndex.fetch_add(1);
+				if (idx >= aCount)
+				{
+					break;
+				}
+				aFunction(idx);
+			}
+		}
+		catch (...)
+		{
+			nextIndex = aCount;
+			std::lock_guard<std::mutex> lock(mtx);
+			if (error == nullptr)
+			{
+				error = std::current_exception();
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	aNumThreads = static_cast<unsigned>(std::min<size_t>(aNumThreads, aCount));
+	for (unsigned i = 0; i < aNumThreads; ++i)
+	{
+		threads.emplace_back(worker);
+	}
+	for (auto & thread: threads)
+	{
+		thread.join();
+	}
+	if (error != nullptr)
+	{
+		std::rethrow_exception(error);
+	}
+}
+
+
+
+
+
+}  // namespace Dxf
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** Calls aFunction for each index in the range [0, aCount), distributed over aNumThreads threads.
+Each thread picks the next unprocessed index until there are none left, so unevenly sized work items balance out.
+1 thread (or a single item) processes everything on the calling thread, 0 uses as many threads as there are
+hardware threads.
+If aFunction throws, the remaining indices are skipped and the exception is rethrown on the calling thread,
+once all the threads have finished. */
+void parallelFor(size_t aCount, unsigned aNumThreads, const std::function<void(size_t)> & aFunction);
+
+
+
+
+
+}  // namespace Dxf
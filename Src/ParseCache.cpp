@@ -0,0 +1,239 @@
+// ParseCache.cpp
+
+// Implements the ParseCache class for reusing the parsed drawings of repeated inputs
+
+#include "ParseCache.hpp"
+#include <cstdio>
+#include <fstream>
+#include <fmt/format.h>
+#include "ContentHash.hpp"
+#include "DxfParser.hpp"
+#include "Snapshot.hpp"
+
+
+
+
+
+namespace Dxf::Parser
+{
+
+
+
+
+
+namespace
+{
+	/** The size of the blocks in which the input data is read. */
+	static const size_t READ_BLOCK_SIZE = 64 * 1024;
+}
+
+
+
+
+
+ParseCache::ParseCache(size_t aMaxNumDrawings, const std::string & aDiskCacheFolder):
+	mMaxNumDrawings(aMaxNumDrawings),
+	mDiskCacheFolder(aDiskCacheFolder),
+	mStats{0, 0, 0}
+{
+}
+
+
+
+
+
+std::shared_ptr<const Drawing> ParseCache::parse(DataSource && aDataSource)
+{
+	// Read the entire input, hashing it on the way:
+	ContentHasher hasher;
+	std::string data;
+	while (true)
+	{
+		auto oldSize = data.size();
+		data.resize(oldSize + READ_BLOCK_SIZE);
+		auto numRead = aDataSource(data.data() + oldSize, READ_BLOCK_SIZE);
+		data.resize(oldSize + numRead);
+		if (numRead == 0)
+		{
+			break;
+		}
+		hasher.update(data.data() + oldSize, numRead);
+	}
+	auto hash = hasher.digest();
+
+	// Try the memory:
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		auto res = findLocked(hash);
+		if (res != nullptr)
+		{
+			mStats.mNumHits += 1;
+			return res;
+		}
+	}
+
+	// Try the disk:
+	auto res = loadSnapshot(hash);
+	if (res != nullptr)
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMtx);
+			mStats.mNumDiskHits += 1;
+		}
+		return store(hash, std::move(res));
+	}
+
+	// Parse, without holding the lock:
+	auto drawing = Parser::parse(dataSourceFromString(std::move(data)));
+	saveSnapshot(hash, *drawing);
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		mStats.mNumMisses += 1;
+	}
+	return store(hash, std::move(drawing));
+}
+
+
+
+
+
+void ParseCache::clear()
+{
+	std::lock_guard<std::mutex> lock(mMtx);
+	mEntriesByHash.clear();
+	mEntries.clear();
+}
+
+
+
+
+
+size_t ParseCache::size() const
+{
+	std::lock_guard<std::mutex> lock(mMtx);
+	return mEntries.size();
+}
+
+
+
+
+
+ParseCache::Stats ParseCache::stats() const
+{
+	std::lock_guard<std::mutex> lock(mMtx);
+	return mStats;
+}
+
+
+
+
+
+std::shared_ptr<const Drawing> ParseCache::findLocked(uint64_t aHash)
+{
+	auto itr = mEntriesByHash.find(aHash);
+	if (itr == mEntriesByHash.end())
+	{
+		return nullptr;
+	}
+	mEntries.splice(mEntries.begin(), mEntries, itr->second);
+	return itr->second->mDrawing;
+}
+
+
+
+
+
+std::shared_ptr<const Drawing> ParseCache::store(uint64_t aHash, std::shared_ptr<const Drawing> && aDrawing)
+{
+	std::lock_guard<std::mutex> lock(mMtx);
+	auto existing = findLocked(aHash);
+	if (existing != nullptr)
+	{
+		return existing;
+	}
+	if (mMaxNumDrawings == 0)
+	{
+		return std::move(aDrawing);
+	}
+	while (mEntries.size() >= mMaxNumDrawings)
+	{
+		mEntriesByHash.erase(mEntries.back().mHash);
+		mEntries.pop_back();
+	}
+	mEntries.push_front({aHash, aDrawing});
+	mEntriesByHash[aHash] = mEntries.begin();
+	return std::move(aDrawing);
+}
+
+
+
+
+
+std::string ParseCache::snapshotFileName(uint64_t aHash) const
+{
+	return fmt::format("{}/{:016x}.dxfsnap", mDiskCacheFolder, aHash);
+}
+
+
+
+
+
+std::shared_ptr<const Drawing> ParseCache::loadSnapshot(uint64_t aHash) const
+{
+	if (mDiskCacheFolder.empty())
+	{
+		return nullptr;
+	}
+	try
+	{
+		auto view = Snapshot::openFile(snapshotFileName(aHash));
+		if (view.sourceHash() != aHash)
+		{
+			return nullptr;
+		}
+		return view.toDrawing();
+	}
+	catch (const std::exception &)
+	{
+		// No snapshot, or it is damaged; parse the data instead
+		return nullptr;
+	}
+}
+
+
+
+
+
+void ParseCache::saveSnapshot(uint64_t aHash, const Drawing & aDrawing) const
+{
+	if (mDiskCacheFolder.empty())
+	{
+		return;
+	}
+
+	// Write into a temporary file first, then rename, so that concurrent readers never see a partial snapshot:
+	auto fileName = snapshotFileName(aHash);
+	auto tempFileName = fmt::format("{}.{}.tmp", fileName, static_cast<const void *>(&aDrawing));
+	try
+	{
+		{
+			std::ofstream f(tempFileName, std::ios::binary | std::ios::trunc);
+			Snapshot::write(aDrawing, aHash, Writer::dataSinkFromStdStream(f));
+		}
+		if (std::rename(tempFileName.c_str(), fileName.c_str()) != 0)
+		{
+			std::remove(tempFileName.c_str());
+		}
+	}
+	catch (const std::exception &)
+	{
+		// The disk cache is only an optimization, ignore the failure
+		std::remove(tempFileName.c_str());
+	}
+}
+
+
+
+
+
+}  // namespace Dxf::Parser
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "DxfDrawing.hpp"
+#include "DataSource.hpp"
+
+
+
+
+
+namespace Dxf::Parser
+{
+
+
+
+
+
+/** A cache of parsed drawings, keyed by the hash of the input data.
+Meant for services that repeatedly open the same files: parsing the same data again returns the very same immutable Drawing.
+The input is always read completely, hashed while reading, and only parsed if the hash is not in the cache.
+Keeps up to the specified number of the most recently used drawings in the memory.
+Optionally, the parsed drawings are also stored as snapshots (see Dxf::Snapshot) in a folder on the disk,
+which is used when a drawing is not in the memory; this persists the cache across process restarts.
+The snapshots keep the entities' extended data and the raw data (see Drawing::mRawEntities), so the drawings loaded
+from them are written back the same way as the freshly parsed ones.
+All public functions are thread-safe. */
+class ParseCache
+{
+public:
+
+	/** The statistics of the cache usage. */
+	class Stats
+	{
+	public:
+		/** The number of parse() calls served from the memory. */
+		size_t mNumHits;
+
+		/** The number of parse() calls served from the snapshots on the disk. */
+		size_t mNumDiskHits;
+
+		/** The number of parse() calls that had to parse the data. */
+		size_t mNumMisses;
+	};
+
+
+	/** Creates a new empty cache that keeps up to aMaxNumDrawings drawings in the memory.
+	If aDiskCacheFolder is not empty, the snapshots of the parsed drawings are stored in (and loaded from) that folder.
+	The folder must already exist. */
+	explicit ParseCache(size_t aMaxNumDrawings, const std::string & aDiskCacheFolder = std::string());
+
+	// Disable copy- and move-constructors, the mutex is not copyable:
+	ParseCache(const ParseCache & aOther) = delete;
+	ParseCache(ParseCache && aOther) = delete;
+
+	/** Returns the drawing parsed from the specified data source, using the cache.
+	The returned drawing is shared with all the other callers parsing the same data, so it must not be modified.
+	Throws a Dxf::Parser::Error exception upon a parsing error (errors are not cached).
+	May throw other exceptions coming from the underlying systems, such as when reading the data source.
+	Failures of the disk cache are not reported, such data is simply parsed again. */
+	std::shared_ptr<const Drawing> parse(DataSource && aDataSource);
+
+	/** Removes all the drawings from the memory.
+	The snapshots on the disk are kept. */
+	void clear();
+
+	/** Returns the number of drawings currently kept in the memory. */
+	size_t size() const;
+
+	/** Returns the statistics of the cache usage so far. */
+	Stats stats() const;
+
+
+protected:
+
+	/** A single cached drawing. */
+	struct Entry
+	{
+		/** The hash of the data from which the drawing was parsed. */
+		uint64_t mHash;
+
+		std::shared_ptr<const Drawing> mDrawing;
+	};
+
+	/** The maximum number of drawings kept in mEntries. */
+	const size_t mMaxNumDrawings;
+
+	/** The folder in which the snapshots are stored, empty if the disk cache is not used. */
+	const std::string mDiskCacheFolder;
+
+	/** Protects all the mutable members against multithreaded access. */
+	mutable std::mutex mMtx;
+
+	/** The cached drawings, the most recently used first. */
+	std::list<Entry> mEntries;
+
+	/** Map of the input hash -> the entry in mEntries, for fast lookups. */
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> mEntriesByHash;
+
+	/** The statistics so far. */
+	Stats mStats;
+
+
+	/** Returns the drawing cached in the memory for the specified hash, or nullptr if not present.
+	Marks the entry as the most recently used. Expects mMtx to be locked by the caller. */
+	std::shared_ptr<const Drawing> findLocked(uint64_t aHash);
+
+	/** Adds the specified drawing into the memory, evicting the least recently used drawings over the limit.
+	If another drawing of the same hash has been added meanwhile (concurrent parse), keeps that one and returns it,
+	otherwise returns aDrawing. */
+	std::shared_ptr<const Drawing> store(uint64_t aHash, std::shared_ptr<const Drawing> && aDrawing);
+
+	/** Returns the name of the disk snapshot file for the specified hash. */
+	std::string snapshotFileName(uint64_t aHash) const;
+
+	/** Loads the drawing from the disk snapshot for the specified hash.
+	Returns nullptr if the disk cache is not used, there's no snapshot or it is not valid. */
+	std::shared_ptr<const Drawing> loadSnapshot(uint64_t aHash) const;
+
+	/** Stores the snapshot of the specified drawing on the disk, if the disk cache is used.
+	Ignores any errors. */
+	void saveSnapshot(uint64_t aHash, const Drawing & aDrawing) const;
+};
+
+
+
+
+
+}  // namespace Dxf::Parser
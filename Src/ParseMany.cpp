@@ -0,0 +1,239 @@
+// ParseMany.cpp
+
+// Implements the parseMany() function for parsing many files concurrently
+
+#include "ParseMany.hpp"
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+
+
+
+
+namespace Dxf::Parser
+{
+
+
+
+
+
+namespace
+{
+
+/** A single parseMany() run: the shared state of the workers and the delivery of their results. */
+class Batch
+{
+	const std::vector<std::string> & mFileNames;
+	const BatchCallback & mCallback;
+	const BatchOptions & mOptions;
+
+	/** Protects all the members below. */
+	std::mutex mMtx;
+
+	/** Notified whenever the state changes: a result finished, a result delivered, a worker ended. */
+	std::condition_variable mCV;
+
+	/** The index of the next file to be parsed. */
+	size_t mNextIndex;
+
+	/** The total size of the files that are being parsed or whose results haven't been delivered yet. */
+	uint64_t mInFlightBytes;
+
+	/** The number of files that are being parsed or whose results haven't been delivered yet. */
+	size_t mNumInFlight;
+
+	/** The finished results, waiting to be delivered to the callback, together with their file sizes. */
+	std::deque<std::pair<BatchResult, uint64_t>> mFinished;
+
+	/** The number of worker threads that haven't ended yet. */
+	size_t mNumRunningWorkers;
+
+	/** Set when the workers should stop starting new files. */
+	bool mShouldStop;
+
+
+public:
+
+	Batch(const std::vector<std::string> & aFileNames, const BatchCallback & aCallback, const BatchOptions & aOptions):
+		mFileNames(aFileNames),
+		mCallback(aCallback),
+		mOptions(aOptions),
+		mNextIndex(0),
+		mInFlightBytes(0),
+		mNumInFlight(0),
+		mNumRunningWorkers(0),
+		mShouldStop(false)
+	{
+	}
+
+
+
+
+
+	/** Runs the workers and delivers their results on the calling thread, until all the files are done. */
+	void run(unsigned aNumThreads)
+	{
+		if (aNumThreads == 0)
+		{
+			aNumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+		}
+		aNumThreads = static_cast<unsigned>(std::min<size_t>(aNumThreads, mFileNames.size()));
+		std::vector<std::thread> workers;
+		mNumRunningWorkers = aNumThreads;
+		for (unsigned i = 0; i < aNumThreads; ++i)
+		{
+			workers.emplace_back([this]() { workerThread(); });
+		}
+
+		// Deliver the results as they come:
+		std::exception_ptr callbackError;
+		for (;;)
+		{
+			std::pair<BatchResult, uint64_t> finished;
+			{
+				std::unique_lock<std::mutex> lock(mMtx);
+				mCV.wait(lock, [this]() { return !mFinished.empty() || (mNumRunningWorkers == 0); });
+				if (mFinished.empty())
+				{
+					break;
+				}
+				finished = std::move(mFinished.front());
+				mFinished.pop_front();
+			}
+			if (callbackError == nullptr)
+			{
+				try
+				{
+					mCallback(std::move(finished.first));
+				}
+				catch (...)
+				{
+					callbackError = std::current_exception();
+				}
+			}
+			std::lock_guard<std::mutex> lock(mMtx);
+			mInFlightBytes -= finished.second;
+			mNumInFlight -= 1;
+			if (callbackError != nullptr)
+			{
+				mShouldStop = true;
+			}
+			mCV.notify_all();
+		}
+
+		for (auto & worker: workers)
+		{
+			worker.join();
+		}
+		if (callbackError != nullptr)
+		{
+			std::rethrow_exception(callbackError);
+		}
+	}
+
+
+protected:
+
+	/** The worker thread: parses the files one by one, until there are no more files. */
+	void workerThread()
+	{
+		for (;;)
+		{
+			// Pick the next file:
+			size_t index;
+			{
+				std::lock_guard<std::mutex> lock(mMtx);
+				if (mShouldStop || (mNextIndex >= mFileNames.size()))
+				{
+					break;
+				}
+				index = mNextIndex;
+				mNextIndex += 1;
+			}
+			const auto & fileName = mFileNames[index];
+			std::error_code ec;
+			uint64_t fileSize = std::filesystem::file_size(fileName, ec);
+			if (ec)
+			{
+				fileSize = 0;  // The error will be reported by the parsing
+			}
+
+			// Wait for the in-flight data to fit the limit:
+			{
+				std::unique_lock<std::mutex> lock(mMtx);
+				mCV.wait(lock, [this, fileSize]()
+					{
+						return mShouldStop || (mNumInFlight == 0) || (mInFlightBytes + fileSize <= mOptions.mMaxInFlightBytes);
+					}
+				);
+				if (mShouldStop)
+				{
+					break;
+				}
+				mInFlightBytes += fileSize;
+				mNumInFlight += 1;
+			}
+
+			// Parse:
+			BatchResult res;
+			res.mIndex = index;
+			res.mFileName = fileName;
+			try
+			{
+				auto options = mOptions.mParseOptions;
+				options.mTotalSize = fileSize;
+				if (mOptions.mLayerListOnly)
+				{
+					res.mLayerNames = parseLayerList(dataSourceFromFile(fileName), options);
+				}
+				else
+				{
+					res.mDrawing = parse(dataSourceFromFile(fileName), options);
+				}
+			}
+			catch (...)
+			{
+				res.mError = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock(mMtx);
+			mFinished.emplace_back(std::move(res), fileSize);
+			mCV.notify_all();
+		}
+
+		std::lock_guard<std::mutex> lock(mMtx);
+		mNumRunningWorkers -= 1;
+		mCV.notify_all();
+	}
+};
+
+}  // anonymous namespace
+
+
+
+
+
+void parseMany(
+	const std::vector<std::string> & aFileNames,
+	unsigned aNumThreads,
+	const BatchCallback & aCallback,
+	const BatchOptions & aOptions
+)
+{
+	if (aOptions.mParseOptions.mStats != nullptr)
+	{
+		throw std::logic_error("parseMany() doesn't support the parser instrumentation");
+	}
+	Batch batch(aFileNames, aCallback, aOptions);
+	batch.run(aNumThreads);
+}
+
+
+
+
+
+}  // namespace Dxf::Parser
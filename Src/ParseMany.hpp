@@ -0,0 +1,94 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <string>
+#include <vector>
+#include "DxfParser.hpp"
+
+
+
+
+
+namespace Dxf::Parser
+{
+
+
+
+
+
+/** The result of parsing a single file by parseMany(). */
+class BatchResult
+{
+public:
+	/** The index of the file within the file list given to parseMany(). */
+	size_t mIndex;
+
+	/** The name of the parsed file. */
+	std::string mFileName;
+
+	/** The parsed drawing, nullptr on error or when parsing only the layer lists. */
+	std::shared_ptr<Drawing> mDrawing;
+
+	/** The names of the layers, when parsing only the layer lists. */
+	std::vector<std::string> mLayerNames;
+
+	/** The exception that occurred while reading or parsing the file, empty on success. */
+	std::exception_ptr mError;
+};
+
+/** The callback that receives the individual results from parseMany(). */
+using BatchCallback = std::function<void (BatchResult && aResult)>;
+
+
+
+
+
+/** Options for parseMany(). */
+class BatchOptions
+{
+public:
+
+	/** The options used for parsing each of the files.
+	The callbacks are called from the worker threads, concurrently, and so must be thread-safe.
+	mStats is not supported (the threads would write the same object) and must be nullptr. */
+	Options mParseOptions;
+
+	/** If true, only the layer lists are parsed (see parseLayerList()), instead of the full drawings. */
+	bool mLayerListOnly;
+
+	/** The maximum total size of the files being parsed or waiting in the results, in bytes.
+	A worker doesn't start parsing another file until the previous results are delivered and the total fits.
+	A single file larger than this is still parsed, when it's the only one in flight. */
+	uint64_t mMaxInFlightBytes;
+
+
+	/** Creates the default options: full parsing, up to 1 GiB of input data in flight. */
+	BatchOptions():
+		mLayerListOnly(false),
+		mMaxInFlightBytes(1024 * 1024 * 1024)
+	{
+	}
+};
+
+
+
+
+
+/** Parses the specified files concurrently on a pool of aNumThreads threads (zero for the number of CPU cores).
+The results are delivered through aCallback as soon as each file finishes, in the order of finishing.
+The callback is always called on the calling thread (never concurrently); parseMany() returns after all the files are done.
+Errors in individual files are reported in their results and don't stop the other files.
+If the callback throws, the remaining files are not started and the exception is rethrown once the workers finish. */
+void parseMany(
+	const std::vector<std::string> & aFileNames,
+	unsigned aNumThreads,
+	const BatchCallback & aCallback,
+	const BatchOptions & aOptions = BatchOptions()
+);
+
+
+
+
+
+}  // namespace Dxf::Parser
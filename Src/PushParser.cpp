@@ -0,0 +1,164 @@
+// PushParser.cpp
+
+// Implements the PushParser class for parsing the input data incrementally, as it arrives
+
+#include "PushParser.hpp"
+#include <algorithm>
+#include <cstring>
+
+
+
+
+
+namespace Dxf::Parser
+{
+
+
+
+
+
+PushParser::PushParser(const Options & aOptions):
+	mData(nullptr),
+	mDataSize(0),
+	mIsWaitingForData(false),
+	mIsEndOfData(false),
+	mShouldAbort(false),
+	mIsParserDone(false)
+{
+	mParserThread = std::thread([this, aOptions]()
+		{
+			std::shared_ptr<Drawing> drawing;
+			std::exception_ptr exc;
+			try
+			{
+				drawing = parse([this](char * aDestBuffer, size_t aSize)
+					{
+						return readData(aDestBuffer, aSize);
+					},
+					aOptions
+				);
+			}
+			catch (...)
+			{
+				exc = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lock(mMtx);
+			mDrawing = std::move(drawing);
+			mException = exc;
+			mIsParserDone = true;
+			mCV.notify_all();
+		}
+	);
+}
+
+
+
+
+
+PushParser::~PushParser()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMtx);
+		mShouldAbort = true;
+		mCV.notify_all();
+	}
+	if (mParserThread.joinable())
+	{
+		mParserThread.join();
+	}
+}
+
+
+
+
+
+void PushParser::feed(const char * aData, size_t aSize)
+{
+	if (aSize == 0)
+	{
+		return;
+	}
+	std::unique_lock<std::mutex> lock(mMtx);
+	if (mIsEndOfData)
+	{
+		throw std::logic_error("PushParser::feed() called after finish()");
+	}
+	if (mIsParserDone)
+	{
+		if (mException != nullptr)
+		{
+			std::rethrow_exception(mException);
+		}
+		return;
+	}
+	mData = aData;
+	mDataSize = aSize;
+	mIsWaitingForData = false;
+	mCV.notify_all();
+
+	// Wait for the parser to process the whole chunk:
+	mCV.wait(lock, [this]() { return ((mDataSize == 0) && mIsWaitingForData) || mIsParserDone; });
+	mData = nullptr;
+	mDataSize = 0;
+	if (mException != nullptr)
+	{
+		std::rethrow_exception(mException);
+	}
+}
+
+
+
+
+
+std::shared_ptr<Drawing> PushParser::finish()
+{
+	{
+		std::unique_lock<std::mutex> lock(mMtx);
+		mIsEndOfData = true;
+		mCV.notify_all();
+		mCV.wait(lock, [this]() { return mIsParserDone; });
+	}
+	if (mParserThread.joinable())
+	{
+		mParserThread.join();
+	}
+	if (mException != nullptr)
+	{
+		std::rethrow_exception(mException);
+	}
+	return mDrawing;
+}
+
+
+
+
+
+size_t PushParser::readData(char * aDestBuffer, size_t aSize)
+{
+	std::unique_lock<std::mutex> lock(mMtx);
+	if (mDataSize == 0)
+	{
+		// Let feed() return and wait for the next chunk:
+		mIsWaitingForData = true;
+		mCV.notify_all();
+		mCV.wait(lock, [this]() { return (mDataSize > 0) || mIsEndOfData || mShouldAbort; });
+	}
+	if (mShouldAbort)
+	{
+		throw Cancelled(0);
+	}
+	auto numBytes = std::min(aSize, mDataSize);
+	if (numBytes > 0)
+	{
+		memcpy(aDestBuffer, mData, numBytes);
+		mData += numBytes;
+		mDataSize -= numBytes;
+	}
+	return numBytes;
+}
+
+
+
+
+
+}  // namespace Dxf::Parser
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include "DxfParser.hpp"
+
+
+
+
+
+namespace Dxf::Parser
+{
+
+
+
+
+
+/** A parser that is fed the input data in chunks as they arrive, instead of pulling it from a DataSource.
+Meant for parsing the data while it is still being received, such as chunked uploads.
+The parsing state is kept between the chunks, each feed() call parses as much of the data as possible and only returns
+once the parser needs more data. The completed entities are reported through Options::mEntityCallback
+(and the progress through Options::mProgressCallback) while inside feed() or finish(), on an internal thread,
+but never concurrently with the caller.
+Internally the regular parser runs on a dedicated thread that waits for the data, so the results are exactly
+the same as parsing the entire data at once with parse(). */
+class PushParser
+{
+public:
+
+	/** Creates a new parser that will use the specified options for the parsing. */
+	explicit PushParser(const Options & aOptions = Options());
+
+	/** Stops the parsing, if it hasn't finished yet, discarding its results. */
+	~PushParser();
+
+	// Disable copy- and move-constructors, the internal thread refers to this object:
+	PushParser(const PushParser & aOther) = delete;
+	PushParser(PushParser && aOther) = delete;
+
+	/** Feeds the next chunk of the input data to the parser and parses it.
+	Returns once the parser has processed the whole chunk, the data is not referenced afterwards.
+	Data fed after the parser has found the end of the drawing is ignored.
+	Throws the parsing exception (Dxf::Parser::Error, Dxf::Parser::Cancelled, ...) if the parsing has failed
+	(in this call or any previous one). */
+	void feed(const char * aData, size_t aSize);
+
+	/** Signals that there's no more input data, finishes the parsing and returns the parsed drawing.
+	Throws the parsing exception if the parsing has failed, or a Dxf::Parser::Error if the data is incomplete. */
+	std::shared_ptr<Drawing> finish();
+
+
+protected:
+
+	/** Protects all the members shared with the parser thread. */
+	std::mutex mMtx;
+
+	/** Notified whenever the shared state changes. */
+	std::condition_variable mCV;
+
+	/** The not-yet-consumed part of the chunk currently being fed. */
+	const char * mData;
+
+	/** The size of mData. */
+	size_t mDataSize;
+
+	/** Set when the parser thread is waiting for more data. */
+	bool mIsWaitingForData;
+
+	/** Set by finish(), when there's no more data to come. */
+	bool mIsEndOfData;
+
+	/** Set by the destructor to abort the parser thread. */
+	bool mShouldAbort;
+
+	/** Set by the parser thread once it has finished (successfully or not). */
+	bool mIsParserDone;
+
+	/** The exception that terminated the parser thread, if any. */
+	std::exception_ptr mException;
+
+	/** The parsed drawing, once mIsParserDone is set and mException is empty. */
+	std::shared_ptr<Drawing> mDrawing;
+
+	/** The thread running the parser. */
+	std::thread mParserThread;
+
+
+	/** The DataSource implementation used by the parser thread, waits for the data from feed().
+	Returns zero (EOF) once finish() has been called. */
+	size_t readData(char * aDestBuffer, size_t aSize);
+};
+
+
+
+
+
+}  // namespace Dxf::Parser
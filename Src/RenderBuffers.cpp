@@ -0,0 +1,551 @@
+// RenderBuffers.cpp
+
+// Implements the export of drawings into flat vertex and index buffers for rendering
+
+#include "RenderBuffers.hpp"
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include "ParallelFor.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+namespace
+{
+	/** The alpha bits added to the gColors values. */
+	static const uint32_t OPAQUE = 0xff000000;
+
+
+
+
+
+	/** The objects of a single layer to be exported. */
+	class LayerInput
+	{
+	public:
+
+		/** The layer, used for resolving the COLOR_BYLAYER colors. May be nullptr. */
+		const Layer * mLayer;
+
+		/** The objects to export. */
+		const PrimitivePtrs * mObjects;
+	};
+
+
+
+
+
+	/** Counts or writes the render buffers of a single layer.
+	Both use the same code path, so that the counts always match what gets written. */
+	class LayerWriter
+	{
+	public:
+
+		/** Creates a writer that only counts the items. */
+		LayerWriter(const Layer * aLayer, const RenderOptions & aOptions, BlockFlattener & aBlockFlattener):
+			mLayer(aLayer),
+			mOptions(aOptions),
+			mBlockFlattener(aBlockFlattener),
+			mDest(nullptr)
+		{
+		}
+
+
+		/** Creates a writer that writes the items into aDest, starting at the specified positions within the buffers. */
+		LayerWriter(
+			const Layer * aLayer,
+			const RenderOptions & aOptions,
+			BlockFlattener & aBlockFlattener,
+			const RenderBufferMemory & aDest,
+			const RenderBufferSizes & aStart
+		):
+			mLayer(aLayer),
+			mOptions(aOptions),
+			mBlockFlattener(aBlockFlattener),
+			mDest(&aDest),
+			mPos(aStart)
+		{
+		}
+
+
+		/** Adds all the specified objects. */
+		void addObjects(const PrimitivePtrs & aObjects)
+		{
+			auto offset = Coords(0, 0) - mOptions.mOrigin;
+			for (const auto & obj: aObjects)
+			{
+				if (obj != nullptr)
+				{
+					addObject(*obj, offset, COLOR_BYBLOCK);
+				}
+			}
+		}
+
+
+		/** Returns the current positions within the buffers; for the counting writer, the number of the items. */
+		const RenderBufferSizes & position() const { return mPos; }
+
+
+	protected:
+
+		/** The layer whose objects are written, may be nullptr. */
+		const Layer * mLayer;
+
+		/** The export options. */
+		const RenderOptions & mOptions;
+
+		/** Provides the geometry of the Block objects. */
+		BlockFlattener & mBlockFlattener;
+
+		/** The memory to write into, nullptr when only counting. */
+		const RenderBufferMemory * mDest;
+
+		/** The positions within the buffers where the next items are written. */
+		RenderBufferSizes mPos;
+
+		/** The tessellated coords of the current path, reused between the objects. */
+		std::vector<Coord> mScratch;
+
+
+		/** Returns the color to write for the specified object color.
+		aBlockColor is the color of the Block the object comes from, COLOR_BYBLOCK for the objects outside any blocks. */
+		uint32_t resolveColor(Color aColor, Color aBlockColor) const
+		{
+			if (aColor == COLOR_BYBLOCK)
+			{
+				aColor = aBlockColor;
+			}
+			if ((aColor == COLOR_BYLAYER) && (mLayer != nullptr))
+			{
+				aColor = mLayer->defaultColor();
+			}
+			if ((aColor < 0) || (static_cast<size_t>(aColor) >= gNumColors))
+			{
+				aColor = mOptions.mFallbackColor;
+			}
+			return OPAQUE | gColors[aColor];
+		}
+
+
+		/** Adds the specified object, moved by aOffset. */
+		void addObject(const Primitive & aObject, const Coords & aOffset, Color aBlockColor)
+		{
+			switch (aObject.mObjectType)
+			{
+				case otPoint:
+				{
+					addPoint(aObject.mPos, aOffset, resolveColor(aObject.mColor, aBlockColor));
+					return;
+				}
+				case otSolid:
+				{
+					// The SOLID's corners are in the triangle strip order:
+					const auto & solid = static_cast<const Solid &>(aObject);
+					auto color = resolveColor(solid.mColor, aBlockColor);
+					if (solid.isTetra())
+					{
+						addTriangles({&solid.mPos, &solid.mPos2, &solid.mPos3, &solid.mPos4}, {0, 1, 2, 1, 3, 2}, aOffset, color);
+					}
+					else
+					{
+						addTriangles({&solid.mPos, &solid.mPos2, &solid.mPos3}, {0, 1, 2}, aOffset, color);
+					}
+					return;
+				}
+				case otBlock:
+				{
+					// The flattened objects contain no more blocks, so this recurses only once:
+					const auto & block = static_cast<const Block &>(aObject);
+					auto flattened = mBlockFlattener.flatten(block);
+					auto offset = aOffset + block.mPos;
+					auto blockColor = (block.mColor == COLOR_BYBLOCK) ? aBlockColor : block.mColor;
+					for (const auto & obj: flattened->mObjects)
+					{
+						addObject(*obj, offset, blockColor);
+					}
+					return;
+				}
+				default:
+				{
+					addPath(aObject, aOffset, aBlockColor);
+					return;
+				}
+			}
+		}
+
+
+		/** Returns the vertex at the specified coords moved by aOffset. */
+		static RenderVertex vertex(Coord aX, Coord aY, Coord aZ, const Coords & aOffset, uint32_t aColor)
+		{
+			return RenderVertex{
+				static_cast<float>(aX + aOffset.mX),
+				static_cast<float>(aY + aOffset.mY),
+				static_cast<float>(aZ + aOffset.mZ),
+				aColor
+			};
+		}
+
+
+		/** Adds a single point. */
+		void addPoint(const Coords & aPos, const Coords & aOffset, uint32_t aColor)
+		{
+			auto & pos = mPos.mPoints;
+			if (mDest != nullptr)
+			{
+				mDest->mPoints.mVertices[pos.mNumVertices] = vertex(aPos.mX, aPos.mY, aPos.mZ, aOffset, aColor);
+				mDest->mPoints.mIndices[pos.mNumIndices] = static_cast<uint32_t>(pos.mNumVertices);
+			}
+			pos.mNumVertices += 1;
+			pos.mNumIndices += 1;
+		}
+
+
+		/** Adds the triangles with the specified corners; aIndices index into aCorners, three per triangle. */
+		void addTriangles(
+			std::initializer_list<const Coords *> aCorners,
+			std::initializer_list<uint32_t> aIndices,
+			const Coords & aOffset,
+			uint32_t aColor
+		)
+		{
+			auto & pos = mPos.mTriangles;
+			if (mDest != nullptr)
+			{
+				auto base = static_cast<uint32_t>(pos.mNumVertices);
+				auto dstVertex = mDest->mTriangles.mVertices + pos.mNumVertices;
+				for (auto corner: aCorners)
+				{
+					*dstVertex++ = vertex(corner->mX, corner->mY, corner->mZ, aOffset, aColor);
+				}
+				auto dstIndex = mDest->mTriangles.mIndices + pos.mNumIndices;
+				for (auto index: aIndices)
+				{
+					*dstIndex++ = base + index;
+				}
+			}
+			pos.mNumVertices += aCorners.size();
+			pos.mNumIndices += aIndices.size();
+		}
+
+
+		/** Adds the tessellated path of the object, if it has one. */
+		void addPath(const Primitive & aObject, const Coords & aOffset, Color aBlockColor)
+		{
+			auto numPoints = numTessellatedPoints(aObject, mOptions.mTessellation);
+			if (numPoints < 2)
+			{
+				return;
+			}
+			auto & pos = mPos.mLines;
+			if (mDest != nullptr)
+			{
+				mScratch.resize(3 * numPoints);
+				tessellate(aObject, mOptions.mTessellation, mScratch.data());
+				auto color = resolveColor(aObject.mColor, aBlockColor);
+				auto coords = mScratch.data();
+				auto dstVertex = mDest->mLines.mVertices + pos.mNumVertices;
+				for (size_t i = 0; i < numPoints; ++i, coords += 3)
+				{
+					dstVertex[i] = vertex(coords[0], coords[1], coords[2], aOffset, color);
+				}
+				auto base = static_cast<uint32_t>(pos.mNumVertices);
+				auto dstIndex = mDest->mLines.mIndices + pos.mNumIndices;
+				for (uint32_t i = 0; i + 1 < numPoints; ++i)
+				{
+					*dstIndex++ = base + i;
+					*dstIndex++ = base + i + 1;
+				}
+			}
+			pos.mNumVertices += numPoints;
+			pos.mNumIndices += 2 * (numPoints - 1);
+		}
+	};
+
+
+
+
+
+	/** Exports a list of layers: counts the items of each layer, lays the layers out one after another in the buffers,
+	then writes each layer into its part of the buffers. */
+	class Exporter
+	{
+	public:
+
+		Exporter(std::vector<LayerInput> && aLayers, const RenderOptions & aOptions):
+			mLayers(std::move(aLayers)),
+			mOptions(aOptions),
+			mBlockFlattener((aOptions.mBlockFlattener != nullptr) ? *aOptions.mBlockFlattener : mLocalBlockFlattener)
+		{
+			if ((aOptions.mFallbackColor < 0) || (static_cast<size_t>(aOptions.mFallbackColor) >= gNumColors))
+			{
+				throw std::invalid_argument("RenderOptions: Invalid fallback color");
+			}
+		}
+
+
+		/** Counts the items of each layer, in parallel, and calculates where each layer starts in the buffers.
+		Returns the total number of the items.
+		Throws a std::length_error if a buffer has too many vertices for the 32-bit indices. */
+		RenderBufferSizes layOut()
+		{
+			mStarts.resize(mLayers.size());
+			parallelFor(mLayers.size(), mOptions.mNumThreads, [this](size_t aIndex)
+				{
+					LayerWriter writer(mLayers[aIndex].mLayer, mOptions, mBlockFlattener);
+					writer.addObjects(*mLayers[aIndex].mObjects);
+					mStarts[aIndex] = writer.position();
+				}
+			);
+			RenderBufferSizes total;
+			for (auto & start: mStarts)
+			{
+				auto layerSizes = start;
+				start = total;
+				addSize(total.mLines, layerSizes.mLines);
+				addSize(total.mTriangles, layerSizes.mTriangles);
+				addSize(total.mPoints, layerSizes.mPoints);
+			}
+			return total;
+		}
+
+
+		/** Writes all the layers into aDest, in parallel, each one into its part of the buffers.
+		layOut() must have been called before. */
+		void write(const RenderBufferMemory & aDest)
+		{
+			parallelFor(mLayers.size(), mOptions.mNumThreads, [&](size_t aIndex)
+				{
+					LayerWriter writer(mLayers[aIndex].mLayer, mOptions, mBlockFlattener, aDest, mStarts[aIndex]);
+					writer.addObjects(*mLayers[aIndex].mObjects);
+				}
+			);
+		}
+
+
+	protected:
+
+		/** The layers to export. */
+		std::vector<LayerInput> mLayers;
+
+		/** The export options. */
+		const RenderOptions & mOptions;
+
+		/** The block flattener used when the options don't provide one. */
+		BlockFlattener mLocalBlockFlattener;
+
+		/** The block flattener in use. */
+		BlockFlattener & mBlockFlattener;
+
+		/** The position of each layer's first items within the buffers, calculated by layOut(). */
+		std::vector<RenderBufferSizes> mStarts;
+
+
+		/** Adds aSize to aTotal, checking that the vertices can still be indexed by 32-bit indices. */
+		static void addSize(RenderBatchSize & aTotal, const RenderBatchSize & aSize)
+		{
+			aTotal.mNumVertices += aSize.mNumVertices;
+			aTotal.mNumIndices += aSize.mNumIndices;
+			if (aTotal.mNumVertices > std::numeric_limits<uint32_t>::max())
+			{
+				throw std::length_error("RenderBuffers: Too many vertices");
+			}
+		}
+	};
+
+
+
+
+
+	/** Returns the layers of the drawing to export.
+	The layers' storage may contain the tombstones of the removed objects, those are skipped by Writer::addObjects(). */
+	std::vector<LayerInput> drawingLayers(const Drawing & aDrawing)
+	{
+		std::vector<LayerInput> res;
+		res.reserve(aDrawing.layers().size());
+		for (const auto & layer: aDrawing.layers())
+		{
+			res.push_back({layer.get(), &layer->objects()});
+		}
+		return res;
+	}
+
+
+
+
+
+	/** Returns the layers of the LodPyramid query result to export. */
+	std::vector<LayerInput> queryLayers(const std::vector<LodLayerObjects> & aObjects)
+	{
+		std::vector<LayerInput> res;
+		res.reserve(aObjects.size());
+		for (const auto & layerObjects: aObjects)
+		{
+			res.push_back({layerObjects.mLayer, &layerObjects.mObjects});
+		}
+		return res;
+	}
+
+
+
+
+
+	/** Throws a std::invalid_argument if the memory is missing for a non-empty batch,
+	or if its capacity is smaller than the batch size. */
+	void checkMemory(const RenderBatchSize & aSize, const RenderBatchMemory & aMemory)
+	{
+		if (
+			((aSize.mNumVertices > 0) && (aMemory.mVertices == nullptr)) ||
+			((aSize.mNumIndices > 0) && (aMemory.mIndices == nullptr))
+		)
+		{
+			throw std::invalid_argument("RenderBufferMemory: Missing memory for a non-empty buffer");
+		}
+		if ((aSize.mNumVertices > aMemory.mVertexCapacity) || (aSize.mNumIndices > aMemory.mIndexCapacity))
+		{
+			throw std::invalid_argument("RenderBufferMemory: Buffer capacity smaller than the buffer size");
+		}
+	}
+
+
+
+
+
+	/** Lays out and writes the buffers into the caller-provided memory. */
+	void writeBuffers(Exporter & aExporter, const RenderBufferMemory & aDest)
+	{
+		auto sizes = aExporter.layOut();
+		checkMemory(sizes.mLines, aDest.mLines);
+		checkMemory(sizes.mTriangles, aDest.mTriangles);
+		checkMemory(sizes.mPoints, aDest.mPoints);
+		aExporter.write(aDest);
+	}
+
+
+
+
+
+	/** Lays out the buffers, allocates them once and writes them. */
+	RenderBuffers exportBuffers(Exporter & aExporter)
+	{
+		auto sizes = aExporter.layOut();
+		RenderBuffers res;
+		res.mLines.mVertices.resize(sizes.mLines.mNumVertices);
+		res.mLines.mIndices.resize(sizes.mLines.mNumIndices);
+		res.mTriangles.mVertices.resize(sizes.mTriangles.mNumVertices);
+		res.mTriangles.mIndices.resize(sizes.mTriangles.mNumIndices);
+		res.mPoints.mVertices.resize(sizes.mPoints.mNumVertices);
+		res.mPoints.mIndices.resize(sizes.mPoints.mNumIndices);
+		aExporter.write(res.memory());
+		return res;
+	}
+}  // anonymous namespace
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// RenderBuffers:
+
+RenderBufferSizes RenderBuffers::sizes() const
+{
+	RenderBufferSizes res;
+	res.mLines.mNumVertices = mLines.mVertices.size();
+	res.mLines.mNumIndices = mLines.mIndices.size();
+	res.mTriangles.mNumVertices = mTriangles.mVertices.size();
+	res.mTriangles.mNumIndices = mTriangles.mIndices.size();
+	res.mPoints.mNumVertices = mPoints.mVertices.size();
+	res.mPoints.mNumIndices = mPoints.mIndices.size();
+	return res;
+}
+
+
+
+
+
+RenderBufferMemory RenderBuffers::memory()
+{
+	RenderBufferMemory res;
+	res.mLines = RenderBatchMemory(mLines.mVertices.data(), mLines.mVertices.size(), mLines.mIndices.data(), mLines.mIndices.size());
+	res.mTriangles = RenderBatchMemory(mTriangles.mVertices.data(), mTriangles.mVertices.size(), mTriangles.mIndices.data(), mTriangles.mIndices.size());
+	res.mPoints = RenderBatchMemory(mPoints.mVertices.data(), mPoints.mVertices.size(), mPoints.mIndices.data(), mPoints.mIndices.size());
+	return res;
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Global functions:
+
+RenderBufferSizes renderBufferSizes(const Drawing & aDrawing, const RenderOptions & aOptions)
+{
+	Exporter exporter(drawingLayers(aDrawing), aOptions);
+	return exporter.layOut();
+}
+
+
+
+
+
+RenderBufferSizes renderBufferSizes(const std::vector<LodLayerObjects> & aObjects, const RenderOptions & aOptions)
+{
+	Exporter exporter(queryLayers(aObjects), aOptions);
+	return exporter.layOut();
+}
+
+
+
+
+
+void writeRenderBuffers(const Drawing & aDrawing, const RenderOptions & aOptions, const RenderBufferMemory & aDest)
+{
+	Exporter exporter(drawingLayers(aDrawing), aOptions);
+	writeBuffers(exporter, aDest);
+}
+
+
+
+
+
+void writeRenderBuffers(const std::vector<LodLayerObjects> & aObjects, const RenderOptions & aOptions, const RenderBufferMemory & aDest)
+{
+	Exporter exporter(queryLayers(aObjects), aOptions);
+	writeBuffers(exporter, aDest);
+}
+
+
+
+
+
+RenderBuffers exportRenderBuffers(const Drawing & aDrawing, const RenderOptions & aOptions)
+{
+	Exporter exporter(drawingLayers(aDrawing), aOptions);
+	return exportBuffers(exporter);
+}
+
+
+
+
+
+RenderBuffers exportRenderBuffers(const std::vector<LodLayerObjects> & aObjects, const RenderOptions & aOptions)
+{
+	Exporter exporter(queryLayers(aObjects), aOptions);
+	return exportBuffers(exporter);
+}
+
+
+
+
+
+}  // namespace Dxf
@@ -0,0 +1,230 @@
+#pragma once
+
+#include "BlockFlattener.hpp"
+#include "LevelOfDetail.hpp"
+#include "Tessellation.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** A single vertex of the render buffers, laid out as most GPU APIs expect: three floats and a packed color. */
+class RenderVertex
+{
+public:
+
+	/** The position, relative to RenderOptions::mOrigin. */
+	float mX, mY, mZ;
+
+	/** The resolved color as 0xAABBGGRR, the gColors value with full opacity;
+	on little-endian machines it reads as R, G, B, A bytes. */
+	uint32_t mColor;
+};
+
+static_assert(sizeof(RenderVertex) == 16, "RenderVertex must be tightly packed");
+
+
+
+
+
+/** Options for exporting the render buffers. */
+class RenderOptions
+{
+public:
+
+	/** The tessellation of the curves into line segments.
+	Its mNumThreads is ignored, the layers are processed in parallel instead, as specified by mNumThreads. */
+	TessellationOptions mTessellation;
+
+	/** Subtracted from all the coords before converting them to floats, so that drawings far from the origin keep
+	their precision. Typically the center of the drawing's extent. */
+	Coords mOrigin;
+
+	/** The gColors index used for the colors that don't resolve to a valid index,
+	such as COLOR_BYLAYER on a layer without a color. Must itself be a valid index. */
+	Color mFallbackColor;
+
+	/** The number of threads processing the layers.
+	1 processes everything on the calling thread, 0 uses as many threads as there are hardware threads. */
+	unsigned mNumThreads;
+
+	/** The flattener providing the geometry of the Block objects, so that its cache can be reused between exports.
+	If nullptr, a temporary one is used for each export. */
+	BlockFlattener * mBlockFlattener;
+
+
+	/** Creates the default options: default tessellation, origin at zero, black fallback color (the same as the layers
+	without a color are displayed), all the hardware threads, a temporary block flattener. */
+	RenderOptions():
+		mOrigin(0, 0),
+		mFallbackColor(0),
+		mNumThreads(0),
+		mBlockFlattener(nullptr)
+	{
+	}
+};
+
+
+
+
+
+/** The number of the items in the buffers of a single primitive kind. */
+class RenderBatchSize
+{
+public:
+
+	/** The number of the vertices. */
+	size_t mNumVertices;
+
+	/** The number of the indices. */
+	size_t mNumIndices;
+
+
+	RenderBatchSize():
+		mNumVertices(0),
+		mNumIndices(0)
+	{
+	}
+};
+
+
+
+
+
+/** The number of the items in all the render buffers. */
+class RenderBufferSizes
+{
+public:
+	RenderBatchSize mLines;
+	RenderBatchSize mTriangles;
+	RenderBatchSize mPoints;
+};
+
+
+
+
+
+/** Caller-provided memory for the buffers of a single primitive kind, such as a mapped GPU buffer.
+Each capacity must be at least the number of items reported by renderBufferSizes(), it is checked before anything
+is written; the pointer may be nullptr if there are no such items. */
+class RenderBatchMemory
+{
+public:
+	RenderVertex * mVertices;
+
+	/** The number of the vertices that fit into mVertices. */
+	size_t mVertexCapacity;
+
+	uint32_t * mIndices;
+
+	/** The number of the indices that fit into mIndices. */
+	size_t mIndexCapacity;
+
+
+	RenderBatchMemory(
+		RenderVertex * aVertices = nullptr, size_t aVertexCapacity = 0,
+		uint32_t * aIndices = nullptr, size_t aIndexCapacity = 0
+	):
+		mVertices(aVertices),
+		mVertexCapacity(aVertexCapacity),
+		mIndices(aIndices),
+		mIndexCapacity(aIndexCapacity)
+	{
+	}
+};
+
+
+
+
+
+/** Caller-provided memory for all the render buffers. */
+class RenderBufferMemory
+{
+public:
+	RenderBatchMemory mLines;
+	RenderBatchMemory mTriangles;
+	RenderBatchMemory mPoints;
+};
+
+
+
+
+
+/** The vertices and indices of a single primitive kind.
+The indices refer to mVertices; the lines use two indices per segment, the triangles three per triangle,
+the points one per point. */
+class RenderBatch
+{
+public:
+	std::vector<RenderVertex> mVertices;
+	std::vector<uint32_t> mIndices;
+};
+
+
+
+
+
+/** The render buffers of a drawing, or a part of it, owning their memory. */
+class RenderBuffers
+{
+public:
+
+	/** The tessellated Lines, Arcs, Circles, AxisAligned2DEllipses, polylines and Polygons. */
+	RenderBatch mLines;
+
+	/** The Solids. */
+	RenderBatch mTriangles;
+
+	/** The Points. */
+	RenderBatch mPoints;
+
+
+	/** Returns the sizes of the buffers. */
+	RenderBufferSizes sizes() const;
+
+	/** Returns the memory of the buffers, for writeRenderBuffers(). */
+	RenderBufferMemory memory();
+};
+
+
+
+
+
+/** Returns the number of the items that writeRenderBuffers() writes for the specified drawing.
+The objects are processed the same way as in writeRenderBuffers(). */
+RenderBufferSizes renderBufferSizes(const Drawing & aDrawing, const RenderOptions & aOptions);
+
+/** Returns the number of the items that writeRenderBuffers() writes for the specified LodPyramid query result. */
+RenderBufferSizes renderBufferSizes(const std::vector<LodLayerObjects> & aObjects, const RenderOptions & aOptions);
+
+/** Writes the render buffers of all the layers of the drawing into the caller-provided memory,
+whose capacities must be at least renderBufferSizes() items.
+The layers are processed in parallel, each one writing its part of the buffers in place, in the layers' order.
+The colors are resolved through COLOR_BYBLOCK (the Block's color), COLOR_BYLAYER (the layer's default color) and gColors.
+The Blocks are expanded into their flattened objects; Texts and mesh polylines are skipped.
+Throws a std::length_error if a buffer has more vertices than the 32-bit indices can address,
+and a std::invalid_argument if a non-empty buffer has no memory or too small a capacity, or if the fallback color is invalid. */
+void writeRenderBuffers(const Drawing & aDrawing, const RenderOptions & aOptions, const RenderBufferMemory & aDest);
+
+/** Writes the render buffers of the specified LodPyramid query result into the caller-provided memory,
+the same way as for a whole drawing. */
+void writeRenderBuffers(const std::vector<LodLayerObjects> & aObjects, const RenderOptions & aOptions, const RenderBufferMemory & aDest);
+
+/** Returns the render buffers of all the layers of the drawing, written as in writeRenderBuffers(). */
+RenderBuffers exportRenderBuffers(const Drawing & aDrawing, const RenderOptions & aOptions);
+
+/** Returns the render buffers of the specified LodPyramid query result, written as in writeRenderBuffers(). */
+RenderBuffers exportRenderBuffers(const std::vector<LodLayerObjects> & aObjects, const RenderOptions & aOptions);
+
+
+
+
+
+}  // namespace Dxf
@@ -0,0 +1,490 @@
+// Simplification.cpp
+
+// Implements the polyline simplification (Douglas–Peucker and Visvalingam–Whyatt)
+
+#include "Simplification.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <queue>
+#include "ParallelFor.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+namespace
+{
+	/** Returns the dot product of the two vectors. */
+	Coord dot(const Coords & aV1, const Coords & aV2)
+	{
+		return aV1.mX * aV2.mX + aV1.mY * aV2.mY + aV1.mZ * aV2.mZ;
+	}
+
+
+
+
+
+	/** Returns the squared distance of the point from the line segment between aStart and aEnd. */
+	Coord segmentDistanceSquared(const Coords & aPt, const Coords & aStart, const Coords & aEnd)
+	{
+		auto seg = aEnd - aStart;
+		auto rel = aPt - aStart;
+		auto segLengthSquared = dot(seg, seg);
+		if (segLengthSquared > 0)
+		{
+			auto t = std::clamp(dot(rel, seg) / segLengthSquared, 0.0, 1.0);
+			rel = rel - Coords(seg.mX * t, seg.mY * t, seg.mZ * t);
+		}
+		return dot(rel, rel);
+	}
+
+
+
+
+
+	/** Returns the area of the triangle. */
+	Coord triangleArea(const Coords & aPt1, const Coords & aPt2, const Coords & aPt3)
+	{
+		auto v1 = aPt2 - aPt1;
+		auto v2 = aPt3 - aPt1;
+		auto cx = v1.mY * v2.mZ - v1.mZ * v2.mY;
+		auto cy = v1.mZ * v2.mX - v1.mX * v2.mZ;
+		auto cz = v1.mX * v2.mY - v1.mY * v2.mX;
+		return std::sqrt(cx * cx + cy * cy + cz * cz) / 2;
+	}
+
+
+
+
+
+	/** Marks the vertices that must be kept regardless of the algorithm: the first and last ones,
+	and the endpoints of all the bulged segments. */
+	void markAnchors(const std::vector<Vertex> & aVertices, bool aIsClosed, std::vector<char> & aKeep)
+	{
+		auto count = aVertices.size();
+		aKeep.assign(count, 0);
+		aKeep[0] = 1;
+		if (!aIsClosed)
+		{
+			aKeep[count - 1] = 1;
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (aVertices[i].mBulge != 0)
+			{
+				aKeep[i] = 1;
+				if ((i + 1 < count) || aIsClosed)
+				{
+					aKeep[(i + 1) % count] = 1;
+				}
+			}
+		}
+	}
+
+
+
+
+
+	/** Marks the vertices kept by Douglas–Peucker, between each pair of consecutive anchors.
+	For closed polylines, the path continues from the last vertex back to the first one. */
+	void douglasPeucker(const std::vector<Vertex> & aVertices, bool aIsClosed, Coord aTolerance, std::vector<char> & aKeep)
+	{
+		auto count = aVertices.size();
+		auto pathLength = aIsClosed ? count + 1 : count;  // Index count is the first vertex again
+		auto pos = [&](size_t aIndex) -> const Coords & { return aVertices[aIndex % count].mPos; };
+		auto toleranceSquared = aTolerance * aTolerance;
+
+		// Processed iteratively, deep recursion would overflow the stack on long polylines:
+		std::vector<std::pair<size_t, size_t>> ranges;
+		size_t anchor = 0;
+		for (size_t i = 1; i < pathLength; ++i)
+		{
+			if (!aKeep[i % count])
+			{
+				continue;
+			}
+			ranges.emplace_back(anchor, i);
+			anchor = i;
+			while (!ranges.empty())
+			{
+				auto [first, last] = ranges.back();
+				ranges.pop_back();
+				Coord maxDistSquared = -1;
+				size_t maxIdx = first;
+				for (size_t idx = first + 1; idx < last; ++idx)
+				{
+					auto distSquared = segmentDistanceSquared(pos(idx), pos(first), pos(last));
+					if (distSquared > maxDistSquared)
+					{
+						maxDistSquared = distSquared;
+						maxIdx = idx;
+					}
+				}
+				if (maxDistSquared > toleranceSquared)
+				{
+					aKeep[maxIdx] = 1;
+					ranges.emplace_back(first, maxIdx);
+					ranges.emplace_back(maxIdx, last);
+				}
+			}
+		}
+	}
+
+
+
+
+
+	/** Marks the vertices kept by Visvalingam–Whyatt.
+	Only the non-anchor vertices are removed, the anchors' keep flags are already set.
+	The effective areas never decrease while removing, so that the removal order follows the significance. */
+	void visvalingamWhyatt(const std::vector<Vertex> & aVertices, bool aIsClosed, Coord aTolerance, std::vector<char> & aKeep)
+	{
+		auto count = aVertices.size();
+		static const size_t NONE = static_cast<size_t>(-1);
+		std::vector<size_t> prev(count), next(count);
+		for (size_t i = 0; i < count; ++i)
+		{
+			prev[i] = (i > 0) ? i - 1 : (aIsClosed ? count - 1 : NONE);
+			next[i] = (i + 1 < count) ? i + 1 : (aIsClosed ? 0 : NONE);
+		}
+
+		// The min-heap of the removable vertices' areas; entries whose area doesn't match areas[] are stale:
+		std::vector<Coord> areas(count, 0);
+		using Entry = std::pair<Coord, size_t>;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> heap;
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!aKeep[i])
+			{
+				areas[i] = triangleArea(aVertices[prev[i]].mPos, aVertices[i].mPos, aVertices[next[i]].mPos);
+				heap.emplace(areas[i], i);
+			}
+		}
+
+		auto threshold = aTolerance * aTolerance;
+		size_t numLeft = count;
+		size_t minNumLeft = aIsClosed ? 3 : 2;
+		std::vector<char> isRemoved(count, 0);
+		while (!heap.empty() && (numLeft > minNumLeft))
+		{
+			auto [area, idx] = heap.top();
+			if (area >= threshold)
+			{
+				break;
+			}
+			heap.pop();
+			if (isRemoved[idx] || (area != areas[idx]))
+			{
+				continue;
+			}
+			isRemoved[idx] = 1;
+			numLeft -= 1;
+			auto p = prev[idx];
+			auto n = next[idx];
+			next[p] = n;
+			prev[n] = p;
+			for (auto neighbor: {p, n})
+			{
+				if (aKeep[neighbor])
+				{
+					continue;
+				}
+				auto neighborArea = triangleArea(
+					aVertices[prev[neighbor]].mPos, aVertices[neighbor].mPos, aVertices[next[neighbor]].mPos
+				);
+				areas[neighbor] = std::max(neighborArea, area);
+				heap.emplace(areas[neighbor], neighbor);
+			}
+		}
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (!aKeep[i] && !isRemoved[i])
+			{
+				aKeep[i] = 1;
+			}
+		}
+	}
+
+
+
+
+
+	/** Marks the most significant removed vertices as kept, until at least aMinNumKept vertices are kept.
+	Each time, the vertex farthest from the segment between the first two kept vertices
+	(or from the single kept vertex) is kept, so that a thin closed sliver keeps its width. */
+	void keepAtLeast(const std::vector<Vertex> & aVertices, size_t aMinNumKept, std::vector<char> & aKeep)
+	{
+		auto count = aVertices.size();
+		auto numKept = static_cast<size_t>(std::count(aKeep.begin(), aKeep.end(), 1));
+		while ((numKept < aMinNumKept) && (numKept < count))
+		{
+			size_t first = count, second = count;
+			for (size_t i = 0; (i < count) && (second == count); ++i)
+			{
+				if (aKeep[i])
+				{
+					((first == count) ? first : second) = i;
+				}
+			}
+			if (first == count)
+			{
+				aKeep[0] = 1;
+				numKept += 1;
+				continue;
+			}
+			const auto & start = aVertices[first].mPos;
+			const auto & end = aVertices[(second == count) ? first : second].mPos;
+			Coord maxDistSquared = -1;
+			size_t maxIdx = count;
+			for (size_t i = 0; i < count; ++i)
+			{
+				if (aKeep[i])
+				{
+					continue;
+				}
+				auto distSquared = segmentDistanceSquared(aVertices[i].mPos, start, end);
+				if (distSquared > maxDistSquared)
+				{
+					maxDistSquared = distSquared;
+					maxIdx = i;
+				}
+			}
+			aKeep[maxIdx] = 1;
+			numKept += 1;
+		}
+	}
+
+
+
+
+
+	/** Returns the keep flags for the polyline's vertices, as specified by the options.
+	Returns an empty vector if there's nothing to remove. */
+	std::vector<char> verticesToKeep(const MultiVertex & aPolyline, const SimplifyOptions & aOptions)
+	{
+		std::vector<char> keep;
+		const auto & vertices = aPolyline.mVertices;
+		if ((vertices.size() < 3) || !aPolyline.isSimplePath() || (aOptions.mTolerance <= 0))
+		{
+			return keep;
+		}
+		auto isClosed = aPolyline.isClosed();
+		markAnchors(vertices, isClosed, keep);
+		switch (aOptions.mAlgorithm)
+		{
+			case saDouglasPeucker:    douglasPeucker(vertices, isClosed, aOptions.mTolerance, keep); break;
+			case saVisvalingamWhyatt: visvalingamWhyatt(vertices, isClosed, aOptions.mTolerance, keep); break;
+		}
+		if (isClosed)
+		{
+			keepAtLeast(vertices, 3, keep);
+		}
+		auto numKept = static_cast<size_t>(std::count(keep.begin(), keep.end(), 1));
+		if (numKept == vertices.size())
+		{
+			keep.clear();
+		}
+		return keep;
+	}
+
+
+
+
+
+	/** Removes the vertices not marked in aKeep, keeping the order. Returns the number of the removed vertices. */
+	size_t removeVertices(std::vector<Vertex> & aVertices, const std::vector<char> & aKeep)
+	{
+		size_t numKept = 0;
+		for (size_t idx = 0, count = aVertices.size(); idx < count; ++idx)
+		{
+			if (!aKeep[idx])
+			{
+				continue;
+			}
+			if (numKept != idx)
+			{
+				aVertices[numKept] = std::move(aVertices[idx]);
+			}
+			numKept += 1;
+		}
+		auto res = aVertices.size() - numKept;
+		aVertices.erase(aVertices.begin() + static_cast<std::ptrdiff_t>(numKept), aVertices.end());
+		return res;
+	}
+
+
+
+
+
+	/** Returns true if the object is one of the MultiVertex descendants. */
+	bool isMultiVertex(const Primitive & aObject)
+	{
+		switch (aObject.mObjectType)
+		{
+			case otPolyline:
+			case otLWPolyline:
+			case otPolygon:
+			{
+				return true;
+			}
+			default:
+			{
+				return false;
+			}
+		}
+	}
+
+
+
+
+
+	/** Simplifies the specified polylines in place, in parallel. Returns the total number of the removed vertices. */
+	size_t simplifyAll(const std::vector<MultiVertex *> & aPolylines, const SimplifyOptions & aOptions)
+	{
+		std::atomic<size_t> res(0);
+		parallelFor(aPolylines.size(), aOptions.mNumThreads, [&](size_t aIndex)
+			{
+				res += simplifyPolyline(*aPolylines[aIndex], aOptions);
+			}
+		);
+		return res;
+	}
+
+
+
+
+
+	/** Adds all the polylines from aObjects to aDest. */
+	void collectPolylines(const PrimitivePtrs & aObjects, std::vector<MultiVertex *> & aDest)
+	{
+		for (const auto & obj: aObjects)
+		{
+			if (isMultiVertex(*obj))
+			{
+				aDest.push_back(static_cast<MultiVertex *>(obj.get()));
+			}
+		}
+	}
+}  // anonymous namespace
+
+
+
+
+
+size_t simplifyPolyline(MultiVertex & aPolyline, const SimplifyOptions & aOptions)
+{
+	auto keep = verticesToKeep(aPolyline, aOptions);
+	if (keep.empty())
+	{
+		return 0;
+	}
+	return removeVertices(aPolyline.mVertices, keep);
+}
+
+
+
+
+
+std::shared_ptr<MultiVertex> simplifiedPolyline(const MultiVertex & aPolyline, const SimplifyOptions & aOptions)
+{
+	auto res = std::static_pointer_cast<MultiVertex>(clonePrimitive(aPolyline));
+	auto keep = verticesToKeep(aPolyline, aOptions);
+	if (!keep.empty())
+	{
+		removeVertices(res->mVertices, keep);
+	}
+	return res;
+}
+
+
+
+
+
+PrimitivePtrs simplifiedObjects(
+	const PrimitivePtrs & aObjects,
+	const SimplifyOptions & aOptions,
+	size_t * aNumRemovedVertices
+)
+{
+	PrimitivePtrs res(aObjects);
+	std::vector<size_t> polylineIndices;
+	for (size_t i = 0, count = aObjects.size(); i < count; ++i)
+	{
+		if (isMultiVertex(*aObjects[i]))
+		{
+			polylineIndices.push_back(i);
+		}
+	}
+	std::atomic<size_t> numRemoved(0);
+	parallelFor(polylineIndices.size(), aOptions.mNumThreads, [&](size_t aIndex)
+		{
+			auto idx = polylineIndices[aIndex];
+			const auto & polyline = static_cast<const MultiVertex &>(*aObjects[idx]);
+			auto keep = verticesToKeep(polyline, aOptions);
+			if (keep.empty())
+			{
+				return;
+			}
+			auto copy = std::static_pointer_cast<MultiVertex>(clonePrimitive(polyline));
+			numRemoved += removeVertices(copy->mVertices, keep);
+			res[idx] = std::move(copy);
+		}
+	);
+	if (aNumRemovedVertices != nullptr)
+	{
+		*aNumRemovedVertices = numRemoved;
+	}
+	return res;
+}
+
+
+
+
+
+size_t simplifyLayer(Layer & aLayer, const SimplifyOptions & aOptions)
+{
+	std::vector<MultiVertex *> polylines;
+	aLayer.compact();
+	collectPolylines(aLayer.objects(), polylines);
+	auto res = simplifyAll(polylines, aOptions);
+	aLayer.updateExtent();
+	return res;
+}
+
+
+
+
+
+size_t simplifyDrawing(Drawing & aDrawing, const SimplifyOptions & aOptions)
+{
+	std::vector<MultiVertex *> polylines;
+	aDrawing.compact();
+	for (const auto & lay: aDrawing.layers())
+	{
+		collectPolylines(lay->objects(), polylines);
+	}
+	for (const auto & bd: aDrawing.mBlockDefinitions)
+	{
+		collectPolylines(bd.second->mObjects, polylines);
+	}
+	auto res = simplifyAll(polylines, aOptions);
+	for (const auto & lay: aDrawing.layers())
+	{
+		lay->updateExtent();
+	}
+	return res;
+}
+
+
+
+
+
+}  // namespace Dxf
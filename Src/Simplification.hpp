@@ -0,0 +1,97 @@
+#pragma once
+
+#include "DxfDrawing.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** The algorithms available for the polyline simplification. */
+enum SimplificationAlgorithm
+{
+	/** Douglas–Peucker: keeps the vertices farther than the tolerance from the simplified path.
+	Guarantees the maximum deviation, tends to keep spikes. */
+	saDouglasPeucker,
+
+	/** Visvalingam–Whyatt: repeatedly removes the vertex with the smallest effective area (the triangle it forms
+	with its neighbors). Produces smoother shapes, preferable for the natural features such as contours. */
+	saVisvalingamWhyatt,
+};
+
+
+
+
+
+/** Options for the polyline simplification functions. */
+class SimplifyOptions
+{
+public:
+
+	/** For saDouglasPeucker, the maximum distance of the removed vertices from the simplified path.
+	For saVisvalingamWhyatt, the vertices with effective area below mTolerance squared are removed. */
+	Coord mTolerance;
+
+	/** The algorithm to use. */
+	SimplificationAlgorithm mAlgorithm;
+
+	/** The number of threads used for simplifying multiple polylines.
+	1 processes everything on the calling thread, 0 uses as many threads as there are hardware threads. */
+	unsigned mNumThreads;
+
+
+	/** Creates the options with the specified tolerance and algorithm, single-threaded. */
+	explicit SimplifyOptions(Coord aTolerance = 0, SimplificationAlgorithm aAlgorithm = saDouglasPeucker, unsigned aNumThreads = 1):
+		mTolerance(aTolerance),
+		mAlgorithm(aAlgorithm),
+		mNumThreads(aNumThreads)
+	{
+	}
+};
+
+
+
+
+
+/** Simplifies the polyline in place. Returns the number of the removed vertices.
+The first and last vertices, and the endpoints of the bulged (arc) segments, are always kept, so the arcs keep their shape.
+Closed polylines keep at least 3 vertices.
+Mesh and curve- / spline-fit Polylines are not modified, their vertices are not a simple path. */
+size_t simplifyPolyline(MultiVertex & aPolyline, const SimplifyOptions & aOptions);
+
+/** Returns a simplified copy of the polyline; the original is not modified.
+The copy is of the same type as the original (Polyline, LWPolyline or Polygon). */
+std::shared_ptr<MultiVertex> simplifiedPolyline(const MultiVertex & aPolyline, const SimplifyOptions & aOptions);
+
+/** Returns a copy of the object list, with the polylines replaced by their simplified copies.
+The objects that don't change (non-polylines and the polylines with nothing to remove) are shared with the original list,
+so the result is cheap to make, but the shared objects must not be modified through either list.
+The polylines are processed in parallel, as specified by the options.
+If aNumRemovedVertices is given, it receives the total number of the vertices removed. */
+PrimitivePtrs simplifiedObjects(
+	const PrimitivePtrs & aObjects,
+	const SimplifyOptions & aOptions,
+	size_t * aNumRemovedVertices = nullptr
+);
+
+/** Simplifies all the polylines in the layer in place, in parallel as specified by the options, and updates the
+layer's extent. The layer is compacted first. Returns the total number of the removed vertices. */
+size_t simplifyLayer(Layer & aLayer, const SimplifyOptions & aOptions);
+
+/** Simplifies all the polylines in the drawing in place, both in the layers and in the block definitions, in parallel
+as specified by the options. The layers are compacted first and their extents are updated.
+Any BlockFlattener caches of the drawing's block definitions need to be cleared afterwards.
+Returns the total number of the removed vertices. */
+size_t simplifyDrawing(Drawing & aDrawing, const SimplifyOptions & aOptions);
+
+
+
+
+
+}  // namespace Dxf
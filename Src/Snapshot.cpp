@@ -0,0 +1,1463 @@
+// Snapshot.cpp
+
+// Implements writing and reading the binary snapshots of Drawing objects
+
+#include "Snapshot.hpp"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <fmt/format.h>
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+
+
+
+
+namespace Dxf::Snapshot
+{
+
+
+
+
+
+namespace
+{
+	/** The magic bytes at the start of each snapshot. */
+	static const char MAGIC[8] = {'D', 'X', 'F', 'S', 'N', 'A', 'P', 0};
+
+	/** The value stored in the header to detect snapshots written on a machine with a different byte order. */
+	static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+	/** All the columns are aligned to this many bytes, relative to the snapshot start. */
+	static const size_t COLUMN_ALIGNMENT = 8;
+
+
+
+
+
+	/** The fixed-size header at the start of the snapshot. */
+	struct Header
+	{
+		char mMagic[8];
+		uint32_t mVersion;
+		uint32_t mByteOrderMark;
+		uint64_t mSourceHash;
+		uint64_t mTotalSize;
+		uint64_t mNumStrings;
+		uint64_t mStringDataSize;
+		uint64_t mNumLayers;
+		uint64_t mNumBlockDefinitions;
+		uint64_t mNumEntities;
+		uint64_t mNumVertices;
+		uint64_t mNumAttribs;
+		uint64_t mNumExtras;
+		uint64_t mNumXDataGroups;
+		uint64_t mXDataValuesSize;
+		uint64_t mNumRawSections;
+		uint64_t mNumRawEntityPositions;
+		uint64_t mNumRawGroups;
+		uint64_t mRawValuesSize;
+		uint64_t mNumRawEntityGroups;
+		uint64_t mColumnOffsets[colCount];
+	};
+
+	/** A single element of the colLayers column. */
+	struct LayerRecord
+	{
+		uint32_t mName;
+		int32_t mColor;
+		uint32_t mFirstEntity;
+		uint32_t mNumEntities;
+	};
+
+	/** A single element of the colBlockDefinitions column. */
+	struct BlockDefinitionRecord
+	{
+		/** The key under which the definition is registered in the Drawing, NO_INDEX if not registered. */
+		uint32_t mKey;
+
+		/** The mName of the definition. */
+		uint32_t mName;
+
+		uint32_t mFirstEntity;
+		uint32_t mNumEntities;
+	};
+
+	/** A single element of the colEntityPos and colVertexPos columns. */
+	struct CoordsRecord
+	{
+		double mX;
+		double mY;
+		double mZ;
+	};
+
+	/** A single element of the colAttribs column. */
+	struct AttribRecord
+	{
+		uint32_t mName;
+		uint32_t mValue;
+		double mFontSize;
+	};
+
+	/** A single element of the colRawSections column.
+	The raw groups of the sections follow the raw entities' groups (the first mNumRawEntityGroups) in the raw columns. */
+	struct RawSectionRecord
+	{
+		uint64_t mFirstGroup;
+		uint64_t mNumGroups;
+		uint32_t mName;
+		uint32_t mPadding;
+	};
+
+	/** A single element of the colRawEntityPositions column, see Drawing::RawEntityPosition. */
+	struct RawEntityPositionRecord
+	{
+		uint64_t mFirstGroup;
+
+		/** The snapshot index of the preceding entity, NO_INDEX if the raw entity preceded all the parsed ones. */
+		uint32_t mPrecedingEntity;
+
+		uint32_t mPadding;
+	};
+
+	static_assert(sizeof(Header) % COLUMN_ALIGNMENT == 0);
+	static_assert(sizeof(LayerRecord) == 16);
+	static_assert(sizeof(BlockDefinitionRecord) == 16);
+	static_assert(sizeof(CoordsRecord) == 24);
+	static_assert(sizeof(AttribRecord) == 16);
+	static_assert(sizeof(RawSectionRecord) == 24);
+	static_assert(sizeof(RawEntityPositionRecord) == 16);
+
+
+
+
+
+	/** Returns the size of a single element in the specified column. */
+	size_t columnElementSize(Column aColumn)
+	{
+		switch (aColumn)
+		{
+			case colStringOffsets:      return sizeof(uint64_t);
+			case colStringData:         return 1;
+			case colLayers:             return sizeof(LayerRecord);
+			case colBlockDefinitions:   return sizeof(BlockDefinitionRecord);
+			case colEntityTypes:        return sizeof(uint8_t);
+			case colEntityColors:       return sizeof(int32_t);
+			case colEntityWidths:       return sizeof(double);
+			case colEntityPos:          return sizeof(CoordsRecord);
+			case colEntityInts:         return sizeof(int32_t);
+			case colEntityRefs:         return sizeof(uint32_t);
+			case colEntityHandles:      return sizeof(uint64_t);
+			case colEntityOwnerHandles: return sizeof(uint64_t);
+			case colEntityExtraStarts:  return sizeof(uint32_t);
+			case colEntityVertexStarts: return sizeof(uint32_t);
+			case colEntityAttribStarts: return sizeof(uint32_t);
+			case colEntityXDataStarts:  return sizeof(uint32_t);
+			case colVertexPos:          return sizeof(CoordsRecord);
+			case colVertexBulges:       return sizeof(double);
+			case colVertexColors:       return sizeof(int32_t);
+			case colVertexWidths:       return sizeof(double);
+			case colAttribs:            return sizeof(AttribRecord);
+			case colExtras:             return sizeof(double);
+			case colXDataGroupCodes:    return sizeof(int16_t);
+			case colXDataValueEnds:     return sizeof(uint64_t);
+			case colXDataValues:        return 1;
+			case colRawSections:        return sizeof(RawSectionRecord);
+			case colRawEntityPositions: return sizeof(RawEntityPositionRecord);
+			case colRawGroupCodes:      return sizeof(int16_t);
+			case colRawValueEnds:       return sizeof(uint64_t);
+			case colRawValues:          return 1;
+			case colCount:              break;
+		}
+		assert(!"Unknown column");
+		return 0;
+	}
+
+
+
+
+
+	/** Returns the number of elements in the specified column, based on the counts in the header. */
+	uint64_t columnNumElements(const Header & aHeader, Column aColumn)
+	{
+		switch (aColumn)
+		{
+			case colStringOffsets:      return aHeader.mNumStrings + 1;
+			case colStringData:         return aHeader.mStringDataSize;
+			case colLayers:             return aHeader.mNumLayers;
+			case colBlockDefinitions:   return aHeader.mNumBlockDefinitions;
+			case colEntityTypes:
+			case colEntityColors:
+			case colEntityWidths:
+			case colEntityPos:
+			case colEntityInts:
+			case colEntityRefs:
+			case colEntityHandles:
+			case colEntityOwnerHandles: return aHeader.mNumEntities;
+			case colEntityExtraStarts:
+			case colEntityVertexStarts:
+			case colEntityAttribStarts:
+			case colEntityXDataStarts:  return aHeader.mNumEntities + 1;
+			case colVertexPos:
+			case colVertexBulges:
+			case colVertexColors:
+			case colVertexWidths:       return aHeader.mNumVertices;
+			case colAttribs:            return aHeader.mNumAttribs;
+			case colExtras:             return aHeader.mNumExtras;
+			case colXDataGroupCodes:
+			case colXDataValueEnds:     return aHeader.mNumXDataGroups;
+			case colXDataValues:        return aHeader.mXDataValuesSize;
+			case colRawSections:        return aHeader.mNumRawSections;
+			case colRawEntityPositions: return aHeader.mNumRawEntityPositions;
+			case colRawGroupCodes:
+			case colRawValueEnds:       return aHeader.mNumRawGroups;
+			case colRawValues:          return aHeader.mRawValuesSize;
+			case colCount:              break;
+		}
+		assert(!"Unknown column");
+		return 0;
+	}
+
+
+
+
+
+	/** Returns the specified size, rounded up to the column alignment. */
+	inline uint64_t alignedSize(uint64_t aSize)
+	{
+		return (aSize + COLUMN_ALIGNMENT - 1) / COLUMN_ALIGNMENT * COLUMN_ALIGNMENT;
+	}
+
+
+
+
+
+	/** Converts the specified count into the 32-bit index used in the snapshot.
+	Throws an Error if the count doesn't fit. */
+	uint32_t toIndex(size_t aCount, const char * aWhat)
+	{
+		if (aCount >= NO_INDEX)
+		{
+			throw Error(fmt::format("Too many {} for a snapshot: {}", aWhat, aCount));
+		}
+		return static_cast<uint32_t>(aCount);
+	}
+
+
+
+
+
+	/** Collects the snapshot data from a Drawing into the individual columns, then writes them out. */
+	class Builder
+	{
+	public:
+
+		Builder():
+			mStringOffsets({0}),
+			mEntityExtraStarts({0}),
+			mEntityVertexStarts({0}),
+			mEntityAttribStarts({0}),
+			mEntityXDataStarts({0}),
+			mNumRawEntityGroups(0)
+		{
+		}
+
+
+
+		/** Adds the entire drawing to the columns. */
+		void addDrawing(const Drawing & aDrawing)
+		{
+			// Registered block definitions get the first indices, in the Drawing's order:
+			for (const auto & bd: aDrawing.mBlockDefinitions)
+			{
+				auto idx = blockDefinitionIndex(bd.second.get());
+				mBlockDefinitions[idx].mKey = addString(bd.first);
+			}
+
+			// The entities preceding the raw entities, their snapshot indices are assigned while adding the layers:
+			for (const auto & pos: aDrawing.mRawEntityPositions)
+			{
+				if (pos.mPrecedingEntity != nullptr)
+				{
+					mPrecedingEntityIndices[pos.mPrecedingEntity.get()] = NO_INDEX;
+				}
+			}
+
+			// Layers:
+			for (const auto & layer: aDrawing.layers())
+			{
+				LayerRecord rec;
+				rec.mName = addString(layer->name());
+				rec.mColor = layer->defaultColor();
+				rec.mFirstEntity = toIndex(mEntityTypes.size(), "entities");
+				layer->forEachObject([this](const PrimitivePtr & aObject)
+				{
+					if (!mPrecedingEntityIndices.empty())
+					{
+						auto itr = mPrecedingEntityIndices.find(aObject.get());
+						if ((itr != mPrecedingEntityIndices.end()) && (itr->second == NO_INDEX))
+						{
+							itr->second = toIndex(mEntityTypes.size(), "entities");
+						}
+					}
+					addEntity(*aObject);
+				});
+				rec.mNumEntities = toIndex(mEntityTypes.size() - rec.mFirstEntity, "entities");
+				mLayers.push_back(rec);
+			}
+
+			// Block definitions' contents, including those referenced only from Blocks (the list may grow while processing):
+			for (size_t i = 0; i < mBlockDefinitionPtrs.size(); ++i)
+			{
+				auto & objects = mBlockDefinitionPtrs[i]->mObjects;
+				auto first = toIndex(mEntityTypes.size(), "entities");
+				for (const auto & obj: objects)
+				{
+					addEntity(*obj);
+				}
+				mBlockDefinitions[i].mFirstEntity = first;
+				mBlockDefinitions[i].mNumEntities = toIndex(mEntityTypes.size() - first, "entities");
+			}
+
+			addRawData(aDrawing);
+		}
+
+
+
+		/** Writes the header and all the columns into the data sink. */
+		void write(uint64_t aSourceHash, Writer::DataSink & aDataSink)
+		{
+			Header header;
+			std::memset(&header, 0, sizeof(header));
+			std::memcpy(header.mMagic, MAGIC, sizeof(MAGIC));
+			header.mVersion = FORMAT_VERSION;
+			header.mByteOrderMark = BYTE_ORDER_MARK;
+			header.mSourceHash = aSourceHash;
+			header.mNumStrings = mStringOffsets.size() - 1;
+			header.mStringDataSize = mStringData.size();
+			header.mNumLayers = mLayers.size();
+			header.mNumBlockDefinitions = mBlockDefinitions.size();
+			header.mNumEntities = mEntityTypes.size();
+			header.mNumVertices = mVertexPos.size();
+			header.mNumAttribs = mAttribs.size();
+			header.mNumExtras = mExtras.size();
+			header.mNumXDataGroups = mXDataGroupCodes.size();
+			header.mXDataValuesSize = mXDataValues.size();
+			header.mNumRawSections = mRawSections.size();
+			header.mNumRawEntityPositions = mRawEntityPositions.size();
+			header.mNumRawGroups = mRawGroupCodes.size();
+			header.mRawValuesSize = mRawValues.size();
+			header.mNumRawEntityGroups = mNumRawEntityGroups;
+
+			// Assign the column offsets:
+			const std::pair<const void *, size_t> columns[colCount] =
+			{
+				columnData(mStringOffsets),
+				{mStringData.data(), mStringData.size()},
+				columnData(mLayers),
+				columnData(mBlockDefinitions),
+				columnData(mEntityTypes),
+				columnData(mEntityColors),
+				columnData(mEntityWidths),
+				columnData(mEntityPos),
+				columnData(mEntityInts),
+				columnData(mEntityRefs),
+				columnData(mEntityHandles),
+				columnData(mEntityOwnerHandles),
+				columnData(mEntityExtraStarts),
+				columnData(mEntityVertexStarts),
+				columnData(mEntityAttribStarts),
+				columnData(mEntityXDataStarts),
+				columnData(mVertexPos),
+				columnData(mVertexBulges),
+				columnData(mVertexColors),
+				columnData(mVertexWidths),
+				columnData(mAttribs),
+				columnData(mExtras),
+				columnData(mXDataGroupCodes),
+				columnData(mXDataValueEnds),
+				{mXDataValues.data(), mXDataValues.size()},
+				columnData(mRawSections),
+				columnData(mRawEntityPositions),
+				columnData(mRawGroupCodes),
+				columnData(mRawValueEnds),
+				{mRawValues.data(), mRawValues.size()},
+			};
+			uint64_t offset = sizeof(Header);
+			for (int col = 0; col < colCount; ++col)
+			{
+				assert(columns[col].second == columnNumElements(header, static_cast<Column>(col)) * columnElementSize(static_cast<Column>(col)));
+				header.mColumnOffsets[col] = offset;
+				offset += alignedSize(columns[col].second);
+			}
+			header.mTotalSize = offset;
+
+			// Output everything:
+			static const char padding[COLUMN_ALIGNMENT] = {};
+			aDataSink(reinterpret_cast<const char *>(&header), sizeof(header));
+			for (const auto & col: columns)
+			{
+				if (col.second > 0)
+				{
+					aDataSink(static_cast<const char *>(col.first), col.second);
+				}
+				auto paddingSize = alignedSize(col.second) - col.second;
+				if (paddingSize > 0)
+				{
+					aDataSink(padding, paddingSize);
+				}
+			}
+		}
+
+
+	protected:
+
+		/** The string table, the offsets of each string's start in mStringData, plus the end of the last one. */
+		std::vector<uint64_t> mStringOffsets;
+		std::string mStringData;
+
+		/** Map of string -> its index in the string table, for deduplicating the strings. */
+		std::unordered_map<std::string, uint32_t> mStringIndices;
+
+		std::vector<LayerRecord> mLayers;
+		std::vector<BlockDefinitionRecord> mBlockDefinitions;
+
+		/** The block definitions, in the order of their snapshot indices. */
+		std::vector<const BlockDefinition *> mBlockDefinitionPtrs;
+
+		/** Map of block definition -> its snapshot index. */
+		std::unordered_map<const BlockDefinition *, uint32_t> mBlockDefinitionIndices;
+
+		std::vector<uint8_t> mEntityTypes;
+		std::vector<int32_t> mEntityColors;
+		std::vector<double> mEntityWidths;
+		std::vector<CoordsRecord> mEntityPos;
+		std::vector<int32_t> mEntityInts;
+		std::vector<uint32_t> mEntityRefs;
+		std::vector<uint64_t> mEntityHandles;
+		std::vector<uint64_t> mEntityOwnerHandles;
+		std::vector<uint32_t> mEntityExtraStarts;
+		std::vector<uint32_t> mEntityVertexStarts;
+		std::vector<uint32_t> mEntityAttribStarts;
+		std::vector<uint32_t> mEntityXDataStarts;
+		std::vector<CoordsRecord> mVertexPos;
+		std::vector<double> mVertexBulges;
+		std::vector<int32_t> mVertexColors;
+		std::vector<double> mVertexWidths;
+		std::vector<AttribRecord> mAttribs;
+		std::vector<double> mExtras;
+
+		/** The extended data of all the entities, as raw groups: the group codes, the end offset of each value
+		in mXDataValues (the start is the previous value's end) and all the values concatenated. */
+		std::vector<int16_t> mXDataGroupCodes;
+		std::vector<uint64_t> mXDataValueEnds;
+		std::string mXDataValues;
+
+		/** The raw data of the drawing, as raw groups (same as the extended data): the raw entities' groups first
+		(mNumRawEntityGroups of them), followed by the raw sections' groups. */
+		std::vector<RawSectionRecord> mRawSections;
+		std::vector<RawEntityPositionRecord> mRawEntityPositions;
+		std::vector<int16_t> mRawGroupCodes;
+		std::vector<uint64_t> mRawValueEnds;
+		std::string mRawValues;
+		uint64_t mNumRawEntityGroups;
+
+		/** Map of the entities preceding the raw entities -> their snapshot index, NO_INDEX if not in any layer. */
+		std::unordered_map<const Primitive *, uint32_t> mPrecedingEntityIndices;
+
+
+
+		/** Returns the pointer and the byte size of the data in the specified column vector. */
+		template <typename T>
+		static std::pair<const void *, size_t> columnData(const std::vector<T> & aColumn)
+		{
+			return {aColumn.data(), aColumn.size() * sizeof(T)};
+		}
+
+
+
+		/** Returns the index of the specified string in the string table, adding it if not present yet. */
+		uint32_t addString(const std::string & aString)
+		{
+			auto itr = mStringIndices.find(aString);
+			if (itr != mStringIndices.end())
+			{
+				return itr->second;
+			}
+			auto idx = toIndex(mStringOffsets.size() - 1, "strings");
+			mStringData.append(aString);
+			mStringOffsets.push_back(mStringData.size());
+			mStringIndices.emplace(aString, idx);
+			return idx;
+		}
+
+
+
+		/** Returns the snapshot index of the specified block definition, adding it if not present yet.
+		Returns NO_INDEX for a nullptr definition. */
+		uint32_t blockDefinitionIndex(const BlockDefinition * aBlockDefinition)
+		{
+			if (aBlockDefinition == nullptr)
+			{
+				return NO_INDEX;
+			}
+			auto itr = mBlockDefinitionIndices.find(aBlockDefinition);
+			if (itr != mBlockDefinitionIndices.end())
+			{
+				return itr->second;
+			}
+			auto idx = toIndex(mBlockDefinitionPtrs.size(), "block definitions");
+			mBlockDefinitionPtrs.push_back(aBlockDefinition);
+			mBlockDefinitions.push_back({NO_INDEX, addString(aBlockDefinition->mName), 0, 0});
+			mBlockDefinitionIndices.emplace(aBlockDefinition, idx);
+			return idx;
+		}
+
+
+
+		void addCoords(const Coords & aCoords)
+		{
+			mExtras.push_back(aCoords.mX);
+			mExtras.push_back(aCoords.mY);
+			mExtras.push_back(aCoords.mZ);
+		}
+
+
+
+		void addVertices(const MultiVertex & aMultiVertex)
+		{
+			for (const auto & v: aMultiVertex.mVertices)
+			{
+				mVertexPos.push_back({v.mPos.mX, v.mPos.mY, v.mPos.mZ});
+				mVertexBulges.push_back(v.mBulge);
+				mVertexColors.push_back(v.mColor);
+				mVertexWidths.push_back(v.mWidth);
+			}
+		}
+
+
+
+		/** Appends the raw groups in the [aBegin, aEnd) range into the raw columns. */
+		void addRawGroups(const RawGroups & aGroups, size_t aBegin, size_t aEnd)
+		{
+			for (size_t i = aBegin; i < aEnd; ++i)
+			{
+				auto value = aGroups.value(i);
+				mRawGroupCodes.push_back(static_cast<int16_t>(aGroups.groupCode(i)));
+				mRawValues.append(value.data(), value.size());
+				mRawValueEnds.push_back(mRawValues.size());
+			}
+		}
+
+
+
+		/** Adds the raw entities, their positions and the raw sections into the raw columns.
+		The raw entities whose preceding entity is not in any layer are moved before the first position,
+		where the writer treats them the same way: they are written after all the parsed entities. */
+		void addRawData(const Drawing & aDrawing)
+		{
+			const auto & raw = aDrawing.mRawEntities;
+			const auto & positions = aDrawing.mRawEntityPositions;
+			auto numGroups = raw.size();
+			auto placedBegin = std::min(positions.empty() ? numGroups : positions[0].mFirstGroup, numGroups);
+			addRawGroups(raw, 0, placedBegin);
+			std::vector<std::pair<size_t, size_t>> ranges;  // The [begin, end) group range of each position
+			ranges.reserve(positions.size());
+			for (size_t i = 0, count = positions.size(); i < count; ++i)
+			{
+				auto begin = std::max(std::min(positions[i].mFirstGroup, numGroups), placedBegin);
+				auto end = (i + 1 < count) ? std::max(std::min(positions[i + 1].mFirstGroup, numGroups), begin) : numGroups;
+				ranges.push_back({begin, end});
+				placedBegin = end;
+			}
+			auto precedingIndex = [this, &positions](size_t aPositionIndex)
+			{
+				const auto & preceding = positions[aPositionIndex].mPrecedingEntity;
+				return (preceding == nullptr) ? NO_INDEX : mPrecedingEntityIndices.at(preceding.get());
+			};
+			for (size_t i = 0, count = positions.size(); i < count; ++i)
+			{
+				if ((positions[i].mPrecedingEntity != nullptr) && (precedingIndex(i) == NO_INDEX))
+				{
+					addRawGroups(raw, ranges[i].first, ranges[i].second);
+				}
+			}
+			for (size_t i = 0, count = positions.size(); i < count; ++i)
+			{
+				auto preceding = precedingIndex(i);
+				if ((positions[i].mPrecedingEntity == nullptr) || (preceding != NO_INDEX))
+				{
+					mRawEntityPositions.push_back({mRawGroupCodes.size(), preceding, 0});
+					addRawGroups(raw, ranges[i].first, ranges[i].second);
+				}
+			}
+			mNumRawEntityGroups = mRawGroupCodes.size();
+
+			for (const auto & rs: aDrawing.mRawSections)
+			{
+				RawSectionRecord rec{mRawGroupCodes.size(), rs.second.size(), addString(rs.first), 0};
+				addRawGroups(rs.second, 0, rs.second.size());
+				mRawSections.push_back(rec);
+			}
+		}
+
+
+
+		/** Adds the specified object into the entity columns. */
+		void addEntity(const Primitive & aObject)
+		{
+			int32_t intValue = 0;
+			uint32_t ref = 0;
+			switch (aObject.mObjectType)
+			{
+				case otLine:
+				{
+					const auto & line = static_cast<const Line &>(aObject);
+					addCoords(line.mPos2);
+					intValue = line.mStyle;
+					break;
+				}
+				case otPolyline:
+				{
+					const auto & polyline = static_cast<const Polyline &>(aObject);
+					addVertices(polyline);
+					intValue = polyline.mFlags;
+					break;
+				}
+				case otLWPolyline:
+				{
+					const auto & lwPolyline = static_cast<const LWPolyline &>(aObject);
+					addVertices(lwPolyline);
+					intValue = lwPolyline.mFlags;
+					break;
+				}
+				case otPolygon:
+				{
+					addVertices(static_cast<const Polygon &>(aObject));
+					break;
+				}
+				case otSolid:
+				{
+					const auto & solid = static_cast<const Solid &>(aObject);
+					addCoords(solid.mPos2);
+					addCoords(solid.mPos3);
+					addCoords(solid.mPos4);
+					intValue = solid.mIsTetra ? 1 : 0;
+					break;
+				}
+				case otCircle:
+				{
+					mExtras.push_back(static_cast<const Circle &>(aObject).mRadius);
+					break;
+				}
+				case otSimpleEllipse:
+				{
+					const auto & ellipse = static_cast<const AxisAligned2DEllipse &>(aObject);
+					mExtras.push_back(ellipse.mDiameterX);
+					mExtras.push_back(ellipse.mDiameterY);
+					break;
+				}
+				case otArc:
+				{
+					const auto & arc = static_cast<const Arc &>(aObject);
+					mExtras.push_back(arc.mRadius);
+					mExtras.push_back(arc.mStartAngle);
+					mExtras.push_back(arc.mEndAngle);
+					break;
+				}
+				case otText:
+				{
+					const auto & text = static_cast<const Text &>(aObject);
+					ref = addString(text.mRawText.str());
+					intValue = text.mAlignment;
+					mExtras.push_back(text.mAngle);
+					mExtras.push_back(text.mSize);
+					mExtras.push_back(text.mOblique);
+					mExtras.push_back(text.mThickness);
+					break;
+				}
+				case otBlock:
+				{
+					const auto & block = static_cast<const Block &>(aObject);
+					ref = blockDefinitionIndex(block.mDefinition.get());
+					mExtras.push_back(block.mAngle);
+					addCoords(block.mScale);
+					break;
+				}
+				case otVertex:
+				{
+					mExtras.push_back(static_cast<const Vertex &>(aObject).mBulge);
+					break;
+				}
+				case otError:
+				case otHatch:
+				case otPoint:
+				{
+					// No type-specific data
+					break;
+				}
+			}
+
+			for (const auto & attr: aObject.mAttribs)
+			{
+				mAttribs.push_back({addString(attr.mName), addString(attr.mValue), attr.mFontSize});
+			}
+
+			if (aObject.mExtendedData != nullptr)
+			{
+				const auto & xdata = *aObject.mExtendedData;
+				for (size_t i = 0, count = xdata.size(); i < count; ++i)
+				{
+					auto value = xdata.value(i);
+					mXDataGroupCodes.push_back(static_cast<int16_t>(xdata.groupCode(i)));
+					mXDataValues.append(value.data(), value.size());
+					mXDataValueEnds.push_back(mXDataValues.size());
+				}
+			}
+
+			mEntityTypes.push_back(static_cast<uint8_t>(aObject.mObjectType));
+			mEntityColors.push_back(aObject.mColor);
+			mEntityWidths.push_back(aObject.mWidth);
+			mEntityPos.push_back({aObject.mPos.mX, aObject.mPos.mY, aObject.mPos.mZ});
+			mEntityInts.push_back(intValue);
+			mEntityRefs.push_back(ref);
+			mEntityHandles.push_back(aObject.mHandle);
+			mEntityOwnerHandles.push_back(aObject.mOwnerHandle);
+			mEntityExtraStarts.push_back(toIndex(mExtras.size(), "values"));
+			mEntityVertexStarts.push_back(toIndex(mVertexPos.size(), "vertices"));
+			mEntityAttribStarts.push_back(toIndex(mAttribs.size(), "attribs"));
+			mEntityXDataStarts.push_back(toIndex(mXDataGroupCodes.size(), "extended data groups"));
+		}
+	};
+}  // anonymous namespace
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// View:
+
+View::View(const char * aData, size_t aSize):
+	mData(aData),
+	mSize(aSize)
+{
+	if (aSize < sizeof(Header))
+	{
+		throw Error("Snapshot data is too short");
+	}
+	Header header;
+	std::memcpy(&header, aData, sizeof(header));
+	if (std::memcmp(header.mMagic, MAGIC, sizeof(MAGIC)) != 0)
+	{
+		throw Error("Not a snapshot data");
+	}
+	if (header.mVersion != FORMAT_VERSION)
+	{
+		throw Error(fmt::format("Unsupported snapshot version: {}", header.mVersion));
+	}
+	if (header.mByteOrderMark != BYTE_ORDER_MARK)
+	{
+		throw Error("The snapshot was written with a different byte order");
+	}
+	if (header.mTotalSize != aSize)
+	{
+		throw Error(fmt::format("Snapshot data size mismatch, expected {} bytes, got {}", header.mTotalSize, aSize));
+	}
+	for (int col = 0; col < colCount; ++col)
+	{
+		auto offset = header.mColumnOffsets[col];
+		auto numElements = columnNumElements(header, static_cast<Column>(col));
+		auto elementSize = columnElementSize(static_cast<Column>(col));
+		if (
+			(offset < sizeof(Header)) ||
+			(offset > aSize) ||
+			(numElements > (aSize - offset) / elementSize)
+		)
+		{
+			throw Error(fmt::format("Snapshot column {} is out of the data bounds", col));
+		}
+		mColumnOffsets[col] = offset;
+	}
+	mSourceHash = header.mSourceHash;
+	mNumStrings = header.mNumStrings;
+	mStringDataSize = header.mStringDataSize;
+	mNumLayers = header.mNumLayers;
+	mNumBlockDefinitions = header.mNumBlockDefinitions;
+	mNumEntities = header.mNumEntities;
+	mNumVertices = header.mNumVertices;
+	mNumAttribs = header.mNumAttribs;
+	mNumExtras = header.mNumExtras;
+	mNumXDataGroups = header.mNumXDataGroups;
+	mXDataValuesSize = header.mXDataValuesSize;
+	mNumRawSections = header.mNumRawSections;
+	mNumRawEntityPositions = header.mNumRawEntityPositions;
+	mNumRawGroups = header.mNumRawGroups;
+	mRawValuesSize = header.mRawValuesSize;
+	mNumRawEntityGroups = header.mNumRawEntityGroups;
+	if (mNumRawEntityGroups > mNumRawGroups)
+	{
+		throw Error("Snapshot has an invalid number of raw entity groups");
+	}
+}
+
+
+
+
+
+std::string_view View::layerName(size_t aLayerIndex) const
+{
+	if (aLayerIndex >= mNumLayers)
+	{
+		throw Error(fmt::format("Layer index out of range: {}", aLayerIndex));
+	}
+	return string(read<LayerRecord>(colLayers, aLayerIndex).mName);
+}
+
+
+
+
+
+Color View::layerColor(size_t aLayerIndex) const
+{
+	if (aLayerIndex >= mNumLayers)
+	{
+		throw Error(fmt::format("Layer index out of range: {}", aLayerIndex));
+	}
+	return read<LayerRecord>(colLayers, aLayerIndex).mColor;
+}
+
+
+
+
+
+EntityRange View::layerEntities(size_t aLayerIndex) const
+{
+	if (aLayerIndex >= mNumLayers)
+	{
+		throw Error(fmt::format("Layer index out of range: {}", aLayerIndex));
+	}
+	auto rec = read<LayerRecord>(colLayers, aLayerIndex);
+	if (static_cast<uint64_t>(rec.mFirstEntity) + rec.mNumEntities > mNumEntities)
+	{
+		throw Error(fmt::format("Layer {} has an invalid entity range", aLayerIndex));
+	}
+	return {rec.mFirstEntity, rec.mNumEntities};
+}
+
+
+
+
+
+std::string_view View::blockDefinitionName(size_t aBlockDefinitionIndex) const
+{
+	if (aBlockDefinitionIndex >= mNumBlockDefinitions)
+	{
+		throw Error(fmt::format("Block definition index out of range: {}", aBlockDefinitionIndex));
+	}
+	return string(read<BlockDefinitionRecord>(colBlockDefinitions, aBlockDefinitionIndex).mName);
+}
+
+
+
+
+
+EntityRange View::blockDefinitionEntities(size_t aBlockDefinitionIndex) const
+{
+	if (aBlockDefinitionIndex >= mNumBlockDefinitions)
+	{
+		throw Error(fmt::format("Block definition index out of range: {}", aBlockDefinitionIndex));
+	}
+	auto rec = read<BlockDefinitionRecord>(colBlockDefinitions, aBlockDefinitionIndex);
+	if (static_cast<uint64_t>(rec.mFirstEntity) + rec.mNumEntities > mNumEntities)
+	{
+		throw Error(fmt::format("Block definition {} has an invalid entity range", aBlockDefinitionIndex));
+	}
+	return {rec.mFirstEntity, rec.mNumEntities};
+}
+
+
+
+
+
+uint32_t View::blockDefinitionIndex(size_t aEntityIndex) const
+{
+	if (entityType(aEntityIndex) != otBlock)
+	{
+		return NO_INDEX;
+	}
+	auto idx = read<uint32_t>(colEntityRefs, aEntityIndex);
+	if ((idx != NO_INDEX) && (idx >= mNumBlockDefinitions))
+	{
+		throw Error(fmt::format("Entity {} references an invalid block definition", aEntityIndex));
+	}
+	return idx;
+}
+
+
+
+
+
+ObjectType View::entityType(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	auto type = read<uint8_t>(colEntityTypes, aEntityIndex);
+	if (type > otPoint)
+	{
+		throw Error(fmt::format("Entity {} has an invalid type", aEntityIndex));
+	}
+	return static_cast<ObjectType>(type);
+}
+
+
+
+
+
+Color View::entityColor(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	return read<int32_t>(colEntityColors, aEntityIndex);
+}
+
+
+
+
+
+Coord View::entityWidth(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	return read<double>(colEntityWidths, aEntityIndex);
+}
+
+
+
+
+
+Coords View::entityPos(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	auto rec = read<CoordsRecord>(colEntityPos, aEntityIndex);
+	return {rec.mX, rec.mY, rec.mZ};
+}
+
+
+
+
+
+uint64_t View::entityHandle(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	return read<uint64_t>(colEntityHandles, aEntityIndex);
+}
+
+
+
+
+
+uint64_t View::entityOwnerHandle(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	return read<uint64_t>(colEntityOwnerHandles, aEntityIndex);
+}
+
+
+
+
+
+EntityRange View::entityVertices(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	return startsRange(colEntityVertexStarts, aEntityIndex, mNumVertices);
+}
+
+
+
+
+
+Coords View::vertexPos(size_t aVertexIndex) const
+{
+	if (aVertexIndex >= mNumVertices)
+	{
+		throw Error(fmt::format("Vertex index out of range: {}", aVertexIndex));
+	}
+	auto rec = read<CoordsRecord>(colVertexPos, aVertexIndex);
+	return {rec.mX, rec.mY, rec.mZ};
+}
+
+
+
+
+
+EntityRange View::entityExtendedData(size_t aEntityIndex) const
+{
+	checkEntityIndex(aEntityIndex);
+	return startsRange(colEntityXDataStarts, aEntityIndex, mNumXDataGroups);
+}
+
+
+
+
+
+int View::xDataGroupCode(size_t aGroupIndex) const
+{
+	if (aGroupIndex >= mNumXDataGroups)
+	{
+		throw Error(fmt::format("Extended data group index out of range: {}", aGroupIndex));
+	}
+	return read<int16_t>(colXDataGroupCodes, aGroupIndex);
+}
+
+
+
+
+
+std::string_view View::xDataValue(size_t aGroupIndex) const
+{
+	if (aGroupIndex >= mNumXDataGroups)
+	{
+		throw Error(fmt::format("Extended data group index out of range: {}", aGroupIndex));
+	}
+	auto start = (aGroupIndex == 0) ? 0 : read<uint64_t>(colXDataValueEnds, aGroupIndex - 1);
+	auto end = read<uint64_t>(colXDataValueEnds, aGroupIndex);
+	if ((start > end) || (end > mXDataValuesSize))
+	{
+		throw Error(fmt::format("Extended data group {} has an invalid range", aGroupIndex));
+	}
+	return {mData + mColumnOffsets[colXDataValues] + start, static_cast<size_t>(end - start)};
+}
+
+
+
+
+
+std::shared_ptr<Drawing> View::toDrawing() const
+{
+	auto res = std::make_shared<Drawing>();
+
+	// Create all the block definitions first, so that Blocks can reference them (even recursively):
+	BlockDefinitions blockDefinitions;
+	blockDefinitions.reserve(mNumBlockDefinitions);
+	for (size_t i = 0; i < mNumBlockDefinitions; ++i)
+	{
+		blockDefinitions.push_back(std::make_shared<BlockDefinition>(std::string(blockDefinitionName(i))));
+	}
+	for (size_t i = 0; i < mNumBlockDefinitions; ++i)
+	{
+		auto range = blockDefinitionEntities(i);
+		auto & objects = blockDefinitions[i]->mObjects;
+		objects.reserve(range.mCount);
+		for (size_t e = range.mFirst; e < range.mFirst + range.mCount; ++e)
+		{
+			objects.push_back(createPrimitive(e, blockDefinitions, res->stringPool()));
+		}
+		auto key = read<BlockDefinitionRecord>(colBlockDefinitions, i).mKey;
+		if (key != NO_INDEX)
+		{
+			res->addBlockDefinition(std::string(string(key)), blockDefinitions[i]);
+		}
+	}
+
+	// Layers:
+	PrimitivePtrs entityObjects(mNumRawEntityPositions > 0 ? mNumEntities : 0);
+	for (size_t i = 0; i < mNumLayers; ++i)
+	{
+		auto layer = res->addLayer(std::string(layerName(i)));
+		layer->setDefaultColor(layerColor(i));
+		auto range = layerEntities(i);
+		for (size_t e = range.mFirst; e < range.mFirst + range.mCount; ++e)
+		{
+			auto obj = createPrimitive(e, blockDefinitions, res->stringPool());
+			if (!entityObjects.empty())
+			{
+				entityObjects[e] = obj;
+			}
+			layer->addObject(std::move(obj));
+		}
+	}
+
+	restoreRawData(*res, entityObjects);
+	return res;
+}
+
+
+
+
+
+template <typename T>
+T View::read(Column aColumn, size_t aIndex) const
+{
+	// The data may not be suitably aligned (arbitrary memory given to the constructor), use memcpy:
+	T res;
+	std::memcpy(&res, mData + mColumnOffsets[aColumn] + aIndex * sizeof(T), sizeof(T));
+	return res;
+}
+
+
+
+
+
+std::string_view View::string(uint32_t aStringIndex) const
+{
+	if (aStringIndex >= mNumStrings)
+	{
+		throw Error(fmt::format("String index out of range: {}", aStringIndex));
+	}
+	auto start = read<uint64_t>(colStringOffsets, aStringIndex);
+	auto end = read<uint64_t>(colStringOffsets, aStringIndex + 1);
+	if ((start > end) || (end > mStringDataSize))
+	{
+		throw Error(fmt::format("String {} has an invalid range", aStringIndex));
+	}
+	return {mData + mColumnOffsets[colStringData] + start, static_cast<size_t>(end - start)};
+}
+
+
+
+
+
+EntityRange View::startsRange(Column aColumn, size_t aEntityIndex, size_t aMaxValue) const
+{
+	auto start = read<uint32_t>(aColumn, aEntityIndex);
+	auto end = read<uint32_t>(aColumn, aEntityIndex + 1);
+	if ((start > end) || (end > aMaxValue))
+	{
+		throw Error(fmt::format("Entity {} has an invalid range in column {}", aEntityIndex, static_cast<int>(aColumn)));
+	}
+	return {start, end - start};
+}
+
+
+
+
+
+RawGroups View::rawGroups(uint64_t aFirstGroup, uint64_t aNumGroups) const
+{
+	if ((aFirstGroup > mNumRawGroups) || (aNumGroups > mNumRawGroups - aFirstGroup))
+	{
+		throw Error(fmt::format("Raw group range out of range: {} + {}", aFirstGroup, aNumGroups));
+	}
+	RawGroups res;
+	auto start = (aFirstGroup == 0) ? 0 : read<uint64_t>(colRawValueEnds, aFirstGroup - 1);
+	for (auto i = aFirstGroup; i < aFirstGroup + aNumGroups; ++i)
+	{
+		auto end = read<uint64_t>(colRawValueEnds, i);
+		if ((start > end) || (end > mRawValuesSize))
+		{
+			throw Error(fmt::format("Raw group {} has an invalid range", i));
+		}
+		auto value = std::string_view(mData + mColumnOffsets[colRawValues] + start, static_cast<size_t>(end - start));
+		res.add(read<int16_t>(colRawGroupCodes, i), value);
+		start = end;
+	}
+	return res;
+}
+
+
+
+
+
+void View::restoreRawData(Drawing & aDrawing, const PrimitivePtrs & aLayerEntities) const
+{
+	aDrawing.mRawEntities = rawGroups(0, mNumRawEntityGroups);
+	aDrawing.mRawEntityPositions.reserve(mNumRawEntityPositions);
+	for (size_t i = 0; i < mNumRawEntityPositions; ++i)
+	{
+		auto rec = read<RawEntityPositionRecord>(colRawEntityPositions, i);
+		if (
+			(rec.mFirstGroup > mNumRawEntityGroups) ||
+			((rec.mPrecedingEntity != NO_INDEX) && (
+				(rec.mPrecedingEntity >= aLayerEntities.size()) ||
+				(aLayerEntities[rec.mPrecedingEntity] == nullptr)
+			))
+		)
+		{
+			throw Error(fmt::format("Raw entity position {} is invalid", i));
+		}
+		auto preceding = (rec.mPrecedingEntity == NO_INDEX) ? nullptr : aLayerEntities[rec.mPrecedingEntity];
+		aDrawing.mRawEntityPositions.push_back({static_cast<size_t>(rec.mFirstGroup), std::move(preceding)});
+	}
+	for (size_t i = 0; i < mNumRawSections; ++i)
+	{
+		auto rec = read<RawSectionRecord>(colRawSections, i);
+		aDrawing.mRawSections[std::string(string(rec.mName))] = rawGroups(rec.mFirstGroup, rec.mNumGroups);
+	}
+}
+
+
+
+
+
+void View::checkEntityIndex(size_t aEntityIndex) const
+{
+	if (aEntityIndex >= mNumEntities)
+	{
+		throw Error(fmt::format("Entity index out of range: {}", aEntityIndex));
+	}
+}
+
+
+
+
+
+PrimitivePtr View::createPrimitive(size_t aEntityIndex, const BlockDefinitions & aBlockDefinitions, StringPool & aStringPool) const
+{
+	auto type = entityType(aEntityIndex);
+	auto intValue = read<int32_t>(colEntityInts, aEntityIndex);
+	auto extras = startsRange(colEntityExtraStarts, aEntityIndex, mNumExtras);
+	auto extra = [&](size_t aIndex)
+	{
+		if (aIndex >= extras.mCount)
+		{
+			throw Error(fmt::format("Entity {} has too few values", aEntityIndex));
+		}
+		return read<double>(colExtras, extras.mFirst + aIndex);
+	};
+	auto extraCoords = [&](size_t aIndex)
+	{
+		return Coords(extra(aIndex), extra(aIndex + 1), extra(aIndex + 2));
+	};
+	auto readVertices = [&](MultiVertex & aMultiVertex)
+	{
+		auto vertices = startsRange(colEntityVertexStarts, aEntityIndex, mNumVertices);
+		aMultiVertex.mVertices.reserve(vertices.mCount);
+		for (size_t i = vertices.mFirst; i < vertices.mFirst + vertices.mCount; ++i)
+		{
+			Vertex v(vertexPos(i));
+			v.mBulge = read<double>(colVertexBulges, i);
+			v.mColor = read<int32_t>(colVertexColors, i);
+			v.mWidth = read<double>(colVertexWidths, i);
+			aMultiVertex.mVertices.push_back(std::move(v));
+		}
+	};
+
+	PrimitivePtr res;
+	switch (type)
+	{
+		case otLine:
+		{
+			auto line = std::make_shared<Line>();
+			line->mPos2 = extraCoords(0);
+			line->mStyle = intValue;
+			res = std::move(line);
+			break;
+		}
+		case otPolyline:
+		{
+			auto polyline = std::make_shared<Polyline>();
+			readVertices(*polyline);
+			polyline->mFlags = intValue;
+			res = std::move(polyline);
+			break;
+		}
+		case otLWPolyline:
+		{
+			auto lwPolyline = std::make_shared<LWPolyline>();
+			readVertices(*lwPolyline);
+			lwPolyline->mFlags = intValue;
+			res = std::move(lwPolyline);
+			break;
+		}
+		case otPolygon:
+		{
+			auto polygon = std::make_shared<Polygon>();
+			readVertices(*polygon);
+			res = std::move(polygon);
+			break;
+		}
+		case otSolid:
+		{
+			if (intValue != 0)
+			{
+				res = std::make_shared<Solid>(Coords(0, 0), extraCoords(0), extraCoords(3), extraCoords(6));
+			}
+			else
+			{
+				auto solid = std::make_shared<Solid>(Coords(0, 0), extraCoords(0), extraCoords(3));
+				solid->mPos4 = extraCoords(6);
+				res = std::move(solid);
+			}
+			break;
+		}
+		case otCircle:
+		{
+			auto circle = std::make_shared<Circle>();
+			circle->mRadius = extra(0);
+			res = std::move(circle);
+			break;
+		}
+		case otSimpleEllipse:
+		{
+			res = std::make_shared<AxisAligned2DEllipse>(Coords(0, 0), extra(0), extra(1));
+			break;
+		}
+		case otArc:
+		{
+			auto arc = std::make_shared<Arc>();
+			arc->mRadius = extra(0);
+			arc->mStartAngle = extra(1);
+			arc->mEndAngle = extra(2);
+			res = std::move(arc);
+			break;
+		}
+		case otText:
+		{
+			auto text = std::make_shared<Text>();
+			text->mRawText = aStringPool.intern(string(read<uint32_t>(colEntityRefs, aEntityIndex)));
+			text->mAlignment = intValue;
+			text->mAngle = extra(0);
+			text->mSize = extra(1);
+			text->mOblique = extra(2);
+			text->mThickness = extra(3);
+			res = std::move(text);
+			break;
+		}
+		case otBlock:
+		{
+			auto defIdx = blockDefinitionIndex(aEntityIndex);
+			auto def = (defIdx == NO_INDEX) ? nullptr : aBlockDefinitions[defIdx];
+			auto block = std::make_shared<Block>(Coords(0, 0), std::move(def), extra(0), 1);
+			block->mScale = extraCoords(1);
+			res = std::move(block);
+			break;
+		}
+		case otVertex:
+		{
+			auto vertex = std::make_shared<Vertex>();
+			vertex->mBulge = extra(0);
+			res = std::move(vertex);
+			break;
+		}
+		case otPoint:
+		{
+			res = std::make_shared<Point>();
+			break;
+		}
+		case otError:
+		case otHatch:
+		{
+			// No specific class for these, only the base data is stored
+			res = std::make_shared<Primitive>(type);
+			break;
+		}
+	}
+
+	// Common data:
+	res->mPos = entityPos(aEntityIndex);
+	res->mColor = read<int32_t>(colEntityColors, aEntityIndex);
+	res->mWidth = read<double>(colEntityWidths, aEntityIndex);
+	res->mHandle = read<uint64_t>(colEntityHandles, aEntityIndex);
+	res->mOwnerHandle = read<uint64_t>(colEntityOwnerHandles, aEntityIndex);
+	auto attribs = startsRange(colEntityAttribStarts, aEntityIndex, mNumAttribs);
+	res->mAttribs.reserve(attribs.mCount);
+	for (size_t i = attribs.mFirst; i < attribs.mFirst + attribs.mCount; ++i)
+	{
+		auto rec = read<AttribRecord>(colAttribs, i);
+		res->mAttribs.emplace_back(std::string(string(rec.mName)), std::string(string(rec.mValue)), Coord(rec.mFontSize));
+	}
+	auto xdata = entityExtendedData(aEntityIndex);
+	if (xdata.mCount > 0)
+	{
+		res->mExtendedData = std::make_unique<RawGroups>();
+		for (size_t i = xdata.mFirst; i < xdata.mFirst + xdata.mCount; ++i)
+		{
+			res->mExtendedData->add(xDataGroupCode(i), xDataValue(i));
+		}
+	}
+	return res;
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Globals:
+
+void write(const Drawing & aDrawing, uint64_t aSourceHash, Writer::DataSink && aDataSink)
+{
+	Builder builder;
+	builder.addDrawing(aDrawing);
+	builder.write(aSourceHash, aDataSink);
+}
+
+
+
+
+
+View openFile(const std::string & aFileName)
+{
+	#ifdef _WIN32
+		auto file = CreateFileA(aFileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw Error(fmt::format("Cannot open snapshot file {}", aFileName));
+		}
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0))
+		{
+			CloseHandle(file);
+			throw Error(fmt::format("Cannot read snapshot file {}", aFileName));
+		}
+		auto mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		CloseHandle(file);
+		if (mapping == nullptr)
+		{
+			throw Error(fmt::format("Cannot map snapshot file {}", aFileName));
+		}
+		auto data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+		CloseHandle(mapping);
+		if (data == nullptr)
+		{
+			throw Error(fmt::format("Cannot map snapshot file {}", aFileName));
+		}
+		auto size = static_cast<size_t>(fileSize.QuadPart);
+		std::shared_ptr<const void> storage(data, [](const void * aData)
+		{
+			UnmapViewOfFile(aData);
+		});
+	#else
+		auto fd = open(aFileName.c_str(), O_RDONLY);
+		if (fd < 0)
+		{
+			throw Error(fmt::format("Cannot open snapshot file {}", aFileName));
+		}
+		struct stat st;
+		if ((fstat(fd, &st) != 0) || (st.st_size <= 0))
+		{
+			close(fd);
+			throw Error(fmt::format("Cannot read snapshot file {}", aFileName));
+		}
+		auto size = static_cast<size_t>(st.st_size);
+		auto data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (data == MAP_FAILED)
+		{
+			throw Error(fmt::format("Cannot map snapshot file {}", aFileName));
+		}
+		std::shared_ptr<const void> storage(data, [size](const void * aData)
+		{
+			munmap(const_cast<void *>(aData), size);
+		});
+	#endif
+
+	View res(static_cast<const char *>(storage.get()), size);
+	res.mStorage = std::move(storage);
+	return res;
+}
+
+
+
+
+
+}  // namespace Dxf::Snapshot
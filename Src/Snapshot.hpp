@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include "DxfDrawing.hpp"
+#include "DataSink.hpp"
+
+
+
+
+
+namespace Dxf::Snapshot
+{
+
+
+
+
+
+/** Exception thrown when the snapshot data is damaged, or is of an unsupported version or byte order. */
+using Error = std::runtime_error;
+
+/** The version of the snapshot format written by write() and accepted by View.
+Incremented on each incompatible change of the format. */
+static const uint32_t FORMAT_VERSION = 4;
+
+/** The index value used in the snapshot for "no object", such as a Block without a definition. */
+static const uint32_t NO_INDEX = 0xffffffff;
+
+
+
+
+
+/** A contiguous range of entities within a snapshot, belonging to a single layer or block definition. */
+class EntityRange
+{
+public:
+	size_t mFirst;
+	size_t mCount;
+};
+
+
+
+
+
+/** The columns stored in the snapshot.
+The header stores the offset of each column, in this order. */
+enum Column
+{
+	colStringOffsets,
+	colStringData,
+	colLayers,
+	colBlockDefinitions,
+	colEntityTypes,
+	colEntityColors,
+	colEntityWidths,
+	colEntityPos,
+	colEntityInts,
+	colEntityRefs,
+	colEntityHandles,
+	colEntityOwnerHandles,
+	colEntityExtraStarts,
+	colEntityVertexStarts,
+	colEntityAttribStarts,
+	colEntityXDataStarts,
+	colVertexPos,
+	colVertexBulges,
+	colVertexColors,
+	colVertexWidths,
+	colAttribs,
+	colExtras,
+	colXDataGroupCodes,
+	colXDataValueEnds,
+	colXDataValues,
+	colRawSections,
+	colRawEntityPositions,
+	colRawGroupCodes,
+	colRawValueEnds,
+	colRawValues,
+
+	colCount,
+};
+
+
+
+
+
+/** Writes the snapshot of the specified drawing into the data sink.
+aSourceHash is stored in the snapshot and is meant to identify the source data from which the drawing was parsed
+(see ContentHasher), so that stale snapshots can be detected by View::sourceHash().
+The snapshot contains the layers, block definitions and all the entities, stored column-wise, with all the strings
+deduplicated into a single string table, and with indices instead of pointers, so that it can be used without
+deserialization, directly from a memory-mapped file.
+Vertices store only their coords, bulge, color and width; Attribs and extended data of vertices are not stored.
+The entities' extended data (Primitive::mExtendedData) is stored as a single buffer of raw groups, with a range per entity.
+The raw data preserved by the parser (Drawing::mRawEntities, with their positions, and mRawSections) is stored
+as another buffer of raw groups, so that a drawing restored from the snapshot is written back the same way.
+The raw entities that follow an entity no longer in any layer are stored as not having a position.
+The data is stored in the native byte order. */
+void write(const Drawing & aDrawing, uint64_t aSourceHash, Writer::DataSink && aDataSink);
+
+
+
+
+
+/** Read-only access to the snapshot data, without deserializing it.
+Opening a snapshot only validates the header, all the accessors read directly from the underlying data,
+so opening a memory-mapped snapshot is O(1) and only the pages actually accessed are ever read from the disk.
+The accessors throw an Error if they encounter damaged data or are given an out-of-range index. */
+class View
+{
+public:
+
+	/** Creates a view of the snapshot data in the specified memory.
+	The memory must stay valid for the lifetime of the View (and all its copies).
+	Throws an Error if the header is not valid. */
+	View(const char * aData, size_t aSize);
+
+	/** Returns the hash of the source data, as given to write(). */
+	uint64_t sourceHash() const { return mSourceHash; }
+
+	/** Returns the total size of the snapshot data, in bytes. */
+	size_t dataSize() const { return mSize; }
+
+	size_t numLayers() const { return mNumLayers; }
+	std::string_view layerName(size_t aLayerIndex) const;
+	Color layerColor(size_t aLayerIndex) const;
+	EntityRange layerEntities(size_t aLayerIndex) const;
+
+	size_t numBlockDefinitions() const { return mNumBlockDefinitions; }
+	std::string_view blockDefinitionName(size_t aBlockDefinitionIndex) const;
+	EntityRange blockDefinitionEntities(size_t aBlockDefinitionIndex) const;
+
+	/** Returns the index of the BlockDefinition used by the specified Block entity.
+	Returns NO_INDEX if the entity is not a Block, or if the Block has no definition. */
+	uint32_t blockDefinitionIndex(size_t aEntityIndex) const;
+
+	size_t numEntities() const { return mNumEntities; }
+	ObjectType entityType(size_t aEntityIndex) const;
+	Color entityColor(size_t aEntityIndex) const;
+	Coord entityWidth(size_t aEntityIndex) const;
+	Coords entityPos(size_t aEntityIndex) const;
+
+	/** Returns the handle (Primitive::mHandle) of the specified entity, 0 if it has none. */
+	uint64_t entityHandle(size_t aEntityIndex) const;
+
+	/** Returns the owner handle (Primitive::mOwnerHandle) of the specified entity, 0 if not known. */
+	uint64_t entityOwnerHandle(size_t aEntityIndex) const;
+
+	/** Returns the range of the vertices of the specified entity, in the vertex columns.
+	Only MultiVertex entities have vertices. */
+	EntityRange entityVertices(size_t aEntityIndex) const;
+
+	/** Returns the coords of the vertex at the specified index (within the entire snapshot, see entityVertices()). */
+	Coords vertexPos(size_t aVertexIndex) const;
+
+	/** Returns the range of the extended data groups of the specified entity, in the XDATA columns.
+	Empty if the entity has no extended data. */
+	EntityRange entityExtendedData(size_t aEntityIndex) const;
+
+	/** Returns the group code of the extended data group at the specified index (see entityExtendedData()). */
+	int xDataGroupCode(size_t aGroupIndex) const;
+
+	/** Returns the value of the extended data group at the specified index (see entityExtendedData()),
+	in its text DXF representation. */
+	std::string_view xDataValue(size_t aGroupIndex) const;
+
+	/** Creates a new Drawing that has the same contents as the one from which the snapshot was written. */
+	std::shared_ptr<Drawing> toDrawing() const;
+
+
+protected:
+
+	friend View openFile(const std::string & aFileName);
+
+	/** The owner of the underlying data, if any (such as the memory mapping).
+	Keeps the data alive for as long as any copy of the View exists. */
+	std::shared_ptr<const void> mStorage;
+
+	/** The snapshot data. */
+	const char * mData;
+
+	/** The size of mData, in bytes. */
+	size_t mSize;
+
+	uint64_t mSourceHash;
+	size_t mNumStrings;
+	size_t mStringDataSize;
+	size_t mNumLayers;
+	size_t mNumBlockDefinitions;
+	size_t mNumEntities;
+	size_t mNumVertices;
+	size_t mNumAttribs;
+	size_t mNumExtras;
+	size_t mNumXDataGroups;
+	size_t mXDataValuesSize;
+	size_t mNumRawSections;
+	size_t mNumRawEntityPositions;
+	size_t mNumRawGroups;
+	size_t mRawValuesSize;
+	size_t mNumRawEntityGroups;
+
+	/** The offsets of the individual columns within mData. */
+	uint64_t mColumnOffsets[colCount];
+
+
+	/** Reads a single value of the specified type from the specified column at the specified element index.
+	Doesn't check the index, the callers are expected to do so. */
+	template <typename T> T read(Column aColumn, size_t aIndex) const;
+
+	/** Returns the string stored at the specified index in the string table. */
+	std::string_view string(uint32_t aStringIndex) const;
+
+	/** Returns the range stored in the specified "starts" column for the specified entity. */
+	EntityRange startsRange(Column aColumn, size_t aEntityIndex, size_t aMaxValue) const;
+
+	/** Throws an Error if the specified entity index is out of range. */
+	void checkEntityIndex(size_t aEntityIndex) const;
+
+	/** Returns the raw groups in the specified range of the raw group columns.
+	Throws an Error if the range or the stored value offsets are invalid. */
+	RawGroups rawGroups(uint64_t aFirstGroup, uint64_t aNumGroups) const;
+
+	/** Restores the raw entities, their positions and the raw sections into the drawing.
+	aLayerEntities are the entities added to the drawing's layers, indexed by their snapshot index (nullptr for the others). */
+	void restoreRawData(Drawing & aDrawing, const PrimitivePtrs & aLayerEntities) const;
+
+	/** Creates a new primitive from the specified entity.
+	aBlockDefinitions are the already created block definitions, indexed by their snapshot index.
+	The texts are interned in aStringPool. */
+	PrimitivePtr createPrimitive(size_t aEntityIndex, const BlockDefinitions & aBlockDefinitions, StringPool & aStringPool) const;
+};
+
+
+
+
+
+/** Opens the snapshot stored in the specified file.
+The file is memory-mapped (where supported), so this is O(1) regardless of the snapshot size.
+The mapping is kept alive for as long as the returned View (or any of its copies) exists.
+Throws an Error if the file cannot be opened or its header is not valid. */
+View openFile(const std::string & aFileName);
+
+
+
+
+
+}  // namespace Dxf::Snapshot
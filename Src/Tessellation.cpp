@@ -0,0 +1,481 @@
+// Tessellation.cpp
+
+// Implements the tessellation of curves (arcs, circles, ellipses and bulged polyline segments) into line segments
+
+#include "Tessellation.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include "ParallelFor.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+namespace
+{
+	/** The number of points after which writeArcPoints() replaces the recurrence with the exact sin / cos,
+	so that the rounding errors of the recurrence cannot accumulate. */
+	static const size_t REANCHOR_INTERVAL = 64;
+
+	static const Coord FULL_TURN = 2 * PI;
+
+
+
+
+
+	/** Writes the coords into aDest, returns the pointer past them. */
+	Coord * writePoint(const Coords & aPos, Coord * aDest)
+	{
+		aDest[0] = aPos.mX;
+		aDest[1] = aPos.mY;
+		aDest[2] = aPos.mZ;
+		return aDest + 3;
+	}
+
+
+
+
+
+	/** Returns the sweep of the arc, in radians, in the range [0, 2 * pi].
+	Equal start and end angles make a zero sweep, end angle exactly a full turn after the start makes a full turn. */
+	Coord arcSweep(const Arc & aArc)
+	{
+		auto sweep = std::fmod(aArc.mEndAngle - aArc.mStartAngle, 360.0);
+		if (sweep < 0)
+		{
+			sweep += 360;
+		}
+		if ((sweep == 0) && (aArc.mEndAngle != aArc.mStartAngle))
+		{
+			sweep = 360;
+		}
+		return sweep * PI / 180;
+	}
+
+
+
+
+
+	/** The circular arc of a bulged polyline segment. */
+	class BulgeArc
+	{
+	public:
+		Coords mCenter;
+		Coord mRadius;
+		Coord mStartAngle;
+		Coord mSweep;
+
+		BulgeArc():
+			mCenter(0, 0),
+			mRadius(0),
+			mStartAngle(0),
+			mSweep(0)
+		{
+		}
+	};
+
+
+
+
+
+	/** Calculates the arc of the polyline segment from aStart to aEnd, with the bulge of aStart.
+	Returns false if the segment is straight (zero bulge or zero length). */
+	bool bulgeArc(const Vertex & aStart, const Vertex & aEnd, BulgeArc & aArc)
+	{
+		auto bulge = aStart.mBulge;
+		auto chordX = aEnd.mPos.mX - aStart.mPos.mX;
+		auto chordY = aEnd.mPos.mY - aStart.mPos.mY;
+		if ((bulge == 0) || ((chordX == 0) && (chordY == 0)))
+		{
+			return false;
+		}
+
+		// The bulge is tan(sweep / 4); the center lies on the chord's perpendicular, left of the chord for positive bulges:
+		auto offset = (1 - bulge * bulge) / (4 * bulge);
+		aArc.mCenter = Coords(
+			(aStart.mPos.mX + aEnd.mPos.mX) / 2 - chordY * offset,
+			(aStart.mPos.mY + aEnd.mPos.mY) / 2 + chordX * offset,
+			aStart.mPos.mZ
+		);
+		auto relX = aStart.mPos.mX - aArc.mCenter.mX;
+		auto relY = aStart.mPos.mY - aArc.mCenter.mY;
+		aArc.mRadius = std::sqrt(relX * relX + relY * relY);
+		aArc.mStartAngle = std::atan2(relY, relX);
+		aArc.mSweep = 4 * std::atan(bulge);
+		return true;
+	}
+
+
+
+
+
+	/** Returns true if the polyline is tessellated into a path: it has vertices and it isn't a mesh.
+	The curve- and spline-fit polylines are tessellated through their (fit) vertices. */
+	bool hasPath(const MultiVertex & aPolyline)
+	{
+		if (aPolyline.mVertices.empty())
+		{
+			return false;
+		}
+		if (aPolyline.mObjectType != otPolyline)
+		{
+			return true;
+		}
+		return ((static_cast<const Polyline &>(aPolyline).mFlags & (plf3DPolygonMesh | plfPolyfaceMesh)) == 0);
+	}
+
+
+
+
+
+	/** Returns the number of points of the polyline's path, 0 if it has none. */
+	size_t numPolylinePoints(const MultiVertex & aPolyline, const TessellationOptions & aOptions)
+	{
+		if (!hasPath(aPolyline))
+		{
+			return 0;
+		}
+		const auto & vertices = aPolyline.mVertices;
+		auto count = vertices.size();
+		auto numSegments = aPolyline.isClosed() ? count : count - 1;
+		size_t res = 1;
+		BulgeArc arc;
+		for (size_t i = 0; i < numSegments; ++i)
+		{
+			if (bulgeArc(vertices[i], vertices[(i + 1) % count], arc))
+			{
+				res += numArcSegments(arc.mRadius, arc.mSweep, aOptions);
+			}
+			else
+			{
+				res += 1;
+			}
+		}
+		return res;
+	}
+
+
+
+
+
+	/** Writes the path of the polyline, numPolylinePoints() points. */
+	Coord * writePolyline(const MultiVertex & aPolyline, const TessellationOptions & aOptions, Coord * aDest)
+	{
+		const auto & vertices = aPolyline.mVertices;
+		auto count = vertices.size();
+		auto numSegments = aPolyline.isClosed() ? count : count - 1;
+		aDest = writePoint(vertices[0].mPos, aDest);
+		BulgeArc arc;
+		for (size_t i = 0; i < numSegments; ++i)
+		{
+			const auto & end = vertices[(i + 1) % count];
+			if (bulgeArc(vertices[i], end, arc))
+			{
+				// The arc's first point overwrites the segment start already written, then both endpoints are set exactly:
+				auto start = aDest - 3;
+				aDest = writeArcPoints(
+					arc.mCenter, arc.mRadius, arc.mRadius, arc.mStartAngle, arc.mSweep,
+					numArcSegments(arc.mRadius, arc.mSweep, aOptions),
+					start
+				);
+				writePoint(vertices[i].mPos, start);
+				writePoint(end.mPos, aDest - 3);
+			}
+			else
+			{
+				aDest = writePoint(end.mPos, aDest);
+			}
+		}
+		return aDest;
+	}
+
+
+
+
+
+	/** Writes a full turn of the ellipse, with the last point an exact copy of the first one. */
+	Coord * writeFullTurn(const Coords & aCenter, Coord aRadiusX, Coord aRadiusY, const TessellationOptions & aOptions, Coord * aDest)
+	{
+		auto numSegments = numArcSegments(std::max(aRadiusX, aRadiusY), FULL_TURN, aOptions);
+		auto res = writeArcPoints(aCenter, aRadiusX, aRadiusY, 0, FULL_TURN, numSegments, aDest);
+		std::copy(aDest, aDest + 3, res - 3);
+		return res;
+	}
+}  // anonymous namespace
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// TessellatedPaths:
+
+void TessellatedPaths::clear()
+{
+	mCoords.clear();
+	mPathStarts.assign(1, 0);
+	mSourceIndices.clear();
+}
+
+
+
+
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Global functions:
+
+size_t numArcSegments(Coord aRadius, Coord aSweep, const TessellationOptions & aOptions)
+{
+	auto sweep = std::min(std::abs(aSweep), FULL_TURN);
+	auto isFullTurn = (sweep >= FULL_TURN * (1 - 1e-12));
+	size_t minSegments = isFullTurn ? 3 : 1;
+	size_t maxSegments = std::max<size_t>(aOptions.mMaxSegments, minSegments);
+	Coord numSegments = 1;
+	switch (aOptions.mMode)
+	{
+		case tmFixedSegments:
+		{
+			numSegments = std::ceil(aOptions.mNumSegments * sweep / FULL_TURN);
+			break;
+		}
+		case tmChordTolerance:
+		{
+			auto radius = std::abs(aRadius);
+			if (radius <= 0)
+			{
+				numSegments = 1;
+				break;
+			}
+			if (aOptions.mChordTolerance <= 0)
+			{
+				numSegments = static_cast<Coord>(maxSegments);
+				break;
+			}
+			// A chord spanning the angle a deviates from the arc by r * (1 - cos(a / 2)):
+			auto maxStep = 2 * std::acos(1 - std::min(aOptions.mChordTolerance / radius, 1.0));
+			numSegments = (maxStep > 0) ? std::ceil(sweep / maxStep) : static_cast<Coord>(maxSegments);
+			break;
+		}
+	}
+	if (!(numSegments < static_cast<Coord>(maxSegments)))  // Also catches NaN
+	{
+		return maxSegments;
+	}
+	return std::max(static_cast<size_t>(numSegments), minSegments);
+}
+
+
+
+
+
+Coord * writeArcPoints(
+	const Coords & aCenter,
+	Coord aRadiusX,
+	Coord aRadiusY,
+	Coord aStartAngle,
+	Coord aSweep,
+	size_t aNumSegments,
+	Coord * aDest
+)
+{
+	// Rotating the unit vector by a constant step costs two multiply-adds per coord instead of a sin / cos pair:
+	auto step = aSweep / static_cast<Coord>(aNumSegments);
+	auto cosStep = std::cos(step);
+	auto sinStep = std::sin(step);
+	Coord c = 1, s = 0;
+	for (size_t i = 0; i <= aNumSegments; ++i)
+	{
+		if ((i % REANCHOR_INTERVAL == 0) || (i == aNumSegments))
+		{
+			auto angle = (i == aNumSegments) ? (aStartAngle + aSweep) : (aStartAngle + step * static_cast<Coord>(i));
+			c = std::cos(angle);
+			s = std::sin(angle);
+		}
+		aDest[0] = aCenter.mX + aRadiusX * c;
+		aDest[1] = aCenter.mY + aRadiusY * s;
+		aDest[2] = aCenter.mZ;
+		aDest += 3;
+		auto nextC = c * cosStep - s * sinStep;
+		s = s * cosStep + c * sinStep;
+		c = nextC;
+	}
+	return aDest;
+}
+
+
+
+
+
+size_t numTessellatedPoints(const Primitive & aObject, const TessellationOptions & aOptions)
+{
+	switch (aObject.mObjectType)
+	{
+		case otLine:
+		{
+			return 2;
+		}
+		case otArc:
+		{
+			const auto & arc = static_cast<const Arc &>(aObject);
+			return numArcSegments(arc.mRadius, arcSweep(arc), aOptions) + 1;
+		}
+		case otCircle:
+		{
+			return numArcSegments(static_cast<const Circle &>(aObject).mRadius, FULL_TURN, aOptions) + 1;
+		}
+		case otSimpleEllipse:
+		{
+			const auto & ellipse = static_cast<const AxisAligned2DEllipse &>(aObject);
+			auto radius = std::max(std::abs(ellipse.mDiameterX), std::abs(ellipse.mDiameterY));
+			return numArcSegments(radius, FULL_TURN, aOptions) + 1;
+		}
+		case otPolyline:
+		case otLWPolyline:
+		case otPolygon:
+		{
+			return numPolylinePoints(static_cast<const MultiVertex &>(aObject), aOptions);
+		}
+		default:
+		{
+			return 0;
+		}
+	}
+}
+
+
+
+
+
+Coord * tessellate(const Primitive & aObject, const TessellationOptions & aOptions, Coord * aDest)
+{
+	switch (aObject.mObjectType)
+	{
+		case otLine:
+		{
+			aDest = writePoint(aObject.mPos, aDest);
+			return writePoint(static_cast<const Line &>(aObject).mPos2, aDest);
+		}
+		case otArc:
+		{
+			const auto & arc = static_cast<const Arc &>(aObject);
+			auto sweep = arcSweep(arc);
+			auto radius = std::abs(arc.mRadius);
+			return writeArcPoints(
+				arc.mPos, radius, radius, arc.mStartAngle * PI / 180, sweep,
+				numArcSegments(radius, sweep, aOptions),
+				aDest
+			);
+		}
+		case otCircle:
+		{
+			auto radius = std::abs(static_cast<const Circle &>(aObject).mRadius);
+			return writeFullTurn(aObject.mPos, radius, radius, aOptions, aDest);
+		}
+		case otSimpleEllipse:
+		{
+			const auto & ellipse = static_cast<const AxisAligned2DEllipse &>(aObject);
+			return writeFullTurn(ellipse.mPos, std::abs(ellipse.mDiameterX), std::abs(ellipse.mDiameterY), aOptions, aDest);
+		}
+		case otPolyline:
+		case otLWPolyline:
+		case otPolygon:
+		{
+			const auto & polyline = static_cast<const MultiVertex &>(aObject);
+			if (!hasPath(polyline))
+			{
+				return aDest;
+			}
+			return writePolyline(polyline, aOptions, aDest);
+		}
+		default:
+		{
+			return aDest;
+		}
+	}
+}
+
+
+
+
+
+void tessellate(const Primitive & aObject, const TessellationOptions & aOptions, uint32_t aSourceIndex, TessellatedPaths & aDest)
+{
+	auto numPoints = numTessellatedPoints(aObject, aOptions);
+	if (numPoints == 0)
+	{
+		return;
+	}
+	auto start = aDest.mCoords.size();
+	if (start / 3 + numPoints > std::numeric_limits<uint32_t>::max())
+	{
+		throw std::length_error("TessellatedPaths: Too many points");
+	}
+	aDest.mCoords.resize(start + 3 * numPoints);
+	tessellate(aObject, aOptions, aDest.mCoords.data() + start);
+	aDest.mPathStarts.push_back(static_cast<uint32_t>(aDest.mCoords.size() / 3));
+	aDest.mSourceIndices.push_back(aSourceIndex);
+}
+
+
+
+
+
+TessellatedPaths tessellateObjects(const PrimitivePtrs & aObjects, const TessellationOptions & aOptions)
+{
+	// Count the points of each object:
+	auto count = aObjects.size();
+	std::vector<size_t> numPoints(count);
+	parallelFor(count, aOptions.mNumThreads, [&](size_t aIndex)
+		{
+			numPoints[aIndex] = numTessellatedPoints(*aObjects[aIndex], aOptions);
+		}
+	);
+
+	// Lay out the output:
+	TessellatedPaths res;
+	std::vector<size_t> starts(count);
+	size_t total = 0;
+	for (size_t i = 0; i < count; ++i)
+	{
+		starts[i] = total;
+		if (numPoints[i] == 0)
+		{
+			continue;
+		}
+		total += numPoints[i];
+		if (total > std::numeric_limits<uint32_t>::max())
+		{
+			throw std::length_error("TessellatedPaths: Too many points");
+		}
+		res.mPathStarts.push_back(static_cast<uint32_t>(total));
+		res.mSourceIndices.push_back(static_cast<uint32_t>(i));
+	}
+
+	// Write each object's points in place:
+	res.mCoords.resize(3 * total);
+	auto coords = res.mCoords.data();
+	parallelFor(count, aOptions.mNumThreads, [&](size_t aIndex)
+		{
+			if (numPoints[aIndex] > 0)
+			{
+				tessellate(*aObjects[aIndex], aOptions, coords + 3 * starts[aIndex]);
+			}
+		}
+	);
+	return res;
+}
+
+
+
+
+
+}  // namespace Dxf
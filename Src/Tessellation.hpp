@@ -0,0 +1,148 @@
+#pragma once
+
+#include "DxfDrawing.hpp"
+
+
+
+
+
+namespace Dxf
+{
+
+
+
+
+
+/** The ways of determining the number of segments for the tessellated curves. */
+enum TessellationMode
+{
+	/** The number of segments is chosen so that the chords are at most TessellationOptions::mChordTolerance
+	away from the curve; large curves get more segments than the small ones. */
+	tmChordTolerance,
+
+	/** A full turn always uses TessellationOptions::mNumSegments segments, partial arcs use a proportional part. */
+	tmFixedSegments,
+};
+
+
+
+
+
+/** Options for the tessellation functions. */
+class TessellationOptions
+{
+public:
+
+	/** The way of determining the number of segments. */
+	TessellationMode mMode;
+
+	/** For tmChordTolerance, the maximum distance between a curve and its chords, in the drawing units. */
+	Coord mChordTolerance;
+
+	/** For tmFixedSegments, the number of segments for a full turn. */
+	unsigned mNumSegments;
+
+	/** The maximum number of segments for a single curve, regardless of the mode. */
+	unsigned mMaxSegments;
+
+	/** The number of threads used by tessellateObjects().
+	1 processes everything on the calling thread, 0 uses as many threads as there are hardware threads. */
+	unsigned mNumThreads;
+
+
+	/** Creates the default options: chord tolerance of 0.01, 64 segments per turn in the fixed mode,
+	at most 4096 segments per curve, single-threaded. */
+	TessellationOptions():
+		mMode(tmChordTolerance),
+		mChordTolerance(0.01),
+		mNumSegments(64),
+		mMaxSegments(4096),
+		mNumThreads(1)
+	{
+	}
+};
+
+
+
+
+
+/** The flat output of tessellating multiple objects: the points of all the paths (line strips), one after another. */
+class TessellatedPaths
+{
+public:
+
+	/** The coords of all the points, interleaved: X, Y, Z of the first point, then of the second one, etc. */
+	std::vector<Coord> mCoords;
+
+	/** The index of the first point of each path, plus one final item with the total number of the points,
+	so that path i consists of the points [mPathStarts[i], mPathStarts[i + 1]). */
+	std::vector<uint32_t> mPathStarts;
+
+	/** The index of the source object (within the tessellated object list) of each path. */
+	std::vector<uint32_t> mSourceIndices;
+
+
+	/** Creates an empty instance. */
+	TessellatedPaths():
+		mPathStarts(1, 0)
+	{
+	}
+
+	/** Returns the number of the paths. */
+	size_t numPaths() const { return mPathStarts.size() - 1; }
+
+	/** Returns the total number of the points in all the paths. */
+	size_t numPoints() const { return mCoords.size() / 3; }
+
+	/** Removes all the paths. */
+	void clear();
+};
+
+
+
+
+
+/** Returns the number of segments used for tessellating an arc of the specified radius and sweep (in radians),
+as specified by the options. Returns at least 1; full turns use at least 3 segments. */
+size_t numArcSegments(Coord aRadius, Coord aSweep, const TessellationOptions & aOptions);
+
+/** Writes the points of an axis-aligned elliptic arc, divided into aNumSegments segments, into aDest:
+aNumSegments + 1 points, 3 coords each, starting at aStartAngle and sweeping aSweep (both in radians, the sweep
+positive counter-clockwise). The points are generated by a rotation recurrence, re-anchored periodically and at the end
+with the exact sin / cos, so that the endpoints are exact.
+Returns the pointer past the last written coord. */
+Coord * writeArcPoints(
+	const Coords & aCenter,
+	Coord aRadiusX,
+	Coord aRadiusY,
+	Coord aStartAngle,
+	Coord aSweep,
+	size_t aNumSegments,
+	Coord * aDest
+);
+
+/** Returns the number of the points that tessellate() writes for the specified object.
+Lines, Arcs, Circles, AxisAligned2DEllipses and polylines (including their bulged segments) are tessellated
+into a single path each; other objects, and mesh polylines, return 0. */
+size_t numTessellatedPoints(const Primitive & aObject, const TessellationOptions & aOptions);
+
+/** Writes the tessellated path of the specified object into aDest, exactly numTessellatedPoints() points,
+3 coords each. Closed curves and closed polylines repeat their first point at the end.
+The AxisAligned2DEllipse's mDiameterX and mDiameterY are used as the semi-axes, same as in its extent().
+Returns the pointer past the last written coord. */
+Coord * tessellate(const Primitive & aObject, const TessellationOptions & aOptions, Coord * aDest);
+
+/** Appends the tessellated path of the specified object to aDest, with the specified source index.
+Objects that aren't tessellated are ignored. */
+void tessellate(const Primitive & aObject, const TessellationOptions & aOptions, uint32_t aSourceIndex, TessellatedPaths & aDest);
+
+/** Tessellates all the specified objects, in parallel as specified by the options, into a single flat output.
+The points are first counted for each object, then the output is allocated once and each object writes its part in place.
+Throws a std::length_error if the total number of the points doesn't fit the 32-bit path starts. */
+TessellatedPaths tessellateObjects(const PrimitivePtrs & aObjects, const TessellationOptions & aOptions);
+
+
+
+
+
+}  // namespace Dxf
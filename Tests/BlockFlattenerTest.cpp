@@ -0,0 +1,223 @@
+// BlockFlattenerTest.cpp
+
+// Tests the BlockFlattener class
+
+#include "BlockFlattener.hpp"
+#include <cmath>
+#include <thread>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns true if the two coords are the same, within a small tolerance. */
+static bool isClose(const Dxf::Coords & aCoords1, const Dxf::Coords & aCoords2)
+{
+	return (
+		(std::abs(aCoords1.mX - aCoords2.mX) < 1e-9) &&
+		(std::abs(aCoords1.mY - aCoords2.mY) < 1e-9) &&
+		(std::abs(aCoords1.mZ - aCoords2.mZ) < 1e-9)
+	);
+}
+
+
+
+
+
+/** Creates a simple block definition with a line and a circle. */
+static std::shared_ptr<Dxf::BlockDefinition> createSymbol()
+{
+	auto def = std::make_shared<Dxf::BlockDefinition>("SYMBOL");
+	def->mObjects.push_back(std::make_shared<Dxf::Line>(Dxf::Coords(0, 0), Dxf::Coords(1, 0)));
+	def->mObjects.push_back(std::make_shared<Dxf::Circle>(Dxf::Coords(1, 1), 0.5));
+	return def;
+}
+
+
+
+
+
+static void testTransform()
+{
+	fmt::print("Testing block transformation...\n");
+
+	Dxf::BlockFlattener flattener;
+	Dxf::Block block({10, 20}, createSymbol(), 90, 2);
+	auto flattened = flattener.flatten(block);
+	TEST_EQUAL(flattened->mObjects.size(), 2u);
+	auto line = std::static_pointer_cast<Dxf::Line>(flattened->mObjects[0]);
+	TEST_TRUE(isClose(line->mPos, {0, 0}));
+	TEST_TRUE(isClose(line->mPos2, {0, 2}));
+	auto circle = std::static_pointer_cast<Dxf::Circle>(flattened->mObjects[1]);
+	TEST_TRUE(isClose(circle->mPos, {-2, 2}));
+	TEST_EQUAL(circle->mRadius, 1);
+
+	// World objects are moved by the insertion point:
+	auto world = flattener.worldObjects(block);
+	TEST_EQUAL(world.size(), 2u);
+	TEST_TRUE(isClose(std::static_pointer_cast<Dxf::Line>(world[0])->mPos2, {10, 22}));
+	TEST_TRUE(isClose(world[1]->mPos, {8, 22}));
+
+	// The cached geometry must not be affected:
+	TEST_TRUE(isClose(line->mPos2, {0, 2}));
+}
+
+
+
+
+
+static void testNonUniform()
+{
+	fmt::print("Testing curves that cannot be transformed in-place...\n");
+
+	auto def = std::make_shared<Dxf::BlockDefinition>("CURVES");
+	def->mObjects.push_back(std::make_shared<Dxf::Circle>(Dxf::Coords(1, 1), 0.5, 3));
+	def->mObjects.push_back(std::make_shared<Dxf::Arc>(Dxf::Coords(0, 0), 1, 0, 90));
+	def->mObjects.push_back(std::make_shared<Dxf::AxisAligned2DEllipse>(Dxf::Coords(0, 0), 2, 1));
+	Dxf::BlockFlattener flattener;
+
+	// Non-uniform scale, the circle and arc become polylines on the ellipse:
+	auto flattened = flattener.flatten(def, 0, {2, 1, 1});
+	TEST_EQUAL(flattened->mObjects.size(), 3u);
+	TEST_TRUE(flattened->mObjects[0]->mObjectType == Dxf::otPolyline);
+	auto circle = std::static_pointer_cast<Dxf::Polyline>(flattened->mObjects[0]);
+	TEST_EQUAL(circle->mColor, 3);
+	TEST_EQUAL(circle->mFlags, Dxf::plfClosedPolyline);
+	TEST_TRUE(circle->mVertices.size() > 8);
+	for (const auto & v: circle->mVertices)
+	{
+		auto dx = (v.mPos.mX - 2) / 1;
+		auto dy = (v.mPos.mY - 1) / 0.5;
+		TEST_TRUE(std::abs(dx * dx + dy * dy - 1) < 1e-9);
+	}
+	TEST_TRUE(!isClose(circle->mVertices.front().mPos, circle->mVertices.back().mPos));
+	TEST_TRUE(flattened->mObjects[1]->mObjectType == Dxf::otPolyline);
+	auto arc = std::static_pointer_cast<Dxf::Polyline>(flattened->mObjects[1]);
+	TEST_EQUAL(arc->mFlags, Dxf::plfNone);
+	TEST_TRUE(isClose(arc->mVertices.front().mPos, {2, 0}));
+	TEST_TRUE(isClose(arc->mVertices.back().mPos, {0, 1}));
+	TEST_TRUE(flattened->mObjects[2]->mObjectType == Dxf::otSimpleEllipse);
+	TEST_TRUE(std::abs(flattened->mExtent.maxCoord().mX - 4) < 1e-9);
+
+	// Rotation by 45 degrees, only the ellipse becomes a polyline:
+	flattened = flattener.flatten(def, 45, {1, 1, 1});
+	TEST_TRUE(flattened->mObjects[0]->mObjectType == Dxf::otCircle);
+	TEST_TRUE(flattened->mObjects[1]->mObjectType == Dxf::otArc);
+	TEST_TRUE(flattened->mObjects[2]->mObjectType == Dxf::otPolyline);
+	auto ellipse = std::static_pointer_cast<Dxf::Polyline>(flattened->mObjects[2]);
+	TEST_TRUE(isClose(ellipse->mVertices.front().mPos, {std::sqrt(2.0), std::sqrt(2.0)}));
+
+	// Rotation by 90 degrees keeps the ellipse:
+	flattened = flattener.flatten(def, 90, {1, 1, 1});
+	TEST_TRUE(flattened->mObjects[2]->mObjectType == Dxf::otSimpleEllipse);
+}
+
+
+
+
+
+static void testNested()
+{
+	fmt::print("Testing nested blocks...\n");
+
+	auto symbol = createSymbol();
+	auto outer = std::make_shared<Dxf::BlockDefinition>("OUTER");
+	outer->mObjects.push_back(std::make_shared<Dxf::Block>(Dxf::Coords(5, 0), std::move(symbol), 0, 1));
+	outer->mObjects.push_back(std::make_shared<Dxf::Point>(Dxf::Coords(1, 1)));
+
+	Dxf::BlockFlattener flattener;
+	auto flattened = flattener.flatten(outer, 180, {1, 1, 1});
+	TEST_EQUAL(flattened->mObjects.size(), 3u);
+	for (const auto & obj: flattened->mObjects)
+	{
+		TEST_NOTEQUAL(obj->mObjectType, Dxf::otBlock);
+	}
+	auto line = std::static_pointer_cast<Dxf::Line>(flattened->mObjects[0]);
+	TEST_TRUE(isClose(line->mPos, {-5, 0}));
+	TEST_TRUE(isClose(line->mPos2, {-6, 0}));
+	TEST_TRUE(isClose(flattened->mObjects[2]->mPos, {-1, -1}));
+
+	// Both the outer and the nested geometry is cached:
+	TEST_EQUAL(flattener.cacheSize(), 2u);
+}
+
+
+
+
+
+static void testSharing()
+{
+	fmt::print("Testing flattened geometry sharing...\n");
+
+	auto symbol = createSymbol();
+	Dxf::BlockFlattener flattener;
+	std::vector<Dxf::Block> blocks;
+	for (int i = 0; i < 100; ++i)
+	{
+		auto def = symbol;
+		blocks.emplace_back(Dxf::Coords(i, i), std::move(def), 30, 2);
+	}
+
+	// Flatten from multiple threads concurrently, all must receive the same instance:
+	std::vector<Dxf::FlattenedBlockPtr> results(blocks.size());
+	std::vector<std::thread> threads;
+	for (size_t t = 0; t < 4; ++t)
+	{
+		threads.emplace_back([&, t]()
+		{
+			for (size_t i = t; i < blocks.size(); i += 4)
+			{
+				results[i] = flattener.flatten(blocks[i]);
+			}
+		});
+	}
+	for (auto & th: threads)
+	{
+		th.join();
+	}
+	for (const auto & res: results)
+	{
+		TEST_TRUE(res == results[0]);
+	}
+	TEST_EQUAL(flattener.cacheSize(), 1u);
+
+	// A different scale is a different geometry:
+	auto def = symbol;
+	Dxf::Block scaled({0, 0}, std::move(def), 30, 3);
+	TEST_TRUE(flattener.flatten(scaled) != results[0]);
+	TEST_EQUAL(flattener.cacheSize(), 2u);
+
+	flattener.invalidate(*symbol);
+	TEST_EQUAL(flattener.cacheSize(), 0u);
+}
+
+
+
+
+
+static void testRecursive()
+{
+	fmt::print("Testing recursive block definitions...\n");
+
+	auto def = std::make_shared<Dxf::BlockDefinition>("RECURSIVE");
+	auto self = def;
+	def->mObjects.push_back(std::make_shared<Dxf::Block>(Dxf::Coords(1, 1), std::move(self), 0, 1));
+	Dxf::BlockFlattener flattener;
+	TEST_THROWS(flattener.flatten(def, 0, {1, 1, 1}), Dxf::BlockFlattener::RecursiveBlockDefinition);
+
+	// Break the reference cycle so that the definition can be freed:
+	def->mObjects.clear();
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("BlockFlattenerTest",
+	testTransform();
+	testNonUniform();
+	testNested();
+	testSharing();
+	testRecursive();
+)
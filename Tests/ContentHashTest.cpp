@@ -0,0 +1,90 @@
+// ContentHashTest.cpp
+
+// Tests the ContentHasher class
+
+#include "ContentHash.hpp"
+#include "TestHelpers.h"
+
+
+
+
+
+static void testSplitting()
+{
+	fmt::print("Testing hashing data split into pieces...\n");
+
+	std::string data;
+	for (int i = 0; i < 1000; ++i)
+	{
+		data.push_back(static_cast<char>(i * 7 + i / 13));
+	}
+	auto expected = Dxf::contentHash(data.data(), data.size());
+	for (size_t pieceSize: {1, 3, 7, 8, 9, 64, 999})
+	{
+		Dxf::ContentHasher hasher;
+		for (size_t pos = 0; pos < data.size(); pos += pieceSize)
+		{
+			hasher.update(data.data() + pos, std::min(pieceSize, data.size() - pos));
+		}
+		TEST_EQUAL(hasher.digest(), expected);
+		TEST_EQUAL(hasher.totalSize(), data.size());
+	}
+}
+
+
+
+
+
+static void testDifferences()
+{
+	fmt::print("Testing hashes of different data...\n");
+
+	std::string data(100, 'a');
+	auto hash = Dxf::contentHash(data.data(), data.size());
+
+	// A single changed byte:
+	auto changed = data;
+	changed[50] = 'b';
+	TEST_NOTEQUAL(Dxf::contentHash(changed.data(), changed.size()), hash);
+
+	// Trailing zero bytes:
+	auto longer = data;
+	longer.push_back(0);
+	TEST_NOTEQUAL(Dxf::contentHash(longer.data(), longer.size()), hash);
+
+	// Swapped words:
+	std::string swapped = data.substr(0, 8) + std::string(8, 'b');
+	std::string swapped2 = std::string(8, 'b') + data.substr(0, 8);
+	TEST_NOTEQUAL(Dxf::contentHash(swapped.data(), swapped.size()), Dxf::contentHash(swapped2.data(), swapped2.size()));
+
+	TEST_NOTEQUAL(Dxf::contentHash(nullptr, 0), Dxf::contentHash("\0", 1));
+}
+
+
+
+
+
+static void testHashingDataSource()
+{
+	fmt::print("Testing the hashing data source...\n");
+
+	std::string data = "0\r\nSECTION\r\n2\r\nENTITIES\r\n0\r\nENDSEC\r\n0\r\nEOF\r\n";
+	auto expected = Dxf::contentHash(data.data(), data.size());
+	Dxf::ContentHasher hasher;
+	auto dataSource = Dxf::Parser::hashingDataSource(Dxf::Parser::dataSourceFromString(std::move(data)), hasher);
+	char buffer[5];
+	while (dataSource(buffer, sizeof(buffer)) > 0)
+	{
+	}
+	TEST_EQUAL(hasher.digest(), expected);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ContentHashTest",
+	testSplitting();
+	testDifferences();
+	testHashingDataSource();
+)
@@ -0,0 +1,471 @@
+// DxfBench.cpp
+
+// Measures the performance of the individual library parts on a synthetic drawing
+// The results are printed as one JSON object per line, for easy machine processing
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <fmt/format.h>
+#include "DxfParser.hpp"
+#include "DxfWriter.hpp"
+
+#ifdef _WIN32
+	#ifndef NOMINMAX
+		#define NOMINMAX
+	#endif
+	#include <windows.h>
+	#include <psapi.h>
+#else
+	#include <sys/resource.h>
+#endif
+
+
+
+
+
+/** The settings for generating the synthetic drawing and running the benchmarks. */
+class Settings
+{
+public:
+
+	/** The total number of entities to generate. */
+	size_t mNumEntities = 200000;
+
+	/** The number of layers into which the entities are distributed. */
+	size_t mNumLayers = 16;
+
+	/** The range of the number of vertices in the generated polylines. */
+	size_t mMinVertices = 2;
+	size_t mMaxVertices = 20;
+
+	/** The relative weights of the individual entity types in the generated mix. */
+	unsigned mWeightLine = 4;
+	unsigned mWeightLWPolyline = 2;
+	unsigned mWeightPolyline = 1;
+	unsigned mWeightCircle = 1;
+	unsigned mWeightArc = 1;
+	unsigned mWeightText = 1;
+	unsigned mWeightPoint = 1;
+
+	/** If true, the lines in the DXF data are separated by LF only, instead of CRLF. */
+	bool mUseLF = false;
+
+	/** The number of times each benchmark is run; the fastest run is reported. */
+	unsigned mNumRepeats = 3;
+
+	/** The seed for the pseudo-random generator, the same seed always generates the same drawing. */
+	uint64_t mSeed = 42;
+};
+
+
+
+
+
+/** A simple deterministic pseudo-random generator (PCG-style LCG), so that the drawing is the same on all platforms. */
+class Random
+{
+	uint64_t mState;
+
+
+public:
+
+	explicit Random(uint64_t aSeed):
+		mState(aSeed)
+	{
+	}
+
+	/** Returns a pseudo-random number in the range [0, aMax). */
+	size_t nextInt(size_t aMax)
+	{
+		mState = mState * 6364136223846793005ull + 1442695040888963407ull;
+		return static_cast<size_t>((mState >> 33) % aMax);
+	}
+
+	/** Returns a pseudo-random number in the range [0, aMax). */
+	double nextDouble(double aMax)
+	{
+		mState = mState * 6364136223846793005ull + 1442695040888963407ull;
+		return static_cast<double>(mState >> 11) / static_cast<double>(1ull << 53) * aMax;
+	}
+
+	Dxf::Coords nextCoords()
+	{
+		auto x = nextDouble(100000);
+		auto y = nextDouble(100000);
+		return {x, y};
+	}
+};
+
+
+
+
+
+/** Creates the synthetic drawing, according to the settings. */
+static std::shared_ptr<Dxf::Drawing> createDrawing(const Settings & aSettings)
+{
+	auto drawing = std::make_shared<Dxf::Drawing>();
+	std::vector<std::shared_ptr<Dxf::Layer>> layers;
+	for (size_t i = 0; i < aSettings.mNumLayers; ++i)
+	{
+		layers.push_back(drawing->addLayer(fmt::format("LAYER_{}", i)));
+		layers.back()->setDefaultColor(static_cast<Dxf::Color>(i % 255 + 1));
+	}
+
+	const unsigned weights[] =
+	{
+		aSettings.mWeightLine,
+		aSettings.mWeightLWPolyline,
+		aSettings.mWeightPolyline,
+		aSettings.mWeightCircle,
+		aSettings.mWeightArc,
+		aSettings.mWeightText,
+		aSettings.mWeightPoint,
+	};
+	unsigned totalWeight = 0;
+	for (auto w: weights)
+	{
+		totalWeight += w;
+	}
+	if (totalWeight == 0)
+	{
+		throw std::runtime_error("All entity weights are zero");
+	}
+
+	Random rnd(aSettings.mSeed);
+	auto addVertices = [&](Dxf::MultiVertex & aMultiVertex)
+	{
+		auto numVertices = aSettings.mMinVertices + rnd.nextInt(aSettings.mMaxVertices - aSettings.mMinVertices + 1);
+		aMultiVertex.mVertices.reserve(numVertices);
+		for (size_t v = 0; v < numVertices; ++v)
+		{
+			aMultiVertex.addVertex(rnd.nextCoords());
+		}
+	};
+	for (size_t i = 0; i < aSettings.mNumEntities; ++i)
+	{
+		// Pick the entity type based on the weights:
+		auto r = static_cast<unsigned>(rnd.nextInt(totalWeight));
+		size_t type = 0;
+		while (r >= weights[type])
+		{
+			r -= weights[type];
+			type += 1;
+		}
+
+		Dxf::PrimitivePtr obj;
+		switch (type)
+		{
+			case 0: obj = std::make_shared<Dxf::Line>(rnd.nextCoords(), rnd.nextCoords()); break;
+			case 1:
+			{
+				auto lwPolyline = std::make_shared<Dxf::LWPolyline>();
+				addVertices(*lwPolyline);
+				obj = std::move(lwPolyline);
+				break;
+			}
+			case 2:
+			{
+				auto polyline = std::make_shared<Dxf::Polyline>();
+				addVertices(*polyline);
+				obj = std::move(polyline);
+				break;
+			}
+			case 3: obj = std::make_shared<Dxf::Circle>(rnd.nextCoords(), rnd.nextDouble(100)); break;
+			case 4: obj = std::make_shared<Dxf::Arc>(rnd.nextCoords(), rnd.nextDouble(100), rnd.nextDouble(360), rnd.nextDouble(360)); break;
+			case 5: obj = std::make_shared<Dxf::Text>(rnd.nextCoords(), fmt::format("Text {}", i), rnd.nextDouble(10)); break;
+			default: obj = std::make_shared<Dxf::Point>(rnd.nextCoords()); break;
+		}
+		layers[rnd.nextInt(layers.size())]->addObject(std::move(obj));
+	}
+	return drawing;
+}
+
+
+
+
+
+/** Returns the DXF data of the drawing, with the line ends specified in the settings. */
+static std::string createDxf(const Dxf::Drawing & aDrawing, const Settings & aSettings)
+{
+	std::string res;
+	Dxf::Writer::write(aDrawing, Dxf::Writer::dataSinkToString(res));
+	if (aSettings.mUseLF)
+	{
+		res.erase(std::remove(res.begin(), res.end(), '\r'), res.end());
+	}
+	return res;
+}
+
+
+
+
+
+/** Returns the peak resident set size of the process so far, in KiB. */
+static size_t peakRssKiB()
+{
+	#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS pmc;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc)))
+		{
+			return 0;
+		}
+		return pmc.PeakWorkingSetSize / 1024;
+	#else
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return 0;
+		}
+		#ifdef __APPLE__
+			return static_cast<size_t>(usage.ru_maxrss) / 1024;  // Bytes on macOS
+		#else
+			return static_cast<size_t>(usage.ru_maxrss);  // KiB on Linux
+		#endif
+	#endif
+}
+
+
+
+
+
+/** Runs the specified benchmark function the configured number of times and prints the fastest run's results.
+aNumBytes and aNumEntities are the amount of data processed by a single run, used for the throughput values. */
+static void bench(
+	const Settings & aSettings,
+	const char * aName,
+	size_t aNumBytes,
+	size_t aNumEntities,
+	const std::function<void()> & aFunction
+)
+{
+	double bestSeconds = 0;
+	for (unsigned i = 0; i < aSettings.mNumRepeats; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		aFunction();
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		if ((i == 0) || (seconds < bestSeconds))
+		{
+			bestSeconds = seconds;
+		}
+	}
+	auto safeSeconds = std::max(bestSeconds, 1e-9);
+	fmt::print(
+		"{{\"benchmark\": \"{}\", \"seconds\": {:.6f}, \"bytes\": {}, \"mb_per_s\": {:.2f}, \"entities\": {}, \"entities_per_s\": {:.0f}, \"peak_rss_kib\": {}}}\n",
+		aName, bestSeconds, aNumBytes, static_cast<double>(aNumBytes) / 1e6 / safeSeconds,
+		aNumEntities, static_cast<double>(aNumEntities) / safeSeconds, peakRssKiB()
+	);
+	std::fflush(stdout);
+}
+
+
+
+
+
+static void printUsage(const char * aProgramName)
+{
+	std::cerr
+		<< "Usage: " << aProgramName << " [options]\n"
+		<< "Options:\n"
+		<< "  --entities N       Total number of entities (default 200000)\n"
+		<< "  --layers N         Number of layers (default 16)\n"
+		<< "  --vertices MIN MAX Range of polyline vertex counts (default 2 20)\n"
+		<< "  --mix L,LW,P,C,A,T,PT  Weights of Line, LWPolyline, Polyline, Circle, Arc, Text, Point (default 4,2,1,1,1,1,1)\n"
+		<< "  --lf               Use LF line ends instead of CRLF\n"
+		<< "  --repeat N         Number of runs of each benchmark, the fastest is reported (default 3)\n"
+		<< "  --seed N           Seed for the generator (default 42)\n";
+}
+
+
+
+
+
+/** Parses the command line into the settings.
+Returns false if the command line is not valid. */
+static bool parseCommandLine(int argc, char * argv[], Settings & aSettings)
+{
+	for (int i = 1; i < argc; ++i)
+	{
+		auto hasArgs = [&](int aNumArgs)
+		{
+			return (i + aNumArgs < argc);
+		};
+		if ((std::strcmp(argv[i], "--entities") == 0) && hasArgs(1))
+		{
+			aSettings.mNumEntities = std::stoul(argv[++i]);
+		}
+		else if ((std::strcmp(argv[i], "--layers") == 0) && hasArgs(1))
+		{
+			aSettings.mNumLayers = std::max<size_t>(1, std::stoul(argv[++i]));
+		}
+		else if ((std::strcmp(argv[i], "--vertices") == 0) && hasArgs(2))
+		{
+			aSettings.mMinVertices = std::stoul(argv[++i]);
+			aSettings.mMaxVertices = std::max(aSettings.mMinVertices, static_cast<size_t>(std::stoul(argv[++i])));
+		}
+		else if ((std::strcmp(argv[i], "--mix") == 0) && hasArgs(1))
+		{
+			unsigned * weights[] =
+			{
+				&aSettings.mWeightLine, &aSettings.mWeightLWPolyline, &aSettings.mWeightPolyline,
+				&aSettings.mWeightCircle, &aSettings.mWeightArc, &aSettings.mWeightText, &aSettings.mWeightPoint
+			};
+			std::string mix(argv[++i]);
+			size_t start = 0;
+			for (auto w: weights)
+			{
+				auto end = mix.find(',', start);
+				*w = static_cast<unsigned>(std::stoul(mix.substr(start, end - start)));
+				if (end == std::string::npos)
+				{
+					break;
+				}
+				start = end + 1;
+			}
+		}
+		else if (std::strcmp(argv[i], "--lf") == 0)
+		{
+			aSettings.mUseLF = true;
+		}
+		else if ((std::strcmp(argv[i], "--repeat") == 0) && hasArgs(1))
+		{
+			aSettings.mNumRepeats = std::max(1u, static_cast<unsigned>(std::stoul(argv[++i])));
+		}
+		else if ((std::strcmp(argv[i], "--seed") == 0) && hasArgs(1))
+		{
+			aSettings.mSeed = std::stoull(argv[++i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+int main(int argc, char * argv[])
+{
+	Settings settings;
+	try
+	{
+		if (!parseCommandLine(argc, argv, settings))
+		{
+			printUsage(argv[0]);
+			return 1;
+		}
+	}
+	catch (const std::exception &)
+	{
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	auto drawing = createDrawing(settings);
+	auto dxf = createDxf(*drawing, settings);
+	auto numLines = static_cast<size_t>(std::count(dxf.begin(), dxf.end(), '\n'));
+	auto numEntities = settings.mNumEntities;
+	fmt::print(stderr, "Generated {} entities in {} layers, {} bytes of DXF data in {} lines\n",
+		numEntities, settings.mNumLayers, dxf.size(), numLines
+	);
+
+	bench(settings, "line_extractor", dxf.size(), numEntities, [&]()
+	{
+		Dxf::Parser::LineExtractor le(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+		for (size_t i = 0; i < numLines; ++i)
+		{
+			le.getNextLine();
+		}
+	});
+
+	bench(settings, "parse", dxf.size(), numEntities, [&]()
+	{
+		Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	});
+
+	Dxf::Parser::ParseStats stats;
+	bench(settings, "parse_instrumented", dxf.size(), numEntities, [&]()
+	{
+		stats = Dxf::Parser::ParseStats();
+		Dxf::Parser::Options options;
+		options.mStats = &stats;
+		Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)), options);
+	});
+	for (const auto & section: stats.mSections)
+	{
+		fmt::print(
+			"{{\"parse_section\": \"{}\", \"seconds\": {:.6f}, \"bytes\": {}, \"lines\": {}}}\n",
+			section.first, section.second.mSeconds, section.second.mNumBytes, section.second.mNumLines
+		);
+	}
+
+	std::string binaryDxf;
+	Dxf::Writer::Options binaryOptions;
+	binaryOptions.mFormat = Dxf::Writer::ofBinary;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(binaryDxf), binaryOptions);
+	bench(settings, "parse_binary", binaryDxf.size(), numEntities, [&]()
+	{
+		Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(binaryDxf)));
+	});
+
+	bench(settings, "entity_reader", dxf.size(), numEntities, [&]()
+	{
+		Dxf::Parser::EntityReader reader(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+		while (reader.next())
+		{
+		}
+	});
+
+	bench(settings, "scan_statistics", dxf.size(), numEntities, [&]()
+	{
+		Dxf::Parser::scanStatistics(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	});
+
+	// The only filtered parse available is the layer list, which stops after the TABLES section:
+	bench(settings, "parse_layer_list", dxf.size(), 0, [&]()
+	{
+		Dxf::Parser::parseLayerList(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	});
+
+	bench(settings, "extent", 0, numEntities, [&]()
+	{
+		Dxf::Extent extent;
+		for (const auto & layer: drawing->layers())
+		{
+			for (const auto & obj: layer->objects())
+			{
+				extent.expandTo(obj->extent());
+			}
+		}
+		if (extent.isEmpty() && (numEntities > 0))
+		{
+			throw std::runtime_error("Unexpected empty extent");
+		}
+	});
+
+	auto benchWrite = [&](const char * aName, const Dxf::Writer::Options & aOptions)
+	{
+		size_t numBytes = 0;
+		Dxf::Writer::write(*drawing, [&numBytes](const char *, size_t aSize) { numBytes += aSize; }, aOptions);
+		bench(settings, aName, numBytes, numEntities, [&]()
+		{
+			Dxf::Writer::write(*drawing, [](const char *, size_t) {}, aOptions);
+		});
+	};
+	benchWrite("write", Dxf::Writer::Options());
+	Dxf::Writer::Options fixed;
+	fixed.mDecimalPlaces = 3;
+	benchWrite("write_fixed3", fixed);
+	Dxf::Writer::Options parallel;
+	parallel.mNumThreads = 0;
+	benchWrite("write_parallel", parallel);
+	benchWrite("write_binary", binaryOptions);
+	return 0;
+}
@@ -86,7 +86,245 @@ static void testDuplicateRemoval()
 
 
 
+static void testMemoryUsage()
+{
+	using namespace Dxf;
+	Drawing drawing;
+	auto layer = drawing.addLayer("A_LAYER_WITH_A_NAME_LONG_ENOUGH_TO_BE_ALLOCATED");
+	layer->addObject(std::make_shared<Line>(Coords(1, 2), Coords(3, 4)));
+	layer->addObject(std::make_shared<Line>(Coords(5, 6), Coords(7, 8)));
+	std::string longText(1000, 'x');
+	layer->addObject(std::make_shared<Text>(Coords(0, 0), longText, 1));
+	auto polyline = std::make_shared<Polyline>();
+	for (int i = 0; i < 1000; ++i)
+	{
+		polyline->addVertex({static_cast<Coord>(i), 0});
+	}
+	layer->addObject(polyline);
+
+	auto usage = layer->memoryUsage();
+	TEST_EQUAL(usage.mObjectTypes.size(), 3);
+	TEST_EQUAL(usage.mObjectTypes[otLine].mCount, 2);
+	TEST_EQUAL(usage.mObjectTypes[otLine].mBytes, 2 * sizeof(Line));
+	TEST_EQUAL(usage.mObjectTypes[otText].mCount, 1);
+	TEST_EQUAL(usage.mObjectTypes[otPolyline].mCount, 1);
+	TEST_EQUAL(usage.mObjects, 2 * sizeof(Line) + sizeof(Text) + sizeof(Polyline));
+	TEST_TRUE(usage.mVertices >= 1000 * sizeof(Vertex));
+	TEST_TRUE(usage.mStrings >= 1000 + layer->name().size());
+	TEST_TRUE(usage.mSmartPointers >= 4 * sizeof(PrimitivePtr));
+	TEST_EQUAL(usage.total(),
+		usage.mObjects + usage.mVertices + usage.mStrings + usage.mAttribs + usage.mSmartPointers + usage.mOther
+	);
+
+	// The drawing includes the layer and the block definitions:
+	auto def = std::make_shared<BlockDefinition>("BLOCK");
+	def->mObjects.push_back(std::make_shared<Line>(Coords(0, 0), Coords(1, 1)));
+	drawing.addBlockDefinition("BLOCK", def);
+	auto drawingUsage = drawing.memoryUsage();
+	TEST_EQUAL(drawingUsage.mObjectTypes[otLine].mCount, 3);
+	TEST_TRUE(drawingUsage.total() > usage.total() + sizeof(Line));
+}
+
+
+
+
+
+static void testStringPool()
+{
+	using namespace Dxf;
+	StringPool pool;
+	std::string longText(100, 'x');
+	auto s1 = pool.intern(std::string_view(longText));
+	auto s2 = pool.intern(std::string(longText));
+	auto s3 = pool.intern("N");
+	TEST_TRUE(s1.sharesStorageWith(s2));
+	TEST_TRUE(!s1.sharesStorageWith(s3));
+	TEST_EQUAL(s1.str(), longText);
+	TEST_EQUAL(pool.size(), 2u);
+	TEST_TRUE(s1 == longText);
+	TEST_TRUE(s3 != s1);
+
+	// Unpooled strings with the same value are still equal:
+	SharedString s4(longText);
+	TEST_TRUE(!s4.sharesStorageWith(s1));
+	TEST_TRUE(s4 == s1);
+	TEST_TRUE(SharedString().empty());
+
+	// Shared texts are counted only once in the memory usage:
+	Drawing drawing;
+	auto layer = drawing.addLayer("LAYER");
+	for (int i = 0; i < 100; ++i)
+	{
+		auto text = std::make_shared<Text>();
+		text->mRawText = drawing.stringPool().intern(std::string_view(longText));
+		layer->addObject(text);
+	}
+	auto usage = drawing.memoryUsage();
+	TEST_TRUE(usage.mStrings >= longText.size());
+	TEST_TRUE(usage.mStrings < 2 * longText.size() + 1000);
+}
+
+
+
+
+
+static void testHandleIndex()
+{
+	using namespace Dxf;
+	Drawing drawing;
+	auto layer1 = drawing.addLayer("LAYER_1");
+	auto layer2 = drawing.addLayer("LAYER_2");
+	for (int i = 0; i < 100; ++i)
+	{
+		auto line = std::make_shared<Line>(Coords(i, 0), Coords(i, 1));
+		line->mHandle = static_cast<uint64_t>(0x100 + i);
+		((i % 2 == 0) ? layer1 : layer2)->addObject(line);
+	}
+	layer1->addObject(std::make_shared<Point>());  // No handle, not indexed
+	TEST_EQUAL(drawing.mHandleIndex.size(), 100u);
+
+	// Lookup:
+	auto entry = drawing.findByHandle(0x105);
+	TEST_NOTNULL(entry);
+	TEST_TRUE(entry->mLayer == layer2.get());
+	TEST_EQUAL(entry->mObject->mPos.mX, 5.0);
+	TEST_TRUE(drawing.findByHandle(0x99) == nullptr);
+
+	// Removal, through the drawing and through the layer:
+	auto removed = drawing.removeByHandle(0x105);
+	TEST_NOTNULL(removed);
+	TEST_EQUAL(layer2->numObjects(), 49u);
+	TEST_TRUE(drawing.findByHandle(0x105) == nullptr);
+	TEST_TRUE(drawing.removeByHandle(0x105) == nullptr);
+	layer1->removeObj(drawing.findByHandle(0x100)->mObject.get());
+	TEST_TRUE(drawing.findByHandle(0x100) == nullptr);
+	TEST_TRUE(layer1->removeObjByStableIndex(0) == nullptr);  // The indices don't shift until compacted, 0x100 was at 0
+	TEST_EQUAL(layer1->removeObjByStableIndex(1)->mHandle, 0x102u);
+	TEST_TRUE(drawing.findByHandle(0x102) == nullptr);
+	TEST_EQUAL(drawing.mHandleIndex.size(), 97u);
+
+	// A copy with the same handle replaces the original in the index; removing the original keeps the copy:
+	auto original = drawing.findByHandle(0x104)->mObject;
+	auto copy = clonePrimitive(*original);
+	layer2->addObject(copy);
+	TEST_TRUE(drawing.findByHandle(0x104)->mObject == copy);
+	layer1->removeObj(original.get());
+	TEST_TRUE(drawing.findByHandle(0x104)->mObject == copy);
+
+	// Changed handles are picked up by a rebuild:
+	copy->mHandle = 0x1000;
+	drawing.rebuildHandleIndex();
+	TEST_TRUE(drawing.findByHandle(0x104) == nullptr);
+	TEST_TRUE(drawing.findByHandle(0x1000)->mLayer == layer2.get());
+
+	layer2->clear();
+	TEST_EQUAL(drawing.mHandleIndex.size(), 47u);
+	drawing.clear();
+	TEST_TRUE(drawing.mHandleIndex.empty());
+}
+
+
+
+
+
+static void testEntityIds()
+{
+	using namespace Dxf;
+	Drawing drawing;
+	auto layer = drawing.addLayer("LAYER");
+	std::vector<EntityId> ids;
+	for (int i = 0; i < 1000; ++i)
+	{
+		ids.push_back(layer->addObject(std::make_shared<Point>(Coords(i, 0))));
+	}
+	TEST_TRUE(ids[5] != ids[6]);
+	TEST_TRUE(layer->objectById(ids[5]) == layer->objects()[5]);
+	TEST_TRUE(layer->objectId(7) == ids[7]);
+	TEST_TRUE(!layer->objectId(1000).isValid());
+
+	// Remove every odd object by its ID, the order of the remaining ones is kept:
+	for (size_t i = 1; i < ids.size(); i += 2)
+	{
+		auto removed = layer->removeObjById(ids[i]);
+		TEST_NOTNULL(removed);
+		TEST_EQUAL(removed->mPos.mX, static_cast<double>(i));
+	}
+	TEST_TRUE(layer->removeObjById(ids[1]) == nullptr);
+	TEST_TRUE(layer->objectById(ids[1]) == nullptr);
+	TEST_TRUE(layer->removeObjById(EntityId()) == nullptr);
+	TEST_TRUE(layer->needsCompaction());
+	TEST_EQUAL(layer->numObjects(), 500u);
+	TEST_EQUAL(layer->objects().size(), 1000u);
+	TEST_TRUE(layer->objects()[1] == nullptr);
+	size_t numVisited = 0;
+	layer->forEachObject([&numVisited](const PrimitivePtr & aObject)
+	{
+		TEST_EQUAL(aObject->mPos.mX, static_cast<double>(2 * numVisited));
+		numVisited += 1;
+	});
+	TEST_EQUAL(numVisited, 500u);
+	layer->compact();
+	TEST_TRUE(!layer->needsCompaction());
+	const auto & objects = layer->objects();
+	TEST_EQUAL(objects.size(), 500u);
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		TEST_EQUAL(objects[i]->mPos.mX, static_cast<double>(2 * i));
+	}
+
+	// The remaining IDs are still valid after the compaction:
+	TEST_EQUAL(layer->objectById(ids[998])->mPos.mX, 998.0);
+	TEST_TRUE(layer->objectId(499) == ids[998]);
+
+	// Reused slots get new IDs, stale IDs don't refer to the new objects:
+	auto newId = layer->addObject(std::make_shared<Point>(Coords(-1, 0)));
+	TEST_TRUE(newId.mSlot == ids[999].mSlot);
+	TEST_TRUE(newId != ids[999]);
+	TEST_TRUE(layer->objectById(ids[999]) == nullptr);
+	TEST_EQUAL(layer->objects().back()->mPos.mX, -1.0);
+
+	// Index-based removal shifts the later objects, stable-index removal leaves a tombstone:
+	TEST_TRUE(layer->removeObjByIndex(501) == nullptr);
+	TEST_EQUAL(layer->removeObjByIndex(0)->mPos.mX, 0.0);
+	TEST_TRUE(!layer->needsCompaction());
+	TEST_TRUE(layer->objectId(0) == ids[2]);
+	TEST_TRUE(layer->objectById(ids[4]) == layer->objects()[1]);
+	TEST_EQUAL(layer->removeObjByStableIndex(1)->mPos.mX, 4.0);
+	TEST_TRUE(layer->removeObjByStableIndex(1) == nullptr);
+	TEST_TRUE(layer->objectId(2) == ids[6]);
+	TEST_EQUAL(layer->removeObjByIndex(1)->mPos.mX, 6.0);  // Compacts first, so the tombstone doesn't count
+	layer->removeObj(layer->objectById(ids[2]).get());
+	layer->compact();
+	TEST_EQUAL(layer->objects().size(), 497u);
+	TEST_EQUAL(layer->objects()[0]->mPos.mX, 8.0);
+
+	layer->clear();
+	TEST_TRUE(layer->objectById(ids[4]) == nullptr);
+	TEST_TRUE(layer->objects().empty());
+
+	// Removing by stable index in a loop doesn't compact, so it stays linear even for large layers:
+	for (int i = 0; i < 200000; ++i)
+	{
+		layer->addObject(std::make_shared<Point>(Coords(i, 0)));
+	}
+	for (size_t i = 0; i < 200000; i += 2)
+	{
+		TEST_EQUAL(layer->removeObjByStableIndex(i)->mPos.mX, static_cast<double>(i));
+	}
+	layer->compact();
+	TEST_EQUAL(layer->objects().size(), 100000u);
+	TEST_EQUAL(layer->objects()[0]->mPos.mX, 1.0);
+}
+
+
+
+
+
 IMPLEMENT_TEST_MAIN("DxfDrawingTest",
 	testCreation();
 	testDuplicateRemoval();
+	testMemoryUsage();
+	testStringPool();
+	testHandleIndex();
+	testEntityIds();
 )
@@ -3,6 +3,8 @@
 // Tests the DxfParser class
 
 #include "DxfParser.hpp"
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 #include "TestHelpers.h"
 
@@ -134,6 +136,448 @@ static void testPolyline()
 
 
 
+static void testBinaryR12()
+{
+	fmt::print("Testing binary DXF with 1-byte group codes...\n");
+
+	// Binary DXF in the pre-R13 format, with 1-byte group codes:
+	std::string dxf("AutoCAD Binary DXF\r\n\x1a\0", 22);
+	auto group = [&dxf](int aGroupCode, const std::string & aValue)
+	{
+		dxf.push_back(static_cast<char>(aGroupCode));
+		dxf.append(aValue);
+		dxf.push_back(0);
+	};
+	auto groupDouble = [&dxf](int aGroupCode, double aValue)
+	{
+		dxf.push_back(static_cast<char>(aGroupCode));
+		char bytes[8];
+		std::memcpy(bytes, &aValue, sizeof(bytes));  // NOTE: Assumes a little-endian machine
+		dxf.append(bytes, sizeof(bytes));
+	};
+	group(0, "SECTION");
+	group(2, "TABLES");
+	group(0, "TABLE");
+	group(2, "LAYER");
+	group(0, "LAYER");
+	group(2, "Layer1");
+	dxf.append(std::string("\x3e\x05\x00", 3));  // {62, 5} as a 2-byte int
+	group(0, "ENDTAB");
+	group(0, "ENDSEC");
+	group(0, "SECTION");
+	group(2, "ENTITIES");
+	group(0, "LINE");
+	group(8, "Layer1");
+	groupDouble(10, 1.25);
+	groupDouble(20, -2.5);
+	groupDouble(11, 1e-300);
+	groupDouble(21, 4);
+	group(0, "ENDSEC");
+	group(0, "EOF");
+
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(dxf)));
+	TEST_NOTNULL(drawing);
+	auto layer1 = drawing->layerByName("Layer1");
+	TEST_NOTNULL(layer1);
+	TEST_EQUAL(layer1->defaultColor(), 5);
+	TEST_EQUAL(layer1->objects().size(), 1u);
+	auto line = std::static_pointer_cast<Dxf::Line>(layer1->objects()[0]);
+	TEST_EQUAL(line->mPos.mX, 1.25);
+	TEST_EQUAL(line->mPos.mY, -2.5);
+	TEST_EQUAL(line->mPos2.mX, 1e-300);
+	TEST_EQUAL(line->mPos2.mY, 4);
+}
+
+
+
+
+
+static void testStats()
+{
+	fmt::print("Testing parser instrumentation...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nHEADER\n9\n$ACADVER\n1\nAC1009\n0\nENDSEC\n"
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nLINE\n8\nLayer1\n10\n1\n20\n1\n11\n2\n21\n2\n"
+		"0\nELLIPSE\n8\nLayer1\n10\n1\n20\n1\n"
+		"0\nPOLYLINE\n8\nLayer1\n70\n0\n"
+		"0\nVERTEX\n8\nLayer1\n10\n1\n20\n1\n"
+		"0\nSEQEND\n"
+		"0\nENDSEC\n0\nEOF\n";
+	Dxf::Parser::ParseStats stats;
+	Dxf::Parser::Options options;
+	options.mStats = &stats;
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)), options);
+	TEST_EQUAL(drawing->layerByName("Layer1")->objects().size(), 3u);
+
+	TEST_EQUAL(stats.mTotalBytes, dxf.size());
+	TEST_EQUAL(stats.mTotalLines, static_cast<unsigned>(std::count(dxf.begin(), dxf.end(), '\n')));
+	TEST_EQUAL(stats.mSections.size(), 3u);
+	TEST_EQUAL(stats.mSections["HEADER"].mNumLines, 6u);  // The section name itself is not included
+	TEST_EQUAL(stats.mSections["TABLES"].mNumLines, 14u);
+	TEST_TRUE(stats.mSections["ENTITIES"].mNumBytes > stats.mSections["TABLES"].mNumBytes);
+	TEST_EQUAL(stats.mEntityCounts["LINE"], 2u);
+	TEST_EQUAL(stats.mEntityCounts["ELLIPSE"], 1u);
+	TEST_EQUAL(stats.mEntityCounts["VERTEX"], 1u);
+	TEST_EQUAL(stats.mNumUnknownEntities, 1u);
+	TEST_EQUAL(stats.mNumObjectAllocations, 5u);  // Layer, 2 lines, polyline, vertex
+	TEST_TRUE(stats.mNumDataSourceReads > 0);
+	TEST_TRUE(stats.mBufferSize > 0);
+}
+
+
+
+
+
+static void testProgress()
+{
+	fmt::print("Testing progress reporting and cancellation...\n");
+
+	std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n0\nLAYER\n2\nLayer1\n62\n7\n0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n";
+	for (int i = 0; i < 1000; ++i)
+	{
+		dxf.append(fmt::format("0\nLINE\n8\nLayer1\n10\n{0}\n20\n0\n11\n{0}\n21\n1\n", i));
+	}
+	dxf.append("0\nENDSEC\n0\nEOF\n");
+
+	// Progress is reported in regular intervals, and once more at the end:
+	std::vector<uint64_t> reports;
+	Dxf::Parser::Options options;
+	options.mProgressInterval = 1000;
+	options.mTotalSize = dxf.size();
+	options.mProgressCallback = [&](uint64_t aNumBytesConsumed, uint64_t aTotalSize)
+	{
+		TEST_EQUAL(aTotalSize, dxf.size());
+		reports.push_back(aNumBytesConsumed);
+		return true;
+	};
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)), options);
+	TEST_EQUAL(drawing->layerByName("Layer1")->objects().size(), 1000u);
+	TEST_TRUE(reports.size() >= dxf.size() / 1000);
+	TEST_TRUE(std::is_sorted(reports.begin(), reports.end()));
+	TEST_EQUAL(reports.back(), dxf.size());
+
+	// Cancelling stops the parsing early:
+	size_t numCalls = 0;
+	options.mProgressCallback = [&](uint64_t, uint64_t)
+	{
+		numCalls += 1;
+		return (numCalls < 3);
+	};
+	TEST_THROWS(Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)), options), Dxf::Parser::Cancelled);
+	TEST_EQUAL(numCalls, 3u);
+	uint64_t numBytesConsumed = 0;
+	try
+	{
+		numCalls = 0;
+		Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)), options);
+	}
+	catch (const Dxf::Parser::Cancelled & exc)
+	{
+		numBytesConsumed = exc.mNumBytesConsumed;
+	}
+	TEST_TRUE(numBytesConsumed >= 3000);
+	TEST_TRUE(numBytesConsumed < 4000);
+}
+
+
+
+
+
+static void testEntityReader()
+{
+	fmt::print("Testing the entity reader...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nLAYER\n2\nLayer2\n62\n1\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nPOLYLINE\n8\nLayer2\n70\n0\n"
+		"0\nVERTEX\n8\nLayer2\n10\n1\n20\n1\n"
+		"0\nVERTEX\n8\nLayer2\n10\n2\n20\n1\n"
+		"0\nSEQEND\n"
+		"0\nLINE\n8\nUnknownLayer\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nCIRCLE\n8\nLayer1\n10\n5\n20\n5\n40\n2\n"
+		"0\nENDSEC\n0\nEOF\n";
+	Dxf::Parser::EntityReader reader(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	auto entity = reader.next();
+	TEST_TRUE(static_cast<bool>(entity));
+	TEST_EQUAL(entity.mPrimitive->mObjectType, Dxf::otLine);
+	TEST_EQUAL(entity.mLayer->name(), "Layer1");
+	entity = reader.next();
+	TEST_EQUAL(entity.mPrimitive->mObjectType, Dxf::otPolyline);
+	TEST_EQUAL(entity.mLayer->name(), "Layer2");
+	TEST_EQUAL(std::static_pointer_cast<Dxf::Polyline>(entity.mPrimitive)->mVertices.size(), 2u);
+	entity = reader.next();
+	TEST_EQUAL(entity.mPrimitive->mObjectType, Dxf::otCircle);
+	TEST_TRUE(!reader.next());
+	TEST_TRUE(!reader.next());
+
+	// The entities are not stored in the drawing:
+	TEST_EQUAL(reader.drawing()->layers().size(), 2u);
+	TEST_TRUE(reader.drawing()->layerByName("Layer1")->objects().empty());
+
+	// The same is available from parse() through the entity callback:
+	size_t numEntities = 0;
+	Dxf::Parser::Options options;
+	options.mShouldStoreEntities = false;
+	options.mEntityCallback = [&numEntities](const std::shared_ptr<Dxf::Layer> &, const Dxf::PrimitivePtr &)
+	{
+		numEntities += 1;
+	};
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)), options);
+	TEST_EQUAL(numEntities, 3u);
+	TEST_TRUE(drawing->layerByName("Layer2")->objects().empty());
+}
+
+
+
+
+
+static void testScanStatistics()
+{
+	fmt::print("Testing scanning the statistics...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n8\nLayer1\n10\n-1\n20\n0\n11\n1\n21\n5\n"
+		"0\nPOLYLINE\n8\nLayer2\n70\n0\n"
+		"0\nVERTEX\n8\nLayer2\n10\n1\n20\n1\n"
+		"0\nVERTEX\n8\nLayer2\n10\n2\n20\n1\n"
+		"0\nSEQEND\n"
+		"0\nLWPOLYLINE\n8\nLayer1\n90\n3\n10\n0\n20\n0\n10\n1\n20\n0\n10\n1\n20\n-2\n"
+		"0\nTEXT\n8\nLayer1\n10\n0\n20\n0\n1\nHello\n"
+		"0\nHATCH\n8\nLayer1\n"
+		"0\nENDSEC\n0\nEOF\n";
+	auto stats = Dxf::Parser::scanStatistics(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	TEST_EQUAL(stats.mNumEntities, 5u);
+	TEST_EQUAL(stats.mEntityCounts.size(), 5u);
+	TEST_EQUAL(stats.mEntityCounts["LWPOLYLINE"], 1u);
+	TEST_EQUAL(stats.mLayerEntityCounts["Layer1"], 4u);
+	TEST_EQUAL(stats.mLayerEntityCounts["Layer2"], 1u);
+	TEST_EQUAL(stats.mNumVertices, 5u);
+	TEST_EQUAL(stats.mTextBytes, 5u);
+	TEST_EQUAL(stats.mTotalBytes, dxf.size());
+	TEST_EQUAL(stats.mExtent.minCoord().mX, -1);
+	TEST_EQUAL(stats.mExtent.minCoord().mY, -2);
+	TEST_EQUAL(stats.mExtent.maxCoord().mX, 2);
+	TEST_EQUAL(stats.mExtent.maxCoord().mY, 5);
+
+	// The memory estimate counts only the entities the parser creates:
+	auto usage = stats.estimateMemoryUsage();
+	TEST_EQUAL(usage.mObjectTypes.size(), 4u);
+	TEST_EQUAL(usage.mObjectTypes[Dxf::otLine].mCount, 1u);
+	TEST_EQUAL(usage.mVertices, 5 * sizeof(Dxf::Vertex));
+	TEST_TRUE(usage.total() > 4 * sizeof(Dxf::Line));
+}
+
+
+
+
+
+static void testTextInterning()
+{
+	fmt::print("Testing interning of the repeated texts...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nTEXT\n8\nLayer1\n10\n0\n20\n0\n1\nGV\n"
+		"0\nTEXT\n8\nLayer1\n10\n1\n20\n0\n1\nN\n"
+		"0\nTEXT\n8\nLayer1\n10\n2\n20\n0\n1\nGV\n"
+		"0\nENDSEC\n0\nEOF\n";
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	const auto & objects = drawing->layerByName("Layer1")->objects();
+	TEST_EQUAL(objects.size(), 3u);
+	const auto & text0 = static_cast<const Dxf::Text &>(*objects[0]);
+	const auto & text1 = static_cast<const Dxf::Text &>(*objects[1]);
+	const auto & text2 = static_cast<const Dxf::Text &>(*objects[2]);
+	TEST_EQUAL(text0.mRawText.str(), "GV");
+	TEST_EQUAL(text1.mRawText.str(), "N");
+	TEST_TRUE(text0.mRawText.sharesStorageWith(text2.mRawText));
+	TEST_EQUAL(drawing->stringPool().size(), 2u);
+
+	// The texts are not interned when streaming the entities, the pool doesn't grow:
+	Dxf::Parser::EntityReader reader(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	std::vector<std::string> texts;
+	while (auto entity = reader.next())
+	{
+		texts.push_back(static_cast<const Dxf::Text &>(*entity.mPrimitive).mRawText.str());
+		TEST_EQUAL(reader.drawing()->stringPool().size(), 0u);
+	}
+	TEST_EQUAL(texts.size(), 3u);
+	TEST_EQUAL(texts[0], "GV");
+	TEST_EQUAL(texts[1], "N");
+	TEST_EQUAL(texts[2], "GV");
+}
+
+
+
+
+
+static void testRawPreservation()
+{
+	fmt::print("Testing preservation of the unsupported entities and sections...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nCLASSES\n0\nCLASS\n1\nACDBDICTIONARYWDFLT\n0\nENDSEC\n"
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nHATCH\n8\nLayer1\n10\n0.5\n2\nSOLID\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nINSERT\n8\nLayer1\n66\n1\n2\nBLK\n"
+		"0\nATTRIB\n8\nLayer1\n1\nValue\n"
+		"0\nSEQEND\n8\nLayer1\n"
+		"0\nENDSEC\n"
+		"0\nSECTION\n2\nOBJECTS\n0\nDICTIONARY\n5\nC\n330\n0\n0\nENDSEC\n"
+		"0\nEOF\n";
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	TEST_EQUAL(drawing->layerByName("Layer1")->objects().size(), 1u);
+
+	// The unsupported entities, including the whole INSERT sequence:
+	const auto & raw = drawing->mRawEntities;
+	TEST_EQUAL(raw.size(), 13u);
+	TEST_EQUAL(raw.groupCode(0), 0);
+	TEST_EQUAL(std::string(raw.value(0)), "HATCH");
+	TEST_EQUAL(raw.groupCode(2), 10);
+	TEST_EQUAL(std::string(raw.value(2)), "0.5");
+	TEST_EQUAL(std::string(raw.value(4)), "INSERT");
+	TEST_EQUAL(std::string(raw.value(8)), "ATTRIB");
+	TEST_EQUAL(std::string(raw.value(11)), "SEQEND");
+	TEST_EQUAL(std::string(raw.value(12)), "Layer1");
+
+	// The unsupported sections:
+	TEST_EQUAL(drawing->mRawSections.size(), 2u);
+	const auto & classes = drawing->mRawSections.at("CLASSES");
+	TEST_EQUAL(classes.size(), 2u);
+	TEST_EQUAL(std::string(classes.value(1)), "ACDBDICTIONARYWDFLT");
+	const auto & objects = drawing->mRawSections.at("OBJECTS");
+	TEST_EQUAL(objects.size(), 3u);
+	TEST_EQUAL(objects.groupCode(2), 330);
+
+	// Nothing is preserved when streaming the entities:
+	Dxf::Parser::EntityReader reader(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	size_t numEntities = 0;
+	while (reader.next())
+	{
+		numEntities += 1;
+	}
+	TEST_EQUAL(numEntities, 1u);
+	TEST_TRUE(reader.drawing()->mRawEntities.empty());
+	TEST_TRUE(reader.drawing()->mRawSections.empty());
+}
+
+
+
+
+
+static void testExtendedData()
+{
+	fmt::print("Testing extended entity data...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"1001\nMYAPP\n1000\nID-1234\n1002\n{\n1071\n42\n1010\n1.5\n1020\n2.5\n1030\n0\n1002\n}\n"
+		"1001\nOTHERAPP\n1005\n1A2B\n1004\n00FF\n1040\n-0.25\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nENDSEC\n0\nEOF\n";
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	const auto & objects = drawing->layerByName("Layer1")->objects();
+	TEST_EQUAL(objects.size(), 2u);
+
+	// Only the entity with XDATA has the storage allocated:
+	TEST_NOTNULL(objects[0]->mExtendedData);
+	TEST_EQUAL(objects[0]->mExtendedData->size(), 12u);
+	TEST_TRUE(objects[1]->mExtendedData == nullptr);
+	TEST_TRUE(objects[1]->extendedData().empty());
+
+	auto xdata = objects[0]->extendedData();
+	TEST_EQUAL(xdata.size(), 2u);
+	TEST_EQUAL(xdata[0].mApplicationName, "MYAPP");
+	TEST_EQUAL(xdata[0].mString, "ID-1234");
+	TEST_EQUAL(xdata[0].mLong, 42);
+	TEST_TRUE(xdata[0].mControlString);
+	TEST_EQUAL(xdata[0].mPos.mX, 1.5);
+	TEST_EQUAL(xdata[0].mPos.mY, 2.5);
+	TEST_EQUAL(xdata[1].mApplicationName, "OTHERAPP");
+	TEST_EQUAL(xdata[1].mDatabaseHandle, 0x1a2bu);
+	TEST_EQUAL(xdata[1].mBinaryData, std::string("\x00\xff", 2));
+	TEST_EQUAL(xdata[1].mReal, -0.25);
+	TEST_TRUE(!xdata[1].mControlString);
+
+	// Copies have their own extended data:
+	auto copy = Dxf::clonePrimitive(*objects[0]);
+	TEST_NOTNULL(copy->mExtendedData);
+	TEST_TRUE(copy->mExtendedData != objects[0]->mExtendedData);
+	TEST_EQUAL(copy->extendedData().at(0).mString, "ID-1234");
+}
+
+
+
+
+
+static void testHandles()
+{
+	fmt::print("Testing entity handles...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n5\n2A\n330\n1F\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nPOLYLINE\n5\nff00\n8\nLayer1\n66\n1\n"
+		"0\nVERTEX\n5\nFF01\n8\nLayer1\n10\n0\n20\n0\n"
+		"0\nVERTEX\n5\nFF02\n8\nLayer1\n10\n1\n20\n0\n"
+		"0\nSEQEND\n8\nLayer1\n"
+		"0\nENDSEC\n0\nEOF\n";
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	const auto & objects = drawing->layerByName("Layer1")->objects();
+	TEST_EQUAL(objects.size(), 3u);
+	TEST_EQUAL(objects[0]->mHandle, 0x2au);
+	TEST_EQUAL(objects[0]->mOwnerHandle, 0x1fu);
+	TEST_EQUAL(objects[1]->mHandle, 0u);
+	auto polyline = std::static_pointer_cast<Dxf::Polyline>(objects[2]);
+	TEST_EQUAL(polyline->mVertices.at(1).mHandle, 0xff02u);
+
+	// The index contains the entities in layers, not the vertices:
+	TEST_EQUAL(drawing->mHandleIndex.size(), 2u);
+	TEST_TRUE(drawing->findByHandle(0x2a)->mObject == objects[0]);
+	TEST_TRUE(drawing->findByHandle(0xff00)->mObject == objects[2]);
+	TEST_TRUE(drawing->findByHandle(0xff01) == nullptr);
+
+	// Invalid handle:
+	static const std::string invalid =
+		"0\nSECTION\n2\nENTITIES\n0\nLINE\n5\nXYZ\n0\nENDSEC\n0\nEOF\n";
+	TEST_THROWS(Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(invalid))), Dxf::Parser::Error);
+}
+
+
+
+
+
 IMPLEMENT_TEST_MAIN("DxfParserTest",
 	testEmpty();
 	testLayerList();
@@ -141,4 +585,13 @@ IMPLEMENT_TEST_MAIN("DxfParserTest",
 	testPolyline();
 	testInvalid();
 	testIncomplete();
+	testBinaryR12();
+	testStats();
+	testProgress();
+	testEntityReader();
+	testScanStatistics();
+	testTextInterning();
+	testRawPreservation();
+	testExtendedData();
+	testHandles();
 )
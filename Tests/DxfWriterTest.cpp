@@ -2,13 +2,501 @@
 
 // Tests the DxfWriter class
 
-#include "DxfDrawing.hpp"
+#include "DxfWriter.hpp"
+#include "DxfParser.hpp"
+#include <sstream>
 #include "TestHelpers.h"
 
 
 
 
 
+/** Creates a drawing with at least one of each object that the parser can read back. */
+static std::shared_ptr<Dxf::Drawing> createDrawing()
+{
+	auto drawing = std::make_shared<Dxf::Drawing>();
+	auto layer1 = drawing->addLayer("LAYER_1");
+	auto layer2 = drawing->addLayer("LAYER_2");
+	layer1->setDefaultColor(3);
+	layer1->addObject(std::make_shared<Dxf::Point>(Dxf::Coords(3, 2)));
+	layer1->addObject(std::make_shared<Dxf::Line>(Dxf::Coords(1, 2), Dxf::Coords(3, 4.5), 5));
+	layer1->addObject(std::make_shared<Dxf::Circle>(Dxf::Coords(5, 5), 1));
+	layer1->addObject(std::make_shared<Dxf::Arc>(Dxf::Coords(5, 5), 2, 0, 45));
+	layer1->addObject(std::make_shared<Dxf::Text>(Dxf::Coords(4, 1), "Test", 0.5, 30));
+	auto polyline = std::make_shared<Dxf::Polyline>();
+	polyline->addVertex({2, 3, 1});
+	polyline->addVertex({3, 3, 2});
+	polyline->addVertex({3, 2, 3});
+	polyline->mFlags = Dxf::plf3DPolyline;
+	layer2->addObject(polyline);
+	auto lwPolyline = std::make_shared<Dxf::LWPolyline>();
+	lwPolyline->addVertex({1, 3});
+	lwPolyline->addVertex({2, 3});
+	lwPolyline->addVertex({2, 2});
+	lwPolyline->mVertices[1].mBulge = 0.5;
+	lwPolyline->mFlags = Dxf::plfClosedPolyline;
+	layer2->addObject(lwPolyline);
+
+	// Objects that the parser doesn't read back, but must not break the parsing:
+	auto blockDef = std::make_shared<Dxf::BlockDefinition>("SYMBOL");
+	blockDef->mObjects.push_back(std::make_shared<Dxf::Line>(Dxf::Coords(0, 0), Dxf::Coords(1, 1)));
+	drawing->addBlockDefinition("SYMBOL", blockDef);
+	layer2->addObject(std::make_shared<Dxf::Block>(Dxf::Coords(10, 10), std::move(blockDef), 90, 2));
+	layer2->addObject(std::make_shared<Dxf::Solid>(Dxf::Coords(0, 0), Dxf::Coords(1, 0), Dxf::Coords(0, 1)));
+	layer2->addObject(std::make_shared<Dxf::AxisAligned2DEllipse>(Dxf::Coords(5, 5), 2, 1));
+	return drawing;
+}
+
+
+
+
+
+static void testRoundTrip()
+{
+	fmt::print("Testing write-parse round trip...\n");
+
+	auto drawing = createDrawing();
+	std::string output;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(output));
+	auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(output)));
+	TEST_NOTNULL(parsed);
+	TEST_EQUAL(parsed->layers().size(), 2u);
+
+	auto layer1 = parsed->layerByName("LAYER_1");
+	TEST_NOTNULL(layer1);
+	TEST_EQUAL(layer1->defaultColor(), 3);
+	const auto & objs1 = layer1->objects();
+	TEST_EQUAL(objs1.size(), 5u);
+	TEST_EQUAL(objs1[0]->mObjectType, Dxf::otPoint);
+	TEST_EQUAL(objs1[1]->mObjectType, Dxf::otLine);
+	TEST_EQUAL(objs1[1]->mColor, 5);
+	TEST_EQUAL(std::static_pointer_cast<Dxf::Line>(objs1[1])->mPos2.mY, 4.5);
+	TEST_EQUAL(std::static_pointer_cast<Dxf::Circle>(objs1[2])->mRadius, 1);
+	TEST_EQUAL(std::static_pointer_cast<Dxf::Arc>(objs1[3])->mEndAngle, 45);
+	auto text = std::static_pointer_cast<Dxf::Text>(objs1[4]);
+	TEST_EQUAL(text->mRawText.str(), "Test");
+	TEST_EQUAL(text->mSize, 0.5);
+	TEST_EQUAL(text->mAngle, 30);
+
+	auto layer2 = parsed->layerByName("LAYER_2");
+	TEST_NOTNULL(layer2);
+	const auto & objs2 = layer2->objects();
+	TEST_EQUAL(objs2.size(), 2u);
+	auto polyline = std::static_pointer_cast<Dxf::Polyline>(objs2[0]);
+	TEST_EQUAL(polyline->mObjectType, Dxf::otPolyline);
+	TEST_EQUAL(polyline->mFlags, Dxf::plf3DPolyline);
+	TEST_EQUAL(polyline->mVertices.size(), 3u);
+	TEST_EQUAL(polyline->mVertices[2].mPos.mX, 3);
+	TEST_EQUAL(polyline->mVertices[2].mPos.mZ, 3);
+	auto lwPolyline = std::static_pointer_cast<Dxf::LWPolyline>(objs2[1]);
+	TEST_EQUAL(lwPolyline->mObjectType, Dxf::otLWPolyline);
+	TEST_EQUAL(lwPolyline->mVertices.size(), 3u);
+	TEST_EQUAL(lwPolyline->mVertices[1].mBulge, 0.5);
+}
+
+
+
+
+
+static void testBuffering()
+{
+	fmt::print("Testing buffered output...\n");
+
+	// Create a drawing large enough to need several buffer flushes:
+	Dxf::Drawing drawing;
+	auto layer = drawing.addLayer("LAYER");
+	for (int i = 0; i < 100000; ++i)
+	{
+		layer->addObject(std::make_shared<Dxf::Line>(Dxf::Coords(i, i / 3.0), Dxf::Coords(i + 0.25, i / 7.0)));
+	}
+
+	std::string output;
+	size_t numCalls = 0;
+	Dxf::Writer::write(drawing, [&output, &numCalls](const char * aData, size_t aSize)
+	{
+		numCalls += 1;
+		output.append(aData, aSize);
+	});
+	TEST_TRUE(numCalls > 1);
+	TEST_TRUE(numCalls < output.size() / 100000);
+
+	// The output must be the same as when written through a stream:
+	std::stringstream ss;
+	Dxf::Writer::write(drawing, Dxf::Writer::dataSinkFromStdStream(ss));
+	TEST_EQUAL(ss.str(), output);
+
+	auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(output)));
+	TEST_EQUAL(parsed->layers()[0]->objects().size(), 100000u);
+}
+
+
+
+
+
+static void testNumberFormatting()
+{
+	fmt::print("Testing number formatting...\n");
+
+	Dxf::Drawing drawing;
+	auto layer = drawing.addLayer("LAYER");
+	layer->addObject(std::make_shared<Dxf::Circle>(Dxf::Coords(0.1, -1234567.125), 1.0 / 3));
+	layer->addObject(std::make_shared<Dxf::Circle>(Dxf::Coords(-0.0001, 2.5), 1e300));
+
+	// The default is the shortest representation that reads back the exact value:
+	std::string shortest;
+	Dxf::Writer::write(drawing, Dxf::Writer::dataSinkToString(shortest));
+	TEST_TRUE(shortest.find("\r\n10\r\n0.1\r\n20\r\n-1234567.125\r\n") != std::string::npos);
+	TEST_TRUE(shortest.find("\r\n40\r\n0.3333333333333333\r\n") != std::string::npos);
+	auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(shortest)));
+	auto circle = std::static_pointer_cast<Dxf::Circle>(parsed->layers()[0]->objects()[0]);
+	TEST_EQUAL(circle->mRadius, 1.0 / 3);
+
+	// Fixed precision, with the trailing zeroes removed:
+	Dxf::Writer::Options options;
+	options.mDecimalPlaces = 3;
+	std::string fixed;
+	Dxf::Writer::write(drawing, Dxf::Writer::dataSinkToString(fixed), options);
+	TEST_TRUE(fixed.find("\r\n10\r\n0.1\r\n20\r\n-1234567.125\r\n") != std::string::npos);
+	TEST_TRUE(fixed.find("\r\n40\r\n0.333\r\n") != std::string::npos);
+	TEST_TRUE(fixed.find("\r\n10\r\n0\r\n20\r\n2.5\r\n") != std::string::npos);
+	TEST_TRUE(fixed.find("\r\n40\r\n1e+300\r\n") != std::string::npos);
+	TEST_TRUE(fixed.size() < shortest.size());
+}
+
+
+
+
+
+static void testParallel()
+{
+	fmt::print("Testing parallel entity formatting...\n");
+
+	// Create a drawing with several layers of varying sizes, some larger than a single chunk:
+	Dxf::Drawing drawing;
+	for (int lay = 0; lay < 5; ++lay)
+	{
+		auto layer = drawing.addLayer(fmt::format("LAYER_{}", lay));
+		for (int i = 0; i < lay * 7000; ++i)
+		{
+			layer->addObject(std::make_shared<Dxf::Line>(Dxf::Coords(i, lay / 3.0), Dxf::Coords(i + 0.5, i / 7.0)));
+			auto text = std::make_shared<Dxf::Text>(Dxf::Coords(i, lay), fmt::format("T{}", i), 1);
+			layer->addObject(text);
+		}
+	}
+
+	std::string singleThreaded;
+	Dxf::Writer::write(drawing, Dxf::Writer::dataSinkToString(singleThreaded));
+	for (unsigned numThreads: {0u, 2u, 3u, 8u})
+	{
+		Dxf::Writer::Options options;
+		options.mNumThreads = numThreads;
+		std::string parallel;
+		Dxf::Writer::write(drawing, Dxf::Writer::dataSinkToString(parallel), options);
+		TEST_TRUE(parallel == singleThreaded);
+	}
+
+	// An exception from the data sink must be propagated and the workers stopped:
+	Dxf::Writer::Options options;
+	options.mNumThreads = 4;
+	size_t numBytes = 0;
+	TEST_THROWS(
+		Dxf::Writer::write(drawing, [&numBytes](const char * aData, size_t aSize)
+		{
+			(void)aData;
+			numBytes += aSize;
+			if (numBytes > 2 * 1024 * 1024)
+			{
+				throw std::runtime_error("Sink full");
+			}
+		}, options),
+		std::runtime_error
+	);
+}
+
+
+
+
+
+static void testBinary()
+{
+	fmt::print("Testing binary output...\n");
+
+	auto drawing = createDrawing();
+	std::string text;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(text));
+	Dxf::Writer::Options options;
+	options.mFormat = Dxf::Writer::ofBinary;
+	std::string binary;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(binary), options);
+	TEST_EQUAL(binary.compare(0, 22, std::string("AutoCAD Binary DXF\r\n\x1a\0", 22)), 0);
+
+	// Parsing the binary output must produce the same drawing as parsing the text output:
+	auto fromText = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(text)));
+	auto fromBinary = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(binary)));
+	TEST_EQUAL(fromBinary->layers().size(), fromText->layers().size());
+	for (size_t lay = 0; lay < fromText->layers().size(); ++lay)
+	{
+		const auto & textLayer = *fromText->layers()[lay];
+		const auto & binaryLayer = *fromBinary->layers()[lay];
+		TEST_EQUAL(binaryLayer.name(), textLayer.name());
+		TEST_EQUAL(binaryLayer.defaultColor(), textLayer.defaultColor());
+		TEST_EQUAL(binaryLayer.objects().size(), textLayer.objects().size());
+		for (size_t i = 0; i < textLayer.objects().size(); ++i)
+		{
+			const auto & textObj = *textLayer.objects()[i];
+			const auto & binaryObj = *binaryLayer.objects()[i];
+			TEST_EQUAL(binaryObj.mObjectType, textObj.mObjectType);
+			TEST_EQUAL(binaryObj.mColor, textObj.mColor);
+			TEST_TRUE(binaryObj.mPos == textObj.mPos);
+		}
+	}
+	auto lwPolyline = std::static_pointer_cast<Dxf::LWPolyline>(fromBinary->layerByName("LAYER_2")->objects()[1]);
+	TEST_EQUAL(lwPolyline->mVertices.size(), 3u);
+	TEST_EQUAL(lwPolyline->mVertices[1].mBulge, 0.5);
+	TEST_EQUAL(lwPolyline->mFlags, Dxf::plfClosedPolyline);
+
+	// Parallel binary output must be identical, too:
+	options.mNumThreads = 3;
+	std::string parallel;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(parallel), options);
+	TEST_TRUE(parallel == binary);
+}
+
+
+
+
+
+static void testRawRoundTrip()
+{
+	fmt::print("Testing round trip of the unsupported entities and sections...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n"
+		"0\nLAYER\n2\nLayer1\n62\n7\n"
+		"0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nHATCH\n8\nLayer1\n10\n0.5\n70\n1\n2\nFIRST\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nHATCH\n8\nLayer1\n10\n0.25\n70\n1\n2\nSOLID\n"
+		"0\nLINE\n8\nLayer1\n10\n2\n20\n2\n11\n3\n21\n3\n"
+		"0\nENDSEC\n"
+		"0\nSECTION\n2\nOBJECTS\n0\nDICTIONARY\n5\nC\n290\n1\n310\n0A1BFF\n0\nENDSEC\n"
+		"0\nEOF\n";
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	for (auto format: {Dxf::Writer::ofText, Dxf::Writer::ofBinary})
+	{
+		Dxf::Writer::Options options;
+		options.mFormat = format;
+		std::string output;
+		Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(output), options);
+		if (format == Dxf::Writer::ofText)
+		{
+			// The raw entities keep their positions among the parsed ones:
+			auto entities = output.find("ENTITIES");
+			auto first = output.find("FIRST", entities);
+			auto line1 = output.find("\nLINE\r\n", entities);
+			auto solid = output.find("SOLID", entities);
+			auto line2 = output.find("\nLINE\r\n", line1 + 1);
+			TEST_TRUE(first < line1);
+			TEST_TRUE(line1 < solid);
+			TEST_TRUE(solid < line2);
+			TEST_TRUE(line2 != std::string::npos);
+		}
+		auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(output)));
+		const auto & parsedObjects = parsed->layerByName("Layer1")->objects();
+		TEST_EQUAL(parsedObjects.size(), 2u);
+		const auto & positions = parsed->mRawEntityPositions;
+		TEST_EQUAL(positions.size(), 2u);
+		TEST_EQUAL(positions[0].mFirstGroup, 0u);
+		TEST_TRUE(positions[0].mPrecedingEntity == nullptr);
+		TEST_TRUE(positions[1].mPrecedingEntity == parsedObjects[0]);
+		const auto & raw = parsed->mRawEntities;
+		TEST_EQUAL(raw.size(), drawing->mRawEntities.size());
+		for (size_t i = 0; i < raw.size(); ++i)
+		{
+			TEST_EQUAL(raw.groupCode(i), drawing->mRawEntities.groupCode(i));
+			TEST_EQUAL(std::string(raw.value(i)), std::string(drawing->mRawEntities.value(i)));
+		}
+		const auto & objects = parsed->mRawSections.at("OBJECTS");
+		TEST_EQUAL(objects.size(), 4u);
+		TEST_EQUAL(std::string(objects.value(1)), "C");
+		TEST_EQUAL(std::string(objects.value(2)), "1");
+		TEST_EQUAL(std::string(objects.value(3)), "0A1BFF");
+	}
+
+	// The parallel formatting places the raw entities the same way:
+	std::string sequential, parallel;
+	Dxf::Writer::Options options;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(sequential), options);
+	options.mNumThreads = 4;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(parallel), options);
+	TEST_TRUE(sequential == parallel);
+
+	// The raw entities following a removed entity are written after all the parsed ones:
+	drawing->layerByName("Layer1")->removeObjByIndex(0);
+	std::string output;
+	Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(output), options);
+	auto entities = output.find("ENTITIES");
+	TEST_TRUE(output.find("\nLINE\r\n", entities) < output.find("SOLID", entities));
+	TEST_TRUE(output.find("FIRST", entities) < output.find("\nLINE\r\n", entities));
+}
+
+
+
+
+
+/** Tests that the raw INSERTs are written together with the block definitions and tables they depend on. */
+static void testInsertRoundTrip()
+{
+	fmt::print("Testing round trip of an INSERT of an unsupported block...\n");
+
+	static const std::string dxf =
+		"0\nSECTION\n2\nHEADER\n9\n$ACADVER\n1\nAC1015\n9\n$EXTMIN\n10\n-1\n20\n-1\n30\n0\n"
+		"9\n$HANDSEED\n5\n30\n9\n$INSUNITS\n70\n4\n0\nENDSEC\n"
+		"0\nSECTION\n2\nTABLES\n"
+		"0\nTABLE\n2\nLTYPE\n5\n5\n70\n1\n0\nLTYPE\n5\n14\n2\nCONTINUOUS\n70\n0\n0\nENDTAB\n"
+		"0\nTABLE\n2\nLAYER\n0\nLAYER\n2\nLayer1\n62\n7\n0\nENDTAB\n"
+		"0\nTABLE\n2\nSTYLE\n5\n3\n70\n1\n0\nSTYLE\n5\n11\n2\nSTANDARD\n70\n0\n0\nENDTAB\n"
+		"0\nTABLE\n2\nBLOCK_RECORD\n5\n1\n70\n1\n0\nBLOCK_RECORD\n5\n1F\n2\nSYM\n0\nENDTAB\n"
+		"0\nENDSEC\n"
+		"0\nSECTION\n2\nBLOCKS\n"
+		"0\nBLOCK\n5\n20\n8\n0\n2\nSYM\n70\n0\n10\n0\n20\n0\n30\n0\n3\nSYM\n"
+		"0\nLINE\n5\n21\n8\n0\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nENDBLK\n5\n22\n8\n0\n"
+		"0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n8\nLayer1\n10\n0\n20\n0\n11\n1\n21\n1\n"
+		"0\nINSERT\n5\n23\n8\nLayer1\n2\nSYM\n10\n5\n20\n5\n"
+		"0\nENDSEC\n"
+		"0\nSECTION\n2\nOBJECTS\n0\nDICTIONARY\n5\nC\n330\n0\n0\nENDSEC\n"
+		"0\nEOF\n";
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::string(dxf)));
+	TEST_EQUAL(drawing->mRawSections.count("HEADER"), 1u);
+	TEST_EQUAL(drawing->mRawSections.count("TABLES"), 1u);
+	TEST_EQUAL(drawing->mRawSections.count("BLOCKS"), 1u);
+	for (auto format: {Dxf::Writer::ofText, Dxf::Writer::ofBinary})
+	{
+		Dxf::Writer::Options options;
+		options.mFormat = format;
+		std::string output;
+		Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(output), options);
+		if (format == Dxf::Writer::ofText)
+		{
+			// The generated header variables replace the original ones, the rest is kept:
+			TEST_TRUE(output.find("$ACADVER\r\n1\r\nAC1015\r\n") != std::string::npos);
+			TEST_TRUE(output.find("$INSUNITS\r\n70\r\n4\r\n") != std::string::npos);
+			TEST_TRUE(output.find("$EXTMIN") == output.rfind("$EXTMIN"));
+			TEST_TRUE(output.find("$HANDSEED\r\n5\r\n24\r\n") != std::string::npos);
+
+			// The raw LTYPE and STYLE tables replace the generated ones:
+			TEST_TRUE(output.find("LTYPE\r\n5\r\n14\r\n") != std::string::npos);
+			TEST_TRUE(output.find("Solid line") == std::string::npos);
+			TEST_TRUE(output.find("STYLE\r\n5\r\n11\r\n") != std::string::npos);
+			TEST_TRUE(output.find("txt") == std::string::npos);
+		}
+		auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(output)));
+		TEST_EQUAL(parsed->layerByName("Layer1")->objects().size(), 1u);
+
+		// The INSERT and the block definition it references:
+		const auto & raw = parsed->mRawEntities;
+		TEST_EQUAL(raw.size(), drawing->mRawEntities.size());
+		TEST_EQUAL(std::string(raw.value(0)), "INSERT");
+		TEST_EQUAL(std::string(raw.value(3)), "SYM");
+		const auto & blocks = parsed->mRawSections.at("BLOCKS");
+		const auto & origBlocks = drawing->mRawSections.at("BLOCKS");
+		TEST_EQUAL(blocks.size(), origBlocks.size());
+		for (size_t i = 0; i < blocks.size(); ++i)
+		{
+			TEST_EQUAL(blocks.groupCode(i), origBlocks.groupCode(i));
+			TEST_EQUAL(std::string(blocks.value(i)), std::string(origBlocks.value(i)));
+		}
+
+		// The block record, line type and style tables, the LAYER table is not among the raw tables:
+		const auto & tables = parsed->mRawSections.at("TABLES");
+		const auto & origTables = drawing->mRawSections.at("TABLES");
+		TEST_EQUAL(tables.size(), origTables.size());
+		bool hasBlockRecord = false;
+		for (size_t i = 0; i < tables.size(); ++i)
+		{
+			TEST_EQUAL(tables.groupCode(i), origTables.groupCode(i));
+			TEST_EQUAL(std::string(tables.value(i)), std::string(origTables.value(i)));
+			TEST_TRUE(std::string(tables.value(i)) != "LAYER");
+			hasBlockRecord = hasBlockRecord || (std::string(tables.value(i)) == "BLOCK_RECORD");
+		}
+		TEST_TRUE(hasBlockRecord);
+
+		// The header keeps only the variables that are not generated:
+		const auto & header = parsed->mRawSections.at("HEADER");
+		size_t numExtMin = 0;
+		for (size_t i = 0; i < header.size(); ++i)
+		{
+			numExtMin += (std::string(header.value(i)) == "$EXTMIN") ? 1 : 0;
+		}
+		TEST_EQUAL(numExtMin, 1u);
+		TEST_EQUAL(parsed->mRawSections.at("OBJECTS").size(), 3u);
+	}
+}
+
+
+
+
+
+static void testHandles()
+{
+	fmt::print("Testing writing the entity handles...\n");
+
+	auto drawing = createDrawing();
+	const auto & objects = drawing->layerByName("LAYER_1")->objects();
+	objects[1]->mHandle = 0x2a;
+	objects[1]->mOwnerHandle = 0x1f;
+	objects[2]->mHandle = 0xabc;
+	for (auto format: {Dxf::Writer::ofText, Dxf::Writer::ofBinary})
+	{
+		Dxf::Writer::Options options;
+		options.mFormat = format;
+		std::string output;
+		Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(output), options);
+		if (format == Dxf::Writer::ofText)
+		{
+			TEST_TRUE(output.find("$HANDSEED\r\n5\r\nABD\r\n") != std::string::npos);
+		}
+		auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(output)));
+		const auto & parsedObjects = parsed->layerByName("LAYER_1")->objects();
+		TEST_EQUAL(parsedObjects[1]->mHandle, 0x2au);
+		TEST_EQUAL(parsedObjects[1]->mOwnerHandle, 0x1fu);
+		TEST_EQUAL(parsedObjects[2]->mHandle, 0xabcu);
+		TEST_EQUAL(parsedObjects[0]->mHandle, 0u);
+		TEST_EQUAL(parsed->mHandleIndex.size(), 2u);
+	}
+
+	// The removed entities are skipped, even without compacting the layers first:
+	auto numObjects = drawing->layerByName("LAYER_1")->numObjects();
+	drawing->rebuildHandleIndex();
+	TEST_NOTNULL(drawing->removeByHandle(0xabc));
+	for (auto numThreads: {1u, 4u})
+	{
+		Dxf::Writer::Options options;
+		options.mNumThreads = numThreads;
+		std::string output;
+		Dxf::Writer::write(*drawing, Dxf::Writer::dataSinkToString(output), options);
+		auto parsed = Dxf::Parser::parse(Dxf::Parser::dataSourceFromString(std::move(output)));
+		TEST_EQUAL(parsed->layerByName("LAYER_1")->numObjects(), numObjects - 1);
+		TEST_TRUE(parsed->findByHandle(0xabc) == nullptr);
+		TEST_NOTNULL(parsed->findByHandle(0x2a));
+	}
+}
+
+
+
+
+
 IMPLEMENT_TEST_MAIN("DxfWriterTest",
-	fmt::print("TODO\n");
+	testRoundTrip();
+	testBuffering();
+	testNumberFormatting();
+	testParallel();
+	testBinary();
+	testRawRoundTrip();
+	testInsertRoundTrip();
+	testHandles();
 )
@@ -0,0 +1,206 @@
+// GeometryCleanupTest.cpp
+
+// Tests the cleanupVertices() and cleanupGeometry() functions
+
+#include "GeometryCleanup.hpp"
+#include "TestHelpers.h"
+
+
+
+
+
+static void testVertexCleanup()
+{
+	fmt::print("Testing the vertex cleanup...\n");
+	using namespace Dxf;
+
+	// Duplicates, with the bulge taken over by the remaining vertex:
+	LWPolyline polyline;
+	polyline.addVertex({0, 0});
+	polyline.addVertex({0, 0});
+	polyline.mVertices.back().mBulge = 0.5;
+	polyline.addVertex({1, 0});
+	polyline.addVertex({1, 1e-12});
+	polyline.addVertex({1, 1});
+	auto stats = cleanupVertices(polyline);
+	TEST_EQUAL(stats.mNumDuplicateVertices, 2u);
+	TEST_EQUAL(stats.mNumCollinearVertices, 0u);
+	TEST_EQUAL(polyline.mVertices.size(), 3u);
+	TEST_EQUAL(polyline.mVertices[0].mBulge, 0.5);
+	TEST_TRUE(polyline.mVertices[1].mPos == Coords(1, 0));
+	TEST_TRUE(polyline.mVertices[2].mPos == Coords(1, 1));
+
+	// Collinear vertices along a straight run, a bulged segment and a turn-back are kept:
+	LWPolyline collinear;
+	collinear.addVertex({0, 0});
+	collinear.addVertex({1, 0});
+	collinear.addVertex({2, 0});
+	collinear.addVertex({3, 0});
+	collinear.mVertices.back().mBulge = 1;
+	collinear.addVertex({4, 0});
+	collinear.addVertex({5, 0});
+	collinear.addVertex({4.5, 0});
+	stats = cleanupVertices(collinear);
+	TEST_EQUAL(stats.mNumCollinearVertices, 2u);
+	TEST_EQUAL(collinear.mVertices.size(), 5u);
+	TEST_TRUE(collinear.mVertices[0].mPos == Coords(0, 0));
+	TEST_TRUE(collinear.mVertices[1].mPos == Coords(3, 0));
+	TEST_EQUAL(collinear.mVertices[1].mBulge, 1.0);
+	TEST_TRUE(collinear.mVertices[2].mPos == Coords(4, 0));
+	TEST_TRUE(collinear.mVertices[3].mPos == Coords(5, 0));
+	TEST_TRUE(collinear.mVertices[4].mPos == Coords(4.5, 0));
+
+	// The tolerance applies to the distance from the resulting segment:
+	LWPolyline nearlyStraight;
+	nearlyStraight.addVertex({0, 0});
+	nearlyStraight.addVertex({10, 0.01});
+	nearlyStraight.addVertex({20, 0});
+	CleanupOptions options;
+	options.mTolerance = 0.001;
+	TEST_EQUAL(cleanupVertices(nearlyStraight, options).mNumCollinearVertices, 0u);
+	options.mTolerance = 0.1;
+	TEST_EQUAL(cleanupVertices(nearlyStraight, options).mNumCollinearVertices, 1u);
+	TEST_EQUAL(nearlyStraight.mVertices.size(), 2u);
+
+	// The closing vertex of a closed polyline:
+	LWPolyline closed;
+	closed.mFlags = plfClosedPolyline;
+	closed.addVertex({0, 0});
+	closed.addVertex({1, 0});
+	closed.addVertex({1, 1});
+	closed.addVertex({0, 0});
+	stats = cleanupVertices(closed);
+	TEST_EQUAL(stats.mNumDuplicateVertices, 1u);
+	TEST_EQUAL(closed.mVertices.size(), 3u);
+
+	// Disabled cleanups:
+	LWPolyline untouched;
+	untouched.addVertex({0, 0});
+	untouched.addVertex({0, 0});
+	untouched.addVertex({1, 0});
+	untouched.addVertex({2, 0});
+	options = CleanupOptions();
+	options.mShouldRemoveDuplicateVertices = false;
+	options.mShouldRemoveCollinearVertices = false;
+	stats = cleanupVertices(untouched, options);
+	TEST_EQUAL(stats.mNumDuplicateVertices, 0u);
+	TEST_EQUAL(untouched.mVertices.size(), 4u);
+
+	// Mesh polylines are not simple paths:
+	Polyline mesh;
+	mesh.mFlags = plf3DPolygonMesh;
+	mesh.addVertex({0, 0});
+	mesh.addVertex({0, 0});
+	mesh.addVertex({1, 0});
+	mesh.addVertex({2, 0});
+	stats = cleanupVertices(mesh);
+	TEST_EQUAL(stats.mNumDuplicateVertices, 0u);
+	TEST_EQUAL(mesh.mVertices.size(), 4u);
+}
+
+
+
+
+
+static void testLongPolyline()
+{
+	fmt::print("Testing the vertex cleanup of a long polyline...\n");
+	using namespace Dxf;
+
+	// Every vertex is doubled, the straight runs of 3 vertices are connected by diagonal steps:
+	LWPolyline polyline;
+	static const int NUM_STEPS = 100000;
+	for (int i = 0; i < NUM_STEPS; ++i)
+	{
+		Coords pos(static_cast<Coord>(i), static_cast<Coord>((i / 3) % 2));
+		polyline.addVertex(Coords(pos));
+		polyline.addVertex(std::move(pos));
+	}
+	auto stats = cleanupVertices(polyline);
+	TEST_EQUAL(stats.mNumDuplicateVertices, static_cast<size_t>(NUM_STEPS));
+	TEST_EQUAL(polyline.mVertices.size() + stats.mNumCollinearVertices, static_cast<size_t>(NUM_STEPS));
+	TEST_EQUAL(polyline.mVertices.size(), static_cast<size_t>((NUM_STEPS / 3) * 2 + 1));
+	TEST_TRUE(polyline.mVertices.front().mPos == Coords(0, 0));
+	TEST_EQUAL(polyline.mVertices.back().mPos.mX, static_cast<Coord>(NUM_STEPS - 1));
+}
+
+
+
+
+
+/** Creates a drawing with some degenerate geometry, spread over several layers and a block definition. */
+static std::unique_ptr<Dxf::Drawing> createDrawing()
+{
+	using namespace Dxf;
+	auto res = std::make_unique<Drawing>();
+	for (int i = 0; i < 10; ++i)
+	{
+		auto layer = res->addLayer(fmt::format("LAYER{}", i));
+		layer->addObject(std::make_shared<Line>(Coords(0, 0), Coords(0, 0)));
+		layer->addObject(std::make_shared<Line>(Coords(0, 0), Coords(1, 0)));
+		layer->addObject(std::make_shared<Circle>(Coords(0, 0), 0));
+		layer->addObject(std::make_shared<Circle>(Coords(0, 0), 1));
+		layer->addObject(std::make_shared<Arc>(Coords(0, 0), 1, 10, 10));
+		layer->addObject(std::make_shared<Arc>(Coords(0, 0), 1, 10, 370));
+		auto degenerate = std::make_shared<LWPolyline>();
+		degenerate->addVertex({5, 5});
+		degenerate->addVertex({5, 5});
+		layer->addObject(degenerate);
+		auto polyline = std::make_shared<LWPolyline>();
+		for (int v = 0; v < 100; ++v)
+		{
+			polyline->addVertex({static_cast<Coord>(v / 2), static_cast<Coord>(i)});
+		}
+		layer->addObject(polyline);
+	}
+	auto bd = std::make_shared<BlockDefinition>("BLOCK");
+	bd->mObjects.push_back(std::make_shared<Line>(Coords(1, 1), Coords(1, 1)));
+	bd->mObjects.push_back(std::make_shared<Line>(Coords(1, 1), Coords(2, 1)));
+	res->mBlockDefinitions["BLOCK"] = bd;
+	return res;
+}
+
+
+
+
+
+static void testDrawingCleanup()
+{
+	fmt::print("Testing the drawing cleanup...\n");
+	using namespace Dxf;
+
+	for (unsigned numThreads: {1u, 4u, 0u})
+	{
+		auto drawing = createDrawing();
+		CleanupOptions options;
+		options.mNumThreads = numThreads;
+		auto stats = cleanupGeometry(*drawing, options);
+		TEST_EQUAL(stats.mNumZeroLengthLines, 11u);
+		TEST_EQUAL(stats.mNumDegenerateArcs, 20u);
+		TEST_EQUAL(stats.mNumDegeneratePolylines, 10u);
+		TEST_EQUAL(stats.mNumDuplicateVertices, 10u * 51u);
+		TEST_EQUAL(stats.mNumCollinearVertices, 10u * 48u);
+		for (const auto & layer: drawing->layers())
+		{
+			const auto & objects = layer->objects();
+			TEST_EQUAL(objects.size(), 4u);
+			TEST_TRUE(objects[0]->mObjectType == otLine);
+			TEST_TRUE(objects[1]->mObjectType == otCircle);
+			TEST_TRUE(objects[2]->mObjectType == otArc);
+			TEST_TRUE(objects[3]->mObjectType == otLWPolyline);
+			TEST_EQUAL(static_cast<const LWPolyline &>(*objects[3]).mVertices.size(), 2u);
+			TEST_EQUAL(layer->extent().maxCoord().mX, 49.0);
+		}
+		TEST_EQUAL(drawing->mBlockDefinitions["BLOCK"]->mObjects.size(), 1u);
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("GeometryCleanupTest",
+	testVertexCleanup();
+	testLongPolyline();
+	testDrawingCleanup();
+)
@@ -0,0 +1,220 @@
+// LevelOfDetailTest.cpp
+
+// Tests the LodPyramid class
+
+#include "LevelOfDetail.hpp"
+#include <cmath>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns the total number of objects in the query result. */
+static size_t countObjects(const std::vector<Dxf::LodLayerObjects> & aResult)
+{
+	size_t res = 0;
+	for (const auto & layerObjects: aResult)
+	{
+		res += layerObjects.mObjects.size();
+	}
+	return res;
+}
+
+
+
+
+
+/** Creates a drawing with two layers:
+"SMALL" contains a 100 x 100 grid of lines 0.1 units long, spaced 1 unit apart, plus small and large texts;
+"CONTOURS" contains 10 long wavy polylines, each 200 units long, and a block insert. */
+static std::shared_ptr<Dxf::Drawing> createDrawing()
+{
+	using namespace Dxf;
+	auto res = std::make_shared<Drawing>();
+	auto small = res->addLayer("SMALL");
+	for (int y = 0; y < 100; ++y)
+	{
+		for (int x = 0; x < 100; ++x)
+		{
+			small->addObject(std::make_shared<Line>(
+				Coords(static_cast<Coord>(x), static_cast<Coord>(y)),
+				Coords(static_cast<Coord>(x) + 0.1, static_cast<Coord>(y))
+			));
+		}
+	}
+	small->addObject(std::make_shared<Text>(Coords(50, 50), "small", 0.5));
+	small->addObject(std::make_shared<Text>(Coords(50, 60), "large", 20));
+	small->addObject(std::make_shared<Point>(Coords(70, 70)));
+
+	auto contours = res->addLayer("CONTOURS");
+	for (int i = 0; i < 10; ++i)
+	{
+		auto polyline = std::make_shared<LWPolyline>();
+		for (int v = 0; v <= 2000; ++v)
+		{
+			auto x = static_cast<Coord>(v) / 10;
+			polyline->addVertex({x, std::sin(x / 10) * 10 + static_cast<Coord>(i) * 50});
+		}
+		contours->addObject(polyline);
+	}
+	auto bd = std::make_shared<BlockDefinition>("SYMBOL");
+	bd->mObjects.push_back(std::make_shared<Line>(Coords(0, 0), Coords(30, 30)));
+	res->mBlockDefinitions["SYMBOL"] = bd;
+	contours->addObject(std::make_shared<Block>(Coords(500, 500), std::shared_ptr<BlockDefinition>(bd), 0, 1));
+	return res;
+}
+
+
+
+
+
+static void testLevels()
+{
+	fmt::print("Testing the LOD pyramid levels...\n");
+	using namespace Dxf;
+
+	auto drawing = createDrawing();
+	LodOptions options;
+	options.mPixelSizes = {1, 0.01, 0.1};
+	LodPyramid pyramid(drawing, options);
+	TEST_EQUAL(pyramid.numLevels(), 3u);
+	TEST_EQUAL(pyramid.levelPixelSize(0), 0.01);
+	TEST_EQUAL(pyramid.levelPixelSize(2), 1.0);
+	TEST_EQUAL(pyramid.levelForPixelSize(0.001), 0u);
+	TEST_EQUAL(pyramid.levelForPixelSize(0.01), 0u);
+	TEST_EQUAL(pyramid.levelForPixelSize(0.5), 1u);
+	TEST_EQUAL(pyramid.levelForPixelSize(100), 2u);
+	pyramid.wait();
+	TEST_TRUE(pyramid.isReady());
+	TEST_TRUE(pyramid.isLevelReady(0));
+	TEST_TRUE(pyramid.isLevelReady(2));
+
+	// The finest level contains everything, the contours simplified:
+	Extent everything(Coords(-1000, -1000), Coords(2000, 2000));
+	auto finest = pyramid.query(0, everything);
+	TEST_EQUAL(finest.size(), 2u);
+	TEST_TRUE(finest[0].mLayer == drawing->layerByName("SMALL").get());
+	TEST_EQUAL(finest[0].mObjects.size(), 10003u);
+	TEST_EQUAL(finest[1].mObjects.size(), 11u);
+	const auto & fineContour = static_cast<const MultiVertex &>(*finest[1].mObjects[0]);
+	TEST_TRUE(fineContour.mVertices.size() < 2001);
+
+	// The coarsest level drops the small lines, boxes the small text, keeps the point:
+	auto coarsest = pyramid.query(2, everything);
+	TEST_EQUAL(coarsest.size(), 2u);
+	TEST_EQUAL(coarsest[0].mObjects.size(), 3u);
+	TEST_TRUE(coarsest[0].mObjects[0]->mObjectType == otPolygon);
+	TEST_TRUE(coarsest[0].mObjects[1]->mObjectType == otText);
+	TEST_TRUE(coarsest[0].mObjects[2]->mObjectType == otPoint);
+	const auto & coarseContour = static_cast<const MultiVertex &>(*coarsest[1].mObjects[0]);
+	TEST_TRUE(coarseContour.mVertices.size() < fineContour.mVertices.size());
+	TEST_TRUE(coarsest[1].mObjects[10]->mObjectType == otBlock);
+
+	// The original drawing isn't touched:
+	const auto & origContour = static_cast<const MultiVertex &>(*drawing->layerByName("CONTOURS")->objects()[0]);
+	TEST_EQUAL(origContour.mVertices.size(), 2001u);
+}
+
+
+
+
+
+static void testWindowQuery()
+{
+	fmt::print("Testing the LOD pyramid window queries...\n");
+	using namespace Dxf;
+
+	auto drawing = createDrawing();
+	LodOptions options;
+	options.mPixelSizes = {0.01};
+	options.mCellSize = 100;  // 1 unit cells, so that the contours span many cells
+	LodPyramid pyramid(drawing, options);
+	pyramid.wait();
+
+	// A window containing 10 x 8 small lines:
+	auto res = pyramid.query(0, Extent(Coords(9.5, 20.5), Coords(19.05, 28.5)));
+	TEST_EQUAL(res.size(), 1u);
+	TEST_EQUAL(res[0].mObjects.size(), 80u);
+
+	// A window crossing the first contour, which spans many cells, is reported only once:
+	res = pyramid.queryForPixelSize(0.05, Extent(Coords(100, -20), Coords(180, 5)));
+	TEST_EQUAL(countObjects(res), 1u);
+
+	// The block insert is found by its flattened extent:
+	res = pyramid.query(0, Extent(Coords(520, 520), Coords(521, 521)));
+	TEST_EQUAL(countObjects(res), 1u);
+	TEST_TRUE(res[0].mObjects[0]->mObjectType == otBlock);
+
+	// A sparse layer, whose grid is coarser than the cell size, still answers the small windows exactly:
+	auto sparseDrawing = std::make_shared<Drawing>();
+	auto sparse = sparseDrawing->addLayer("SPARSE");
+	sparse->addObject(std::make_shared<Point>(Coords(-1e6, -1e6)));
+	sparse->addObject(std::make_shared<Point>(Coords(1e6, 1e6)));
+	sparse->addObject(std::make_shared<Line>(Coords(1e6 - 1, 1e6 - 3), Coords(1e6 + 1, 1e6 - 3)));
+	LodPyramid sparsePyramid(sparseDrawing, options);
+	sparsePyramid.wait();
+	res = sparsePyramid.query(0, Extent(Coords(1e6 - 0.5, 1e6 - 0.5), Coords(1e6 + 0.5, 1e6 + 0.5)));
+	TEST_EQUAL(countObjects(res), 1u);
+	TEST_TRUE(res[0].mObjects[0]->mObjectType == otPoint);
+	res = sparsePyramid.query(0, Extent(Coords(-1e6 - 1, -1e6 - 1), Coords(-1e6 + 1, -1e6 + 1)));
+	TEST_EQUAL(countObjects(res), 1u);
+	TEST_EQUAL(countObjects(sparsePyramid.query(0, Extent(Coords(-1e6 + 1, -1e6 + 1), Coords(1e6 - 2, 1e6 - 4)))), 0u);
+
+	// Empty windows:
+	TEST_EQUAL(pyramid.query(0, Extent(Coords(5000, 5000), Coords(6000, 6000))).size(), 0u);
+	TEST_EQUAL(pyramid.query(0, Extent()).size(), 0u);
+	TEST_THROWS(pyramid.query(1, Extent()), std::out_of_range);
+}
+
+
+
+
+
+static void testBackgroundBuilding()
+{
+	fmt::print("Testing the LOD pyramid background building...\n");
+	using namespace Dxf;
+
+	// Queries work while building, falling back to whatever is available (possibly a coarser level),
+	// and destroying mid-build stops the building:
+	Extent window(Coords(9.5, 20.5), Coords(19.05, 28.5));
+	for (int i = 0; i < 3; ++i)
+	{
+		auto drawing = createDrawing();
+		LodOptions options;
+		options.mPixelSizes = {0.001, 0.01, 0.1, 1, 10};
+		options.mNumThreads = 2;
+		LodPyramid pyramid(drawing, options);
+		TEST_TRUE(countObjects(pyramid.query(0, window)) <= 80);
+		if (i == 0)
+		{
+			pyramid.wait();
+			TEST_EQUAL(countObjects(pyramid.query(0, window)), 80u);
+			TEST_EQUAL(countObjects(pyramid.query(4, window)), 0u);
+		}
+	}
+
+	// An error in the building is reported by wait():
+	auto drawing = createDrawing();
+	auto recursive = std::make_shared<BlockDefinition>("RECURSIVE");
+	recursive->mObjects.push_back(std::make_shared<Block>(Coords(1, 1), std::shared_ptr<BlockDefinition>(recursive), 0, 1));
+	drawing->mBlockDefinitions["RECURSIVE"] = recursive;
+	drawing->layerByName("SMALL")->addObject(std::make_shared<Block>(Coords(0, 0), std::shared_ptr<BlockDefinition>(recursive), 0, 1));
+	LodOptions options;
+	options.mPixelSizes = {1};
+	LodPyramid pyramid(drawing, options);
+	TEST_THROWS(pyramid.wait(), BlockFlattener::RecursiveBlockDefinition);
+	TEST_TRUE(pyramid.isReady());
+	recursive->mObjects.clear();  // Break the reference cycle
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("LevelOfDetailTest",
+	testLevels();
+	testWindowQuery();
+	testBackgroundBuilding();
+)
@@ -74,9 +74,30 @@ static void testMixedCrLf()
 
 
 
+static void testReusedBuffer()
+{
+	fmt::print("Testing reading lines into a reused string...\n");
+
+	auto dataSource = Dxf::Parser::dataSourceFromString("A rather long layer name, longer than SSO\r\nShort\n");
+	Dxf::Parser::LineExtractor le(std::move(dataSource));
+	std::string line;
+	le.getNextLine(line);
+	TEST_EQUAL(line, "A rather long layer name, longer than SSO");
+	auto data = line.data();
+	le.getNextLine(line);
+	TEST_EQUAL(line, "Short");
+	TEST_TRUE(line.data() == data);  // No reallocation
+	TEST_THROWS(le.getNextLine(line), Dxf::Parser::Error);
+}
+
+
+
+
+
 IMPLEMENT_TEST_MAIN("LineExtractorTest",
 	testEmpty();
 	testSingleLfLine();
 	testSingleCrLfLine();
 	testMixedCrLf();
+	testReusedBuffer();
 )
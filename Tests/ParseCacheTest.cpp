@@ -0,0 +1,188 @@
+// ParseCacheTest.cpp
+
+// Tests the ParseCache class
+
+#include "ParseCache.hpp"
+#include "DxfParser.hpp"
+#include "DxfWriter.hpp"
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns the DXF data of a simple drawing with a single line of the specified length. */
+static std::string createDxf(double aLineLength)
+{
+	Dxf::Drawing drawing;
+	auto layer = drawing.addLayer("LAYER");
+	layer->addObject(std::make_shared<Dxf::Line>(Dxf::Coords(0, 0), Dxf::Coords(aLineLength, 0)));
+	std::string res;
+	Dxf::Writer::write(drawing, Dxf::Writer::dataSinkToString(res));
+	return res;
+}
+
+
+
+
+
+/** Parses the specified data using the cache. */
+static std::shared_ptr<const Dxf::Drawing> parse(Dxf::Parser::ParseCache & aCache, const std::string & aDxf)
+{
+	return aCache.parse(Dxf::Parser::dataSourceFromString(std::string(aDxf)));
+}
+
+
+
+
+
+static void testMemoryCache()
+{
+	fmt::print("Testing the in-memory cache...\n");
+
+	Dxf::Parser::ParseCache cache(2);
+	auto dxf1 = createDxf(1);
+	auto dxf2 = createDxf(2);
+	auto dxf3 = createDxf(3);
+	auto drawing1 = parse(cache, dxf1);
+	TEST_NOTNULL(drawing1);
+	TEST_EQUAL(drawing1->layers().size(), 1u);
+	TEST_TRUE(parse(cache, dxf1) == drawing1);
+	auto drawing2 = parse(cache, dxf2);
+	TEST_TRUE(drawing2 != drawing1);
+	TEST_EQUAL(cache.size(), 2u);
+
+	// Use drawing1, so that drawing2 is the least recently used, then push it out by drawing3:
+	TEST_TRUE(parse(cache, dxf1) == drawing1);
+	parse(cache, dxf3);
+	TEST_EQUAL(cache.size(), 2u);
+	TEST_TRUE(parse(cache, dxf1) == drawing1);
+	TEST_TRUE(parse(cache, dxf2) != drawing2);
+
+	auto stats = cache.stats();
+	TEST_EQUAL(stats.mNumHits, 3u);
+	TEST_EQUAL(stats.mNumMisses, 4u);
+	TEST_EQUAL(stats.mNumDiskHits, 0u);
+
+	// Errors are not cached:
+	TEST_THROWS(parse(cache, "0\r\nSECTION\r\n"), Dxf::Parser::Error);
+	TEST_THROWS(parse(cache, "0\r\nSECTION\r\n"), Dxf::Parser::Error);
+
+	cache.clear();
+	TEST_EQUAL(cache.size(), 0u);
+}
+
+
+
+
+
+static void testConcurrent()
+{
+	fmt::print("Testing concurrent parsing of the same data...\n");
+
+	Dxf::Parser::ParseCache cache(4);
+	auto dxf = createDxf(1);
+	std::shared_ptr<const Dxf::Drawing> results[4];
+	std::vector<std::thread> threads;
+	for (auto & res: results)
+	{
+		threads.emplace_back([&]()
+		{
+			res = parse(cache, dxf);
+		});
+	}
+	for (auto & th: threads)
+	{
+		th.join();
+	}
+	for (const auto & res: results)
+	{
+		TEST_TRUE(res == results[0]);
+	}
+	TEST_EQUAL(cache.size(), 1u);
+}
+
+
+
+
+
+static void testDiskCache()
+{
+	fmt::print("Testing the disk cache...\n");
+
+	const std::string folder = "ParseCacheTest.cache";
+	std::filesystem::remove_all(folder);
+	std::filesystem::create_directory(folder);
+	auto dxf = createDxf(5);
+
+	// The first cache parses and stores the snapshot:
+	{
+		Dxf::Parser::ParseCache cache(1, folder);
+		parse(cache, dxf);
+		TEST_EQUAL(cache.stats().mNumMisses, 1u);
+	}
+
+	// The second cache (simulating a process restart) loads the snapshot:
+	{
+		Dxf::Parser::ParseCache cache(1, folder);
+		auto drawing = parse(cache, dxf);
+		TEST_EQUAL(cache.stats().mNumDiskHits, 1u);
+		TEST_EQUAL(cache.stats().mNumMisses, 0u);
+		auto line = std::static_pointer_cast<const Dxf::Line>(drawing->layerByName("LAYER")->objects()[0]);
+		TEST_EQUAL(line->mPos2.mX, 5);
+	}
+
+	// The extended data and the raw data survive the snapshot:
+	static const std::string xdataDxf =
+		"0\nSECTION\n2\nTABLES\n0\nTABLE\n2\nLAYER\n0\nLAYER\n2\nLAYER\n62\n7\n0\nENDTAB\n0\nENDSEC\n"
+		"0\nSECTION\n2\nENTITIES\n"
+		"0\nLINE\n8\nLAYER\n10\n0\n20\n0\n11\n1\n21\n1\n1001\nMYAPP\n1000\nID-1234\n"
+		"0\nHATCH\n8\nLAYER\n2\nSOLID\n"
+		"0\nENDSEC\n"
+		"0\nSECTION\n2\nOBJECTS\n0\nDICTIONARY\n5\nC\n0\nENDSEC\n"
+		"0\nEOF\n";
+	for (size_t i = 0; i < 2; ++i)
+	{
+		Dxf::Parser::ParseCache cache(1, folder);
+		auto drawing = parse(cache, xdataDxf);
+		TEST_EQUAL(cache.stats().mNumDiskHits, i);
+		const auto & xdata = drawing->layerByName("LAYER")->objects()[0]->mExtendedData;
+		TEST_NOTNULL(xdata);
+		TEST_EQUAL(xdata->size(), 2u);
+		TEST_EQUAL(xdata->groupCode(1), 1000);
+		TEST_EQUAL(std::string(xdata->value(1)), "ID-1234");
+		TEST_EQUAL(drawing->mRawEntities.size(), 3u);
+		TEST_EQUAL(std::string(drawing->mRawEntities.value(2)), "SOLID");
+		TEST_EQUAL(drawing->mRawEntityPositions.size(), 1u);
+		TEST_TRUE(drawing->mRawEntityPositions[0].mPrecedingEntity == drawing->layerByName("LAYER")->objects()[0]);
+		TEST_EQUAL(drawing->mRawSections.at("OBJECTS").size(), 2u);
+	}
+
+	// A damaged snapshot is ignored:
+	for (const auto & entry: std::filesystem::directory_iterator(folder))
+	{
+		std::ofstream f(entry.path(), std::ios::binary | std::ios::trunc);
+		f << "garbage";
+	}
+	{
+		Dxf::Parser::ParseCache cache(1, folder);
+		auto drawing = parse(cache, dxf);
+		TEST_EQUAL(cache.stats().mNumMisses, 1u);
+		TEST_EQUAL(drawing->layers().size(), 1u);
+	}
+
+	std::filesystem::remove_all(folder);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ParseCacheTest",
+	testMemoryCache();
+	testConcurrent();
+	testDiskCache();
+)
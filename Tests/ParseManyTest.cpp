@@ -0,0 +1,133 @@
+// ParseManyTest.cpp
+
+// Tests the parseMany() function
+
+#include "ParseMany.hpp"
+#include "DxfWriter.hpp"
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include "TestHelpers.h"
+
+
+
+
+
+static const std::string FOLDER = "ParseManyTest.files";
+
+
+
+
+
+/** Writes the specified number of files, each with a single line of length equal to the file's index,
+on a layer named by the index. Returns the file names. */
+static std::vector<std::string> writeFiles(size_t aNumFiles)
+{
+	std::filesystem::remove_all(FOLDER);
+	std::filesystem::create_directory(FOLDER);
+	std::vector<std::string> res;
+	for (size_t i = 0; i < aNumFiles; ++i)
+	{
+		Dxf::Drawing drawing;
+		auto layer = drawing.addLayer(fmt::format("LAYER{}", i));
+		layer->addObject(std::make_shared<Dxf::Line>(Dxf::Coords(0, 0), Dxf::Coords(static_cast<double>(i), 0)));
+		auto fileName = fmt::format("{}/{}.dxf", FOLDER, i);
+		std::ofstream f(fileName, std::ios::binary);
+		Dxf::Writer::write(drawing, Dxf::Writer::dataSinkFromStdStream(f));
+		res.push_back(fileName);
+	}
+	return res;
+}
+
+
+
+
+
+static void testParseMany()
+{
+	fmt::print("Testing parsing many files...\n");
+
+	auto fileNames = writeFiles(50);
+	fileNames.push_back(FOLDER + "/nonexistent.dxf");
+	{
+		std::ofstream f(FOLDER + "/invalid.dxf", std::ios::binary);
+		f << "0\nSECTION\n2\nENTITIES\nnot-a-number\nLINE\n";
+	}
+	fileNames.push_back(FOLDER + "/invalid.dxf");
+
+	std::vector<int> numDelivered(fileNames.size());
+	Dxf::Parser::parseMany(fileNames, 4, [&](Dxf::Parser::BatchResult && aResult)
+		{
+			TEST_TRUE(aResult.mIndex < fileNames.size());
+			TEST_EQUAL(aResult.mFileName, fileNames[aResult.mIndex]);
+			numDelivered[aResult.mIndex] += 1;
+			if (aResult.mIndex >= 50)
+			{
+				TEST_TRUE(aResult.mError != nullptr);
+				TEST_TRUE(aResult.mDrawing == nullptr);
+				return;
+			}
+			TEST_TRUE(aResult.mError == nullptr);
+			auto layer = aResult.mDrawing->layerByName(fmt::format("LAYER{}", aResult.mIndex));
+			TEST_NOTNULL(layer);
+			auto line = std::static_pointer_cast<Dxf::Line>(layer->objects().at(0));
+			TEST_EQUAL(line->mPos2.mX, static_cast<double>(aResult.mIndex));
+		}
+	);
+	for (auto n: numDelivered)
+	{
+		TEST_EQUAL(n, 1);
+	}
+	TEST_THROWS(Dxf::Parser::dataSourceFromFile(FOLDER + "/nonexistent.dxf"), std::runtime_error);
+}
+
+
+
+
+
+static void testLayerLists()
+{
+	fmt::print("Testing parsing layer lists of many files, with a tight in-flight limit...\n");
+
+	auto fileNames = writeFiles(20);
+	Dxf::Parser::BatchOptions options;
+	options.mLayerListOnly = true;
+	options.mMaxInFlightBytes = 1;  // Only a single file in flight at any time
+	size_t numDelivered = 0;
+	Dxf::Parser::parseMany(fileNames, 3, [&](Dxf::Parser::BatchResult && aResult)
+		{
+			TEST_TRUE(aResult.mError == nullptr);
+			TEST_TRUE(aResult.mDrawing == nullptr);
+			TEST_EQUAL(aResult.mLayerNames.size(), 1u);
+			TEST_EQUAL(aResult.mLayerNames[0], fmt::format("LAYER{}", aResult.mIndex));
+			numDelivered += 1;
+		},
+		options
+	);
+	TEST_EQUAL(numDelivered, fileNames.size());
+
+	// An exception from the callback stops the batch and is rethrown:
+	numDelivered = 0;
+	TEST_THROWS(
+		Dxf::Parser::parseMany(fileNames, 3, [&](Dxf::Parser::BatchResult &&)
+			{
+				numDelivered += 1;
+				throw std::runtime_error("Stop");
+			},
+			options
+		),
+		std::runtime_error
+	);
+	TEST_TRUE(numDelivered == 1);
+
+	std::filesystem::remove_all(FOLDER);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("ParseManyTest",
+	testParseMany();
+	testLayerLists();
+)
@@ -0,0 +1,132 @@
+// PushParserTest.cpp
+
+// Tests the PushParser class
+
+#include "PushParser.hpp"
+#include "DxfWriter.hpp"
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns the DXF data of a drawing with the specified number of lines, followed by a single polyline. */
+static std::string createDxf(int aNumLines)
+{
+	Dxf::Drawing drawing;
+	auto layer = drawing.addLayer("LAYER");
+	for (int i = 0; i < aNumLines; ++i)
+	{
+		layer->addObject(std::make_shared<Dxf::Line>(Dxf::Coords(i, 0), Dxf::Coords(i, 1)));
+	}
+	auto polyline = std::make_shared<Dxf::Polyline>();
+	polyline->addVertex({0, 0});
+	polyline->addVertex({1, 0});
+	polyline->addVertex({1, 1});
+	layer->addObject(polyline);
+	std::string res;
+	Dxf::Writer::write(drawing, Dxf::Writer::dataSinkToString(res));
+	return res;
+}
+
+
+
+
+
+static void testChunks()
+{
+	fmt::print("Testing parsing of data in chunks of various sizes...\n");
+
+	auto dxf = createDxf(100);
+	for (size_t chunkSize: {1, 7, 100, 100000})
+	{
+		Dxf::Parser::PushParser parser;
+		for (size_t pos = 0; pos < dxf.size(); pos += chunkSize)
+		{
+			parser.feed(dxf.data() + pos, std::min(chunkSize, dxf.size() - pos));
+		}
+		auto drawing = parser.finish();
+		TEST_NOTNULL(drawing);
+		const auto & objects = drawing->layerByName("LAYER")->objects();
+		TEST_EQUAL(objects.size(), 101u);
+		TEST_EQUAL(objects[100]->mObjectType, Dxf::otPolyline);
+		TEST_EQUAL(std::static_pointer_cast<Dxf::Polyline>(objects[100])->mVertices.size(), 3u);
+	}
+}
+
+
+
+
+
+static void testEntityEmission()
+{
+	fmt::print("Testing emitting the entities while the data is being fed...\n");
+
+	auto dxf = createDxf(100);
+	std::vector<Dxf::PrimitivePtr> emitted;
+	Dxf::Parser::Options options;
+	options.mEntityCallback = [&emitted](const std::shared_ptr<Dxf::Layer> & aLayer, const Dxf::PrimitivePtr & aEntity)
+	{
+		TEST_EQUAL(aLayer->name(), "LAYER");
+		emitted.push_back(aEntity);
+	};
+	Dxf::Parser::PushParser parser(options);
+
+	// Feed the first half of the data, some of the lines should already be emitted:
+	auto half = dxf.size() / 2;
+	parser.feed(dxf.data(), half);
+	TEST_TRUE(emitted.size() > 10);
+	TEST_TRUE(emitted.size() < 100);
+
+	// Feed the rest, the polyline is emitted complete:
+	parser.feed(dxf.data() + half, dxf.size() - half);
+	auto drawing = parser.finish();
+	TEST_EQUAL(emitted.size(), 101u);
+	TEST_TRUE(emitted == drawing->layerByName("LAYER")->objects());
+	TEST_EQUAL(std::static_pointer_cast<Dxf::Polyline>(emitted.back())->mVertices.size(), 3u);
+}
+
+
+
+
+
+static void testErrors()
+{
+	fmt::print("Testing errors and abandoned parsing...\n");
+
+	// Invalid data is reported by feed():
+	{
+		Dxf::Parser::PushParser parser;
+		static const std::string invalid = "0\nSECTION\n2\nENTITIES\nnot-a-number\nLINE\n";
+		TEST_THROWS(parser.feed(invalid.data(), invalid.size()), Dxf::Parser::Error);
+		TEST_THROWS(parser.finish(), Dxf::Parser::Error);
+	}
+
+	// Incomplete data is reported by finish():
+	{
+		Dxf::Parser::PushParser parser;
+		auto dxf = createDxf(10);
+		parser.feed(dxf.data(), dxf.size() / 2);
+		TEST_THROWS(parser.finish(), Dxf::Parser::Error);
+	}
+
+	// Abandoning the parser in the middle doesn't block:
+	{
+		Dxf::Parser::PushParser parser;
+		auto dxf = createDxf(10);
+		parser.feed(dxf.data(), dxf.size() / 2);
+	}
+	{
+		Dxf::Parser::PushParser parser;
+	}
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("PushParserTest",
+	testChunks();
+	testEntityEmission();
+	testErrors();
+)
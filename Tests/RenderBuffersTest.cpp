@@ -0,0 +1,292 @@
+// RenderBuffersTest.cpp
+
+// Tests the export of drawings into flat render buffers
+
+#include "RenderBuffers.hpp"
+#include <cmath>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns the color that the render buffers use for the specified color index. */
+static uint32_t renderColor(size_t aColorIndex)
+{
+	return 0xff000000 | Dxf::gColors[aColorIndex];
+}
+
+
+
+
+
+/** Returns true if the vertex is at the specified position, with the specified color index. */
+static bool isVertex(const Dxf::RenderVertex & aVertex, float aX, float aY, size_t aColorIndex)
+{
+	return ((aVertex.mX == aX) && (aVertex.mY == aY) && (aVertex.mZ == 0) && (aVertex.mColor == renderColor(aColorIndex)));
+}
+
+
+
+
+
+/** Returns true if the two batches have the same contents. */
+static bool isSameBatch(const Dxf::RenderBatch & aBatch1, const Dxf::RenderBatch & aBatch2)
+{
+	if ((aBatch1.mVertices.size() != aBatch2.mVertices.size()) || (aBatch1.mIndices != aBatch2.mIndices))
+	{
+		return false;
+	}
+	for (size_t i = 0; i < aBatch1.mVertices.size(); ++i)
+	{
+		const auto & v1 = aBatch1.mVertices[i];
+		const auto & v2 = aBatch2.mVertices[i];
+		if ((v1.mX != v2.mX) || (v1.mY != v2.mY) || (v1.mZ != v2.mZ) || (v1.mColor != v2.mColor))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+
+/** Creates a drawing with the specified number of layers, each with circles, bulged polylines, solids and points. */
+static std::shared_ptr<Dxf::Drawing> createLargeDrawing(int aNumLayers)
+{
+	using namespace Dxf;
+	auto res = std::make_shared<Drawing>();
+	for (int l = 0; l < aNumLayers; ++l)
+	{
+		auto layer = res->addLayer(fmt::format("LAYER{}", l));
+		layer->setDefaultColor(l % 255 + 1);
+		for (int i = 0; i < 200 * (l + 1); ++i)
+		{
+			auto pos = static_cast<Coord>(i);
+			layer->addObject(std::make_shared<Circle>(Coords(pos, 0), 1 + pos / 100));
+			auto polyline = std::make_shared<LWPolyline>(i % 256);
+			polyline->addVertex({pos, 10});
+			polyline->mVertices.back().mBulge = 0.5;
+			polyline->addVertex({pos + 1, 10});
+			polyline->addVertex({pos + 1, 11});
+			layer->addObject(polyline);
+			layer->addObject(std::make_shared<Solid>(Coords(pos, 20), Coords(pos + 1, 20), Coords(pos, 21)));
+			layer->addObject(std::make_shared<Point>(Coords(pos, 30)));
+		}
+	}
+	return res;
+}
+
+
+
+
+
+static void testObjects()
+{
+	fmt::print("Testing the export of the individual objects...\n");
+	using namespace Dxf;
+
+	Drawing drawing;
+	auto layerA = drawing.addLayer("A");
+	layerA->setDefaultColor(1);
+	layerA->addObject(std::make_shared<Line>(Coords(0, 0), Coords(1, 0)));
+	layerA->addObject(std::make_shared<Line>(Coords(0, 1), Coords(1, 1), 3));
+	layerA->addObject(std::make_shared<Point>(Coords(5, 5)));
+	layerA->objects().back()->mColor = 200;
+	layerA->addObject(std::make_shared<Solid>(Coords(0, 0), Coords(1, 0), Coords(0, 1), Coords(1, 1)));
+	layerA->addObject(std::make_shared<Solid>(Coords(2, 0), Coords(3, 0), Coords(2, 1)));
+	layerA->addObject(std::make_shared<Text>(Coords(0, 0), "skipped", 1));
+	layerA->addObject(std::make_shared<Line>(Coords(0, 2), Coords(1, 2), COLOR_BYBLOCK));
+
+	// A layer without a color, with a block insert:
+	auto layerB = drawing.addLayer("B");
+	layerB->addObject(std::make_shared<Line>(Coords(0, 3), Coords(1, 3)));
+	auto bd = std::make_shared<BlockDefinition>("SYMBOL");
+	bd->mObjects.push_back(std::make_shared<Line>(Coords(0, 0), Coords(1, 0), COLOR_BYBLOCK));
+	bd->mObjects.push_back(std::make_shared<Point>(Coords(0.5, 0.5)));
+	drawing.mBlockDefinitions["SYMBOL"] = bd;
+	auto block = std::make_shared<Block>(Coords(10, 20), std::shared_ptr<BlockDefinition>(bd), 0, 1);
+	block->mColor = 5;
+	layerB->addObject(block);
+
+	RenderOptions options;
+	options.mFallbackColor = 7;
+	auto sizes = renderBufferSizes(drawing, options);
+	TEST_EQUAL(sizes.mLines.mNumVertices, 10u);
+	TEST_EQUAL(sizes.mLines.mNumIndices, 10u);
+	TEST_EQUAL(sizes.mTriangles.mNumVertices, 7u);
+	TEST_EQUAL(sizes.mTriangles.mNumIndices, 9u);
+	TEST_EQUAL(sizes.mPoints.mNumVertices, 2u);
+	TEST_EQUAL(sizes.mPoints.mNumIndices, 2u);
+
+	auto buffers = exportRenderBuffers(drawing, options);
+	auto bufferSizes = buffers.sizes();
+	TEST_EQUAL(bufferSizes.mLines.mNumVertices, 10u);
+	TEST_EQUAL(bufferSizes.mTriangles.mNumIndices, 9u);
+
+	// Lines, with the colors resolved through the layer, the block and the fallback:
+	const auto & lines = buffers.mLines;
+	TEST_TRUE(isVertex(lines.mVertices[0], 0, 0, 1));
+	TEST_TRUE(isVertex(lines.mVertices[1], 1, 0, 1));
+	TEST_TRUE(isVertex(lines.mVertices[2], 0, 1, 3));
+	TEST_TRUE(isVertex(lines.mVertices[4], 0, 2, 0));
+	TEST_TRUE(isVertex(lines.mVertices[6], 0, 3, 7));
+	TEST_TRUE(isVertex(lines.mVertices[8], 10, 20, 5));
+	TEST_TRUE(isVertex(lines.mVertices[9], 11, 20, 5));
+	for (uint32_t i = 0; i < 10; ++i)
+	{
+		TEST_EQUAL(lines.mIndices[i], i);
+	}
+
+	// Triangles, the 4-point SOLID's corners in the strip order:
+	const auto & triangles = buffers.mTriangles;
+	TEST_TRUE(isVertex(triangles.mVertices[3], 1, 1, 1));
+	TEST_TRUE(isVertex(triangles.mVertices[4], 2, 0, 1));
+	std::vector<uint32_t> expectedIndices = {0, 1, 2, 1, 3, 2, 4, 5, 6};
+	TEST_TRUE(triangles.mIndices == expectedIndices);
+
+	// Points:
+	TEST_TRUE(isVertex(buffers.mPoints.mVertices[0], 5, 5, 200));
+	TEST_TRUE(isVertex(buffers.mPoints.mVertices[1], 10.5f, 20.5f, 7));
+	TEST_EQUAL(buffers.mPoints.mIndices[1], 1u);
+
+	// The default fallback color is black, the same as the layers without a color display:
+	options.mFallbackColor = 0;
+	buffers = exportRenderBuffers(drawing, options);
+	TEST_TRUE(isVertex(buffers.mLines.mVertices[6], 0, 3, 0));
+	options.mFallbackColor = 1000;
+	TEST_THROWS(exportRenderBuffers(drawing, options), std::invalid_argument);
+}
+
+
+
+
+
+static void testOrigin()
+{
+	fmt::print("Testing the export relative to an origin...\n");
+	using namespace Dxf;
+
+	// Far from the zero, the floats cannot represent the quarters, relative to the origin they can:
+	Drawing drawing;
+	auto layer = drawing.addLayer("FAR");
+	layer->addObject(std::make_shared<Line>(Coords(1e8 + 0.25, 1e8 + 0.5), Coords(1e8 + 1.75, 1e8)));
+	RenderOptions options;
+	options.mOrigin = Coords(1e8, 1e8);
+	auto buffers = exportRenderBuffers(drawing, options);
+	TEST_EQUAL(buffers.mLines.mVertices.size(), 2u);
+	TEST_EQUAL(buffers.mLines.mVertices[0].mX, 0.25f);
+	TEST_EQUAL(buffers.mLines.mVertices[0].mY, 0.5f);
+	TEST_EQUAL(buffers.mLines.mVertices[1].mX, 1.75f);
+}
+
+
+
+
+
+static void testParallel()
+{
+	fmt::print("Testing the parallel export into preallocated memory...\n");
+	using namespace Dxf;
+
+	auto drawing = createLargeDrawing(8);
+	RenderOptions options;
+	options.mNumThreads = 1;
+	auto single = exportRenderBuffers(*drawing, options);
+	TEST_EQUAL(single.mTriangles.mVertices.size(), 3u * 200 * 36);
+	TEST_EQUAL(single.mPoints.mVertices.size(), 200u * 36);
+	TEST_EQUAL(single.mLines.mIndices.size(), 2 * (single.mLines.mVertices.size() - 2 * 200 * 36));  // Two paths per row
+
+	options.mNumThreads = 4;
+	auto parallel = exportRenderBuffers(*drawing, options);
+	TEST_TRUE(isSameBatch(single.mLines, parallel.mLines));
+	TEST_TRUE(isSameBatch(single.mTriangles, parallel.mTriangles));
+	TEST_TRUE(isSameBatch(single.mPoints, parallel.mPoints));
+
+	// The caller's memory is written exactly within the reported sizes:
+	auto sizes = renderBufferSizes(*drawing, options);
+	RenderBuffers preallocated;
+	preallocated.mLines.mVertices.resize(sizes.mLines.mNumVertices + 1, RenderVertex{-1, -1, -1, 0});
+	preallocated.mLines.mIndices.resize(sizes.mLines.mNumIndices + 1, 0xdeadbeef);
+	preallocated.mTriangles.mVertices.resize(sizes.mTriangles.mNumVertices);
+	preallocated.mTriangles.mIndices.resize(sizes.mTriangles.mNumIndices);
+	preallocated.mPoints.mVertices.resize(sizes.mPoints.mNumVertices);
+	preallocated.mPoints.mIndices.resize(sizes.mPoints.mNumIndices);
+	BlockFlattener blockFlattener;
+	options.mBlockFlattener = &blockFlattener;
+	writeRenderBuffers(*drawing, options, preallocated.memory());
+	TEST_EQUAL(preallocated.mLines.mIndices.back(), 0xdeadbeefu);
+	TEST_EQUAL(preallocated.mLines.mVertices.back().mX, -1.0f);
+	preallocated.mLines.mVertices.pop_back();
+	preallocated.mLines.mIndices.pop_back();
+	TEST_TRUE(isSameBatch(single.mLines, preallocated.mLines));
+	TEST_TRUE(isSameBatch(single.mTriangles, preallocated.mTriangles));
+	TEST_TRUE(isSameBatch(single.mPoints, preallocated.mPoints));
+
+	// Missing memory for a non-empty buffer:
+	auto memory = preallocated.memory();
+	memory.mPoints.mIndices = nullptr;
+	TEST_THROWS(writeRenderBuffers(*drawing, options, memory), std::invalid_argument);
+
+	// A buffer shorter than the reported size, nothing is written:
+	preallocated.mLines.mVertices.pop_back();
+	preallocated.mLines.mVertices.push_back(RenderVertex{-1, -1, -1, 0});
+	memory = preallocated.memory();
+	memory.mLines.mVertexCapacity -= 1;
+	TEST_THROWS(writeRenderBuffers(*drawing, options, memory), std::invalid_argument);
+	TEST_EQUAL(preallocated.mLines.mVertices.back().mX, -1.0f);
+	memory = preallocated.memory();
+	memory.mTriangles.mIndexCapacity -= 1;
+	TEST_THROWS(writeRenderBuffers(*drawing, options, memory), std::invalid_argument);
+}
+
+
+
+
+
+static void testQueryResult()
+{
+	fmt::print("Testing the export of a LOD query result...\n");
+	using namespace Dxf;
+
+	auto drawing = createLargeDrawing(2);
+	LodOptions lodOptions;
+	lodOptions.mPixelSizes = {0.001};
+	LodPyramid pyramid(drawing, lodOptions);
+	pyramid.wait();
+
+	// A window containing the solids and points of the first 10 rows, in both layers:
+	auto result = pyramid.query(0, Extent(Coords(-0.5, 19.5), Coords(9.5, 30.5)));
+	TEST_EQUAL(result.size(), 2u);
+	RenderOptions options;
+	auto buffers = exportRenderBuffers(result, options);
+	TEST_EQUAL(buffers.mLines.mVertices.size(), 0u);
+	TEST_EQUAL(buffers.mTriangles.mIndices.size(), 2u * 10 * 3);
+	TEST_EQUAL(buffers.mPoints.mVertices.size(), 2u * 10);
+	TEST_TRUE(isVertex(buffers.mPoints.mVertices[0], 0, 30, 1));
+	TEST_TRUE(isVertex(buffers.mPoints.mVertices[10], 0, 30, 2));
+	TEST_EQUAL(buffers.mPoints.mIndices[19], 19u);
+
+	// Objects without a layer use the fallback color:
+	std::vector<LodLayerObjects> noLayer(1);
+	noLayer[0].mLayer = nullptr;
+	noLayer[0].mObjects.push_back(std::make_shared<Point>(Coords(1, 2)));
+	options.mFallbackColor = 4;
+	buffers = exportRenderBuffers(noLayer, options);
+	TEST_TRUE(isVertex(buffers.mPoints.mVertices[0], 1, 2, 4));
+	auto sizes = renderBufferSizes(noLayer, options);
+	TEST_EQUAL(sizes.mPoints.mNumVertices, 1u);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("RenderBuffersTest",
+	testObjects();
+	testOrigin();
+	testParallel();
+	testQueryResult();
+)
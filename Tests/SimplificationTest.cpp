@@ -0,0 +1,258 @@
+// SimplificationTest.cpp
+
+// Tests the polyline simplification functions
+
+#include "Simplification.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns a long, slightly noisy, wavy open polyline. */
+static std::shared_ptr<Dxf::LWPolyline> createContour(int aNumVertices, Dxf::Coord aOffsetY = 0)
+{
+	auto res = std::make_shared<Dxf::LWPolyline>();
+	for (int i = 0; i < aNumVertices; ++i)
+	{
+		auto x = static_cast<Dxf::Coord>(i) / 10;
+		auto noise = 0.0005 * static_cast<Dxf::Coord>((i * 7919) % 13 - 6);
+		res->addVertex({x, std::sin(x) + noise + aOffsetY});
+	}
+	return res;
+}
+
+
+
+
+
+/** Returns the maximum distance of the original's vertices from the simplified path. */
+static Dxf::Coord maxDeviation(const Dxf::MultiVertex & aOriginal, const Dxf::MultiVertex & aSimplified)
+{
+	Dxf::Coord res = 0;
+	const auto & simplified = aSimplified.mVertices;
+	for (const auto & v: aOriginal.mVertices)
+	{
+		auto minDist = std::numeric_limits<Dxf::Coord>::max();
+		for (size_t i = 0; i + 1 < simplified.size(); ++i)
+		{
+			auto seg = simplified[i + 1].mPos - simplified[i].mPos;
+			auto rel = v.mPos - simplified[i].mPos;
+			auto segLengthSquared = seg.mX * seg.mX + seg.mY * seg.mY;
+			auto t = (segLengthSquared > 0) ? std::clamp((rel.mX * seg.mX + rel.mY * seg.mY) / segLengthSquared, 0.0, 1.0) : 0.0;
+			auto dx = rel.mX - seg.mX * t;
+			auto dy = rel.mY - seg.mY * t;
+			minDist = std::min(minDist, std::sqrt(dx * dx + dy * dy));
+		}
+		res = std::max(res, minDist);
+	}
+	return res;
+}
+
+
+
+
+
+static void testDouglasPeucker()
+{
+	fmt::print("Testing the Douglas-Peucker simplification...\n");
+	using namespace Dxf;
+
+	auto contour = createContour(2000);
+	auto simplified = simplifiedPolyline(*contour, SimplifyOptions(0.01));
+	TEST_EQUAL(contour->mVertices.size(), 2000u);
+	TEST_TRUE(simplified->mObjectType == otLWPolyline);
+	TEST_TRUE(simplified->mVertices.size() < 1000);
+	TEST_TRUE(simplified->mVertices.size() > 2);
+	TEST_TRUE(simplified->mVertices.front().mPos == contour->mVertices.front().mPos);
+	TEST_TRUE(simplified->mVertices.back().mPos == contour->mVertices.back().mPos);
+	TEST_TRUE(maxDeviation(*contour, *simplified) <= 0.01);
+
+	// In place:
+	auto numRemoved = simplifyPolyline(*contour, SimplifyOptions(0.01));
+	TEST_EQUAL(numRemoved + simplified->mVertices.size(), 2000u);
+	TEST_EQUAL(contour->mVertices.size(), simplified->mVertices.size());
+
+	// A straight line collapses to its endpoints:
+	LWPolyline line;
+	for (int i = 0; i < 100; ++i)
+	{
+		line.addVertex({static_cast<Coord>(i), static_cast<Coord>(2 * i)});
+	}
+	TEST_EQUAL(simplifyPolyline(line, SimplifyOptions(1e-9)), 98u);
+	TEST_EQUAL(line.mVertices.size(), 2u);
+
+	// Zero tolerance doesn't remove anything:
+	auto other = createContour(100);
+	TEST_EQUAL(simplifyPolyline(*other, SimplifyOptions(0)), 0u);
+}
+
+
+
+
+
+static void testVisvalingamWhyatt()
+{
+	fmt::print("Testing the Visvalingam-Whyatt simplification...\n");
+	using namespace Dxf;
+
+	// A noisy line with a single spike, the spike survives:
+	LWPolyline spiky;
+	for (int i = 0; i <= 20; ++i)
+	{
+		auto y = (i == 10) ? 5.0 : 0.01 * (i % 2);
+		spiky.addVertex({static_cast<Coord>(i), y});
+	}
+	simplifyPolyline(spiky, SimplifyOptions(0.5, saVisvalingamWhyatt));
+	TEST_TRUE(spiky.mVertices.size() <= 5);
+	TEST_TRUE(std::any_of(spiky.mVertices.begin(), spiky.mVertices.end(), [](const Vertex & aVertex)
+		{
+			return (aVertex.mPos == Coords(10, 5));
+		}
+	));
+
+	// A closed square with midpoints on its edges, the corners are kept:
+	LWPolyline square;
+	square.mFlags = plfClosedPolyline;
+	for (const auto & pt: {Coords(0, 0), Coords(1, 0), Coords(2, 0), Coords(2, 1), Coords(2, 2), Coords(1, 2), Coords(0, 2), Coords(0, 1)})
+	{
+		square.addVertex(Coords(pt));
+	}
+	TEST_EQUAL(simplifyPolyline(square, SimplifyOptions(0.1, saVisvalingamWhyatt)), 4u);
+	TEST_EQUAL(square.mVertices.size(), 4u);
+	TEST_TRUE(square.mVertices[1].mPos == Coords(2, 0));
+	TEST_TRUE(square.mVertices[2].mPos == Coords(2, 2));
+	TEST_TRUE(square.mVertices[3].mPos == Coords(0, 2));
+
+	// A closed polyline never goes below 3 vertices:
+	auto smallSquare = square;
+	TEST_EQUAL(simplifyPolyline(smallSquare, SimplifyOptions(100, saVisvalingamWhyatt)), 1u);
+	TEST_EQUAL(smallSquare.mVertices.size(), 3u);
+
+	// The contour gets simplified:
+	auto contour = createContour(2000);
+	auto numRemoved = simplifyPolyline(*contour, SimplifyOptions(0.05, saVisvalingamWhyatt));
+	TEST_TRUE(numRemoved > 1000);
+	TEST_TRUE(contour->mVertices.size() > 2);
+}
+
+
+
+
+
+static void testSpecialPolylines()
+{
+	fmt::print("Testing the simplification of bulged and special polylines...\n");
+	using namespace Dxf;
+
+	for (auto algorithm: {saDouglasPeucker, saVisvalingamWhyatt})
+	{
+		// The endpoints of the bulged segment are kept, even though they're collinear with the rest:
+		LWPolyline bulged;
+		for (int i = 0; i <= 10; ++i)
+		{
+			bulged.addVertex({static_cast<Coord>(i), 0});
+		}
+		bulged.mVertices[5].mBulge = 1;
+		TEST_EQUAL(simplifyPolyline(bulged, SimplifyOptions(0.1, algorithm)), 7u);
+		TEST_EQUAL(bulged.mVertices.size(), 4u);
+		TEST_TRUE(bulged.mVertices[1].mPos == Coords(5, 0));
+		TEST_EQUAL(bulged.mVertices[1].mBulge, 1.0);
+		TEST_TRUE(bulged.mVertices[2].mPos == Coords(6, 0));
+
+		// Mesh polylines are not touched:
+		Polyline mesh;
+		mesh.mFlags = plfPolyfaceMesh;
+		for (int i = 0; i <= 10; ++i)
+		{
+			mesh.addVertex({static_cast<Coord>(i), 0});
+		}
+		TEST_EQUAL(simplifyPolyline(mesh, SimplifyOptions(0.1, algorithm)), 0u);
+		TEST_EQUAL(mesh.mVertices.size(), 11u);
+
+		// A thin closed sliver keeps its 3 most significant vertices, rather than collapsing or not being simplified:
+		LWPolyline sliver;
+		sliver.mFlags = plfClosedPolyline;
+		sliver.addVertex({0, 0});
+		sliver.addVertex({5, 0.001});
+		sliver.addVertex({10, 0});
+		sliver.addVertex({5, -0.001});
+		sliver.addVertex({0.5, 0});
+		TEST_EQUAL(simplifyPolyline(sliver, SimplifyOptions(0.1, algorithm)), 2u);
+		TEST_EQUAL(sliver.mVertices.size(), 3u);
+		auto hasVertex = [&sliver](const Coords & aPos)
+		{
+			return std::any_of(sliver.mVertices.begin(), sliver.mVertices.end(),
+				[&aPos](const Vertex & aVertex) { return (aVertex.mPos == aPos); }
+			);
+		};
+		TEST_TRUE(hasVertex(Coords(0, 0)));
+		TEST_TRUE(hasVertex(Coords(10, 0)));
+	}
+}
+
+
+
+
+
+static void testLayersAndDrawings()
+{
+	fmt::print("Testing the simplification of layers and drawings...\n");
+	using namespace Dxf;
+
+	Drawing drawing;
+	auto layer = drawing.addLayer("CONTOURS");
+	auto line = std::make_shared<Line>(Coords(0, 0), Coords(1, 1));
+	layer->addObject(line);
+	auto straight = std::make_shared<LWPolyline>();
+	straight->addVertex({0, 0});
+	straight->addVertex({1, 1});
+	layer->addObject(straight);
+	for (int i = 0; i < 50; ++i)
+	{
+		layer->addObject(createContour(500, static_cast<Coord>(i)));
+	}
+	auto bd = std::make_shared<BlockDefinition>("BLOCK");
+	bd->mObjects.push_back(createContour(500));
+	drawing.mBlockDefinitions["BLOCK"] = bd;
+
+	// Simplified copies share the unchanged objects and don't touch the originals:
+	const auto & objects = layer->objects();
+	size_t numRemovedSingle = 0, numRemovedParallel = 0;
+	auto copySingle = simplifiedObjects(objects, SimplifyOptions(0.01), &numRemovedSingle);
+	auto copyParallel = simplifiedObjects(objects, SimplifyOptions(0.01, saDouglasPeucker, 4), &numRemovedParallel);
+	TEST_EQUAL(numRemovedSingle, numRemovedParallel);
+	TEST_TRUE(numRemovedSingle > 0);
+	TEST_EQUAL(copySingle.size(), objects.size());
+	TEST_TRUE(copySingle[0] == line);
+	TEST_TRUE(copySingle[1] == straight);
+	for (size_t i = 2; i < objects.size(); ++i)
+	{
+		TEST_TRUE(copySingle[i] != objects[i]);
+		TEST_EQUAL(static_cast<const MultiVertex &>(*objects[i]).mVertices.size(), 500u);
+		TEST_EQUAL(
+			static_cast<const MultiVertex &>(*copySingle[i]).mVertices.size(),
+			static_cast<const MultiVertex &>(*copyParallel[i]).mVertices.size()
+		);
+	}
+
+	// In place, the whole layer and then the whole drawing:
+	TEST_EQUAL(simplifyLayer(*layer, SimplifyOptions(0.01, saDouglasPeucker, 0)), numRemovedSingle);
+	auto blockPolyline = std::static_pointer_cast<MultiVertex>(bd->mObjects[0]);
+	simplifyDrawing(drawing, SimplifyOptions(0.01, saDouglasPeucker, 4));
+	TEST_TRUE(blockPolyline->mVertices.size() < 500);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("SimplificationTest",
+	testDouglasPeucker();
+	testVisvalingamWhyatt();
+	testSpecialPolylines();
+	testLayersAndDrawings();
+)
@@ -0,0 +1,260 @@
+// SnapshotTest.cpp
+
+// Tests the Dxf::Snapshot writing and reading
+
+#include "Snapshot.hpp"
+#include "ContentHash.hpp"
+#include "DxfParser.hpp"
+#include "DxfWriter.hpp"
+#include <cstdio>
+#include <fstream>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Creates a drawing with at least one of each object type. */
+static std::shared_ptr<Dxf::Drawing> createDrawing()
+{
+	auto drawing = std::make_shared<Dxf::Drawing>();
+	auto layer1 = drawing->addLayer("LAYER_1");
+	auto layer2 = drawing->addLayer("LAYER_2");
+	drawing->addLayer("EMPTY");
+	layer1->setDefaultColor(3);
+	layer1->addObject(std::make_shared<Dxf::Point>(Dxf::Coords(3, 2)));
+	auto line = std::make_shared<Dxf::Line>(Dxf::Coords(1, 2), Dxf::Coords(3, 4.5, 1), 5);
+	line->mHandle = 0x2a;
+	line->mOwnerHandle = 0x1f;
+	layer1->addObject(line);
+	auto circle = std::make_shared<Dxf::Circle>(Dxf::Coords(5, 5), 1);
+	circle->mExtendedData = std::make_unique<Dxf::RawGroups>();
+	circle->mExtendedData->add(1001, "MYAPP");
+	circle->mExtendedData->add(1000, "ID-1234");
+	circle->mExtendedData->add(1040, "-0.25");
+	layer1->addObject(circle);
+	layer1->addObject(std::make_shared<Dxf::Arc>(Dxf::Coords(5, 5), 2, 0, 45));
+	auto text = std::make_shared<Dxf::Text>(Dxf::Coords(4, 1), "Test", 0.5, 30);
+	text->mAttribs.emplace_back("ATTR", "Value", 2);
+	text->mAttribs.emplace_back("LAYER_1", "Test", 1);
+	layer1->addObject(text);
+	auto polyline = std::make_shared<Dxf::Polyline>();
+	polyline->addVertex({2, 3, 1});
+	polyline->addVertex({3, 3, 2});
+	polyline->addVertex({3, 2, 3});
+	polyline->mFlags = Dxf::plf3DPolyline;
+	layer2->addObject(polyline);
+	auto lwPolyline = std::make_shared<Dxf::LWPolyline>(4, 0.25);
+	lwPolyline->addVertex({1, 3});
+	lwPolyline->addVertex({2, 3});
+	lwPolyline->addVertex({2, 2});
+	lwPolyline->mVertices[1].mBulge = 0.5;
+	lwPolyline->mFlags = Dxf::plfClosedPolyline;
+	layer2->addObject(lwPolyline);
+
+	// Blocks, including a nested one and an unregistered definition:
+	auto blockDef = std::make_shared<Dxf::BlockDefinition>("SYMBOL");
+	blockDef->mObjects.push_back(std::make_shared<Dxf::Line>(Dxf::Coords(0, 0), Dxf::Coords(1, 1)));
+	auto unregistered = std::make_shared<Dxf::BlockDefinition>("UNREGISTERED");
+	unregistered->mObjects.push_back(std::make_shared<Dxf::Circle>(Dxf::Coords(0, 0), 3));
+	blockDef->mObjects.push_back(std::make_shared<Dxf::Block>(Dxf::Coords(1, 1), std::move(unregistered), 0, 1));
+	drawing->addBlockDefinition("SYMBOL", blockDef);
+	layer2->addObject(std::make_shared<Dxf::Block>(Dxf::Coords(10, 10), std::move(blockDef), 90, 2));
+	layer2->addObject(std::make_shared<Dxf::Solid>(Dxf::Coords(0, 0), Dxf::Coords(1, 0), Dxf::Coords(0, 1)));
+	layer2->addObject(std::make_shared<Dxf::Solid>(Dxf::Coords(0, 0), Dxf::Coords(1, 0), Dxf::Coords(0, 1), Dxf::Coords(1, 1)));
+	layer2->addObject(std::make_shared<Dxf::AxisAligned2DEllipse>(Dxf::Coords(5, 5), 2, 1));
+	return drawing;
+}
+
+
+
+
+
+/** Returns the drawing serialized as text DXF, used for comparing drawings. */
+static std::string toDxf(const Dxf::Drawing & aDrawing)
+{
+	std::string res;
+	Dxf::Writer::write(aDrawing, Dxf::Writer::dataSinkToString(res));
+	return res;
+}
+
+
+
+
+
+/** Returns the snapshot of the specified drawing. */
+static std::string createSnapshot(const Dxf::Drawing & aDrawing, uint64_t aSourceHash)
+{
+	std::string res;
+	Dxf::Snapshot::write(aDrawing, aSourceHash, Dxf::Writer::dataSinkToString(res));
+	return res;
+}
+
+
+
+
+
+static void testRoundTrip()
+{
+	fmt::print("Testing snapshot round trip...\n");
+
+	auto drawing = createDrawing();
+	auto snapshot = createSnapshot(*drawing, 0x1234);
+	Dxf::Snapshot::View view(snapshot.data(), snapshot.size());
+	TEST_EQUAL(view.sourceHash(), 0x1234u);
+	TEST_EQUAL(view.dataSize(), snapshot.size());
+
+	// Direct access:
+	TEST_EQUAL(view.numLayers(), 3u);
+	TEST_EQUAL(view.layerName(1), "LAYER_2");
+	TEST_EQUAL(view.layerColor(0), 3);
+	TEST_EQUAL(view.layerEntities(0).mCount, 5u);
+	TEST_EQUAL(view.layerEntities(2).mCount, 0u);
+	TEST_EQUAL(view.entityHandle(1), 0x2au);
+	TEST_EQUAL(view.entityOwnerHandle(1), 0x1fu);
+	TEST_EQUAL(view.entityHandle(0), 0u);
+	TEST_EQUAL(view.numBlockDefinitions(), 2u);
+	TEST_EQUAL(view.blockDefinitionName(0), "SYMBOL");
+	TEST_EQUAL(view.blockDefinitionName(1), "UNREGISTERED");
+	auto layer2 = view.layerEntities(1);
+	TEST_EQUAL(view.entityType(layer2.mFirst), Dxf::otPolyline);
+	auto vertices = view.entityVertices(layer2.mFirst);
+	TEST_EQUAL(vertices.mCount, 3u);
+	TEST_EQUAL(view.vertexPos(vertices.mFirst + 2).mZ, 3);
+	TEST_EQUAL(view.entityColor(layer2.mFirst + 1), 4);
+	TEST_EQUAL(view.entityWidth(layer2.mFirst + 1), 0.25);
+	TEST_EQUAL(view.blockDefinitionIndex(layer2.mFirst + 2), 0u);
+	TEST_EQUAL(view.blockDefinitionIndex(layer2.mFirst), Dxf::Snapshot::NO_INDEX);
+	TEST_EQUAL(view.entityPos(layer2.mFirst + 2).mX, 10);
+	auto xdata = view.entityExtendedData(2);
+	TEST_EQUAL(xdata.mCount, 3u);
+	TEST_EQUAL(view.xDataGroupCode(xdata.mFirst), 1001);
+	TEST_EQUAL(view.xDataValue(xdata.mFirst + 1), "ID-1234");
+	TEST_EQUAL(view.xDataValue(xdata.mFirst + 2), "-0.25");
+	TEST_EQUAL(view.entityExtendedData(1).mCount, 0u);
+	TEST_THROWS(view.entityType(view.numEntities()), Dxf::Snapshot::Error);
+	TEST_THROWS(view.layerName(3), Dxf::Snapshot::Error);
+
+	// The materialized drawing must be the same:
+	auto restored = view.toDrawing();
+	TEST_EQUAL(toDxf(*restored), toDxf(*drawing));
+	TEST_EQUAL(restored->mBlockDefinitions.size(), 1u);
+	auto text = restored->layerByName("LAYER_1")->objects()[4];
+	TEST_EQUAL(text->mAttribs.size(), 2u);
+	TEST_EQUAL(text->mAttribs[0].mValue, "Value");
+	TEST_EQUAL(text->mAttribs[1].mName, "LAYER_1");
+	auto block = std::static_pointer_cast<Dxf::Block>(restored->layerByName("LAYER_2")->objects()[2]);
+	TEST_TRUE(block->mDefinition == restored->mBlockDefinitions["SYMBOL"]);
+	auto nested = std::static_pointer_cast<Dxf::Block>(block->mDefinition->mObjects[1]);
+	TEST_EQUAL(nested->mDefinition->mName, "UNREGISTERED");
+	const auto & restoredObjects = restored->layerByName("LAYER_1")->objects();
+	TEST_TRUE(restoredObjects[1]->mExtendedData == nullptr);
+	TEST_NOTNULL(restoredObjects[2]->mExtendedData);
+	const auto & restoredXData = *restoredObjects[2]->mExtendedData;
+	TEST_EQUAL(restoredXData.size(), 3u);
+	TEST_EQUAL(restoredXData.groupCode(0), 1001);
+	TEST_EQUAL(std::string(restoredXData.value(0)), "MYAPP");
+	TEST_EQUAL(restoredXData.groupCode(2), 1040);
+	TEST_EQUAL(std::string(restoredXData.value(2)), "-0.25");
+
+	// Snapshotting the restored drawing must produce the same data:
+	TEST_EQUAL(createSnapshot(*restored, 0x1234), snapshot);
+}
+
+
+
+
+
+static void testParsedFile()
+{
+	fmt::print("Testing snapshot of a parsed drawing, stored in a file...\n");
+
+	// Add unsupported entities, one before all the others and one after the first LAYER_2 entity:
+	auto source = createDrawing();
+	source->mRawEntityPositions.push_back({0, nullptr});
+	source->mRawEntities.add(0, "HATCH");
+	source->mRawEntities.add(8, "LAYER_1");
+	source->mRawEntities.add(2, "SOLID");
+	source->mRawEntityPositions.push_back({source->mRawEntities.size(), source->layerByName("LAYER_2")->objects()[0]});
+	source->mRawEntities.add(0, "HATCH");
+	source->mRawEntities.add(8, "LAYER_2");
+	source->mRawEntities.add(2, "ANSI31");
+
+	// Parse the DXF data, hashing the input at the same time:
+	auto dxf = toDxf(*source);
+	auto dxfHash = Dxf::contentHash(dxf.data(), dxf.size());
+	Dxf::ContentHasher hasher;
+	auto drawing = Dxf::Parser::parse(Dxf::Parser::hashingDataSource(Dxf::Parser::dataSourceFromString(std::move(dxf)), hasher));
+	TEST_EQUAL(hasher.digest(), dxfHash);
+	const char * fileName = "SnapshotTest.snapshot";
+	{
+		std::ofstream f(fileName, std::ios::binary);
+		Dxf::Snapshot::write(*drawing, hasher.digest(), Dxf::Writer::dataSinkFromStdStream(f));
+	}
+
+	auto view = Dxf::Snapshot::openFile(fileName);
+	TEST_EQUAL(view.sourceHash(), hasher.digest());
+	auto restored = view.toDrawing();
+	TEST_EQUAL(toDxf(*restored), toDxf(*drawing));
+	std::remove(fileName);
+
+	// The raw data is restored, including the raw entities' positions:
+	TEST_EQUAL(restored->mRawEntities.size(), drawing->mRawEntities.size());
+	TEST_EQUAL(std::string(restored->mRawEntities.value(2)), "SOLID");
+	TEST_EQUAL(restored->mRawSections.size(), drawing->mRawSections.size());
+	TEST_EQUAL(restored->mRawSections.at("TABLES").size(), drawing->mRawSections.at("TABLES").size());
+	const auto & positions = restored->mRawEntityPositions;
+	TEST_EQUAL(positions.size(), drawing->mRawEntityPositions.size());
+	TEST_TRUE(positions[0].mPrecedingEntity == nullptr);
+	TEST_EQUAL(positions[1].mFirstGroup, 3u);
+	TEST_TRUE(positions[1].mPrecedingEntity == restored->layerByName("LAYER_2")->objects()[0]);
+
+	// The raw entities following a removed entity are still written after all the others:
+	drawing->layerByName("LAYER_2")->removeObjByIndex(0);
+	auto snapshot = createSnapshot(*drawing, 0);
+	restored = Dxf::Snapshot::View(snapshot.data(), snapshot.size()).toDrawing();
+	TEST_EQUAL(toDxf(*restored), toDxf(*drawing));
+	TEST_EQUAL(restored->mRawEntityPositions.size(), drawing->mRawEntityPositions.size() - 1);
+
+	TEST_THROWS(Dxf::Snapshot::openFile("NonExistent.snapshot"), Dxf::Snapshot::Error);
+}
+
+
+
+
+
+static void testInvalid()
+{
+	fmt::print("Testing invalid snapshot data...\n");
+
+	auto snapshot = createSnapshot(*createDrawing(), 0);
+
+	// Truncated:
+	TEST_THROWS(Dxf::Snapshot::View(snapshot.data(), snapshot.size() - 8), Dxf::Snapshot::Error);
+	TEST_THROWS(Dxf::Snapshot::View(snapshot.data(), 10), Dxf::Snapshot::Error);
+
+	// Bad magic:
+	auto badMagic = snapshot;
+	badMagic[0] = 'X';
+	TEST_THROWS(Dxf::Snapshot::View(badMagic.data(), badMagic.size()), Dxf::Snapshot::Error);
+
+	// Different version:
+	auto badVersion = snapshot;
+	badVersion[8] = static_cast<char>(Dxf::Snapshot::FORMAT_VERSION + 1);
+	TEST_THROWS(Dxf::Snapshot::View(badVersion.data(), badVersion.size()), Dxf::Snapshot::Error);
+
+	// Damaged column offset:
+	auto badOffset = snapshot;
+	badOffset[sizeof(uint64_t) * 12 + 5] = 0x7f;
+	TEST_THROWS(Dxf::Snapshot::View(badOffset.data(), badOffset.size()), Dxf::Snapshot::Error);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("SnapshotTest",
+	testRoundTrip();
+	testParsedFile();
+	testInvalid();
+)
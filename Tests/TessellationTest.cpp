@@ -0,0 +1,247 @@
+// TessellationTest.cpp
+
+// Tests the tessellation of curves into line segments
+
+#include "Tessellation.hpp"
+#include <cmath>
+#include "TestHelpers.h"
+
+
+
+
+
+/** Returns true if the two values are within the specified tolerance. */
+static bool isNear(Dxf::Coord aValue1, Dxf::Coord aValue2, Dxf::Coord aTolerance = 1e-9)
+{
+	return (std::abs(aValue1 - aValue2) <= aTolerance);
+}
+
+
+
+
+
+/** Returns the point at the specified index of the flat coords. */
+static Dxf::Coords pointAt(const std::vector<Dxf::Coord> & aCoords, size_t aIndex)
+{
+	return Dxf::Coords(aCoords[3 * aIndex], aCoords[3 * aIndex + 1], aCoords[3 * aIndex + 2]);
+}
+
+
+
+
+
+static void testArcSegments()
+{
+	fmt::print("Testing the arc segment counts...\n");
+	using namespace Dxf;
+
+	TessellationOptions options;
+	options.mMode = tmFixedSegments;
+	options.mNumSegments = 64;
+	TEST_EQUAL(numArcSegments(1, 2 * Dxf::PI, options), 64u);
+	TEST_EQUAL(numArcSegments(1000, Dxf::PI / 2, options), 16u);
+	TEST_EQUAL(numArcSegments(1, 0, options), 1u);
+	options.mNumSegments = 1;
+	TEST_EQUAL(numArcSegments(1, 2 * Dxf::PI, options), 3u);  // Full turns have at least 3 segments
+
+	// The chord tolerance gives more segments to the larger radii, up to the maximum:
+	options.mMode = tmChordTolerance;
+	options.mChordTolerance = 0.01;
+	auto small = numArcSegments(1, 2 * Dxf::PI, options);
+	auto large = numArcSegments(100, 2 * Dxf::PI, options);
+	TEST_TRUE(small >= 3);
+	TEST_TRUE(large > small);
+	auto step = 2 * Dxf::PI / static_cast<Coord>(large);
+	TEST_TRUE(100 * (1 - std::cos(step / 2)) <= 0.01);
+	TEST_EQUAL(numArcSegments(1e9, 2 * Dxf::PI, options), 4096u);
+	options.mChordTolerance = 0;
+	TEST_EQUAL(numArcSegments(1, Dxf::PI, options), 4096u);
+}
+
+
+
+
+
+static void testCurves()
+{
+	fmt::print("Testing the tessellation of arcs, circles and ellipses...\n");
+	using namespace Dxf;
+
+	TessellationOptions options;
+	options.mMode = tmFixedSegments;
+	options.mNumSegments = 360;
+
+	// A quarter arc, with exact endpoints and all the points on the arc:
+	Arc arc(Coords(10, 20, 5), 2, 0, 90);
+	TEST_EQUAL(numTessellatedPoints(arc, options), 91u);
+	std::vector<Coord> coords(3 * 91);
+	TEST_TRUE(tessellate(arc, options, coords.data()) == coords.data() + coords.size());
+	TEST_TRUE(isNear(coords[0], 12) && isNear(coords[1], 20) && isNear(coords[2], 5));
+	TEST_TRUE(isNear(coords[3 * 90], 10) && isNear(coords[3 * 90 + 1], 22));
+	for (size_t i = 0; i < 91; ++i)
+	{
+		auto pt = pointAt(coords, i);
+		TEST_TRUE(isNear(std::hypot(pt.mX - 10, pt.mY - 20), 2));
+		TEST_TRUE(isNear(std::atan2(pt.mY - 20, pt.mX - 10), static_cast<Coord>(i) * Dxf::PI / 180));
+	}
+
+	// An arc crossing the zero angle goes counter-clockwise:
+	Arc crossing(Coords(0, 0), 1, 270, 90);
+	TEST_EQUAL(numTessellatedPoints(crossing, options), 181u);
+	coords.resize(3 * 181);
+	tessellate(crossing, options, coords.data());
+	TEST_TRUE(isNear(coords[0], 0) && isNear(coords[1], -1));
+	TEST_TRUE(isNear(coords[3 * 90], 1) && isNear(coords[3 * 90 + 1], 0));
+
+	// Circles and ellipses are closed exactly:
+	Circle circle(Coords(1, 1), 3);
+	TEST_EQUAL(numTessellatedPoints(circle, options), 361u);
+	coords.resize(3 * 361);
+	tessellate(circle, options, coords.data());
+	TEST_TRUE(pointAt(coords, 0) == pointAt(coords, 360));
+	TEST_TRUE(isNear(coords[3 * 90], 1) && isNear(coords[3 * 90 + 1], 4));
+
+	AxisAligned2DEllipse ellipse(Coords(0, 0), 4, 2);
+	TEST_EQUAL(numTessellatedPoints(ellipse, options), 361u);
+	tessellate(ellipse, options, coords.data());
+	TEST_TRUE(pointAt(coords, 0) == pointAt(coords, 360));
+	TEST_TRUE(isNear(coords[0], 4) && isNear(coords[3 * 90 + 1], 2) && isNear(coords[3 * 180], -4));
+
+	// A long recurrence stays accurate:
+	options.mNumSegments = 100000;
+	options.mMaxSegments = 100000;
+	coords.resize(3 * 100001);
+	tessellate(circle, options, coords.data());
+	for (size_t i = 0; i <= 100000; i += 997)
+	{
+		auto pt = pointAt(coords, i);
+		TEST_TRUE(isNear(std::hypot(pt.mX - 1, pt.mY - 1), 3, 1e-12));
+	}
+
+	// Non-curves:
+	TEST_EQUAL(numTessellatedPoints(Text(Coords(0, 0), "text", 1), options), 0u);
+	TEST_EQUAL(numTessellatedPoints(Line(Coords(0, 0), Coords(1, 1)), options), 2u);
+}
+
+
+
+
+
+static void testBulges()
+{
+	fmt::print("Testing the tessellation of bulged polylines...\n");
+	using namespace Dxf;
+
+	TessellationOptions options;
+	options.mMode = tmFixedSegments;
+	options.mNumSegments = 8;
+
+	// A straight segment, then a semicircle (bulge 1, counter-clockwise), then a straight segment:
+	LWPolyline polyline;
+	polyline.addVertex({-1, 0});
+	polyline.addVertex({0, 0});
+	polyline.mVertices.back().mBulge = 1;
+	polyline.addVertex({2, 0});
+	polyline.addVertex({3, 0});
+	TEST_EQUAL(numTessellatedPoints(polyline, options), 7u);  // 1 + 1 + 4 + 1
+	std::vector<Coord> coords(3 * 7);
+	tessellate(polyline, options, coords.data());
+	TEST_TRUE(pointAt(coords, 0) == Coords(-1, 0));
+	TEST_TRUE(pointAt(coords, 1) == Coords(0, 0));
+	TEST_TRUE(isNear(coords[3 * 3], 1) && isNear(coords[3 * 3 + 1], -1));  // The arc's middle, below the chord
+	TEST_TRUE(pointAt(coords, 5) == Coords(2, 0));
+	TEST_TRUE(pointAt(coords, 6) == Coords(3, 0));
+	for (size_t i = 1; i <= 5; ++i)
+	{
+		auto pt = pointAt(coords, i);
+		TEST_TRUE(isNear(std::hypot(pt.mX - 1, pt.mY), 1));
+	}
+
+	// A negative bulge goes clockwise, a closed polyline gets the closing segment:
+	polyline.mVertices[1].mBulge = -1;
+	polyline.mFlags = plfClosedPolyline;
+	TEST_EQUAL(numTessellatedPoints(polyline, options), 8u);
+	coords.resize(3 * 8);
+	tessellate(polyline, options, coords.data());
+	TEST_TRUE(isNear(coords[3 * 3], 1) && isNear(coords[3 * 3 + 1], 1));
+	TEST_TRUE(pointAt(coords, 7) == Coords(-1, 0));
+
+	// A quarter-circle bulge:
+	LWPolyline quarter;
+	quarter.addVertex({1, 0});
+	quarter.mVertices.back().mBulge = std::tan(Dxf::PI / 8);
+	quarter.addVertex({0, 1});
+	coords.resize(3 * numTessellatedPoints(quarter, options));
+	tessellate(quarter, options, coords.data());
+	TEST_EQUAL(coords.size(), 3u * 3u);
+	TEST_TRUE(isNear(coords[3], std::sqrt(0.5)) && isNear(coords[4], std::sqrt(0.5)));
+
+	// Meshes aren't tessellated:
+	Polyline mesh;
+	mesh.mFlags = plfPolyfaceMesh;
+	mesh.addVertex({0, 0});
+	mesh.addVertex({1, 0});
+	TEST_EQUAL(numTessellatedPoints(mesh, options), 0u);
+}
+
+
+
+
+
+static void testObjects()
+{
+	fmt::print("Testing the tessellation of object lists...\n");
+	using namespace Dxf;
+
+	PrimitivePtrs objects;
+	for (int i = 0; i < 1000; ++i)
+	{
+		auto pos = static_cast<Coord>(i);
+		objects.push_back(std::make_shared<Circle>(Coords(pos, 0), 1 + pos / 100));
+		objects.push_back(std::make_shared<Text>(Coords(pos, 0), "text", 1));
+		objects.push_back(std::make_shared<Arc>(Coords(pos, 10), 2, 45, 135));
+		auto polyline = std::make_shared<LWPolyline>();
+		polyline->addVertex({pos, 20});
+		polyline->mVertices.back().mBulge = 0.5;
+		polyline->addVertex({pos + 1, 20});
+		polyline->addVertex({pos + 1, 21});
+		objects.push_back(polyline);
+	}
+
+	TessellationOptions options;
+	auto single = tessellateObjects(objects, options);
+	TEST_EQUAL(single.numPaths(), 3000u);
+	TEST_EQUAL(single.mSourceIndices[0], 0u);
+	TEST_EQUAL(single.mSourceIndices[1], 2u);
+	TEST_EQUAL(single.mSourceIndices[2], 3u);
+	TEST_EQUAL(single.mPathStarts.back(), single.numPoints());
+
+	// The same as tessellating one by one, and the same in parallel:
+	TessellatedPaths oneByOne;
+	for (size_t i = 0; i < objects.size(); ++i)
+	{
+		tessellate(*objects[i], options, static_cast<uint32_t>(i), oneByOne);
+	}
+	TEST_TRUE(oneByOne.mCoords == single.mCoords);
+	TEST_TRUE(oneByOne.mPathStarts == single.mPathStarts);
+	TEST_TRUE(oneByOne.mSourceIndices == single.mSourceIndices);
+	options.mNumThreads = 4;
+	auto parallel = tessellateObjects(objects, options);
+	TEST_TRUE(parallel.mCoords == single.mCoords);
+	TEST_TRUE(parallel.mPathStarts == single.mPathStarts);
+
+	oneByOne.clear();
+	TEST_EQUAL(oneByOne.numPaths(), 0u);
+	TEST_EQUAL(oneByOne.numPoints(), 0u);
+}
+
+
+
+
+
+IMPLEMENT_TEST_MAIN("TessellationTest",
+	testArcSegments();
+	testCurves();
+	testBulges();
+	testObjects();
+)